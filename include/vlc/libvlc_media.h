@@ -139,6 +139,27 @@ typedef struct libvlc_media_stats_t
     float       f_send_bitrate;
 } libvlc_media_stats_t;
 
+/**
+ * Clock synchronisation statistics of a media.
+ *
+ * Durations are expressed in microseconds.
+ */
+typedef struct libvlc_media_clock_stats_t
+{
+    /* Input clock */
+    int64_t     i_clock_offset; /**< lateness of the last clock reference */
+    int64_t     i_clock_drift; /**< estimated drift of the stream clock */
+    int64_t     i_clock_jitter; /**< median reception jitter */
+
+    /* Audio output */
+    float       f_resample_ratio; /**< current resampling ratio */
+    int         i_late_abuffers; /**< buffers flushed because late */
+    int         i_early_abuffers; /**< buffers preceded by silence */
+
+    /* Video output */
+    int         i_late_pictures; /**< pictures dropped because late */
+} libvlc_media_clock_stats_t;
+
 typedef struct libvlc_media_track_info_t
 {
     /* Codec fourcc */
@@ -629,6 +650,19 @@ LIBVLC_API libvlc_state_t libvlc_media_get_state(
 LIBVLC_API int libvlc_media_get_stats( libvlc_media_t *p_md,
                                            libvlc_media_stats_t *p_stats );
 
+/**
+ * Get the current clock synchronisation statistics about the media
+ * \param p_md: media descriptor object
+ * \param p_stats: structure that contain the statistics about the media
+ *                 (this structure must be allocated by the caller)
+ * \return true if the statistics are available, false otherwise
+ *
+ * \libvlc_return_bool
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API int libvlc_media_get_clock_stats( libvlc_media_t *p_md,
+                                             libvlc_media_clock_stats_t *p_stats );
+
 /* The following method uses libvlc_media_list_t, however, media_list usage is optionnal
  * and this is here for convenience */
 #define VLC_FORWARD_DECLARE_OBJECT(a) struct a
@@ -0,0 +1,140 @@
+/*****************************************************************************
+ * libvlc_thumbnailer.h:  libvlc external API
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_LIBVLC_THUMBNAILER_H
+#define VLC_LIBVLC_THUMBNAILER_H 1
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/**
+ * @defgroup libvlc_thumbnailer LibVLC thumbnailer
+ * @ingroup libvlc
+ * LibVLC thumbnailer generates thumbnails of media without any audio or
+ * video output, running a bounded number of thumbnails in parallel
+ * @{
+ * @file
+ * LibVLC thumbnailer external API
+ */
+
+typedef struct libvlc_thumbnailer_t libvlc_thumbnailer_t;
+
+/**
+ * Thumbnail image formats
+ */
+typedef enum libvlc_thumbnail_format_t
+{
+    libvlc_thumbnail_png,
+    libvlc_thumbnail_jpg,
+} libvlc_thumbnail_format_t;
+
+/**
+ * Callback prototype for thumbnail completion
+ *
+ * It is called exactly once per queued request, from an unspecified thread.
+ *
+ * \param opaque the opaque pointer passed with the request
+ * \param p_md the media of the request
+ * \param p_data the encoded image (valid until the callback returns),
+ *               or NULL on error, timeout or cancellation
+ * \param i_size size of the encoded image in bytes
+ */
+typedef void (*libvlc_thumbnailer_cb)( void *opaque, libvlc_media_t *p_md,
+                                       const void *p_data, size_t i_size );
+
+/**
+ * Create a thumbnailer
+ *
+ * \version LibVLC 3.0.0 and later.
+ *
+ * \param p_instance libvlc instance
+ * \param i_jobs maximum number of concurrent thumbnails,
+ *               or 0 for the number of CPUs
+ * \param i_timeout maximum duration of each thumbnail in milliseconds,
+ *                  or -1 for no limit
+ * \return the thumbnailer, or NULL on error
+ */
+LIBVLC_API libvlc_thumbnailer_t *
+libvlc_thumbnailer_new( libvlc_instance_t *p_instance, unsigned i_jobs,
+                        libvlc_time_t i_timeout );
+
+/**
+ * Release a thumbnailer
+ *
+ * Running and queued requests are cancelled: their callbacks are called with
+ * no image before this function returns.
+ *
+ * \version LibVLC 3.0.0 and later.
+ *
+ * \param p_thumbnailer the thumbnailer to release
+ */
+LIBVLC_API void
+libvlc_thumbnailer_release( libvlc_thumbnailer_t *p_thumbnailer );
+
+/**
+ * Request a thumbnail at a given time
+ *
+ * The nearest random access picture before the requested time is used.
+ * If both dimensions are 0, the picture is not scaled. If only one of them
+ * is 0, it is deduced from the other one and the aspect ratio.
+ *
+ * \version LibVLC 3.0.0 and later.
+ *
+ * \param p_thumbnailer the thumbnailer
+ * \param p_md the media to thumbnail
+ * \param i_time time in milliseconds
+ * \param i_width thumbnail width in pixels
+ * \param i_height thumbnail height in pixels
+ * \param i_format image format
+ * \param cb completion callback
+ * \param opaque opaque pointer for the callback
+ * \return 0 on success, -1 on error (the callback will not be called)
+ */
+LIBVLC_API int
+libvlc_thumbnailer_request_by_time( libvlc_thumbnailer_t *p_thumbnailer,
+                                    libvlc_media_t *p_md,
+                                    libvlc_time_t i_time,
+                                    unsigned i_width, unsigned i_height,
+                                    libvlc_thumbnail_format_t i_format,
+                                    libvlc_thumbnailer_cb cb, void *opaque );
+
+/**
+ * Request a thumbnail at a given position
+ *
+ * \version LibVLC 3.0.0 and later.
+ *
+ * \param f_pos position between 0.0 and 1.0
+ * \see libvlc_thumbnailer_request_by_time
+ */
+LIBVLC_API int
+libvlc_thumbnailer_request_by_pos( libvlc_thumbnailer_t *p_thumbnailer,
+                                   libvlc_media_t *p_md, float f_pos,
+                                   unsigned i_width, unsigned i_height,
+                                   libvlc_thumbnail_format_t i_format,
+                                   libvlc_thumbnailer_cb cb, void *opaque );
+
+/** @} */
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
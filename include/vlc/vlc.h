@@ -45,6 +45,7 @@ extern "C" {
 #include <vlc/libvlc_media_list_player.h>
 #include <vlc/libvlc_media_library.h>
 #include <vlc/libvlc_media_discoverer.h>
+#include <vlc/libvlc_thumbnailer.h>
 #include <vlc/libvlc_events.h>
 #include <vlc/libvlc_dialog.h>
 #include <vlc/libvlc_vlm.h>
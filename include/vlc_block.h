@@ -288,6 +288,68 @@ VLC_API block_t *block_File(int fd, bool write) VLC_USED VLC_MALLOC;
  */
 VLC_API block_t *block_FilePath(const char *, bool write) VLC_USED VLC_MALLOC;
 
+/**
+ * Wraps a block in a shared block.
+ *
+ * Creates a reference-counted @ref block_t out of an existing block, so that
+ * its payload can be handed to several consumers with block_Share() without
+ * being copied. The original block is released once all the references to
+ * its payload are released.
+ *
+ * The payload of a shared block must be treated as read-only while it is
+ * shared, see block_IsShared(). block_TryRealloc() and block_Realloc() take
+ * care of that. Code writing into the payload in place must first call
+ * block_Unshare().
+ *
+ * If the block is already a shared block, it is returned as is.
+ *
+ * @param block block to wrap (the function takes ownership of it)
+ * @return NULL on error (the block is released in that case), or a valid
+ * block_t pointer.
+ */
+VLC_API block_t *block_shared_Alloc(block_t *block) VLC_USED VLC_MALLOC;
+
+/**
+ * Shares a block payload.
+ *
+ * Creates a new reference to the payload of a block created with
+ * block_shared_Alloc() or block_Share(). The new block has its own properties
+ * and payload boundaries. For any other block, this is the same as
+ * block_Duplicate().
+ *
+ * @return the new reference on success, NULL on error.
+ */
+VLC_API block_t *block_Share(block_t *) VLC_USED;
+
+/**
+ * Merges adjacent views of a shared payload.
+ *
+ * If all the blocks of the chain reference consecutive bytes of the same
+ * shared payload, the first block is extended to cover the whole chain, and
+ * the other blocks are released. The first block keeps its own properties,
+ * and its length is the sum of the lengths of the chain.
+ *
+ * @return the gathered block, or NULL if the chain cannot be merged
+ * without copying (the chain is left untouched in that case).
+ */
+VLC_API block_t *block_shared_Gather(block_t *) VLC_USED;
+
+/**
+ * Checks whether a block payload is shared with other blocks.
+ */
+VLC_API bool block_IsShared(const block_t *) VLC_USED;
+
+/**
+ * Makes a block writeable.
+ *
+ * If the block payload is shared, it is copied into a new block, and the
+ * block is released. Otherwise the block is returned as is.
+ *
+ * @return a block with a writeable payload, or NULL on error (the block is
+ * released in that case).
+ */
+VLC_API block_t *block_Unshare(block_t *) VLC_USED;
+
 static inline void block_Cleanup (void *block)
 {
     block_Release ((block_t *)block);
@@ -396,6 +458,10 @@ static inline block_t *block_ChainGather( block_t *p_list )
     if( p_list->p_next == NULL )
         return p_list;  /* Already gathered */
 
+    g = block_shared_Gather( p_list );
+    if( g != NULL )
+        return g; /* Contiguous views of the same payload */
+
     block_ChainProperties( p_list, NULL, &i_total, &i_length );
 
     g = block_Alloc( i_total );
@@ -44,6 +44,7 @@ VLC_API unsigned vlc_CPU(void);
 #  define VLC_CPU_AVX2   0x00004000
 #  define VLC_CPU_XOP    0x00008000
 #  define VLC_CPU_FMA4   0x00010000
+#  define VLC_CPU_PCLMUL 0x00020000
 
 # if defined (__MMX__)
 #  define vlc_CPU_MMX() (1)
@@ -129,6 +130,12 @@ VLC_API unsigned vlc_CPU(void);
 #  define vlc_CPU_FMA4() ((vlc_CPU() & VLC_CPU_FMA4) != 0)
 # endif
 
+# ifdef __PCLMUL__
+#  define vlc_CPU_PCLMUL() (1)
+# else
+#  define vlc_CPU_PCLMUL() ((vlc_CPU() & VLC_CPU_PCLMUL) != 0)
+# endif
+
 # elif defined (__ppc__) || defined (__ppc64__) || defined (__powerpc__)
 #  define HAVE_FPU 1
 #  define VLC_CPU_ALTIVEC 2
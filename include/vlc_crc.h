@@ -0,0 +1,54 @@
+/*****************************************************************************
+ * vlc_crc.h: cyclic redundancy checks
+ *****************************************************************************
+ * Copyright © 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_CRC_H
+# define VLC_CRC_H
+
+/**
+ * \file
+ * This file defines functions to compute cyclic redundancy checks
+ *
+ * All of them process the bits most significant first, without reflection
+ * nor final inversion. The CRC of a buffer split in several parts is
+ * computed by passing the CRC of each part to the computation of the next
+ * one, starting with the initial value of the standard in use.
+ */
+
+/**
+ * Computes a CRC-8 with polynomial x^8 + x^2 + x + 1, as in FLAC frame
+ * headers (initial value 0).
+ */
+VLC_API uint8_t vlc_crc8( uint8_t crc, const void *buf, size_t len ) VLC_USED;
+
+/**
+ * Computes a CRC-16 with polynomial x^16 + x^15 + x^2 + 1, as in FLAC
+ * frames (initial value 0).
+ */
+VLC_API uint16_t vlc_crc16( uint16_t crc, const void *buf, size_t len ) VLC_USED;
+
+/**
+ * Computes a CRC-32 with polynomial 0x04C11DB7, as in MPEG-2 sections
+ * (initial value 0xFFFFFFFF).
+ *
+ * \note This is not the bit reflected CRC-32 of zlib, Ethernet or PNG.
+ */
+VLC_API uint32_t vlc_crc32_mpeg( uint32_t crc, const void *buf, size_t len ) VLC_USED;
+
+#endif
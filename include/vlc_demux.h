@@ -288,6 +288,17 @@ enum demux_query_e
      * arg1= bool */
     DEMUX_SET_RECORD_STATE,
 
+    /**
+     * Sets whether only the random access pictures of video tracks are
+     * delivered (true), for trick play at high rates, or every packet (false).
+     * Other tracks are not affected. The demuxer starts in the latter mode.
+     *
+     * The control is only used when the input core paces the demuxer.
+     * Can fail.
+     *
+     * arg1= bool */
+    DEMUX_SET_KEYFRAMES_ONLY,
+
     /* II. Specific access_demux queries */
 
     /* DEMUX_CAN_CONTROL_RATE is called only if DEMUX_CAN_CONTROL_PACE has
@@ -81,6 +81,13 @@ struct fingerprinter_thread_t
 };
 typedef struct fingerprinter_thread_t fingerprinter_thread_t;
 
+/* Throughput counters, as integer variables of the fingerprinter object:
+ * "fingerprints": processed requests,
+ * "fingerprint-cache-hits": requests served without decoding,
+ * "fingerprint-audio-time": decoded audio duration (in microseconds),
+ * "fingerprint-decode-time": decoding time summed over jobs (in microseconds)
+ */
+
 VLC_API fingerprinter_thread_t *fingerprinter_Create( vlc_object_t *p_this );
 VLC_API void fingerprinter_Destroy( fingerprinter_thread_t *p_fingerprint );
 
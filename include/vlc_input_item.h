@@ -351,7 +351,11 @@ typedef enum input_item_meta_request_option_t
     META_REQUEST_OPTION_SCOPE_LOCAL   = 0x01,
     META_REQUEST_OPTION_SCOPE_NETWORK = 0x02,
     META_REQUEST_OPTION_SCOPE_ANY     = 0x03,
-    META_REQUEST_OPTION_DO_INTERACT   = 0x04
+    META_REQUEST_OPTION_DO_INTERACT   = 0x04,
+    /* Processed before other requests, e.g. for visible or selected items */
+    META_REQUEST_OPTION_PRIORITY_HIGH = 0x08,
+    /* Processed after other requests, e.g. for bulk additions */
+    META_REQUEST_OPTION_PRIORITY_LOW  = 0x10,
 } input_item_meta_request_option_t;
 
 /* status of the vlc_InputItemPreparseEnded event */
@@ -407,6 +411,14 @@ struct input_stats_t
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+    int64_t i_late_abuffers;
+    int64_t i_early_abuffers;
+    float f_resample_ratio;
+
+    /* Clock */
+    mtime_t i_clock_offset;
+    mtime_t i_clock_drift;
+    mtime_t i_clock_jitter;
 };
 
 #endif
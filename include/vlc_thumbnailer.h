@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * vlc_thumbnailer.h: headless thumbnail generation
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_THUMBNAILER_H
+#define VLC_THUMBNAILER_H 1
+
+#include <vlc_input_item.h>
+
+/**
+ * @defgroup thumbnailer Thumbnailer
+ * @ingroup input
+ * Headless thumbnail generation
+ *
+ * The thumbnailer opens inputs without any audio or video output, seeks to a
+ * random access picture near the requested time or position, decodes a
+ * single picture and encodes it as an image. Requests are processed by a
+ * bounded number of concurrent jobs.
+ * @{
+ * @file
+ * Thumbnailer interface
+ */
+
+typedef struct vlc_thumbnailer_t vlc_thumbnailer_t;
+
+/**
+ * Thumbnail completion callback
+ *
+ * It is called exactly once per queued request, from an unspecified thread.
+ *
+ * \param data the opaque pointer passed with the request
+ * \param thumbnail the encoded picture, to be released with block_Release(),
+ *                  or NULL on error, timeout or cancellation
+ */
+typedef void (*vlc_thumbnailer_cb)( void *data, block_t *thumbnail );
+
+/**
+ * Creates a thumbnailer.
+ *
+ * \param parent parent object
+ * \param jobs maximum number of concurrent thumbnails (0 for the CPU count)
+ * \param timeout maximum duration of a thumbnail in milliseconds, or a
+ *                negative value for no limit
+ * \return a thumbnailer or NULL on error
+ */
+VLC_API vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t *parent,
+                                                   unsigned jobs,
+                                                   int timeout ) VLC_USED;
+#define vlc_thumbnailer_Create(a, b, c) \
+        vlc_thumbnailer_Create(VLC_OBJECT(a), b, c)
+
+/**
+ * Queues a thumbnail of an input item at a given time.
+ *
+ * If both the width and height are zero, the picture is not scaled. If only
+ * one of them is zero, it is deduced from the other one and the picture
+ * aspect ratio.
+ *
+ * \param time time within the input (the nearest preceding random access
+ *             picture is used)
+ * \param codec image codec (e.g. VLC_CODEC_PNG or VLC_CODEC_JPEG)
+ * \return VLC_SUCCESS, or an error code if the callback will not be called
+ */
+VLC_API int vlc_thumbnailer_RequestByTime( vlc_thumbnailer_t *,
+                                           input_item_t *, mtime_t time,
+                                           vlc_fourcc_t codec,
+                                           unsigned width, unsigned height,
+                                           vlc_thumbnailer_cb, void *data );
+
+/**
+ * Queues a thumbnail of an input item at a given position.
+ *
+ * \param pos position within the input, between 0 and 1
+ * \see vlc_thumbnailer_RequestByTime
+ */
+VLC_API int vlc_thumbnailer_RequestByPos( vlc_thumbnailer_t *,
+                                          input_item_t *, float pos,
+                                          vlc_fourcc_t codec,
+                                          unsigned width, unsigned height,
+                                          vlc_thumbnailer_cb, void *data );
+
+/**
+ * Destroys a thumbnailer.
+ *
+ * Running thumbnails are interrupted and queued ones are cancelled: their
+ * callbacks are called with a NULL picture before this function returns.
+ */
+VLC_API void vlc_thumbnailer_Release( vlc_thumbnailer_t * );
+
+/** @} */
+#endif
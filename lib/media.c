@@ -727,6 +727,27 @@ int libvlc_media_get_stats( libvlc_media_t *p_md,
     return true;
 }
 
+int libvlc_media_get_clock_stats( libvlc_media_t *p_md,
+                                  libvlc_media_clock_stats_t *p_stats )
+{
+    if( !p_md->p_input_item )
+        return false;
+
+    input_stats_t *p_itm_stats = p_md->p_input_item->p_stats;
+    vlc_mutex_lock( &p_itm_stats->lock );
+    p_stats->i_clock_offset = p_itm_stats->i_clock_offset;
+    p_stats->i_clock_drift = p_itm_stats->i_clock_drift;
+    p_stats->i_clock_jitter = p_itm_stats->i_clock_jitter;
+
+    p_stats->f_resample_ratio = p_itm_stats->f_resample_ratio;
+    p_stats->i_late_abuffers = p_itm_stats->i_late_abuffers;
+    p_stats->i_early_abuffers = p_itm_stats->i_early_abuffers;
+
+    p_stats->i_late_pictures = p_itm_stats->i_lost_pictures;
+    vlc_mutex_unlock( &p_itm_stats->lock );
+    return true;
+}
+
 /**************************************************************************
  * event_manager
  **************************************************************************/
@@ -0,0 +1,174 @@
+/*****************************************************************************
+ * thumbnailer.c: libvlc thumbnailer API
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc/libvlc.h>
+#include <vlc/libvlc_media.h>
+#include <vlc/libvlc_thumbnailer.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_thumbnailer.h>
+
+#include "libvlc_internal.h"
+#include "media_internal.h"
+
+struct libvlc_thumbnailer_t
+{
+    libvlc_instance_t *p_instance;
+    vlc_thumbnailer_t *p_thumbnailer;
+};
+
+struct libvlc_thumbnail_request
+{
+    libvlc_media_t *p_md;
+    libvlc_thumbnailer_cb cb;
+    void *opaque;
+};
+
+libvlc_thumbnailer_t *
+libvlc_thumbnailer_new( libvlc_instance_t *p_instance, unsigned i_jobs,
+                        libvlc_time_t i_timeout )
+{
+    libvlc_thumbnailer_t *p_lt = malloc( sizeof(*p_lt) );
+
+    if( unlikely(p_lt == NULL) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return NULL;
+    }
+
+    p_lt->p_thumbnailer = vlc_thumbnailer_Create( p_instance->p_libvlc_int,
+                                                  i_jobs, i_timeout );
+    if( unlikely(p_lt->p_thumbnailer == NULL) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        free( p_lt );
+        return NULL;
+    }
+
+    p_lt->p_instance = p_instance;
+    libvlc_retain( p_instance );
+    return p_lt;
+}
+
+void
+libvlc_thumbnailer_release( libvlc_thumbnailer_t *p_lt )
+{
+    vlc_thumbnailer_Release( p_lt->p_thumbnailer );
+    libvlc_release( p_lt->p_instance );
+    free( p_lt );
+}
+
+static void thumbnail_done( void *data, block_t *p_image )
+{
+    struct libvlc_thumbnail_request *p_req = data;
+
+    if( p_image != NULL )
+    {
+        p_req->cb( p_req->opaque, p_req->p_md,
+                   p_image->p_buffer, p_image->i_buffer );
+        block_Release( p_image );
+    }
+    else
+        p_req->cb( p_req->opaque, p_req->p_md, NULL, 0 );
+
+    libvlc_media_release( p_req->p_md );
+    free( p_req );
+}
+
+static int thumbnail_request( libvlc_thumbnailer_t *p_lt,
+                              libvlc_media_t *p_md, bool b_by_pos,
+                              libvlc_time_t i_time, float f_pos,
+                              unsigned i_width, unsigned i_height,
+                              libvlc_thumbnail_format_t i_format,
+                              libvlc_thumbnailer_cb cb, void *opaque )
+{
+    vlc_fourcc_t i_codec;
+
+    switch( i_format )
+    {
+        case libvlc_thumbnail_png:
+            i_codec = VLC_CODEC_PNG;
+            break;
+        case libvlc_thumbnail_jpg:
+            i_codec = VLC_CODEC_JPEG;
+            break;
+        default:
+            libvlc_printerr( "Unknown thumbnail format" );
+            return -1;
+    }
+
+    struct libvlc_thumbnail_request *p_req = malloc( sizeof(*p_req) );
+    if( unlikely(p_req == NULL) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return -1;
+    }
+    p_req->p_md = p_md;
+    p_req->cb = cb;
+    p_req->opaque = opaque;
+    libvlc_media_retain( p_md );
+
+    int i_ret = b_by_pos
+        ? vlc_thumbnailer_RequestByPos( p_lt->p_thumbnailer,
+                                        p_md->p_input_item, f_pos, i_codec,
+                                        i_width, i_height,
+                                        thumbnail_done, p_req )
+        : vlc_thumbnailer_RequestByTime( p_lt->p_thumbnailer,
+                                         p_md->p_input_item,
+                                         to_mtime( i_time ), i_codec,
+                                         i_width, i_height,
+                                         thumbnail_done, p_req );
+    if( i_ret != VLC_SUCCESS )
+    {
+        libvlc_printerr( "Cannot queue the thumbnail" );
+        libvlc_media_release( p_md );
+        free( p_req );
+        return -1;
+    }
+    return 0;
+}
+
+int
+libvlc_thumbnailer_request_by_time( libvlc_thumbnailer_t *p_lt,
+                                    libvlc_media_t *p_md,
+                                    libvlc_time_t i_time,
+                                    unsigned i_width, unsigned i_height,
+                                    libvlc_thumbnail_format_t i_format,
+                                    libvlc_thumbnailer_cb cb, void *opaque )
+{
+    return thumbnail_request( p_lt, p_md, false, i_time, 0.f,
+                              i_width, i_height, i_format, cb, opaque );
+}
+
+int
+libvlc_thumbnailer_request_by_pos( libvlc_thumbnailer_t *p_lt,
+                                   libvlc_media_t *p_md, float f_pos,
+                                   unsigned i_width, unsigned i_height,
+                                   libvlc_thumbnail_format_t i_format,
+                                   libvlc_thumbnailer_cb cb, void *opaque )
+{
+    return thumbnail_request( p_lt, p_md, true, 0, f_pos,
+                              i_width, i_height, i_format, cb, opaque );
+}
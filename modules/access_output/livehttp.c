@@ -981,6 +981,11 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
                 memcpy(p_sys->stuffing_bytes, &output->p_buffer[output->i_buffer], p_sys->stuffing_size);
             }
 
+            /* Encryption is done in place */
+            output = block_Unshare( output );
+            if( unlikely(!output ) )
+                return VLC_ENOMEM;
+
             gcry_error_t err = gcry_cipher_encrypt( p_sys->aes_ctx,
                                 output->p_buffer, output->i_buffer, NULL, 0 );
             if( err )
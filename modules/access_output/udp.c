@@ -46,10 +46,16 @@
 #else
 #   include <sys/socket.h>
 #endif
+#ifdef HAVE_SENDMMSG
+#   include <netinet/in.h>
+#   include <netinet/udp.h>
+#endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
+/* Maximum number of packets handed to the kernel in one system call */
+#define MAX_BATCH_BLOCKS 32
 
 /*****************************************************************************
  * Module descriptor
@@ -71,6 +77,12 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_("Packets that are due at the same time are " \
+                        "handed to the kernel as a single buffer and " \
+                        "split into datagrams by the network stack " \
+                        "(UDP GSO), where the operating system supports it." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +91,7 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_bool( SOUT_CFG_PREFIX "gso", true, GSO_TEXT, GSO_LONGTEXT, true )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +105,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "gso",
     NULL
 };
 
@@ -116,6 +130,7 @@ struct sout_access_out_sys_t
     int           i_handle;
     bool          b_mtu_warning;
     size_t        i_mtu;
+    bool          b_gso;
 
     block_fifo_t *p_fifo;
     block_fifo_t *p_empty_blocks;
@@ -210,6 +225,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
+    p_sys->b_gso = var_GetBool( p_access, SOUT_CFG_PREFIX "gso" );
     p_sys->p_fifo = block_FifoNew();
     p_sys->p_empty_blocks = block_FifoNew();
     p_sys->p_buffer = NULL;
@@ -392,6 +408,134 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/*****************************************************************************
+ * SendBatch: send a batch of packets that are due at the same time
+ *****************************************************************************/
+#if defined(HAVE_SENDMMSG) && defined(UDP_SEGMENT)
+static int SendSegmented( sout_access_out_t *p_access,
+                          block_t *const *pp_blocks, unsigned i_count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    struct iovec iov[MAX_BATCH_BLOCKS];
+    size_t i_total = 0;
+    const size_t i_segment = pp_blocks[0]->i_buffer;
+
+    /* All datagrams but the last one must have the segment size */
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        if( pp_blocks[i]->i_buffer > i_segment
+         || (pp_blocks[i]->i_buffer < i_segment && i + 1 < i_count) )
+            return -1;
+
+        iov[i].iov_base = pp_blocks[i]->p_buffer;
+        iov[i].iov_len = pp_blocks[i]->i_buffer;
+        i_total += pp_blocks[i]->i_buffer;
+    }
+
+    if( i_segment == 0 || i_total > 65000 )
+        return -1;
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = i_count,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    uint16_t i_gso_size = i_segment;
+
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof (i_gso_size));
+    memcpy( CMSG_DATA(cmsg), &i_gso_size, sizeof (i_gso_size) );
+
+    if( sendmsg( p_sys->i_handle, &msg, 0 ) == -1 )
+    {
+        if( errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP
+         || errno == EIO )
+        {
+            msg_Dbg( p_access, "segmentation offload not available: %s",
+                     vlc_strerror_c(errno) );
+            p_sys->b_gso = false;
+            return -1;
+        }
+        msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+
+        /* None of the datagrams was sent: send them one by one */
+        for( unsigned i = 0; i < i_count; i++ )
+            if( send( p_sys->i_handle, pp_blocks[i]->p_buffer,
+                      pp_blocks[i]->i_buffer, 0 ) == -1 )
+                msg_Warn( p_access, "send error: %s",
+                          vlc_strerror_c(errno) );
+    }
+    return 0;
+}
+#endif
+
+static void SendBatch( sout_access_out_t *p_access,
+                       block_t *const *pp_blocks, unsigned i_count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+#ifdef HAVE_SENDMMSG
+# ifdef UDP_SEGMENT
+    if( p_sys->b_gso && i_count > 1
+     && SendSegmented( p_access, pp_blocks, i_count ) == 0 )
+        return;
+# endif
+    struct mmsghdr msgs[MAX_BATCH_BLOCKS];
+    struct iovec iov[MAX_BATCH_BLOCKS];
+
+    memset( msgs, 0, i_count * sizeof (*msgs) );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        iov[i].iov_base = pp_blocks[i]->p_buffer;
+        iov[i].iov_len = pp_blocks[i]->i_buffer;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for( unsigned i_sent = 0; i_sent < i_count; )
+    {
+        int val = sendmmsg( p_sys->i_handle, msgs + i_sent,
+                            i_count - i_sent, 0 );
+        if( val == -1 )
+        {   /* Skip the datagram that failed */
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            val = 1;
+        }
+        i_sent += val;
+    }
+#else
+    for( unsigned i = 0; i < i_count; i++ )
+        if( send( p_sys->i_handle, pp_blocks[i]->p_buffer,
+                  pp_blocks[i]->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+#endif
+}
+
+typedef struct
+{
+    block_t *p_blocks[MAX_BATCH_BLOCKS];
+    unsigned i_count;
+    block_t *p_pending; /* dequeued but not part of the batch */
+} udp_batch_t;
+
+static void BatchCleanup( void *data )
+{
+    udp_batch_t *p_batch = data;
+
+    for( unsigned i = 0; i < p_batch->i_count; i++ )
+        block_Release( p_batch->p_blocks[i] );
+    if( p_batch->p_pending != NULL )
+        block_Release( p_batch->p_pending );
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -404,12 +548,17 @@ static void* ThreadWrite( void *data )
                                              SOUT_CFG_PREFIX "group" );
     mtime_t i_to_send = i_group;
     unsigned i_dropped_packets = 0;
+    udp_batch_t batch = { .i_count = 0, .p_pending = NULL };
 
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
+        block_t *p_pk = batch.p_pending;
         mtime_t       i_date, i_sent;
 
+        if( p_pk == NULL )
+            p_pk = block_FifoGet( p_sys->p_fifo );
+        batch.p_pending = NULL;
+
         i_date = p_sys->i_caching + p_pk->i_dts;
         if( i_date_last > 0 )
         {
@@ -440,8 +589,38 @@ static void* ThreadWrite( void *data )
             mwait( i_date );
             i_to_send = i_group;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+        vlc_cleanup_pop();
+
+        batch.p_blocks[0] = p_pk;
+        batch.i_count = 1;
+        i_date_last = i_date;
+
+        /* Pick up the packets already queued that would not have to wait
+         * any longer, so that they all go out in a single system call. */
+        vlc_fifo_Lock( p_sys->p_fifo );
+        while( batch.i_count < MAX_BATCH_BLOCKS
+            && !vlc_fifo_IsEmpty( p_sys->p_fifo ) )
+        {
+            block_t *p_more = vlc_fifo_DequeueUnlocked( p_sys->p_fifo );
+            mtime_t i_more = p_sys->i_caching + p_more->i_dts;
+            bool b_wait = i_to_send == 1
+                       || (p_more->i_flags & BLOCK_FLAG_CLOCK);
+
+            if( (b_wait && i_more > i_date)
+             || i_more - i_date_last > 2000000 )
+            {
+                batch.p_pending = p_more;
+                break;
+            }
+
+            i_to_send = b_wait ? i_group : i_to_send - 1;
+            batch.p_blocks[batch.i_count++] = p_more;
+            i_date_last = i_more;
+        }
+        vlc_fifo_Unlock( p_sys->p_fifo );
+
+        vlc_cleanup_push( BatchCleanup, &batch );
+        SendBatch( p_access, batch.p_blocks, batch.i_count );
         vlc_cleanup_pop();
 
         if( i_dropped_packets )
@@ -459,9 +638,8 @@ static void* ThreadWrite( void *data )
         }
 #endif
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
-
-        i_date_last = i_date;
+        for( unsigned i = 0; i < batch.i_count; i++ )
+            block_FifoPut( p_sys->p_empty_blocks, batch.p_blocks[i] );
     }
     return NULL;
 }
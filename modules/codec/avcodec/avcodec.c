@@ -132,6 +132,9 @@ vlc_module_begin ()
 #if defined(FF_THREAD_FRAME)
     add_obsolete_integer( "ffmpeg-threads" ) /* removed since 2.1.0 */
     add_integer( "avcodec-threads", 0, THREADS_TEXT, THREADS_LONGTEXT, true );
+    add_integer( "avcodec-threads-budget", 0, THREADS_BUDGET_TEXT,
+                 THREADS_BUDGET_LONGTEXT, true )
+        change_integer_range( 0, 256 )
 #endif
     add_string( "avcodec-options", NULL, AV_OPTIONS_TEXT, AV_OPTIONS_LONGTEXT, true )
 
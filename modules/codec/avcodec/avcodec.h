@@ -114,7 +114,13 @@ int ffmpeg_OpenCodec( decoder_t *p_dec, AVCodecContext *, const AVCodec * );
 #define HW_LONGTEXT N_("This allows hardware decoding when available.")
 
 #define THREADS_TEXT N_( "Threads" )
-#define THREADS_LONGTEXT N_( "Number of threads used for decoding, 0 meaning auto" )
+#define THREADS_LONGTEXT N_( "Number of threads used for decoding, 0 meaning " \
+    "a share of the decoding threads budget" )
+
+#define THREADS_BUDGET_TEXT N_( "Decoding threads budget" )
+#define THREADS_BUDGET_LONGTEXT N_( "Number of threads shared by all the " \
+    "video decoders with automatic threads, in proportion to their " \
+    "resolution and frame rate, 0 meaning the number of CPUs plus one" )
 
 /*
  * Encoder options
@@ -0,0 +1,152 @@
+/*****************************************************************************
+ * budget.c: process-wide budget of libavcodec decoding threads
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "budget.h"
+
+struct lavc_threads
+{
+    struct lavc_threads *next;
+    vlc_object_t *obj;
+    uint64_t load; /* decoded pixels per second */
+    unsigned max;
+    unsigned budget; /* budget requested by the decoder */
+    unsigned count;
+};
+
+static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+static struct lavc_threads *list = NULL;
+
+/**
+ * Shares the budget between the registered decoders.
+ *
+ * The budget is the smallest one requested by the registered decoders. Each
+ * decoder gets one thread, then the remaining threads go one by one to the
+ * decoder with the highest load per thread, up to its maximum. If there are
+ * more decoders than threads in the budget, each still gets one thread.
+ */
+static void lavc_ThreadsAssign( void )
+{
+    unsigned budget = UINT_MAX;
+
+    for( struct lavc_threads *t = list; t != NULL; t = t->next )
+        budget = __MIN( budget, t->budget );
+
+    unsigned left = budget;
+
+    for( struct lavc_threads *t = list; t != NULL; t = t->next )
+    {
+        t->count = 1;
+        if( left > 0 )
+            left--;
+    }
+
+    while( left > 0 )
+    {
+        struct lavc_threads *best = NULL;
+
+        for( struct lavc_threads *t = list; t != NULL; t = t->next )
+            if( t->count < t->max
+             && (best == NULL || t->load * best->count > best->load * t->count) )
+                best = t;
+        if( best == NULL )
+            break;
+        best->count++;
+        left--;
+    }
+
+    for( struct lavc_threads *t = list; t != NULL; t = t->next )
+        msg_Dbg( t->obj, "%u of %u decoding thread(s) assigned", t->count,
+                 budget );
+}
+
+lavc_threads_t *lavc_ThreadsNew( vlc_object_t *obj, uint64_t load,
+                                 unsigned max )
+{
+    lavc_threads_t *t = malloc( sizeof (*t) );
+    if( unlikely(t == NULL) )
+        return NULL;
+
+    int64_t total = var_InheritInteger( obj, "avcodec-threads-budget" );
+    if( total <= 0 )
+    {
+        total = vlc_GetCPUCount();
+        if( total > 1 )
+            total++;
+    }
+
+    t->obj = obj;
+    t->load = load;
+    t->max = max ? max : 1;
+    t->budget = __MIN( total, UINT_MAX );
+
+    vlc_mutex_lock( &lock );
+    t->next = list;
+    list = t;
+    lavc_ThreadsAssign();
+    vlc_mutex_unlock( &lock );
+    return t;
+}
+
+void lavc_ThreadsDelete( lavc_threads_t *t )
+{
+    vlc_mutex_lock( &lock );
+    for( struct lavc_threads **pp = &list; *pp != NULL; pp = &(*pp)->next )
+        if( *pp == t )
+        {
+            *pp = t->next;
+            break;
+        }
+    lavc_ThreadsAssign();
+    vlc_mutex_unlock( &lock );
+    free( t );
+}
+
+void lavc_ThreadsSetLoad( lavc_threads_t *t, uint64_t load, unsigned max )
+{
+    if( max == 0 )
+        max = 1;
+
+    vlc_mutex_lock( &lock );
+    if( t->load != load || t->max != max )
+    {
+        t->load = load;
+        t->max = max;
+        lavc_ThreadsAssign();
+    }
+    vlc_mutex_unlock( &lock );
+}
+
+unsigned lavc_ThreadsGet( lavc_threads_t *t )
+{
+    vlc_mutex_lock( &lock );
+    unsigned count = t->count;
+    vlc_mutex_unlock( &lock );
+    return count;
+}
@@ -0,0 +1,56 @@
+/*****************************************************************************
+ * budget.h: process-wide budget of libavcodec decoding threads
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AVCODEC_BUDGET_H
+#define VLC_AVCODEC_BUDGET_H 1
+
+/**
+ * Share of the decoding threads budget (--avcodec-threads-budget) held by a
+ * decoder.
+ *
+ * The budget is shared by all the decoders of the process in proportion to
+ * their load, within the smallest budget requested by any of them. The
+ * shares are assigned again whenever a decoder is added, removed or changes
+ * its load.
+ */
+typedef struct lavc_threads lavc_threads_t;
+
+/**
+ * Adds a decoder to the budget.
+ *
+ * \param load decoded pixels per second
+ * \param max maximum useful number of threads
+ */
+lavc_threads_t *lavc_ThreadsNew( vlc_object_t *, uint64_t load,
+                                 unsigned max );
+
+void lavc_ThreadsDelete( lavc_threads_t * );
+
+/**
+ * Updates the load of a decoder, e.g. after a resolution change.
+ */
+void lavc_ThreadsSetLoad( lavc_threads_t *, uint64_t load, unsigned max );
+
+/**
+ * Returns the number of threads currently assigned to a decoder.
+ */
+unsigned lavc_ThreadsGet( lavc_threads_t * );
+
+#endif
@@ -32,7 +32,6 @@
 #include <vlc_common.h>
 #include <vlc_codec.h>
 #include <vlc_avcodec.h>
-#include <vlc_cpu.h>
 #include <vlc_atomic.h>
 #include <assert.h>
 
@@ -44,9 +43,13 @@
 #endif
 
 #include "avcodec.h"
+#include "budget.h"
 #include "va.h"
 
 #include "../codec/cc.h"
+#include "../../packetizer/h264_nal.h"
+#include "../../packetizer/hevc_nal.h"
+#include "../../packetizer/startcode_helper.h"
 
 /*****************************************************************************
  * decoder_sys_t : decoder descriptor
@@ -90,6 +93,18 @@ struct decoder_sys_t
     int profile;
     int level;
 
+    /* Decoding threads, from the process-wide budget unless fixed */
+    lavc_threads_t *threads;
+    int i_thread_count;
+    int i_load_width;
+    int i_load_height;
+    bool b_load_hw;
+
+    /* Statistics */
+    mtime_t  i_decoding_time;
+    unsigned i_decoded_frames;
+    unsigned i_late_frames_total;
+
     vlc_sem_t sem_mt;
 };
 
@@ -112,6 +127,7 @@ static enum PixelFormat ffmpeg_GetFormat( AVCodecContext *,
                                           const enum PixelFormat * );
 static int  DecodeVideo( decoder_t *, block_t * );
 static void Flush( decoder_t * );
+static void UpdateThreads( decoder_t *, bool );
 
 static uint32_t ffmpeg_CodecTag( vlc_fourcc_t fcc )
 {
@@ -368,6 +384,67 @@ static int lavc_CopyPicture(decoder_t *dec, picture_t *pic, AVFrame *frame)
     return VLC_SUCCESS;
 }
 
+/* Load of a 1080p stream at 30 frames per second, in pixels per second */
+#define LOAD_1080P30 (UINT64_C(1920) * 1080 * 30)
+
+/**
+ * Estimates the decoding load of the stream, in pixels per second.
+ */
+static uint64_t GetLoad( decoder_t *p_dec, unsigned width, unsigned height )
+{
+    const video_format_t *fmt = &p_dec->fmt_in.video;
+
+    if( width == 0 || height == 0 )
+        return LOAD_1080P30; /* not known yet */
+
+    uint64_t load = (uint64_t)width * height;
+    if( fmt->i_frame_rate > 0 && fmt->i_frame_rate_base > 0 )
+        return load * fmt->i_frame_rate / fmt->i_frame_rate_base;
+    return load * 25;
+}
+
+/**
+ * Returns the number of threads beyond which decoding hardly gets faster,
+ * while latency and memory use keep growing.
+ */
+static unsigned GetMaxThreads( decoder_t *p_dec, uint64_t load )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    if( p_sys->p_context->thread_type == 0 )
+        return 1;
+
+    unsigned max = (p_sys->p_codec->id == AV_CODEC_ID_HEVC) ? 6 : 4;
+    uint64_t scale = (load + LOAD_1080P30 - 1) / LOAD_1080P30;
+
+    if( scale > 1 )
+        max = (scale < 16) ? __MIN( max * scale, 16 ) : 16;
+    return max;
+}
+
+static void LogThreadMode( decoder_t *p_dec, const AVCodecContext *ctx )
+{
+    switch( ctx->active_thread_type )
+    {
+        case FF_THREAD_FRAME:
+            msg_Dbg( p_dec, "using frame thread mode with %d threads",
+                     ctx->thread_count );
+            break;
+        case FF_THREAD_SLICE:
+            msg_Dbg( p_dec, "using slice thread mode with %d threads",
+                     ctx->thread_count );
+            break;
+        case 0:
+            if( ctx->thread_count > 1 )
+                msg_Warn( p_dec, "failed to enable threaded decoding" );
+            break;
+        default:
+            msg_Warn( p_dec, "using unknown thread mode with %d threads",
+                      ctx->thread_count );
+            break;
+    }
+}
+
 static int OpenVideoCodec( decoder_t *p_dec )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
@@ -404,25 +481,7 @@ static int OpenVideoCodec( decoder_t *p_dec )
     if( ret < 0 )
         return ret;
 
-    switch( ctx->active_thread_type )
-    {
-        case FF_THREAD_FRAME:
-            msg_Dbg( p_dec, "using frame thread mode with %d threads",
-                     ctx->thread_count );
-            break;
-        case FF_THREAD_SLICE:
-            msg_Dbg( p_dec, "using slice thread mode with %d threads",
-                     ctx->thread_count );
-            break;
-        case 0:
-            if( ctx->thread_count > 1 )
-                msg_Warn( p_dec, "failed to enable threaded decoding" );
-            break;
-        default:
-            msg_Warn( p_dec, "using unknown thread mode with %d threads",
-                      ctx->thread_count );
-            break;
-    }
+    LogThreadMode( p_dec, ctx );
     return 0;
 }
 
@@ -525,19 +584,6 @@ int InitVideoDec( vlc_object_t *obj )
     p_context->refcounted_frames = true;
     p_context->opaque = p_dec;
 
-    int i_thread_count = var_InheritInteger( p_dec, "avcodec-threads" );
-    if( i_thread_count <= 0 )
-    {
-        i_thread_count = vlc_GetCPUCount();
-        if( i_thread_count > 1 )
-            i_thread_count++;
-
-        //FIXME: take in count the decoding time
-        i_thread_count = __MIN( i_thread_count, p_codec->id == AV_CODEC_ID_HEVC ? 6 : 4 );
-    }
-    i_thread_count = __MIN( i_thread_count, 16 );
-    msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
-    p_context->thread_count = i_thread_count;
     p_context->thread_safe_callbacks = true;
 
     switch( p_codec->id )
@@ -560,6 +606,26 @@ int InitVideoDec( vlc_object_t *obj )
             break;
     }
 
+    int i_thread_count = var_InheritInteger( p_dec, "avcodec-threads" );
+    p_sys->threads = NULL;
+    if( i_thread_count <= 0 )
+    {   /* Take a share of the process-wide budget */
+        p_sys->i_load_width = p_dec->fmt_in.video.i_width;
+        p_sys->i_load_height = p_dec->fmt_in.video.i_height;
+        p_sys->b_load_hw = false;
+
+        uint64_t i_load = GetLoad( p_dec, p_sys->i_load_width,
+                                   p_sys->i_load_height );
+        p_sys->threads = lavc_ThreadsNew( VLC_OBJECT(p_dec), i_load,
+                                          GetMaxThreads( p_dec, i_load ) );
+        i_thread_count = p_sys->threads != NULL
+                       ? (int)lavc_ThreadsGet( p_sys->threads ) : 1;
+    }
+    i_thread_count = __MIN( i_thread_count, 16 );
+    msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
+    p_context->thread_count = i_thread_count;
+    p_sys->i_thread_count = i_thread_count;
+
     if( p_context->thread_type & FF_THREAD_FRAME )
         p_dec->i_extra_picture_buffers = 2 * p_context->thread_count;
 
@@ -594,6 +660,8 @@ int InitVideoDec( vlc_object_t *obj )
     /* ***** Open the codec ***** */
     if( OpenVideoCodec( p_dec ) < 0 )
     {
+        if( p_sys->threads != NULL )
+            lavc_ThreadsDelete( p_sys->threads );
         vlc_sem_destroy( &p_sys->sem_mt );
         free( p_sys );
         avcodec_free_context( &p_context );
@@ -636,6 +704,9 @@ static void Flush( decoder_t *p_dec )
 
     /* Reset cancel state to false */
     decoder_AbortPictures( p_dec, false );
+
+    if( p_sys->threads != NULL )
+        UpdateThreads( p_dec, false );
 }
 
 static bool check_block_validity( decoder_sys_t *p_sys, block_t *block )
@@ -747,6 +818,7 @@ static void update_late_frame_count( decoder_t *p_dec, block_t *p_block, mtime_t
        }
 
        p_sys->i_late_frames++;
+       p_sys->i_late_frames_total++;
        if( p_sys->i_late_frames == 1 )
            p_sys->i_late_frames_start = current_time;
 
@@ -1002,6 +1074,7 @@ static picture_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block, bool *error
             pkt.flags |= AV_PKT_FLAG_DISCARD;
 #endif
 
+        mtime_t i_start = mdate();
         int ret = avcodec_send_packet(p_context, &pkt);
         if( ret != 0 && ret != AVERROR(EAGAIN) )
         {
@@ -1024,6 +1097,7 @@ static picture_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block, bool *error
         }
 
         ret = avcodec_receive_frame(p_context, frame);
+        p_sys->i_decoding_time += mdate() - i_start;
         if( ret != 0 && ret != AVERROR(EAGAIN) )
         {
             if (ret == AVERROR(ENOMEM) || ret == AVERROR(EINVAL))
@@ -1061,6 +1135,7 @@ static picture_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block, bool *error
             if( i_used == 0 ) break;
             continue;
         }
+        p_sys->i_decoded_frames++;
 
         /* Compute the PTS */
 #ifdef FF_API_PKT_PTS
@@ -1199,13 +1274,244 @@ static picture_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block, bool *error
     return NULL;
 }
 
+/**
+ * Logs and resets the statistics of the current number of threads.
+ */
+static void LogStats( decoder_t *p_dec )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    if( p_sys->i_decoded_frames > 0 )
+        msg_Dbg( p_dec, "%u frame(s) decoded with %d thread(s) in %"PRId64
+                 " ms (%"PRId64" us per frame), %u late",
+                 p_sys->i_decoded_frames, p_sys->i_thread_count,
+                 p_sys->i_decoding_time / 1000,
+                 p_sys->i_decoding_time / p_sys->i_decoded_frames,
+                 p_sys->i_late_frames_total );
+
+    p_sys->i_decoding_time = 0;
+    p_sys->i_decoded_frames = 0;
+    p_sys->i_late_frames_total = 0;
+}
+
+/**
+ * Replaces the codec context with one using another number of threads.
+ *
+ * libavcodec cannot change the number of threads of an open codec, so a new
+ * one is opened with the parameters and settings of the current one.
+ */
+static int ReopenCodec( decoder_t *p_dec, int i_thread_count )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    AVCodecContext *old = p_sys->p_context;
+    AVCodecContext *ctx = avcodec_alloc_context3( p_sys->p_codec );
+    AVCodecParameters *par = avcodec_parameters_alloc();
+
+    if( unlikely(ctx == NULL || par == NULL)
+     || avcodec_parameters_from_context( par, old ) < 0
+     || avcodec_parameters_to_context( ctx, par ) < 0 )
+    {
+        avcodec_parameters_free( &par );
+        avcodec_free_context( &ctx );
+        return VLC_ENOMEM;
+    }
+    avcodec_parameters_free( &par );
+
+    ctx->coded_width = old->coded_width;
+    ctx->coded_height = old->coded_height;
+    ctx->workaround_bugs = old->workaround_bugs;
+    ctx->err_recognition = old->err_recognition;
+    ctx->flags = old->flags;
+    ctx->flags2 = old->flags2;
+    ctx->debug = old->debug;
+    ctx->skip_loop_filter = old->skip_loop_filter;
+    ctx->skip_frame = p_sys->i_skip_frame;
+    ctx->skip_idct = old->skip_idct;
+    ctx->get_format = old->get_format;
+    ctx->get_buffer2 = old->get_buffer2;
+    ctx->refcounted_frames = old->refcounted_frames;
+    ctx->opaque = old->opaque;
+    ctx->thread_safe_callbacks = old->thread_safe_callbacks;
+    ctx->thread_type = old->thread_type;
+    ctx->thread_count = i_thread_count;
+
+    post_mt( p_sys );
+    int ret = ffmpeg_OpenCodec( p_dec, ctx, p_sys->p_codec );
+    wait_mt( p_sys );
+    if( ret < 0 )
+    {
+        avcodec_free_context( &ctx );
+        return VLC_EGENERIC;
+    }
+
+    post_mt( p_sys );
+    avcodec_flush_buffers( old );
+    wait_mt( p_sys );
+    avcodec_free_context( &old );
+
+    /* The pictures of the video output were allocated for the initial
+     * number of frame threads */
+    if( (ctx->active_thread_type & FF_THREAD_FRAME)
+     && 2 * ctx->thread_count > p_dec->i_extra_picture_buffers
+     && p_sys->b_direct_rendering )
+    {
+        msg_Dbg( p_dec, "disabling direct rendering" );
+        p_sys->b_direct_rendering = false;
+    }
+
+    p_sys->p_context = ctx;
+    if( p_dec->fmt_in.video.p_palette != NULL )
+        p_sys->palette_sent = false;
+    LogThreadMode( p_dec, ctx );
+    return VLC_SUCCESS;
+}
+
+/**
+ * Tells whether a block starts a clean random access point: no picture
+ * following it in decoding order depends on a picture preceding it.
+ *
+ * A key frame is not enough: H.264 non-IDR I pictures and MPEG video open
+ * GOPs are followed by leading pictures referencing the previous GOP.
+ */
+static bool IsCleanRandomAccess( decoder_t *p_dec, const block_t *p_block )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    /* Without reordering, no picture can lead the random access point */
+    const bool b_no_leading = p_sys->p_context->has_b_frames == 0;
+
+    if( !(p_block->i_flags & BLOCK_FLAG_TYPE_I) )
+        return false;
+
+    const uint8_t *p = p_block->p_buffer;
+    const uint8_t *end = p + p_block->i_buffer;
+
+    while( (p = startcode_FindAnnexB( p, end )) != NULL && end - p >= 8 )
+    {
+        p += 3;
+        switch( p_dec->fmt_in.i_codec )
+        {
+            case VLC_CODEC_H264:
+                switch( p[0] & 0x1f )
+                {
+                    case H264_NAL_SLICE_IDR:
+                        return true;
+                    case H264_NAL_SLICE:
+                        return false;
+                }
+                break;
+
+            case VLC_CODEC_HEVC:
+            {
+                uint8_t i_type = hevc_getNALType( p );
+
+                if( i_type >= HEVC_NAL_BLA_W_LP && i_type <= HEVC_NAL_IDR_N_LP )
+                    return true;
+                /* The RASL pictures of a CRA reference the previous GOP */
+                if( i_type == HEVC_NAL_CRA )
+                    return b_no_leading;
+                if( i_type < HEVC_NAL_VPS )
+                    return false;
+                break;
+            }
+
+            case VLC_CODEC_MPGV:
+            case VLC_CODEC_MP1V:
+            case VLC_CODEC_MP2V:
+                if( p[0] == 0xB8 ) /* GOP: closed_gop or broken_link */
+                    return (p[4] & 0x60) != 0 || b_no_leading;
+                if( p[0] == 0x00 ) /* picture without GOP header */
+                    return b_no_leading;
+                break;
+
+            default:
+                return b_no_leading;
+        }
+    }
+    return b_no_leading;
+}
+
+/**
+ * Applies the number of threads assigned by the budget, if it changed.
+ *
+ * This must only happen when the next pictures do not depend on the previous
+ * ones: at a clean random access point (IDR, closed GOP), after draining the
+ * delayed pictures, or after a flush.
+ */
+static void UpdateThreads( decoder_t *p_dec, bool b_drain )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    int i_thread_count = __MIN( lavc_ThreadsGet( p_sys->threads ), 16 );
+
+    /* Hardware decoding does not depend on the number of threads */
+    if( i_thread_count == p_sys->i_thread_count || p_sys->p_va != NULL
+     || !avcodec_is_open( p_sys->p_context ) )
+        return;
+
+    if( b_drain )
+    {
+        picture_t *p_pic;
+        bool error = false;
+
+        while( ( p_pic = DecodeBlock( p_dec, NULL, &error ) ) != NULL )
+            decoder_QueueVideo( p_dec, p_pic );
+    }
+
+    LogStats( p_dec );
+    msg_Dbg( p_dec, "changing from %d to %d decoding thread(s)",
+             p_sys->i_thread_count, i_thread_count );
+    if( ReopenCodec( p_dec, i_thread_count ) != VLC_SUCCESS )
+        msg_Warn( p_dec, "cannot change the number of threads" );
+    /* Do not try again at every random access point on failure */
+    p_sys->i_thread_count = i_thread_count;
+}
+
+/**
+ * Updates the load of the decoder in the budget when the video size changes,
+ * or when hardware decoding starts or stops.
+ */
+static void UpdateLoad( decoder_t *p_dec )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    const AVCodecContext *ctx = p_sys->p_context;
+    const bool b_hw = p_sys->p_va != NULL;
+
+    if( ctx->coded_width <= 0 || ctx->coded_height <= 0
+     || (ctx->coded_width == p_sys->i_load_width
+      && ctx->coded_height == p_sys->i_load_height
+      && b_hw == p_sys->b_load_hw) )
+        return;
+
+    p_sys->i_load_width = ctx->coded_width;
+    p_sys->i_load_height = ctx->coded_height;
+    p_sys->b_load_hw = b_hw;
+
+    if( b_hw )
+        lavc_ThreadsSetLoad( p_sys->threads, 0, 1 );
+    else
+    {
+        uint64_t i_load = GetLoad( p_dec, ctx->coded_width,
+                                   ctx->coded_height );
+        lavc_ThreadsSetLoad( p_sys->threads, i_load,
+                             GetMaxThreads( p_dec, i_load ) );
+    }
+}
+
 static int DecodeVideo( decoder_t *p_dec, block_t *p_block )
 {
+    decoder_sys_t *p_sys = p_dec->p_sys;
     block_t **pp_block = p_block ? &p_block : NULL;
     picture_t *p_pic;
     bool error = false;
+
+    if( p_sys->threads != NULL && p_block != NULL
+     && IsCleanRandomAccess( p_dec, p_block ) )
+        UpdateThreads( p_dec, true );
+
     while( ( p_pic = DecodeBlock( p_dec, pp_block, &error ) ) != NULL )
         decoder_QueueVideo( p_dec, p_pic );
+
+    if( p_sys->threads != NULL )
+        UpdateLoad( p_dec );
     return error ? VLCDEC_ECRITICAL : VLCDEC_SUCCESS;
 }
 
@@ -1238,6 +1544,10 @@ void EndVideoDec( vlc_object_t *obj )
     if( p_sys->p_va )
         vlc_va_Delete( p_sys->p_va, &hwaccel_context );
 
+    LogStats( p_dec );
+    if( p_sys->threads != NULL )
+        lavc_ThreadsDelete( p_sys->threads );
+
     vlc_sem_destroy( &p_sys->sem_mt );
     free( p_sys );
 }
@@ -89,6 +89,7 @@ struct demux_sys_t
     bool         b_seekable;
     bool         b_fastseekable;
     bool         b_error;        /* unrecoverable */
+    bool         b_keyframes_only; /* trick play, video sync samples only */
 
     bool            b_index_probed;     /* mFra sync points index */
     bool            b_fragments_probed; /* moof segments index created */
@@ -152,6 +153,7 @@ static int  MP4_TrackSeek   ( demux_t *, mp4_track_t *, mtime_t );
 static uint64_t MP4_TrackGetPos    ( mp4_track_t * );
 static uint32_t MP4_TrackGetReadSize( mp4_track_t *, uint32_t * );
 static int      MP4_TrackNextSample( demux_t *, mp4_track_t *, uint32_t );
+static uint32_t MP4_TrackGetNextSyncSample( const mp4_track_t *, uint32_t );
 static void     MP4_TrackSetELST( demux_t *, mp4_track_t *, int64_t );
 
 static void     MP4_UpdateSeekpoint( demux_t *, int64_t );
@@ -1223,6 +1225,22 @@ static int DemuxTrack( demux_t *p_demux, mp4_track_t *tk, uint64_t i_readpos,
         if( tk->i_sample >= tk->i_sample_count )
             return VLC_DEMUXER_EOS;
 
+        /* In trick play, jump over the samples up to the next sync sample
+         * instead of reading them; the clock paces the next one */
+        if( p_demux->p_sys->b_keyframes_only && tk->fmt.i_cat == VIDEO_ES )
+        {
+            uint32_t i_sync = MP4_TrackGetNextSyncSample( tk, tk->i_sample );
+            if( i_sync > tk->i_sample )
+            {
+                if( MP4_TrackNextSample( p_demux, tk, i_sync - tk->i_sample ) )
+                    return ( tk->i_sample >= tk->i_sample_count )
+                           ? VLC_DEMUXER_EOS : VLC_DEMUXER_EGENERIC;
+                i_current_nzdts = MP4_TrackGetDTS( p_demux, tk );
+                i_readpos = MP4_TrackGetPos( tk );
+                continue;
+            }
+        }
+
 #if 0
         msg_Dbg( p_demux, "tk(%i)=%"PRId64" mv=%"PRId64" pos=%"PRIu64, tk->i_track_ID,
                  MP4_TrackGetDTS( p_demux, tk ),
@@ -2099,6 +2117,13 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             }
             return VLC_EGENERIC;
         }
+        case DEMUX_SET_KEYFRAMES_ONLY:
+            /* Fragments have no sync sample table */
+            if( p_sys->b_fragmented )
+                return VLC_EGENERIC;
+            p_sys->b_keyframes_only = va_arg( args, int );
+            return VLC_SUCCESS;
+
         case DEMUX_SET_NEXT_DEMUX_TIME:
         case DEMUX_SET_GROUP:
         case DEMUX_HAS_UNSUPPORTED_META:
@@ -3836,12 +3861,16 @@ static int MP4_TrackNextSample( demux_t *p_demux, mp4_track_t *p_track, uint32_t
     if( p_track->i_sample >= p_track->i_sample_count )
         return VLC_EGENERIC;
 
-    /* Have we changed chunk ? */
-    if( p_track->i_sample >=
-            p_track->chunk[p_track->i_chunk].i_sample_first +
-            p_track->chunk[p_track->i_chunk].i_sample_count )
+    /* Have we changed chunk ? Skipped samples can span several chunks */
+    unsigned i_chunk = p_track->i_chunk;
+    while( i_chunk + 1 < p_track->i_chunk_count &&
+           p_track->i_sample >= p_track->chunk[i_chunk].i_sample_first +
+                                p_track->chunk[i_chunk].i_sample_count )
+        i_chunk++;
+
+    if( i_chunk != p_track->i_chunk )
     {
-        if( TrackGotoChunkSample( p_demux, p_track, p_track->i_chunk + 1,
+        if( TrackGotoChunkSample( p_demux, p_track, i_chunk,
                                   p_track->i_sample ) )
         {
             msg_Warn( p_demux, "track[0x%x] will be disabled "
@@ -3870,6 +3899,30 @@ static int MP4_TrackNextSample( demux_t *p_demux, mp4_track_t *p_track, uint32_t
     return VLC_SUCCESS;
 }
 
+/* Returns the first sync sample from i_sample, or the sample count if none */
+static uint32_t MP4_TrackGetNextSyncSample( const mp4_track_t *p_track,
+                                            uint32_t i_sample )
+{
+    const MP4_Box_t *p_stss = MP4_BoxGet( p_track->p_stbl, "stss" );
+    if( p_stss == NULL || BOXDATA(p_stss) == NULL )
+        return i_sample; /* every sample is a sync sample */
+
+    /* Sample numbers are in increasing order */
+    const MP4_Box_data_stss_t *p_stss_data = BOXDATA(p_stss);
+    uint32_t i_low = 0, i_high = p_stss_data->i_entry_count;
+    while( i_low < i_high )
+    {
+        uint32_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_stss_data->i_sample_number[i_mid] < i_sample )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+
+    return ( i_low < p_stss_data->i_entry_count )
+           ? p_stss_data->i_sample_number[i_low] : p_track->i_sample_count;
+}
+
 static void MP4_TrackSetELST( demux_t *p_demux, mp4_track_t *tk,
                               int64_t i_time )
 {
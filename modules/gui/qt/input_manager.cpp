@@ -688,7 +688,9 @@ void InputManager::requestArtUpdate( input_item_t *p_item, bool b_forced )
                 return;
         }
         libvlc_ArtRequest( p_intf->obj.libvlc, p_item,
-                           (b_forced) ? META_REQUEST_OPTION_SCOPE_ANY
+                           (b_forced) ? (input_item_meta_request_option_t)
+                                        ( META_REQUEST_OPTION_SCOPE_ANY |
+                                          META_REQUEST_OPTION_PRIORITY_HIGH )
                                       : META_REQUEST_OPTION_NONE );
         /* No input will signal the cover art to update,
              * let's do it ourself */
@@ -22,6 +22,7 @@
 #endif
 
 #include <assert.h>
+#include <sys/stat.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -29,6 +30,7 @@
 #include <vlc_modules.h>
 #include <vlc_meta.h>
 #include <vlc_url.h>
+#include <vlc_fs.h>
 
 #include <vlc/vlc.h>
 #include <vlc_input.h>
@@ -40,23 +42,58 @@
  * Local prototypes
  *****************************************************************************/
 
+/* Length of the fingerprinted audio prefix in seconds, as in chromaprint */
+#define FINGERPRINT_LENGTH 90
+/* Extra decoded time to make sure the prefix is complete */
+#define FINGERPRINT_MARGIN 5
+/* Minimum delay between two AcoustID lookups: the service accepts at most
+ * 3 requests per second from a client */
+#define LOOKUP_INTERVAL (CLOCK_FREQ / 3)
+
+struct fingerprint_cache_entry_t
+{
+    char *psz_fingerprint;
+    unsigned int i_duration;
+};
+
 struct fingerprinter_sys_t
 {
-    vlc_thread_t thread;
+    vlc_thread_t *p_threads;
+    unsigned      i_threads;
 
     struct
     {
         vlc_array_t         queue;
         vlc_mutex_t         lock;
-    } incoming, results;
+        vlc_cond_t          cond;
+    } incoming;
 
     struct
     {
         vlc_array_t         queue;
         vlc_mutex_t         lock;
-        vlc_cond_t          cond;
-        bool                b_working;
-    } processing;
+    } results;
+
+    struct
+    {
+        vlc_dictionary_t    entries;
+        vlc_array_t         keys; /* insertion order, for eviction */
+        size_t              i_max;
+        vlc_mutex_t         lock;
+    } cache;
+
+    struct
+    {
+        mtime_t             i_last; /* end date of the previous lookup */
+        vlc_mutex_t         lock;
+    } lookup;
+};
+
+struct fingerprint_job_t
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  cond;
+    bool        b_working;
 };
 
 static int  Open            (vlc_object_t *);
@@ -64,6 +101,14 @@ static void Close           (vlc_object_t *);
 static void CleanSys        (fingerprinter_sys_t *);
 static void *Run(void *);
 
+#define JOBS_TEXT N_("Concurrent fingerprints")
+#define JOBS_LONGTEXT N_("Maximum number of tracks fingerprinted at the " \
+    "same time (0 for the number of CPUs).")
+#define CACHE_TEXT N_("Fingerprint cache size")
+#define CACHE_LONGTEXT N_("Maximum number of fingerprints of local files " \
+    "kept in memory, so that unchanged files are not decoded again " \
+    "(0 disables the cache).")
+
 /*****************************************************************************
  * Module descriptor
  ****************************************************************************/
@@ -73,9 +118,13 @@ vlc_module_begin ()
     set_shortname(N_("acoustid"))
     set_description(N_("Track fingerprinter (based on Acoustid)"))
     set_capability("fingerprinter", 10)
+    add_integer("fingerprinter-jobs", 0, JOBS_TEXT, JOBS_LONGTEXT, true)
+        change_integer_range(0, 64)
+    add_integer("fingerprinter-cache", 4096, CACHE_TEXT, CACHE_LONGTEXT, true)
     set_callbacks(Open, Close)
 vlc_module_end ()
 
+
 /*****************************************************************************
  * Requests lifecycle
  *****************************************************************************/
@@ -85,21 +134,10 @@ static void EnqueueRequest( fingerprinter_thread_t *f, fingerprint_request_t *r
     fingerprinter_sys_t *p_sys = f->p_sys;
     vlc_mutex_lock( &p_sys->incoming.lock );
     vlc_array_append( &p_sys->incoming.queue, r );
+    vlc_cond_signal( &p_sys->incoming.cond );
     vlc_mutex_unlock( &p_sys->incoming.lock );
 }
 
-static void QueueIncomingRequests( fingerprinter_sys_t *p_sys )
-{
-    vlc_mutex_lock( &p_sys->incoming.lock );
-    size_t i = vlc_array_count( &p_sys->incoming.queue );
-
-    while( i )
-        vlc_array_append( &p_sys->processing.queue,
-                          vlc_array_item_at_index( &p_sys->incoming.queue, --i ) );
-    vlc_array_clear( &p_sys->incoming.queue );
-    vlc_mutex_unlock(&p_sys->incoming.lock);
-}
-
 static fingerprint_request_t * GetResult( fingerprinter_thread_t *f )
 {
     fingerprint_request_t *r = NULL;
@@ -126,6 +164,91 @@ static void ApplyResult( fingerprint_request_t *p_r, size_t i_resultid )
     vlc_mutex_unlock( &p_item->lock );
 }
 
+/*****************************************************************************
+ * Fingerprints cache
+ *****************************************************************************/
+
+/* Only local files can be told apart from their modified versions */
+static char *CacheKey( const char *psz_uri )
+{
+    char *psz_path = vlc_uri2path( psz_uri );
+    if ( psz_path == NULL )
+        return NULL;
+
+    struct stat st;
+    char *psz_key;
+    if ( vlc_stat( psz_path, &st )
+      || asprintf( &psz_key, "%"PRIu64" %"PRId64" %s", (uint64_t) st.st_size,
+                   (int64_t) st.st_mtime, psz_uri ) == -1 )
+        psz_key = NULL;
+    free( psz_path );
+    return psz_key;
+}
+
+static void CacheEntryDelete( void *p_data, void *p_obj )
+{
+    struct fingerprint_cache_entry_t *p_entry = p_data;
+    VLC_UNUSED( p_obj );
+    free( p_entry->psz_fingerprint );
+    free( p_entry );
+}
+
+static bool CacheLookup( fingerprinter_sys_t *p_sys, const char *psz_key,
+                         acoustid_fingerprint_t *fp )
+{
+    vlc_mutex_lock( &p_sys->cache.lock );
+    const struct fingerprint_cache_entry_t *p_entry =
+        vlc_dictionary_value_for_key( &p_sys->cache.entries, psz_key );
+    if ( p_entry != NULL )
+    {
+        fp->psz_fingerprint = strdup( p_entry->psz_fingerprint );
+        fp->i_duration = p_entry->i_duration;
+    }
+    vlc_mutex_unlock( &p_sys->cache.lock );
+    return fp->psz_fingerprint != NULL;
+}
+
+static void CacheInsert( fingerprinter_sys_t *p_sys, const char *psz_key,
+                         const acoustid_fingerprint_t *fp )
+{
+    struct fingerprint_cache_entry_t *p_entry = malloc( sizeof( *p_entry ) );
+    char *psz_order_key = strdup( psz_key );
+    if ( unlikely( p_entry == NULL || psz_order_key == NULL ) )
+        goto error;
+    p_entry->psz_fingerprint = strdup( fp->psz_fingerprint );
+    if ( unlikely( p_entry->psz_fingerprint == NULL ) )
+        goto error;
+    p_entry->i_duration = fp->i_duration;
+
+    vlc_mutex_lock( &p_sys->cache.lock );
+    if ( vlc_dictionary_has_key( &p_sys->cache.entries, psz_key ) )
+    {   /* fingerprinted concurrently by another job */
+        vlc_mutex_unlock( &p_sys->cache.lock );
+        free( p_entry->psz_fingerprint );
+        goto error;
+    }
+    if ( vlc_array_count( &p_sys->cache.keys ) >= p_sys->cache.i_max )
+    {
+        char *psz_oldest = vlc_array_item_at_index( &p_sys->cache.keys, 0 );
+        vlc_array_remove( &p_sys->cache.keys, 0 );
+        vlc_dictionary_remove_value_for_key( &p_sys->cache.entries, psz_oldest,
+                                             CacheEntryDelete, NULL );
+        free( psz_oldest );
+    }
+    vlc_dictionary_insert( &p_sys->cache.entries, psz_key, p_entry );
+    vlc_array_append( &p_sys->cache.keys, psz_order_key );
+    vlc_mutex_unlock( &p_sys->cache.lock );
+    return;
+
+error:
+    free( psz_order_key );
+    free( p_entry );
+}
+
+/*****************************************************************************
+ * Fingerprinting
+ *****************************************************************************/
+
 static int InputEventHandler( vlc_object_t *p_this, char const *psz_cmd,
                               vlc_value_t oldval, vlc_value_t newval,
                               void *p_data )
@@ -133,27 +256,39 @@ static int InputEventHandler( vlc_object_t *p_this, char const *psz_cmd,
     VLC_UNUSED( psz_cmd );
     VLC_UNUSED( oldval );
     input_thread_t *p_input = (input_thread_t *) p_this;
-    fingerprinter_sys_t *p_sys = (fingerprinter_sys_t *) p_data;
+    struct fingerprint_job_t *p_job = p_data;
     if( newval.i_int == INPUT_EVENT_STATE )
     {
         if( var_GetInteger( p_input, "state" ) >= PAUSE_S )
         {
-            vlc_mutex_lock( &p_sys->processing.lock );
-            p_sys->processing.b_working = false;
-            vlc_cond_signal( &p_sys->processing.cond );
-            vlc_mutex_unlock( &p_sys->processing.lock );
+            vlc_mutex_lock( &p_job->lock );
+            p_job->b_working = false;
+            vlc_cond_signal( &p_job->cond );
+            vlc_mutex_unlock( &p_job->lock );
         }
     }
     return VLC_SUCCESS;
 }
 
-static void DoFingerprint( fingerprinter_thread_t *p_fingerprinter,
-                           acoustid_fingerprint_t *fp,
-                           const char *psz_uri )
+static int AddIntegerOption( input_item_t *p_item, const char *psz_name,
+                             unsigned i_value )
+{
+    char *psz_option;
+    if ( asprintf( &psz_option, "%s=%u", psz_name, i_value ) == -1 )
+        return VLC_ENOMEM;
+    input_item_AddOption( p_item, psz_option, VLC_INPUT_OPTION_TRUSTED );
+    free( psz_option );
+    return VLC_SUCCESS;
+}
+
+/* Returns the duration of the fingerprinted audio in seconds */
+static unsigned DoFingerprint( fingerprinter_thread_t *p_fingerprinter,
+                               acoustid_fingerprint_t *fp,
+                               const char *psz_uri )
 {
     input_item_t *p_item = input_item_New( NULL, NULL );
     if ( unlikely(p_item == NULL) )
-         return;
+         return 0;
 
     char *psz_sout_option;
     /* Note: need at -max- 2 channels, but we can't guess it before playing */
@@ -164,22 +299,28 @@ static void DoFingerprint( fingerprinter_thread_t *p_fingerprinter,
          == -1 )
     {
         input_item_Release( p_item );
-        return;
+        return 0;
     }
 
     input_item_AddOption( p_item, psz_sout_option, VLC_INPUT_OPTION_TRUSTED );
     free( psz_sout_option );
     input_item_AddOption( p_item, "vout=dummy", VLC_INPUT_OPTION_TRUSTED );
     input_item_AddOption( p_item, "aout=dummy", VLC_INPUT_OPTION_TRUSTED );
+    /* chromaprint only needs the audio: do not decode anything else */
+    input_item_AddOption( p_item, "no-video", VLC_INPUT_OPTION_TRUSTED );
+    input_item_AddOption( p_item, "no-spu", VLC_INPUT_OPTION_TRUSTED );
     if ( fp->i_duration )
     {
-        if ( asprintf( &psz_sout_option, "stop-time=%u", fp->i_duration ) == -1 )
+        /* The track length is known: decode only the fingerprinted prefix */
+        unsigned i_prefix = __MIN( fp->i_duration, FINGERPRINT_LENGTH );
+        if ( AddIntegerOption( p_item, "duration", i_prefix )
+          || ( fp->i_duration > i_prefix
+            && AddIntegerOption( p_item, "stop-time",
+                                 i_prefix + FINGERPRINT_MARGIN ) ) )
         {
             input_item_Release( p_item );
-            return;
+            return 0;
         }
-        input_item_AddOption( p_item, psz_sout_option, VLC_INPUT_OPTION_TRUSTED );
-        free( psz_sout_option );
     }
     input_item_SetURI( p_item, psz_uri ) ;
 
@@ -187,32 +328,36 @@ static void DoFingerprint( fingerprinter_thread_t *p_fingerprinter,
     input_item_Release( p_item );
 
     if( p_input == NULL )
-        return;
+        return 0;
 
     chromaprint_fingerprint_t chroma_fingerprint;
 
     chroma_fingerprint.psz_fingerprint = NULL;
-    chroma_fingerprint.i_duration = fp->i_duration;
+    chroma_fingerprint.i_duration = 0;
 
     var_Create( p_input, "fingerprint-data", VLC_VAR_ADDRESS );
     var_SetAddress( p_input, "fingerprint-data", &chroma_fingerprint );
 
-    var_AddCallback( p_input, "intf-event", InputEventHandler, p_fingerprinter->p_sys );
+    struct fingerprint_job_t job;
+    vlc_mutex_init( &job.lock );
+    vlc_cond_init( &job.cond );
+    job.b_working = true;
+
+    var_AddCallback( p_input, "intf-event", InputEventHandler, &job );
 
     if( input_Start( p_input ) != VLC_SUCCESS )
     {
-        var_DelCallback( p_input, "intf-event", InputEventHandler, p_fingerprinter->p_sys );
+        var_DelCallback( p_input, "intf-event", InputEventHandler, &job );
         input_Close( p_input );
     }
     else
     {
-        p_fingerprinter->p_sys->processing.b_working = true;
-        while( p_fingerprinter->p_sys->processing.b_working )
-        {
-            vlc_cond_wait( &p_fingerprinter->p_sys->processing.cond,
-                           &p_fingerprinter->p_sys->processing.lock );
-        }
-        var_DelCallback( p_input, "intf-event", InputEventHandler, p_fingerprinter->p_sys );
+        vlc_mutex_lock( &job.lock );
+        while( job.b_working )
+            vlc_cond_wait( &job.cond, &job.lock );
+        vlc_mutex_unlock( &job.lock );
+
+        var_DelCallback( p_input, "intf-event", InputEventHandler, &job );
         input_Stop( p_input );
         input_Close( p_input );
 
@@ -220,6 +365,109 @@ static void DoFingerprint( fingerprinter_thread_t *p_fingerprinter,
         if( !fp->i_duration ) /* had not given hint */
             fp->i_duration = chroma_fingerprint.i_duration;
     }
+
+    vlc_cond_destroy( &job.cond );
+    vlc_mutex_destroy( &job.lock );
+    return chroma_fingerprint.i_duration;
+}
+
+static void fill_metas_with_results( fingerprint_request_t *p_r, acoustid_fingerprint_t *p_f )
+{
+    for( unsigned int i=0 ; i < p_f->results.count; i++ )
+    {
+        acoustid_result_t *p_result = & p_f->results.p_results[ i ];
+        for ( unsigned int j=0 ; j < p_result->recordings.count; j++ )
+        {
+            musicbrainz_recording_t *p_record = & p_result->recordings.p_recordings[ j ];
+            vlc_meta_t *p_meta = vlc_meta_New();
+            if ( p_meta )
+            {
+                vlc_meta_Set( p_meta, vlc_meta_Title, p_record->psz_title );
+                vlc_meta_Set( p_meta, vlc_meta_Artist, p_record->psz_artist );
+                vlc_meta_AddExtra( p_meta, "musicbrainz-id", p_record->s_musicbrainz_id );
+                vlc_array_append( & p_r->results.metas_array, p_meta );
+            }
+        }
+    }
+}
+
+/* The jobs share the AcoustID rate limit: their lookups are serialized and
+ * spaced out, whether the fingerprint was decoded or found in the cache. */
+static void DoLookup( fingerprinter_thread_t *p_fingerprinter,
+                      acoustid_fingerprint_t *fp )
+{
+    fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
+
+    if ( fp->psz_fingerprint == NULL )
+        return;
+
+    vlc_mutex_lock( &p_sys->lookup.lock );
+    mwait( p_sys->lookup.i_last + LOOKUP_INTERVAL );
+    DoAcoustIdWebRequest( VLC_OBJECT(p_fingerprinter), fp );
+    p_sys->lookup.i_last = mdate();
+    vlc_mutex_unlock( &p_sys->lookup.lock );
+}
+
+static void ProcessRequest( fingerprinter_thread_t *p_fingerprinter,
+                            fingerprint_request_t *p_data )
+{
+    fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
+    char *psz_uri = input_item_GetURI( p_data->p_item );
+    if ( psz_uri == NULL )
+        return;
+
+    acoustid_fingerprint_t acoustid_print;
+    memset( &acoustid_print , 0, sizeof (acoustid_print) );
+
+    /* AcoustID needs the whole track length: when it is known, only the
+     * fingerprinted prefix is decoded, otherwise the whole track is */
+    unsigned i_length = p_data->i_duration;
+    if ( i_length == 0 )
+    {
+        mtime_t i_item_duration = input_item_GetDuration( p_data->p_item );
+        if ( i_item_duration > 0 )
+            i_length = i_item_duration / CLOCK_FREQ;
+    }
+
+    char *psz_key = p_sys->cache.i_max > 0 ? CacheKey( psz_uri ) : NULL;
+    if ( psz_key != NULL && CacheLookup( p_sys, psz_key, &acoustid_print ) )
+    {
+        /* overwrite with hint, as for a decoded fingerprint */
+        if ( i_length )
+            acoustid_print.i_duration = i_length;
+        var_IncInteger( p_fingerprinter, "fingerprint-cache-hits" );
+    }
+    else
+    {
+        acoustid_print.i_duration = i_length;
+
+        mtime_t i_start = mdate();
+        unsigned i_decoded = DoFingerprint( p_fingerprinter, &acoustid_print,
+                                            psz_uri );
+        vlc_value_t val;
+        val.i_int = mdate() - i_start;
+        var_GetAndSet( VLC_OBJECT(p_fingerprinter), "fingerprint-decode-time",
+                       VLC_VAR_INTEGER_ADD, &val );
+        val.i_int = (int64_t) i_decoded * CLOCK_FREQ;
+        var_GetAndSet( VLC_OBJECT(p_fingerprinter), "fingerprint-audio-time",
+                       VLC_VAR_INTEGER_ADD, &val );
+
+        if ( psz_key != NULL && acoustid_print.psz_fingerprint != NULL )
+            CacheInsert( p_sys, psz_key, &acoustid_print );
+    }
+    free( psz_key );
+    free( psz_uri );
+
+    DoLookup( p_fingerprinter, &acoustid_print );
+    fill_metas_with_results( p_data, &acoustid_print );
+
+    for( unsigned j = 0; j < acoustid_print.results.count; j++ )
+         free_acoustid_result_t( &acoustid_print.results.p_results[j] );
+    if( acoustid_print.results.count )
+        free( acoustid_print.results.p_results );
+    free( acoustid_print.psz_fingerprint );
+
+    var_IncInteger( p_fingerprinter, "fingerprints" );
 }
 
 /*****************************************************************************
@@ -233,33 +481,62 @@ static int Open(vlc_object_t *p_this)
     if ( !p_sys )
         return VLC_ENOMEM;
 
+    int i_jobs = var_InheritInteger( p_fingerprinter, "fingerprinter-jobs" );
+    p_sys->i_threads = i_jobs > 0 ? (unsigned) i_jobs : vlc_GetCPUCount();
+    p_sys->p_threads = calloc( p_sys->i_threads, sizeof( vlc_thread_t ) );
+    if ( !p_sys->p_threads )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     p_fingerprinter->p_sys = p_sys;
 
     vlc_array_init( &p_sys->incoming.queue );
     vlc_mutex_init( &p_sys->incoming.lock );
-
-    vlc_array_init( &p_sys->processing.queue );
-    vlc_mutex_init( &p_sys->processing.lock );
-    vlc_cond_init( &p_sys->processing.cond );
+    vlc_cond_init( &p_sys->incoming.cond );
 
     vlc_array_init( &p_sys->results.queue );
     vlc_mutex_init( &p_sys->results.lock );
 
+    vlc_dictionary_init( &p_sys->cache.entries, 0 );
+    vlc_array_init( &p_sys->cache.keys );
+    int64_t i_cache = var_InheritInteger( p_fingerprinter, "fingerprinter-cache" );
+    p_sys->cache.i_max = i_cache > 0 ? i_cache : 0;
+    vlc_mutex_init( &p_sys->cache.lock );
+
+    p_sys->lookup.i_last = VLC_TS_INVALID;
+    vlc_mutex_init( &p_sys->lookup.lock );
+
     p_fingerprinter->pf_enqueue = EnqueueRequest;
     p_fingerprinter->pf_getresults = GetResult;
     p_fingerprinter->pf_apply = ApplyResult;
 
     var_Create( p_fingerprinter, "results-available", VLC_VAR_BOOL );
-    if( vlc_clone( &p_sys->thread, Run, p_fingerprinter,
-                   VLC_THREAD_PRIORITY_LOW ) )
+    /* throughput counters */
+    var_Create( p_fingerprinter, "fingerprints", VLC_VAR_INTEGER );
+    var_Create( p_fingerprinter, "fingerprint-cache-hits", VLC_VAR_INTEGER );
+    var_Create( p_fingerprinter, "fingerprint-audio-time", VLC_VAR_INTEGER );
+    var_Create( p_fingerprinter, "fingerprint-decode-time", VLC_VAR_INTEGER );
+
+    for ( unsigned i = 0; i < p_sys->i_threads; i++ )
     {
-        msg_Err( p_fingerprinter, "cannot spawn fingerprinter thread" );
-        goto error;
+        if( vlc_clone( &p_sys->p_threads[i], Run, p_fingerprinter,
+                       VLC_THREAD_PRIORITY_LOW ) )
+        {
+            msg_Err( p_fingerprinter, "cannot spawn fingerprinter thread" );
+            p_sys->i_threads = i;
+            goto error;
+        }
     }
 
     return VLC_SUCCESS;
 
 error:
+    for ( unsigned i = 0; i < p_sys->i_threads; i++ )
+        vlc_cancel( p_sys->p_threads[i] );
+    for ( unsigned i = 0; i < p_sys->i_threads; i++ )
+        vlc_join( p_sys->p_threads[i], NULL );
     CleanSys( p_sys );
     free( p_sys );
     return VLC_EGENERIC;
@@ -273,8 +550,10 @@ static void Close(vlc_object_t *p_this)
     fingerprinter_thread_t   *p_fingerprinter = (fingerprinter_thread_t*) p_this;
     fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
 
-    vlc_cancel( p_sys->thread );
-    vlc_join( p_sys->thread, NULL );
+    for ( unsigned i = 0; i < p_sys->i_threads; i++ )
+        vlc_cancel( p_sys->p_threads[i] );
+    for ( unsigned i = 0; i < p_sys->i_threads; i++ )
+        vlc_join( p_sys->p_threads[i], NULL );
 
     CleanSys( p_sys );
     free( p_sys );
@@ -286,37 +565,21 @@ static void CleanSys( fingerprinter_sys_t *p_sys )
         fingerprint_request_Delete( vlc_array_item_at_index( &p_sys->incoming.queue, i ) );
     vlc_array_clear( &p_sys->incoming.queue );
     vlc_mutex_destroy( &p_sys->incoming.lock );
-
-    for ( size_t i = 0; i < vlc_array_count( &p_sys->processing.queue ); i++ )
-        fingerprint_request_Delete( vlc_array_item_at_index( &p_sys->processing.queue, i ) );
-    vlc_array_clear( &p_sys->processing.queue );
-    vlc_mutex_destroy( &p_sys->processing.lock );
-    vlc_cond_destroy( &p_sys->processing.cond );
+    vlc_cond_destroy( &p_sys->incoming.cond );
 
     for ( size_t i = 0; i < vlc_array_count( &p_sys->results.queue ); i++ )
         fingerprint_request_Delete( vlc_array_item_at_index( &p_sys->results.queue, i ) );
     vlc_array_clear( &p_sys->results.queue );
     vlc_mutex_destroy( &p_sys->results.lock );
-}
 
-static void fill_metas_with_results( fingerprint_request_t *p_r, acoustid_fingerprint_t *p_f )
-{
-    for( unsigned int i=0 ; i < p_f->results.count; i++ )
-    {
-        acoustid_result_t *p_result = & p_f->results.p_results[ i ];
-        for ( unsigned int j=0 ; j < p_result->recordings.count; j++ )
-        {
-            musicbrainz_recording_t *p_record = & p_result->recordings.p_recordings[ j ];
-            vlc_meta_t *p_meta = vlc_meta_New();
-            if ( p_meta )
-            {
-                vlc_meta_Set( p_meta, vlc_meta_Title, p_record->psz_title );
-                vlc_meta_Set( p_meta, vlc_meta_Artist, p_record->psz_artist );
-                vlc_meta_AddExtra( p_meta, "musicbrainz-id", p_record->s_musicbrainz_id );
-                vlc_array_append( & p_r->results.metas_array, p_meta );
-            }
-        }
-    }
+    vlc_dictionary_clear( &p_sys->cache.entries, CacheEntryDelete, NULL );
+    for ( size_t i = 0; i < vlc_array_count( &p_sys->cache.keys ); i++ )
+        free( vlc_array_item_at_index( &p_sys->cache.keys, i ) );
+    vlc_array_clear( &p_sys->cache.keys );
+    vlc_mutex_destroy( &p_sys->cache.lock );
+    vlc_mutex_destroy( &p_sys->lookup.lock );
+
+    free( p_sys->p_threads );
 }
 
 /*****************************************************************************
@@ -327,62 +590,31 @@ static void *Run( void *opaque )
     fingerprinter_thread_t *p_fingerprinter = opaque;
     fingerprinter_sys_t *p_sys = p_fingerprinter->p_sys;
 
-    vlc_mutex_lock( &p_sys->processing.lock );
-    mutex_cleanup_push( &p_sys->processing.lock );
-
-    /* main loop */
+    /* worker loop: each thread fingerprints one track at a time */
     for (;;)
     {
-        msleep( CLOCK_FREQ );
-
-        QueueIncomingRequests( p_sys );
-
-        vlc_testcancel();
-
-        for ( size_t i = 0 ; i < vlc_array_count( &p_sys->processing.queue ); i++ )
-        {
-            int canc = vlc_savecancel();
-            fingerprint_request_t *p_data = vlc_array_item_at_index( &p_sys->processing.queue, i );
-
-            char *psz_uri = input_item_GetURI( p_data->p_item );
-            if ( psz_uri != NULL )
-            {
-                 acoustid_fingerprint_t acoustid_print;
-
-                 memset( &acoustid_print , 0, sizeof (acoustid_print) );
-                /* overwrite with hint, as in this case, fingerprint's session will be truncated */
-                if ( p_data->i_duration )
-                     acoustid_print.i_duration = p_data->i_duration;
-
-                DoFingerprint( p_fingerprinter, &acoustid_print, psz_uri );
-                free( psz_uri );
-
-                DoAcoustIdWebRequest( VLC_OBJECT(p_fingerprinter), &acoustid_print );
-                fill_metas_with_results( p_data, &acoustid_print );
-
-                for( unsigned j = 0; j < acoustid_print.results.count; j++ )
-                     free_acoustid_result_t( &acoustid_print.results.p_results[j] );
-                if( acoustid_print.results.count )
-                    free( acoustid_print.results.p_results );
-                free( acoustid_print.psz_fingerprint );
-            }
-            vlc_restorecancel(canc);
-
-            /* copy results */
-            vlc_mutex_lock( &p_sys->results.lock );
-            vlc_array_append( &p_sys->results.queue, p_data );
-            vlc_mutex_unlock( &p_sys->results.lock );
-
-            vlc_testcancel();
-        }
-
-        if ( vlc_array_count( &p_sys->processing.queue ) )
-        {
-            var_TriggerCallback( p_fingerprinter, "results-available" );
-            vlc_array_clear( &p_sys->processing.queue );
-        }
+        fingerprint_request_t *p_data;
+
+        vlc_mutex_lock( &p_sys->incoming.lock );
+        mutex_cleanup_push( &p_sys->incoming.lock );
+        while ( vlc_array_count( &p_sys->incoming.queue ) == 0 )
+            vlc_cond_wait( &p_sys->incoming.cond, &p_sys->incoming.lock );
+        p_data = vlc_array_item_at_index( &p_sys->incoming.queue, 0 );
+        vlc_array_remove( &p_sys->incoming.queue, 0 );
+        vlc_cleanup_pop();
+        vlc_mutex_unlock( &p_sys->incoming.lock );
+
+        int canc = vlc_savecancel();
+        ProcessRequest( p_fingerprinter, p_data );
+
+        /* copy results */
+        vlc_mutex_lock( &p_sys->results.lock );
+        vlc_array_append( &p_sys->results.queue, p_data );
+        vlc_mutex_unlock( &p_sys->results.lock );
+
+        var_TriggerCallback( p_fingerprinter, "results-available" );
+        vlc_restorecancel( canc );
     }
 
-    vlc_cleanup_pop();
     vlc_assert_unreachable();
 }
@@ -53,12 +53,24 @@
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
 
+#define FRAGDURATION_TEXT N_("Fragment duration (ms)")
+#define FRAGDURATION_LONGTEXT N_(\
+    "Maximum duration of each moof/mdat fragment. A fragment is also " \
+    "closed on every keyframe, so that keyframes always start a fragment.")
+
+#define CMAF_TEXT N_("CMAF chunks")
+#define CMAF_LONGTEXT N_(\
+    "Write CMAF conforming output: CMAF brands in the init segment and " \
+    "a single track per fragment, each chunk being sent to the access " \
+    "output as soon as it is complete.")
+
 static int  Open   (vlc_object_t *);
 static void Close  (vlc_object_t *);
 static int  OpenFrag   (vlc_object_t *);
 static void CloseFrag  (vlc_object_t *);
 
 #define SOUT_CFG_PREFIX "sout-mp4-"
+#define FRAG_CFG_PREFIX "sout-mp4frag-"
 
 vlc_module_begin ()
     set_description(N_("MP4/MOV muxer"))
@@ -78,7 +90,12 @@ add_submodule ()
     set_category(CAT_SOUT)
     set_subcategory(SUBCAT_SOUT_MUX)
     set_shortname("MP4 Frag")
-    add_shortcut("mp4frag", "mp4stream")
+    add_integer(FRAG_CFG_PREFIX "duration", 1500,
+                FRAGDURATION_TEXT, FRAGDURATION_LONGTEXT, true)
+        change_integer_range(20, 60000)
+    add_bool(FRAG_CFG_PREFIX "cmaf", false,
+             CMAF_TEXT, CMAF_LONGTEXT, true)
+    add_shortcut("mp4frag", "mp4stream", "cmaf")
     set_capability("sout mux", 0)
     set_callbacks(OpenFrag, CloseFrag)
 
@@ -91,6 +108,10 @@ static const char *const ppsz_sout_options[] = {
     "faststart", NULL
 };
 
+static const char *const ppsz_frag_options[] = {
+    "duration", "cmaf", NULL
+};
+
 static int Control(sout_mux_t *, int, va_list);
 static int AddStream(sout_mux_t *, sout_input_t *);
 static void DelStream(sout_mux_t *, sout_input_t *);
@@ -169,6 +190,8 @@ struct sout_mux_sys_t
     /* mp4frag */
     bool           b_fragmented;
     bool           b_header_sent;
+    bool           b_cmaf;
+    mtime_t        i_fragment_length;
     mtime_t        i_written_duration;
     uint32_t       i_mfhd_sequence;
 };
@@ -782,8 +805,6 @@ static void box_send(sout_mux_t *p_mux,  bo_t *box)
 /***************************************************************************
     MP4 Live submodule
 ****************************************************************************/
-#define FRAGMENT_LENGTH  (CLOCK_FREQ * 3/2)
-
 #define ENQUEUE_ENTRY(object, entry) \
     do {\
         if (object.p_last)\
@@ -842,7 +863,8 @@ static void AddKeyframeEntry(mp4_stream_t *p_stream, const uint64_t i_moof_pos,
  * requires base_offset_is_moof and then comply to late iso brand spec which
  * breaks clients. */
 static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
-                        mtime_t i_barrier_time, const uint64_t i_write_pos)
+                        mtime_t i_barrier_time, const uint64_t i_write_pos,
+                        int i_only_trak)
 {
     sout_mux_sys_t *p_sys = p_mux->p_sys;
 
@@ -863,7 +885,7 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
         bo_free(moof);
         return NULL;
     }
-    bo_add_32be(mfhd, p_sys->i_mfhd_sequence++);   // sequence number
+    bo_add_32be(mfhd, p_sys->i_mfhd_sequence);   // sequence number
 
     box_gather(moof, mfhd);
 
@@ -871,6 +893,9 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
     {
         mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
 
+        if (i_only_trak >= 0 && i_trak != (unsigned) i_only_trak)
+            continue;
+
         /* *** add /moof/traf *** */
         bo_t *traf = box_new("traf");
         if(!traf)
@@ -912,6 +937,10 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
             i_tfhd_flags |= MP4_TFHD_DURATION_IS_EMPTY;
         }
 
+        /* CMAF mandates moof relative offsets (single traf per moof) */
+        if (p_sys->b_cmaf)
+            i_tfhd_flags |= MP4_TFHD_DEFAULT_BASE_IS_MOOF;
+
         /* *** add /moof/traf/tfhd *** */
         bo_t *tfhd = box_full_new("tfhd", 0, i_tfhd_flags);
         if(!tfhd)
@@ -1057,7 +1086,9 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
     return moof;
 }
 
-static void WriteFragmentMDAT(sout_mux_t *p_mux, size_t i_total_size)
+/* Appends the mdat header and samples to the fragment chain */
+static void WriteFragmentMDAT(sout_mux_t *p_mux, size_t i_total_size,
+                              block_t ***ppp_last)
 {
     sout_mux_sys_t *p_sys = p_mux->p_sys;
 
@@ -1070,7 +1101,7 @@ static void WriteFragmentMDAT(sout_mux_t *p_mux, size_t i_total_size)
     box_fix(mdat, mdat->b->i_buffer + i_total_size);
     p_sys->i_pos += mdat->b->i_buffer;
     /* only write header */
-    sout_AccessOutWrite(p_mux->p_access, mdat->b);
+    block_ChainLastAppend(ppp_last, mdat->b);
     free(mdat);
     /* Header and its size are written and good, now write content */
     for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++)
@@ -1084,7 +1115,7 @@ static void WriteFragmentMDAT(sout_mux_t *p_mux, size_t i_total_size)
             p_stream->i_written_duration += p_entry->p_block->i_length;
 
             p_entry->p_block->i_flags &= ~BLOCK_FLAG_TYPE_I; // clear flag for http stream
-            sout_AccessOutWrite(p_mux->p_access, p_entry->p_block);
+            block_ChainLastAppend(ppp_last, p_entry->p_block);
 
             p_stream->towrite.p_first = p_entry->p_next;
             free(p_entry);
@@ -1158,7 +1189,14 @@ static void FlushHeader(sout_mux_t *p_mux)
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
 
     /* Now add ftyp header */
-    bo_t *ftyp = mp4mux_GetFtyp(MAJOR_isom, 0, NULL, 0);
+    bo_t *ftyp;
+    if (p_sys->b_cmaf)
+    {
+        vlc_fourcc_t extra[] = {MAJOR_iso6, MAJOR_cmfc};
+        ftyp = mp4mux_GetFtyp(MAJOR_iso6, 0, extra, ARRAY_SIZE(extra));
+    }
+    else
+        ftyp = mp4mux_GetFtyp(MAJOR_isom, 0, NULL, 0);
     if(!ftyp)
         return;
 
@@ -1181,6 +1219,8 @@ static int OpenFrag(vlc_object_t *p_this)
     if (!p_sys)
         return VLC_ENOMEM;
 
+    config_ChainParse(p_mux, FRAG_CFG_PREFIX, ppsz_frag_options, p_mux->p_cfg);
+
     p_mux->p_sys = (sout_mux_sys_t *) p_sys;
     p_mux->pf_control   = Control;
     p_mux->pf_addstream = AddStream;
@@ -1202,18 +1242,58 @@ static int OpenFrag(vlc_object_t *p_this)
 
     p_sys->b_header_sent = false;
     p_sys->b_fragmented  = true;
+    p_sys->b_cmaf = var_InheritBool(p_mux, FRAG_CFG_PREFIX "cmaf") ||
+                    !strcmp(p_mux->psz_mux, "cmaf");
+    p_sys->i_fragment_length = INT64_C(1000) *
+                    var_InheritInteger(p_mux, FRAG_CFG_PREFIX "duration");
     p_sys->i_start_dts = VLC_TS_INVALID;
     p_sys->i_mfhd_sequence = 1;
 
     return VLC_SUCCESS;
 }
 
-static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
+/* Writes a moof/mdat pair as a single block chain, so that the access
+ * output can deliver it as soon as it is complete */
+static bool WriteFragment(sout_mux_t *p_mux, mtime_t i_barrier_time,
+                          int i_only_trak)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
-    bo_t *moof = NULL;
-    mtime_t i_barrier_time = p_sys->i_written_duration + FRAGMENT_LENGTH;
     size_t i_mdat_size = 0;
+
+    bo_t *moof = GetMoofBox(p_mux, &i_mdat_size, i_barrier_time,
+                            p_sys->i_pos, i_only_trak);
+    if (!moof)
+        return false;
+
+    if (i_mdat_size == 0)
+    {
+        block_Release(moof->b);
+        free(moof);
+        return false;
+    }
+
+    /* only emitted fragments consume a sequence number */
+    p_sys->i_mfhd_sequence++;
+
+    block_t *p_chain = NULL;
+    block_t **pp_last = &p_chain;
+
+    msg_Dbg(p_mux, "writing moof @ %"PRId64, p_sys->i_pos);
+    p_sys->i_pos += moof->b->i_buffer;
+    assert(moof->b->i_flags & BLOCK_FLAG_TYPE_I); /* http sout */
+    block_ChainLastAppend(&pp_last, moof->b);
+    free(moof);
+    msg_Dbg(p_mux, "writing mdat @ %"PRId64, p_sys->i_pos);
+    WriteFragmentMDAT(p_mux, i_mdat_size, &pp_last);
+
+    sout_AccessOutWrite(p_mux->p_access, p_chain);
+    return true;
+}
+
+static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
+{
+    sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
+    mtime_t i_barrier_time = p_sys->i_written_duration + p_sys->i_fragment_length;
     bool b_has_samples = false;
 
     if(!p_sys->b_header_sent)
@@ -1247,24 +1327,23 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
     if (!p_sys->b_header_sent)
         FlushHeader(p_mux);
 
-    if (b_has_samples)
-        moof = GetMoofBox(p_mux, &i_mdat_size, (b_flush)?0:i_barrier_time, p_sys->i_pos);
+    if (!b_has_samples)
+        return;
 
-    if (moof && i_mdat_size == 0)
+    bool b_written;
+    if (p_sys->b_cmaf)
     {
-        block_Release(moof->b);
-        FREENULL(moof);
+        /* CMAF fragments carry a single track each */
+        b_written = false;
+        for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+            if (p_sys->pp_streams[i]->read.p_first)
+                b_written |= WriteFragment(p_mux, b_flush ? 0 : i_barrier_time, i);
     }
+    else
+        b_written = WriteFragment(p_mux, b_flush ? 0 : i_barrier_time, -1);
 
-    if (moof)
+    if (b_written)
     {
-        msg_Dbg(p_mux, "writing moof @ %"PRId64, p_sys->i_pos);
-        p_sys->i_pos += moof->b->i_buffer;
-        assert(moof->b->i_flags & BLOCK_FLAG_TYPE_I); /* http sout */
-        box_send(p_mux, moof);
-        msg_Dbg(p_mux, "writing mdat @ %"PRId64, p_sys->i_pos);
-        WriteFragmentMDAT(p_mux, i_mdat_size);
-
         /* update iframe point */
         for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
         {
@@ -1355,7 +1434,7 @@ static void CloseFrag(vlc_object_t *p_this)
 
     /* Write indexes, but only for non streamed content
        as they refer to moof by absolute position */
-    if (!strcmp(p_mux->psz_mux, "mp4frag"))
+    if (!strcmp(p_mux->psz_mux, "mp4frag") && !p_sys->b_cmaf)
     {
         bo_t *mfra = GetMfraBox(p_mux);
         if (mfra)
@@ -1421,7 +1500,7 @@ static int MuxFrag(sout_mux_t *p_mux)
         p_stream->p_held_entry = NULL;
 
         if (p_stream->b_hasiframes && (p_heldblock->i_flags & BLOCK_FLAG_TYPE_I) &&
-            p_stream->mux.i_read_duration - p_sys->i_written_duration < FRAGMENT_LENGTH)
+            p_stream->mux.i_read_duration - p_sys->i_written_duration < p_sys->i_fragment_length)
         {
             /* Flag the last iframe time, we'll use it as boundary so it will start
                next fragment */
@@ -1470,7 +1549,8 @@ static int MuxFrag(sout_mux_t *p_mux)
     p_sys->i_written_duration = i_min_written_duration;
 
     /* we have prerolled enough to know all streams, and have enough date to create a fragment */
-    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= FRAGMENT_LENGTH)
+    if (p_stream->read.p_first &&
+        p_sys->i_read_duration - p_sys->i_written_duration >= p_sys->i_fragment_length)
         WriteFragments(p_mux, false);
 
     return VLC_SUCCESS;
@@ -157,6 +157,12 @@ static const char *const ts_standards_list_text[] =
 #define BMAX_TEXT N_( "Maximum B (deprecated)")
 #define BMAX_LONGTEXT N_( "This setting is deprecated and not used anymore")
 
+#define BATCH_TEXT N_("Packets per output block")
+#define BATCH_LONGTEXT N_("Packetize each mux cycle into blocks of this " \
+  "many TS packets, dated in a single pass. This lowers the muxing cost " \
+  "at high bit rates, at the expense of the pacing of individual packets. " \
+  "If 0, each TS packet is output in its own block.")
+
 #define DTS_TEXT N_("DTS delay (ms)")
 #define DTS_LONGTEXT N_("Delay the DTS (decoding time " \
   "stamps) and PTS (presentation timestamps) of the data in the " \
@@ -227,6 +233,8 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "bmin", 0, BMIN_TEXT, BMIN_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmax", 0, BMAX_TEXT, BMAX_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "dts-delay", 400, DTS_TEXT, DTS_LONGTEXT, true)
+    add_integer( SOUT_CFG_PREFIX "batch", 0, BATCH_TEXT, BATCH_LONGTEXT, true)
+        change_integer_range( 0, 1024 )
 
     add_bool( SOUT_CFG_PREFIX "crypt-audio", true, ACRYPT_TEXT, ACRYPT_LONGTEXT, true)
     add_bool( SOUT_CFG_PREFIX "crypt-video", true, VCRYPT_TEXT, VCRYPT_LONGTEXT, true)
@@ -247,7 +255,7 @@ static const char *const ppsz_sout_options[] = {
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
-    "muxpmt", "program-pmt", "alignment",
+    "muxpmt", "program-pmt", "alignment", "batch",
     NULL
 };
 
@@ -321,6 +329,13 @@ static inline void BufferChainClean( sout_buffer_chain_t *c )
     BufferChainInit( c );
 }
 
+/* Multi-packet output blocks of the batch mode */
+typedef struct
+{
+    sout_buffer_chain_t chain; /* complete blocks */
+    block_t             *p_block; /* block being filled */
+} ts_batch_t;
+
 typedef struct
 {
     sout_buffer_chain_t chain_pes;
@@ -365,6 +380,10 @@ struct sout_mux_sys_t
     sdt_psi_t       sdt;
     ts_mux_standard standard;
 
+    /* Serialized PAT/PMT/SDT packets, rebuilt when the ES set changes */
+    block_t         *p_psi;
+    bool            b_psi_dirty;
+
     /* for TS building */
     int64_t         i_bitrate_min;
     int64_t         i_bitrate_max;
@@ -376,6 +395,7 @@ struct sout_mux_sys_t
     mtime_t         first_dts;
 
     bool            b_use_key_frames;
+    int             i_batch;
 
     mtime_t         i_pcr;  /* last PCR emited */
 
@@ -475,11 +495,15 @@ static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
 static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
+static void TSDateBatch ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain,
+                          mtime_t i_pcr_length, mtime_t i_pcr_dts );
 static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
+static void GetPSI( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
-static void TSSetPCR( block_t *p_ts, mtime_t i_dts );
+static uint32_t TSFill( sout_input_sys_t *p_stream, bool b_pcr, uint8_t *p_ts );
+static void TSSetPCR( uint8_t *p_ts, mtime_t i_dts );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -732,6 +756,8 @@ static int Open( vlc_object_t *p_this )
              p_sys->i_shaping_delay, p_sys->i_pcr_delay, p_sys->i_dts_delay );
 
     p_sys->b_use_key_frames = var_GetBool( p_mux, SOUT_CFG_PREFIX "use-key-frames" );
+    p_sys->i_batch = var_GetInteger( p_mux, SOUT_CFG_PREFIX "batch" );
+    p_sys->b_psi_dirty = true;
 
     p_mux->p_sys        = p_sys;
 
@@ -771,6 +797,9 @@ static void Close( vlc_object_t * p_this )
         free( p_sys->sdt.desc[i].psz_provider );
     }
 
+    if( p_sys->p_psi )
+        block_ChainRelease( p_sys->p_psi );
+
     free( p_sys );
 }
 
@@ -1041,6 +1070,7 @@ static int AddStream( sout_mux_t *p_mux, sout_input_t *p_input )
 
     /* We only change PMT version (PAT isn't changed) */
     p_sys->i_pmt_version_number = ( p_sys->i_pmt_version_number + 1 )%32;
+    p_sys->b_psi_dirty = true;
 
     /* Update pcr_pid */
     SelectPCRStream( p_mux, NULL );
@@ -1103,6 +1133,7 @@ static void DelStream( sout_mux_t *p_mux, sout_input_t *p_input )
     /* We only change PMT version (PAT isn't changed) */
     p_sys->i_pmt_version_number++;
     p_sys->i_pmt_version_number %= 32;
+    p_sys->b_psi_dirty = true;
 }
 
 static void SetHeader( sout_buffer_chain_t *c,
@@ -1117,6 +1148,71 @@ static void SetHeader( sout_buffer_chain_t *c,
     p_ts->i_flags |= BLOCK_FLAG_HEADER;
 }
 
+static bool TSIsKeyFrameStart( const sout_input_sys_t *p_stream )
+{
+    const block_t *p_pes = p_stream->state.chain_pes.p_first;
+
+    return p_stream->state.i_pes_used <= 0 &&
+           !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) &&
+           (p_pes->i_flags & BLOCK_FLAG_TYPE_I);
+}
+
+static void TSBatchFlush( ts_batch_t *p_batch )
+{
+    if( p_batch->p_block != NULL )
+    {
+        BufferChainAppend( &p_batch->chain, p_batch->p_block );
+        p_batch->p_block = NULL;
+    }
+}
+
+/* Returns room for the next TS packet of the batch */
+static uint8_t *TSBatchNext( sout_mux_t *p_mux, ts_batch_t *p_batch )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    block_t *p_block = p_batch->p_block;
+
+    if( p_block != NULL && p_block->i_buffer >= (size_t)p_sys->i_batch * 188 )
+    {
+        TSBatchFlush( p_batch );
+        p_block = NULL;
+    }
+
+    if( p_block == NULL )
+    {
+        p_block = block_Alloc( p_sys->i_batch * 188 );
+        if( unlikely(p_block == NULL) )
+            return NULL;
+        p_block->i_buffer = 0;
+        p_batch->p_block = p_block;
+    }
+
+    uint8_t *p_ts = &p_block->p_buffer[p_block->i_buffer];
+    p_block->i_buffer += 188;
+    return p_ts;
+}
+
+/* Moves TS packet blocks into the batch, returns the block where they start */
+static block_t *TSBatchAppend( sout_mux_t *p_mux, ts_batch_t *p_batch,
+                               sout_buffer_chain_t *c )
+{
+    block_t *p_first = NULL;
+    block_t *p_ts;
+
+    while( ( p_ts = BufferChainGet( c ) ) != NULL )
+    {
+        uint8_t *p_dst = TSBatchNext( p_mux, p_batch );
+        if( likely(p_dst != NULL) )
+        {
+            memcpy( p_dst, p_ts->p_buffer, 188 );
+            if( p_first == NULL )
+                p_first = p_batch->p_block;
+        }
+        block_Release( p_ts );
+    }
+    return p_first;
+}
+
 static block_t *Pack_Opus(block_t *p_data)
 {
     lldiv_t d = lldiv(p_data->i_buffer, 255);
@@ -1456,12 +1552,19 @@ static bool MuxStreams(sout_mux_t *p_mux )
     BufferChainInit( &chain_ts );
     /* append PAT/PMT  -> FIXME with big pcr delay it won't have enough pat/pmt */
     bool pat_was_previous = true; //This is to prevent unnecessary double PAT/PMT insertions
-    GetPAT( p_mux, &chain_ts );
-    GetPMT( p_mux, &chain_ts );
+    GetPSI( p_mux, &chain_ts );
     int i_packet_pos = 0;
     i_packet_count += chain_ts.i_depth;
     /* msg_Dbg( p_mux, "estimated pck=%d", i_packet_count ); */
 
+    ts_batch_t batch = { .p_block = NULL };
+    block_t *p_header = NULL; /* first batch block of the last PAT/PMT */
+    if( p_sys->i_batch > 0 )
+    {
+        BufferChainInit( &batch.chain );
+        p_header = TSBatchAppend( p_mux, &batch, &chain_ts );
+    }
+
     const mtime_t i_pcr_dts = p_pcr_stream->state.i_pes_dts;
     for (;;)
     {
@@ -1503,11 +1606,47 @@ static bool MuxStreams(sout_mux_t *p_mux )
                 i_pcr_length / i_packet_count;
         }
 
+        const bool b_scrambled = p_sys->csa != NULL &&
+             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
+             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video);
+
+        if( p_sys->i_batch > 0 )
+        {
+            /* Same PAT/PMT insertion as below, PAT/PMT starting a block */
+            if( p_sys->b_use_key_frames &&
+                p_input->p_fmt->i_cat == VIDEO_ES &&
+                TSIsKeyFrameStart( p_stream ) )
+            {
+                if( likely( !pat_was_previous ) )
+                {
+                    TSBatchFlush( &batch );
+                    GetPSI( p_mux, &chain_ts );
+                    i_packet_count += chain_ts.i_depth;
+                    p_header = TSBatchAppend( p_mux, &batch, &chain_ts );
+                }
+                if( p_header != NULL )
+                    p_header->i_flags |= BLOCK_FLAG_HEADER;
+            }
+            pat_was_previous = false;
+
+            uint8_t *p_ts = TSBatchNext( p_mux, &batch );
+            if( unlikely(p_ts == NULL) )
+                break;
+            TSFill( p_stream, b_pcr, p_ts );
+            if( b_scrambled )
+            {
+                /* The adaptation field, hence the PCR, is not scrambled */
+                vlc_mutex_lock( &p_sys->csa_lock );
+                csa_Encrypt( p_sys->csa, p_ts, p_sys->i_csa_pkt_size );
+                vlc_mutex_unlock( &p_sys->csa_lock );
+            }
+            i_packet_pos++;
+            continue;
+        }
+
         /* Build the TS packet */
         block_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
-        if( p_sys->csa != NULL &&
-             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
-             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
+        if( b_scrambled )
         {
             p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
         }
@@ -1523,8 +1662,7 @@ static bool MuxStreams(sout_mux_t *p_mux )
             if( likely( !pat_was_previous ) )
             {
                 int startcount = chain_ts.i_depth;
-                GetPAT( p_mux, &chain_ts );
-                GetPMT( p_mux, &chain_ts );
+                GetPSI( p_mux, &chain_ts );
                 SetHeader( &chain_ts, startcount );
                 i_packet_count += (chain_ts.i_depth - startcount );
             } else {
@@ -1538,7 +1676,13 @@ static bool MuxStreams(sout_mux_t *p_mux )
     }
 
     /* 4: date and send */
-    TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    if( p_sys->i_batch > 0 )
+    {
+        TSBatchFlush( &batch );
+        TSDateBatch( p_mux, &batch.chain, i_pcr_length, i_pcr_dts );
+    }
+    else
+        TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
     return false;
 }
 
@@ -1763,7 +1907,7 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
         {
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
-            TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
+            TSSetPCR( p_ts->p_buffer, p_ts->i_dts - p_sys->first_dts );
         }
         if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
         {
@@ -1779,11 +1923,84 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
     }
 }
 
+static void TSDateBatch( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain,
+                         mtime_t i_pcr_length, mtime_t i_pcr_dts )
+{
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+    int i_packet_count = 0;
+
+    for( block_t *p_block = p_chain->p_first; p_block != NULL;
+         p_block = p_block->p_next )
+        i_packet_count += p_block->i_buffer / 188;
+
+    if( i_packet_count == 0 )
+        return;
+
+    if ( i_pcr_length / 1000 > 0 )
+    {
+        int i_bitrate = ((uint64_t)i_packet_count * 188 * 8000)
+                          / (uint64_t)(i_pcr_length / 1000);
+        if ( p_sys->i_bitrate_max && p_sys->i_bitrate_max < i_bitrate )
+        {
+            msg_Warn( p_mux, "max bitrate exceeded at %"PRId64
+                      " (%d bi/s for %d pkt in %"PRId64" us)",
+                      i_pcr_dts + p_sys->i_shaping_delay * 3 / 2 - mdate(),
+                      i_bitrate, i_packet_count, i_pcr_length);
+        }
+    }
+    else
+    {
+        i_pcr_length = i_packet_count;
+    }
+
+    int i_packet = 0;
+    block_t *p_block;
+
+    while( ( p_block = BufferChainGet( p_chain ) ) != NULL )
+    {
+        int i_count = p_block->i_buffer / 188;
+
+        for( int i = 0; i < i_count; i++ )
+        {
+            uint8_t *p_ts = &p_block->p_buffer[188 * i];
+
+            /* Only TSFill() sets the PCR flag */
+            if( ( p_ts[3] & 0x20 ) && p_ts[4] >= 7 && ( p_ts[5] & 0x10 ) )
+            {
+                mtime_t i_date = i_pcr_dts + i_pcr_length * ( i_packet + i )
+                                 / i_packet_count;
+                TSSetPCR( p_ts, i_date - p_sys->first_dts );
+                p_block->i_flags |= BLOCK_FLAG_CLOCK;
+            }
+        }
+
+        p_block->i_dts = i_pcr_dts + i_pcr_length * i_packet / i_packet_count;
+        p_block->i_length = i_pcr_length * i_count / i_packet_count;
+        i_packet += i_count;
+
+        /* latency */
+        p_block->i_dts += p_sys->i_shaping_delay * 3 / 2;
+
+        sout_AccessOutWrite( p_mux->p_access, p_block );
+    }
+}
+
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
                        bool b_pcr )
 {
     VLC_UNUSED(p_mux);
+    block_t *p_ts = block_Alloc( 188 );
+
+    p_ts->i_dts = p_stream->state.chain_pes.p_first->i_dts;
+    p_ts->i_flags |= TSFill( p_stream, b_pcr, p_ts->p_buffer );
+    return p_ts;
+}
+
+/* Writes the next TS packet of a stream, returns its block flags */
+static uint32_t TSFill( sout_input_sys_t *p_stream, bool b_pcr, uint8_t *p_ts )
+{
     block_t *p_pes = p_stream->state.chain_pes.p_first;
+    uint32_t i_flags = 0;
 
     bool b_new_pes = false;
     bool b_adaptation_field = false;
@@ -1802,20 +2019,16 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         b_adaptation_field = true;
     }
 
-    block_t *p_ts = block_Alloc( 188 );
-
-    if (b_new_pes && !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) && p_pes->i_flags & BLOCK_FLAG_TYPE_I)
+    if( TSIsKeyFrameStart( p_stream ) )
     {
-        p_ts->i_flags |= BLOCK_FLAG_TYPE_I;
+        i_flags |= BLOCK_FLAG_TYPE_I;
     }
 
-    p_ts->i_dts = p_pes->i_dts;
-
-    p_ts->p_buffer[0] = 0x47;
-    p_ts->p_buffer[1] = ( b_new_pes ? 0x40 : 0x00 ) |
+    p_ts[0] = 0x47;
+    p_ts[1] = ( b_new_pes ? 0x40 : 0x00 ) |
         ( ( p_stream->ts.i_pid >> 8 )&0x1f );
-    p_ts->p_buffer[2] = p_stream->ts.i_pid & 0xff;
-    p_ts->p_buffer[3] = ( b_adaptation_field ? 0x30 : 0x10 ) |
+    p_ts[2] = p_stream->ts.i_pid & 0xff;
+    p_ts[3] = ( b_adaptation_field ? 0x30 : 0x10 ) |
         p_stream->ts.i_continuity_counter;
 
     p_stream->ts.i_continuity_counter = (p_stream->ts.i_continuity_counter+1)%16;
@@ -1826,30 +2039,30 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         int i_stuffing = i_payload_max - i_payload;
         if( b_pcr )
         {
-            p_ts->i_flags |= BLOCK_FLAG_CLOCK;
+            i_flags |= BLOCK_FLAG_CLOCK;
 
-            p_ts->p_buffer[4] = 7 + i_stuffing;
-            p_ts->p_buffer[5] = 1 << 4; /* PCR_flag */
+            p_ts[4] = 7 + i_stuffing;
+            p_ts[5] = 1 << 4; /* PCR_flag */
             if( p_stream->ts.b_discontinuity )
             {
-                p_ts->p_buffer[5] |= 0x80; /* flag TS dicontinuity */
+                p_ts[5] |= 0x80; /* flag TS dicontinuity */
                 p_stream->ts.b_discontinuity = false;
             }
-            memset(&p_ts->p_buffer[12], 0xff, i_stuffing);
+            memset(&p_ts[12], 0xff, i_stuffing);
         }
         else
         {
-            p_ts->p_buffer[4] = --i_stuffing;
+            p_ts[4] = --i_stuffing;
             if( i_stuffing-- )
             {
-                p_ts->p_buffer[5] = 0;
-                memset(&p_ts->p_buffer[6], 0xff, i_stuffing);
+                p_ts[5] = 0;
+                memset(&p_ts[6], 0xff, i_stuffing);
             }
         }
     }
 
     /* copy payload */
-    memcpy( &p_ts->p_buffer[188 - i_payload],
+    memcpy( &p_ts[188 - i_payload],
             &p_pes->p_buffer[p_stream->state.i_pes_used], i_payload );
 
     p_stream->state.i_pes_used += i_payload;
@@ -1879,20 +2092,20 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         p_stream->state.i_pes_used = 0;
     }
 
-    return p_ts;
+    return i_flags;
 }
 
-static void TSSetPCR( block_t *p_ts, mtime_t i_dts )
+static void TSSetPCR( uint8_t *p_ts, mtime_t i_dts )
 {
     mtime_t i_pcr = 9 * i_dts / 100;
 
-    p_ts->p_buffer[6]  = ( i_pcr >> 25 )&0xff;
-    p_ts->p_buffer[7]  = ( i_pcr >> 17 )&0xff;
-    p_ts->p_buffer[8]  = ( i_pcr >> 9  )&0xff;
-    p_ts->p_buffer[9]  = ( i_pcr >> 1  )&0xff;
-    p_ts->p_buffer[10] = ( i_pcr << 7  )&0x80;
-    p_ts->p_buffer[10] |= 0x7e;
-    p_ts->p_buffer[11] = 0; /* we don't set PCR extension */
+    p_ts[6]  = ( i_pcr >> 25 )&0xff;
+    p_ts[7]  = ( i_pcr >> 17 )&0xff;
+    p_ts[8]  = ( i_pcr >> 9  )&0xff;
+    p_ts[9]  = ( i_pcr >> 1  )&0xff;
+    p_ts[10] = ( i_pcr << 7  )&0x80;
+    p_ts[10] |= 0x7e;
+    p_ts[11] = 0; /* we don't set PCR extension */
 }
 
 void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
@@ -1935,3 +2148,70 @@ static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
               p_sys->i_num_pmt, p_sys->pmt, p_sys->i_pmt_program_number,
               p_mux->i_nb_inputs, mappeds );
 }
+
+static tsmux_stream_t *GetPSIStream( sout_mux_sys_t *p_sys, uint16_t i_pid )
+{
+    if( i_pid == p_sys->pat.i_pid )
+        return &p_sys->pat;
+    if( i_pid == p_sys->sdt.ts.i_pid )
+        return &p_sys->sdt.ts;
+    for (unsigned i = 0; i < p_sys->i_num_pmt; i++ )
+        if( i_pid == p_sys->pmt[i].i_pid )
+            return &p_sys->pmt[i];
+    return NULL;
+}
+
+/* PAT/PMT/SDT only change with the ES set: they are serialized once, and
+ * only their continuity counters are updated each time they are sent. */
+static void GetPSI( sout_mux_t *p_mux, sout_buffer_chain_t *c )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    if( p_sys->b_psi_dirty )
+    {
+        sout_buffer_chain_t psi;
+        uint8_t pi_pmt_cc[MAX_PMT];
+        uint8_t i_pat_cc = p_sys->pat.i_continuity_counter;
+        uint8_t i_sdt_cc = p_sys->sdt.ts.i_continuity_counter;
+
+        for (unsigned i = 0; i < p_sys->i_num_pmt; i++ )
+            pi_pmt_cc[i] = p_sys->pmt[i].i_continuity_counter;
+
+        BufferChainInit( &psi );
+        GetPAT( p_mux, &psi );
+        GetPMT( p_mux, &psi );
+
+        p_sys->pat.i_continuity_counter = i_pat_cc;
+        p_sys->sdt.ts.i_continuity_counter = i_sdt_cc;
+        for (unsigned i = 0; i < p_sys->i_num_pmt; i++ )
+            p_sys->pmt[i].i_continuity_counter = pi_pmt_cc[i];
+
+        if( p_sys->p_psi )
+            block_ChainRelease( p_sys->p_psi );
+        p_sys->p_psi = psi.p_first;
+        p_sys->b_psi_dirty = false;
+    }
+
+    for( block_t *p_psi = p_sys->p_psi; p_psi != NULL; p_psi = p_psi->p_next )
+    {
+        block_t *p_ts = block_Alloc( 188 );
+        if( unlikely(p_ts == NULL) )
+            break;
+        memcpy( p_ts->p_buffer, p_psi->p_buffer, 188 );
+
+        tsmux_stream_t *p_stream = GetPSIStream( p_sys,
+                ( ( p_ts->p_buffer[1] & 0x1f ) << 8 ) | p_ts->p_buffer[2] );
+        if( likely(p_stream != NULL) )
+        {
+            p_ts->p_buffer[3] = ( p_ts->p_buffer[3] & 0xf0 ) |
+                                p_stream->i_continuity_counter;
+            p_stream->i_continuity_counter =
+                ( p_stream->i_continuity_counter + 1 ) % 16;
+        }
+        BufferChainAppend( c, p_ts );
+
+        /* The discontinuity indicator is only sent once */
+        if( ( p_psi->p_buffer[3] & 0x20 ) && p_psi->p_buffer[4] > 0 )
+            p_psi->p_buffer[5] &= ~0x80;
+    }
+}
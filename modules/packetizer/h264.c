@@ -992,6 +992,8 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
     if( !p_sys->sps[p_sps->i_id].p_sps )
         msg_Dbg( p_dec, "found NAL_SPS (sps_id=%d)", p_sps->i_id );
 
+    /* Do not keep the whole input block alive with the parameter set */
+    p_frag = block_Unshare( p_frag );
     StoreSPS( p_sys, p_sps->i_id, p_frag, p_sps );
 }
 
@@ -1019,6 +1021,8 @@ static void PutPPS( decoder_t *p_dec, block_t *p_frag )
     if( !p_sys->pps[p_pps->i_id].p_pps )
         msg_Dbg( p_dec, "found NAL_PPS (pps_id=%d sps_id=%d)", p_pps->i_id, p_pps->i_sps_id );
 
+    /* Do not keep the whole input block alive with the parameter set */
+    p_frag = block_Unshare( p_frag );
     StorePPS( p_sys, p_pps->i_id, p_frag, p_pps );
 }
 
@@ -41,6 +41,15 @@ static inline void hxxx_WritePrefix( uint8_t i_nal_length_size, uint8_t *p_dest,
         *p_dest = i_payload;
 }
 
+/* startcode_FindAnnexB() never returns a startcode ending the buffer */
+static const uint8_t *hxxx_FindAnnexBStartcode( const uint8_t *p, const uint8_t *end )
+{
+    const uint8_t *p_sc = startcode_FindAnnexB( p, end );
+    if( !p_sc && end - p >= 3 && !end[-3] && !end[-2] && end[-1] == 1 )
+        p_sc = &end[-3];
+    return p_sc;
+}
+
 block_t *hxxx_AnnexB_to_xVC( block_t *p_block, uint8_t i_nal_length_size )
 {
     unsigned i_nalcount = 0;
@@ -61,48 +70,44 @@ block_t *hxxx_AnnexB_to_xVC( block_t *p_block, uint8_t i_nal_length_size )
     /* Search all startcode of size 3 */
     const uint8_t *p_buf = p_block->p_buffer;
     const uint8_t *p_end = &p_block->p_buffer[p_block->i_buffer];
-    unsigned i_bitflow = 0;
     off_t i_move = 0;
-    while( p_buf != p_end )
+    while( (p_buf = hxxx_FindAnnexBStartcode( p_buf, p_end )) )
     {
-        i_bitflow <<= 1;
-        if( !*p_buf )
+        if( p_buf != p_block->p_buffer && p_buf[-1] == 0 ) /* three zero prefixed 1 */
+        {
+            p_list[i_nalcount].p = &p_buf[-1];
+            p_list[i_nalcount].prefix = 4;
+        }
+        else /* two zero prefixed 1 */
         {
-            i_bitflow |= 1;
+            p_list[i_nalcount].p = p_buf;
+            p_list[i_nalcount].prefix = 3;
         }
-        else if( *p_buf == 0x01 && (i_bitflow & 0x06) == 0x06 ) /* >= two zero prefixed 1 */
+        i_move += (off_t) i_nal_length_size - p_list[i_nalcount].prefix;
+        p_list[i_nalcount++].move = i_move;
+
+        /* Check and realloc our list */
+        if(i_nalcount == i_list)
         {
-            if( i_bitflow & 0x08 ) /* three zero prefixed 1 */
-            {
-                p_list[i_nalcount].p = &p_buf[-3];
-                p_list[i_nalcount].prefix = 4;
-            }
-            else /* two zero prefixed 1 */
-            {
-                p_list[i_nalcount].p = &p_buf[-2];
-                p_list[i_nalcount].prefix = 3;
-            }
-            i_move += (off_t) i_nal_length_size - p_list[i_nalcount].prefix;
-            p_list[i_nalcount++].move = i_move;
-
-            /* Check and realloc our list */
-            if(i_nalcount == i_list)
-            {
-                i_list += 16;
-                struct nalmoves_e *p_new = realloc( p_list, sizeof(*p_new) * i_list );
-                if(unlikely(!p_new))
-                    goto error;
-                p_list = p_new;
-            }
+            i_list += 16;
+            struct nalmoves_e *p_new = realloc( p_list, sizeof(*p_new) * i_list );
+            if(unlikely(!p_new))
+                goto error;
+            p_list = p_new;
         }
-        p_buf++;
+        p_buf += 3;
     }
 
     if( !i_nalcount )
         goto error;
 
+    /* Data shared with other blocks (duplicate outputs) must not be written,
+     * and reallocating it moves the data away from the NAL list */
+    const bool b_shared = block_IsShared( p_block );
+
     /* Optimization for 1 NAL block only case */
-    if( i_nalcount == 1 && block_WillRealloc( p_block, p_list[0].move, p_block->i_buffer ) )
+    if( i_nalcount == 1 && !b_shared &&
+        block_WillRealloc( p_block, p_list[0].move, p_block->i_buffer ) )
     {
         uint32_t i_payload = p_block->i_buffer - p_list[0].prefix;
         block_t *p_newblock = block_Realloc( p_block, p_list[0].move, p_block->i_buffer );
@@ -120,10 +125,11 @@ block_t *hxxx_AnnexB_to_xVC( block_t *p_block, uint8_t i_nal_length_size )
     uint8_t *p_dest = NULL;
     const size_t i_dest = p_block->i_buffer + p_list[i_nalcount - 1].move;
 
-    if( p_list[i_nalcount - 1].move != 0 || i_nal_length_size != 4 )  /* We'll need to grow or shrink */
+    if( p_list[i_nalcount - 1].move != 0 || i_nal_length_size != 4 || b_shared )  /* We'll need to grow or shrink, or copy */
     {
         /* If we grow in size, try using realloc to avoid memcpy */
-        if( p_list[i_nalcount - 1].move > 0 && block_WillRealloc( p_block, 0, i_dest ) )
+        if( p_list[i_nalcount - 1].move > 0 && !b_shared &&
+            block_WillRealloc( p_block, 0, i_dest ) )
         {
             uint32_t i_sizebackup = p_block->i_buffer;
             block_t *p_newblock = block_Realloc( p_block, 0, i_dest );
@@ -24,6 +24,10 @@
 #include <vlc_es.h>
 #include "startcode_helper.h"
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+
 static const uint8_t  annexb_startcode4[] = { 0x00, 0x00, 0x00, 0x01 };
 #define annexb_startcode3 (&annexb_startcode4[1])
 
@@ -204,12 +208,74 @@ static inline bool hxxx_strip_AnnexB_startcode( const uint8_t **pp_data, size_t
     return false;
 }
 
+/* Looks up the next 0x00 0x03 sequence, that may hold an emulation
+ * prevention three byte, and returns the 0x03 within [p + 1, end).
+ * p[0] is only read as the byte preceding p[1]. */
+#ifdef HAVE_SSE2_INTRINSICS
+__attribute__ ((__target__ ("sse2")))
+static inline const uint8_t * hxxx_ep3b_find_SSE2( const uint8_t *p, const uint8_t *end )
+{
+    const __m128i zeros = _mm_setzero_si128();
+    const __m128i threes = _mm_set1_epi8( 0x03 );
+
+    for( p++; end - p >= 16; p += 16 )
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i *) p );
+        __m128i prev = _mm_loadu_si128( (const __m128i *) &p[-1] );
+        unsigned match = _mm_movemask_epi8(
+                            _mm_and_si128( _mm_cmpeq_epi8( v, threes ),
+                                           _mm_cmpeq_epi8( prev, zeros ) ) );
+        if( match )
+            return p + ctz( match );
+    }
+
+    for( ; p < end; p++ )
+    {
+        if( p[0] == 0x03 && p[-1] == 0x00 )
+            return p;
+    }
+    return NULL;
+}
+#endif
+
+static inline const uint8_t * hxxx_ep3b_find( const uint8_t *p, const uint8_t *end )
+{
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+        return hxxx_ep3b_find_SSE2( p, end );
+#endif
+    for( p++; p < end; p++ )
+    {
+        p = memchr( p, 0x03, end - p );
+        if( p == NULL || p[-1] == 0x00 )
+            return p;
+    }
+    return NULL;
+}
+
 /* vlc_bits's bs_t forward callback for stripping emulation prevention three bytes */
 static inline uint8_t *hxxx_bsfw_ep3b_to_rbsp( uint8_t *p, uint8_t *end, void *priv, size_t i_count )
 {
     unsigned *pi_prev = (unsigned *) priv;
     for( size_t i=0; i<i_count; i++ )
     {
+        /* Long forwards (skipped payloads): jump to the next escape candidate,
+         * as no byte can be escaped before it */
+        if( i_count - i >= 16 && (size_t)(end - p) > i_count - i )
+        {
+            const uint8_t *p_last = &p[i_count - i];
+            const uint8_t *p_ep3b = hxxx_ep3b_find( p, p_last + 1 );
+            const uint8_t *p_jump = p_ep3b ? p_ep3b - 1 : p_last;
+
+            if( p_jump - p >= 3 )
+            {
+                i += p_jump - p - 1;
+                p += p_jump - p;
+                *pi_prev = (!p[-2] << 2) | (!p[-1] << 1) | (!p[0]);
+                continue;
+            }
+        }
+
         if( ++p >= end )
             return p;
 
@@ -102,6 +102,48 @@ static inline void packetizer_Flush( packetizer_t *p_pack )
     p_pack->pf_reset( p_pack->p_private, true );
 }
 
+/* Returns the next fragment as a view of the current input block, or NULL
+ * if it must be copied. The zero bytes leading the next startcode may lie
+ * in the following block: they are stuffing and are left out of the view. */
+static inline block_t *packetizer_ShareFragment( packetizer_t *p_pack )
+{
+    block_t *p_block = p_pack->bytestream.p_block;
+    const size_t i_prepend = p_pack->i_au_prepend;
+    const size_t i_start = p_pack->bytestream.i_block_offset;
+    size_t i_size = p_block->i_buffer - i_start;
+
+    if( i_start < i_prepend || ( i_prepend > 0 &&
+        memcmp( &p_block->p_buffer[i_start - i_prepend],
+                p_pack->p_au_prepend, i_prepend ) ) )
+        return NULL;
+
+    if( i_size >= p_pack->i_offset )
+        i_size = p_pack->i_offset;
+    else
+    {
+        uint8_t tail[4];
+        const size_t i_tail = p_pack->i_offset - i_size;
+
+        if( i_tail > sizeof(tail) ||
+            block_PeekOffsetBytes( &p_pack->bytestream, i_size, tail, i_tail ) )
+            return NULL;
+        for( size_t i = 0; i < i_tail; i++ )
+            if( tail[i] != 0x00 )
+                return NULL;
+    }
+
+    block_t *p_frag = block_Share( p_block );
+    if( unlikely(p_frag == NULL) )
+        return NULL;
+
+    p_frag->p_buffer += i_start - i_prepend;
+    p_frag->i_buffer = i_size + i_prepend;
+    p_frag->i_flags = 0;
+    p_frag->i_nb_samples = 0;
+    p_frag->i_length = 0;
+    return p_frag;
+}
+
 static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_block )
 {
     block_t *p_block = ( pp_block ) ? *pp_block : NULL;
@@ -127,8 +169,16 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
         }
     }
 
-    if( p_block )
-        block_BytestreamPush( &p_pack->bytestream, p_block );
+    /* Input blocks are shared, so that NAL units can reference them */
+    while( p_block )
+    {
+        block_t *p_next = p_block->p_next;
+        p_block->p_next = NULL;
+        p_block = block_shared_Alloc( p_block );
+        if( p_block )
+            block_BytestreamPush( &p_pack->bytestream, p_block );
+        p_block = p_next;
+    }
 
     for( ;; )
     {
@@ -180,15 +230,29 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
             /* Get the new fragment and set the pts/dts */
             block_t *p_block_bytestream = p_pack->bytestream.p_block;
 
-            p_pic = block_Alloc( p_pack->i_offset + p_pack->i_au_prepend );
+            p_pic = packetizer_ShareFragment( p_pack );
+            if( p_pic )
+            {
+                block_SkipBytes( &p_pack->bytestream, p_pack->i_offset );
+            }
+            else
+            {
+                p_pic = block_Alloc( p_pack->i_offset + p_pack->i_au_prepend );
+                if( unlikely(p_pic == NULL) )
+                {
+                    block_SkipBytes( &p_pack->bytestream, p_pack->i_offset );
+                    p_pack->i_offset = 0;
+                    p_pack->i_state = STATE_NOSYNC;
+                    break;
+                }
+                block_GetBytes( &p_pack->bytestream, &p_pic->p_buffer[p_pack->i_au_prepend],
+                                p_pic->i_buffer - p_pack->i_au_prepend );
+                if( p_pack->i_au_prepend > 0 )
+                    memcpy( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
+            }
             p_pic->i_pts = p_block_bytestream->i_pts;
             p_pic->i_dts = p_block_bytestream->i_dts;
 
-            block_GetBytes( &p_pack->bytestream, &p_pic->p_buffer[p_pack->i_au_prepend],
-                            p_pic->i_buffer - p_pack->i_au_prepend );
-            if( p_pack->i_au_prepend > 0 )
-                memcpy( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
-
             p_pack->i_offset = 0;
 
             /* Parse the NAL */
@@ -221,7 +285,23 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
 
             /* So p_block doesn't get re-added several times */
             if( pp_block )
+            {
+                /* Hand back the AU prepend bytes with the remaining data, so
+                 * that the next fragment can still be shared */
+                block_BytestreamFlush( &p_pack->bytestream );
+                const block_t *p_last = p_pack->bytestream.p_block;
+                const size_t i_rewind =
+                    ( p_last && !p_last->p_next &&
+                      p_pack->bytestream.i_block_offset >= (size_t)p_pack->i_au_prepend )
+                    ? p_pack->i_au_prepend : 0;
+
                 *pp_block = block_BytestreamPop( &p_pack->bytestream );
+                if( *pp_block )
+                {
+                    (*pp_block)->p_buffer -= i_rewind;
+                    (*pp_block)->i_buffer += i_rewind;
+                }
+            }
 
             p_pack->i_state = STATE_NOSYNC;
 
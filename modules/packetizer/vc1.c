@@ -464,7 +464,11 @@ static block_t *ParseIDU( decoder_t *p_dec, bool *pb_ts_used, block_t *p_frag )
                     p_es->video.i_width  = i_potential_width;
                     p_es->video.i_height = i_potential_height;
 
-                    /* Remove it */
+                    /* Remove it, in a copy as the fragment may be a view
+                     * of the input block */
+                    p_frag = block_Unshare( p_frag );
+                    if( unlikely(p_frag == NULL) )
+                        return NULL;
                     p_frag->p_buffer += 4;
                     p_frag->i_buffer -= 4;
                     memcpy( p_frag->p_buffer, startcode, sizeof(startcode) );
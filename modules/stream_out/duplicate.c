@@ -269,31 +269,46 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
     while( p_buffer )
     {
         block_t *p_next = p_buffer->p_next;
+        int i_last = -1, i_count = 0;
 
         p_buffer->p_next = NULL;
 
-        for( i_stream = 0; i_stream < p_sys->i_nb_streams - 1; i_stream++ )
+        for( i_stream = 0; i_stream < p_sys->i_nb_streams; i_stream++ )
+        {
+            if( id->pp_ids[i_stream] )
+            {
+                i_last = i_stream;
+                i_count++;
+            }
+        }
+
+        /* Outputs share the payload rather than each getting a copy */
+        if( i_count > 1 )
+            p_buffer = block_shared_Alloc( p_buffer );
+
+        if( p_buffer == NULL || i_last < 0 )
+        {
+            if( p_buffer )
+                block_Release( p_buffer );
+            p_buffer = p_next;
+            continue;
+        }
+
+        for( i_stream = 0; i_stream < i_last; i_stream++ )
         {
             p_dup_stream = p_sys->pp_streams[i_stream];
 
             if( id->pp_ids[i_stream] )
             {
-                block_t *p_dup = block_Duplicate( p_buffer );
+                block_t *p_dup = block_Share( p_buffer );
 
                 if( p_dup )
                     sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_dup );
             }
         }
 
-        if( i_stream < p_sys->i_nb_streams && id->pp_ids[i_stream] )
-        {
-            p_dup_stream = p_sys->pp_streams[i_stream];
-            sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_buffer );
-        }
-        else
-        {
-            block_Release( p_buffer );
-        }
+        p_dup_stream = p_sys->pp_streams[i_last];
+        sout_StreamIdSend( p_dup_stream, id->pp_ids[i_last], p_buffer );
 
         p_buffer = p_next;
     }
@@ -0,0 +1,1043 @@
+/*****************************************************************************
+ * packager.c: multi-rendition HLS/DASH packager stream output
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define GROUP_TEXT N_("Group")
+#define GROUP_LONGTEXT N_( \
+    "Name of the packaging group. All the packager outputs sharing a group " \
+    "name are the renditions of a single presentation: their segments are " \
+    "aligned and they are listed in the same master playlist and MPD. " \
+    "The directory, segment and manifest settings of a group are taken " \
+    "from its first output." )
+
+#define NAME_TEXT N_("Rendition name")
+#define NAME_LONGTEXT N_( \
+    "Name of this rendition, used to name its playlist and segments." )
+
+#define DIR_TEXT N_("Output directory")
+#define DIR_LONGTEXT N_( \
+    "Directory where playlists, manifest and segments are written." )
+
+#define SEGLEN_TEXT N_("Segment length")
+#define SEGLEN_LONGTEXT N_( \
+    "Minimum length of segments, in seconds. Segments are cut on the first " \
+    "keyframe once this length is reached." )
+
+#define NUMSEGS_TEXT N_("Number of segments")
+#define NUMSEGS_LONGTEXT N_( \
+    "Number of segments to keep in playlists (0 keeps all segments)." )
+
+#define DELSEGS_TEXT N_("Delete segments")
+#define DELSEGS_LONGTEXT N_( \
+    "Delete segments once they are no longer referenced by the playlists." )
+
+#define BANDWIDTH_TEXT N_("Bandwidth")
+#define BANDWIDTH_LONGTEXT N_( \
+    "Advertised bandwidth of this rendition in bits per second. " \
+    "If 0, the peak segment bit rate is used." )
+
+#define MASTER_TEXT N_("Master playlist")
+#define MASTER_LONGTEXT N_( \
+    "File name of the HLS master playlist (empty to disable)." )
+
+#define MPD_TEXT N_("MPD")
+#define MPD_LONGTEXT N_( \
+    "File name of the MPEG-DASH manifest (empty to disable)." )
+
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define SOUT_CFG_PREFIX "sout-packager-"
+
+vlc_module_begin ()
+    set_shortname( N_("Packager") )
+    set_description( N_("HLS/DASH packager stream output") )
+    set_capability( "sout stream", 0 )
+    add_shortcut( "packager" )
+    set_category( CAT_SOUT )
+    set_subcategory( SUBCAT_SOUT_STREAM )
+
+    add_string( SOUT_CFG_PREFIX "group", "default",
+                GROUP_TEXT, GROUP_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "name", "stream",
+                NAME_TEXT, NAME_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "dir", ".", DIR_TEXT, DIR_LONGTEXT, false )
+    add_integer( SOUT_CFG_PREFIX "seglen", 6, SEGLEN_TEXT, SEGLEN_LONGTEXT,
+                 false )
+        change_integer_range( 1, 3600 )
+    add_integer( SOUT_CFG_PREFIX "numsegs", 0, NUMSEGS_TEXT, NUMSEGS_LONGTEXT,
+                 false )
+    add_bool( SOUT_CFG_PREFIX "delsegs", true, DELSEGS_TEXT, DELSEGS_LONGTEXT,
+              true )
+    add_integer( SOUT_CFG_PREFIX "bandwidth", 0,
+                 BANDWIDTH_TEXT, BANDWIDTH_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "master", "master.m3u8",
+                MASTER_TEXT, MASTER_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "mpd", "manifest.mpd",
+                MPD_TEXT, MPD_LONGTEXT, false )
+
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static const char *const ppsz_sout_options[] = {
+    "group", "name", "dir", "seglen", "numsegs", "delsegs", "bandwidth",
+    "master", "mpd", NULL
+};
+
+/* Segments are written as MPEG-TS, which is self-initializing: neither the
+ * playlists nor the MPD need an initialization segment */
+#define SEGMENT_MUX     "ts"
+#define SEGMENT_EXT     "ts"
+#define SEGMENT_MIME    "video/mp2t"
+#define SEGMENT_PROFILE "urn:mpeg:dash:profile:mp2t-simple:2011"
+
+/* Number of segments kept on disk once removed from the playlists, as
+ * clients may still be fetching them */
+#define SEGMENT_GRACE 2
+
+static sout_stream_id_sys_t *Add ( sout_stream_t *, const es_format_t * );
+static void                  Del ( sout_stream_t *, sout_stream_id_sys_t * );
+static int                   Send( sout_stream_t *, sout_stream_id_sys_t *,
+                                   block_t * );
+
+typedef struct
+{
+    uint32_t i_number;
+    mtime_t  i_start;    /* first dts */
+    mtime_t  i_duration;
+    size_t   i_size;
+} packager_segment_t;
+
+/* Playlist state of a rendition, owned by the group so that the manifests
+ * keep listing renditions whose output has already been closed */
+typedef struct
+{
+    char               *psz_name;
+    unsigned            i_bandwidth;
+    unsigned            i_peak_bandwidth;
+    unsigned            i_width;
+    unsigned            i_height;
+    packager_segment_t *p_segments;
+    size_t              i_segments;
+    bool                b_active;
+    bool                b_ended;
+    /* Current segment, only written by the rendition output */
+    bool                b_started;
+    uint32_t            i_segment; /* index in the group timeline */
+} packager_rendition_t;
+
+typedef struct packager_group_t packager_group_t;
+
+struct sout_stream_id_sys_t
+{
+    es_format_t           fmt;
+    sout_stream_id_sys_t *id; /* in the current segment output */
+};
+
+struct sout_stream_sys_t
+{
+    packager_group_t     *p_group;
+    packager_rendition_t *p_rend;
+    bool                  b_delsegs;
+
+    int                    i_id;
+    sout_stream_id_sys_t **id;
+
+    /* Current segment */
+    sout_stream_t *p_out;
+    mtime_t        i_seg_start;
+    mtime_t        i_seg_end;
+    size_t         i_seg_size;
+
+    /* Paths of the segments removed from the playlists, not deleted yet */
+    int    i_dropped;
+    char **ppsz_dropped;
+};
+
+/* State shared by all the renditions of a group */
+struct packager_group_t
+{
+    vlc_mutex_t lock;
+    char       *psz_var;
+    unsigned    i_refs;
+
+    char       *psz_dir;
+    char       *psz_master;
+    char       *psz_mpd;
+    mtime_t     i_seglen;
+    unsigned    i_numsegs;
+    time_t      i_availability_start;
+
+    /* Segment timeline: dts at which every segment starts, from segment
+     * i_cuts_base on; earlier cuts are dropped once no rendition needs them */
+    mtime_t     i_origin; /* dts of the first segment */
+    mtime_t    *p_cuts;
+    size_t      i_cuts;
+    size_t      i_cuts_max;
+    uint32_t    i_cuts_base;
+    bool        b_aligned;
+
+    int                    i_renditions;
+    packager_rendition_t **pp_renditions;
+};
+
+/* Serializes group creation and lookup */
+static vlc_mutex_t groups_lock = VLC_STATIC_MUTEX;
+
+/*****************************************************************************
+ * Group management
+ *****************************************************************************/
+static packager_group_t *GroupHold( sout_stream_t *p_stream )
+{
+    char *psz_group = var_GetNonEmptyString( p_stream, SOUT_CFG_PREFIX "group" );
+    char *psz_var;
+
+    if( asprintf( &psz_var, "packager-group-%s",
+                  psz_group ? psz_group : "default" ) < 0 )
+    {
+        free( psz_group );
+        return NULL;
+    }
+    free( psz_group );
+
+    vlc_mutex_lock( &groups_lock );
+    packager_group_t *p_group = var_GetAddress( p_stream->obj.libvlc,
+                                                psz_var );
+    if( p_group != NULL )
+    {
+        p_group->i_refs++;
+        free( psz_var );
+        goto out;
+    }
+
+    p_group = calloc( 1, sizeof(*p_group) );
+    if( unlikely(p_group == NULL) )
+    {
+        free( psz_var );
+        goto out;
+    }
+
+    vlc_mutex_init( &p_group->lock );
+    p_group->psz_var = psz_var;
+    p_group->i_refs = 1;
+    p_group->psz_dir = var_GetNonEmptyString( p_stream, SOUT_CFG_PREFIX "dir" );
+    p_group->psz_master = var_GetNonEmptyString( p_stream,
+                                                 SOUT_CFG_PREFIX "master" );
+    p_group->psz_mpd = var_GetNonEmptyString( p_stream, SOUT_CFG_PREFIX "mpd" );
+    p_group->i_seglen = CLOCK_FREQ * var_GetInteger( p_stream,
+                                                     SOUT_CFG_PREFIX "seglen" );
+    p_group->i_numsegs = var_GetInteger( p_stream, SOUT_CFG_PREFIX "numsegs" );
+    p_group->i_availability_start = time( NULL );
+    p_group->b_aligned = true;
+    TAB_INIT( p_group->i_renditions, p_group->pp_renditions );
+
+    var_Create( p_stream->obj.libvlc, psz_var, VLC_VAR_ADDRESS );
+    var_SetAddress( p_stream->obj.libvlc, psz_var, p_group );
+out:
+    vlc_mutex_unlock( &groups_lock );
+    return p_group;
+}
+
+static void GroupRelease( sout_stream_t *p_stream, packager_group_t *p_group )
+{
+    vlc_mutex_lock( &groups_lock );
+    if( --p_group->i_refs > 0 )
+    {
+        vlc_mutex_unlock( &groups_lock );
+        return;
+    }
+    var_Destroy( p_stream->obj.libvlc, p_group->psz_var );
+    vlc_mutex_unlock( &groups_lock );
+
+    for( int i = 0; i < p_group->i_renditions; i++ )
+    {
+        packager_rendition_t *p_rend = p_group->pp_renditions[i];
+
+        assert( !p_rend->b_active );
+        free( p_rend->p_segments );
+        free( p_rend->psz_name );
+        free( p_rend );
+    }
+    TAB_CLEAN( p_group->i_renditions, p_group->pp_renditions );
+    vlc_mutex_destroy( &p_group->lock );
+    free( p_group->p_cuts );
+    free( p_group->psz_mpd );
+    free( p_group->psz_master );
+    free( p_group->psz_dir );
+    free( p_group->psz_var );
+    free( p_group );
+}
+
+static int GroupAppendCut( packager_group_t *p_group, mtime_t i_dts )
+{
+    if( p_group->i_cuts_base == 0 && p_group->i_cuts == 0 )
+        p_group->i_origin = i_dts;
+
+    if( p_group->i_cuts == p_group->i_cuts_max )
+    {
+        size_t i_max = p_group->i_cuts_max ? 2 * p_group->i_cuts_max : 64;
+        mtime_t *p_cuts = realloc( p_group->p_cuts, i_max * sizeof(*p_cuts) );
+        if( unlikely(p_cuts == NULL) )
+            return VLC_ENOMEM;
+        p_group->p_cuts = p_cuts;
+        p_group->i_cuts_max = i_max;
+    }
+    p_group->p_cuts[p_group->i_cuts++] = i_dts;
+    return VLC_SUCCESS;
+}
+
+/**
+ * Drops the cuts before the current segment of every started rendition.
+ *
+ * Renditions only look for their next cut, or for the last one when
+ * appending a cut, so this bounds the timeline on live streams.
+ * Must be called with the group lock held.
+ */
+static void GroupTrimCuts( packager_group_t *p_group )
+{
+    uint32_t i_min = p_group->i_cuts_base + p_group->i_cuts;
+
+    for( int i = 0; i < p_group->i_renditions; i++ )
+    {
+        const packager_rendition_t *p_rend = p_group->pp_renditions[i];
+
+        if( p_rend->b_active && p_rend->b_started
+         && p_rend->i_segment < i_min )
+            i_min = p_rend->i_segment;
+    }
+
+    /* Always keep the last cut, new segments are timed from it */
+    size_t i_drop = __MIN( i_min - p_group->i_cuts_base,
+                           p_group->i_cuts ? p_group->i_cuts - 1 : 0 );
+    if( i_drop == 0 )
+        return;
+
+    memmove( p_group->p_cuts, p_group->p_cuts + i_drop,
+             (p_group->i_cuts - i_drop) * sizeof(*p_group->p_cuts) );
+    p_group->i_cuts -= i_drop;
+    p_group->i_cuts_base += i_drop;
+}
+
+/**
+ * Decides whether a rendition may start segment i_next at i_dts.
+ *
+ * The first rendition reaching a segment boundary chooses where it starts,
+ * the other renditions then cut on their keyframe at the same date. With
+ * renditions coming from one source and encoded with aligned GOPs, this
+ * yields the same segment boundaries in every rendition.
+ * Must be called with the group lock held.
+ */
+static bool GroupCanCut( sout_stream_t *p_stream, packager_group_t *p_group,
+                         uint32_t i_next, mtime_t i_dts )
+{
+    assert( i_next >= p_group->i_cuts_base );
+
+    size_t i_cut_idx = i_next - p_group->i_cuts_base;
+
+    if( i_cut_idx < p_group->i_cuts )
+    {
+        mtime_t i_cut = p_group->p_cuts[i_cut_idx];
+
+        if( i_dts < i_cut )
+            return false;
+        if( i_dts != i_cut && p_group->b_aligned )
+        {
+            msg_Warn( p_stream, "segment %"PRIu32" is not aligned (%"PRId64" us "
+                      "late), keyframes of the renditions differ",
+                      i_next, i_dts - i_cut );
+            p_group->b_aligned = false;
+        }
+        return true;
+    }
+
+    assert( i_cut_idx == p_group->i_cuts );
+    if( i_cut_idx > 0
+     && i_dts - p_group->p_cuts[i_cut_idx - 1] < p_group->i_seglen )
+        return false;
+
+    return GroupAppendCut( p_group, i_dts ) == VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Playlists
+ *****************************************************************************/
+static char *GroupPath( const packager_group_t *p_group, const char *psz_file )
+{
+    char *psz_path;
+
+    if( asprintf( &psz_path, "%s"DIR_SEP"%s",
+                  p_group->psz_dir ? p_group->psz_dir : ".", psz_file ) < 0 )
+        return NULL;
+    return psz_path;
+}
+
+static char *SegmentName( const packager_rendition_t *p_rend,
+                          uint32_t i_number )
+{
+    char *psz_name;
+
+    if( asprintf( &psz_name, "%s-%"PRIu32"."SEGMENT_EXT, p_rend->psz_name,
+                  i_number ) < 0 )
+        return NULL;
+    return psz_name;
+}
+
+/* Opens a temporary file to be renamed over psz_path by FileCommit() */
+static FILE *FileOpen( sout_stream_t *p_stream, const char *psz_path,
+                       char **ppsz_tmp )
+{
+    if( asprintf( ppsz_tmp, "%s.tmp", psz_path ) < 0 )
+        return NULL;
+
+    FILE *fp = vlc_fopen( *ppsz_tmp, "wt" );
+    if( fp == NULL )
+    {
+        msg_Err( p_stream, "cannot open `%s': %s", *ppsz_tmp,
+                 vlc_strerror_c(errno) );
+        free( *ppsz_tmp );
+    }
+    return fp;
+}
+
+static void FileCommit( sout_stream_t *p_stream, FILE *fp, char *psz_tmp,
+                        const char *psz_path )
+{
+    if( ferror( fp ) | fclose( fp ) )
+    {
+        msg_Err( p_stream, "cannot write `%s'", psz_tmp );
+        vlc_unlink( psz_tmp );
+    }
+    else if( vlc_rename( psz_tmp, psz_path ) )
+    {
+        msg_Err( p_stream, "cannot rename `%s': %s", psz_tmp,
+                 vlc_strerror_c(errno) );
+        vlc_unlink( psz_tmp );
+    }
+    free( psz_tmp );
+}
+
+static void WriteVariant( sout_stream_t *p_stream, packager_group_t *p_group,
+                          const packager_rendition_t *p_rend )
+{
+    char *psz_file, *psz_path, *psz_tmp;
+
+    if( asprintf( &psz_file, "%s.m3u8", p_rend->psz_name ) < 0 )
+        return;
+    psz_path = GroupPath( p_group, psz_file );
+    free( psz_file );
+    if( psz_path == NULL )
+        return;
+
+    FILE *fp = FileOpen( p_stream, psz_path, &psz_tmp );
+    if( fp == NULL )
+    {
+        free( psz_path );
+        return;
+    }
+
+    mtime_t i_target = 0;
+    for( size_t i = 0; i < p_rend->i_segments; i++ )
+        if( p_rend->p_segments[i].i_duration > i_target )
+            i_target = p_rend->p_segments[i].i_duration;
+
+    fprintf( fp, "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:%u\n"
+             "#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n",
+             (unsigned)((i_target + CLOCK_FREQ - 1) / CLOCK_FREQ),
+             p_rend->i_segments ? p_rend->p_segments[0].i_number : 1 );
+    if( p_group->i_numsegs == 0 )
+        fprintf( fp, "#EXT-X-PLAYLIST-TYPE:%s\n",
+                 p_rend->b_ended ? "VOD" : "EVENT" );
+
+    for( size_t i = 0; i < p_rend->i_segments; i++ )
+    {
+        const packager_segment_t *p_seg = &p_rend->p_segments[i];
+        char *psz_seg = SegmentName( p_rend, p_seg->i_number );
+
+        if( psz_seg == NULL )
+            continue;
+        lldiv_t d = lldiv( p_seg->i_duration / 1000, 1000 );
+        fprintf( fp, "#EXTINF:%lld.%03lld,\n%s\n", d.quot, d.rem, psz_seg );
+        free( psz_seg );
+    }
+
+    if( p_rend->b_ended )
+        fputs( "#EXT-X-ENDLIST\n", fp );
+
+    FileCommit( p_stream, fp, psz_tmp, psz_path );
+    free( psz_path );
+}
+
+static unsigned RenditionBandwidth( const packager_rendition_t *p_rend )
+{
+    return p_rend->i_bandwidth ? p_rend->i_bandwidth
+                               : p_rend->i_peak_bandwidth;
+}
+
+static void WriteMaster( sout_stream_t *p_stream, packager_group_t *p_group )
+{
+    char *psz_path = GroupPath( p_group, p_group->psz_master );
+    char *psz_tmp;
+
+    if( psz_path == NULL )
+        return;
+
+    FILE *fp = FileOpen( p_stream, psz_path, &psz_tmp );
+    if( fp == NULL )
+    {
+        free( psz_path );
+        return;
+    }
+
+    fputs( "#EXTM3U\n#EXT-X-VERSION:3\n", fp );
+    if( p_group->b_aligned )
+        fputs( "#EXT-X-INDEPENDENT-SEGMENTS\n", fp );
+
+    for( int i = 0; i < p_group->i_renditions; i++ )
+    {
+        const packager_rendition_t *p_rend = p_group->pp_renditions[i];
+
+        if( p_rend->i_segments == 0 )
+            continue;
+
+        fprintf( fp, "#EXT-X-STREAM-INF:BANDWIDTH=%u",
+                 RenditionBandwidth( p_rend ) );
+        if( p_rend->i_width && p_rend->i_height )
+            fprintf( fp, ",RESOLUTION=%ux%u", p_rend->i_width,
+                     p_rend->i_height );
+        fprintf( fp, "\n%s.m3u8\n", p_rend->psz_name );
+    }
+
+    FileCommit( p_stream, fp, psz_tmp, psz_path );
+    free( psz_path );
+}
+
+static void FormatDuration( char *psz, size_t i_size, mtime_t i_duration )
+{
+    lldiv_t d = lldiv( i_duration / 1000, 1000 );
+    snprintf( psz, i_size, "PT%lld.%03lldS", d.quot, d.rem );
+}
+
+static void FormatDate( char *psz, size_t i_size, time_t i_date )
+{
+    struct tm tm;
+
+    gmtime_r( &i_date, &tm );
+    strftime( psz, i_size, "%Y-%m-%dT%H:%M:%SZ", &tm );
+}
+
+static void WriteMPD( sout_stream_t *p_stream, packager_group_t *p_group )
+{
+    char *psz_path = GroupPath( p_group, p_group->psz_mpd );
+    char *psz_tmp;
+    char psz_buf[32];
+    bool b_static = true;
+
+    if( psz_path == NULL || p_group->i_cuts_base + p_group->i_cuts == 0 )
+    {
+        free( psz_path );
+        return;
+    }
+
+    FILE *fp = FileOpen( p_stream, psz_path, &psz_tmp );
+    if( fp == NULL )
+    {
+        free( psz_path );
+        return;
+    }
+
+    mtime_t i_duration = 0;
+    for( int i = 0; i < p_group->i_renditions; i++ )
+    {
+        const packager_rendition_t *p_rend = p_group->pp_renditions[i];
+
+        b_static &= p_rend->b_ended;
+        if( p_rend->i_segments > 0 )
+        {
+            const packager_segment_t *p_last =
+                &p_rend->p_segments[p_rend->i_segments - 1];
+            mtime_t i_end = p_last->i_start + p_last->i_duration
+                          - p_group->i_origin;
+            if( i_end > i_duration )
+                i_duration = i_end;
+        }
+    }
+
+    fprintf( fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+             "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" "
+             "profiles=\""SEGMENT_PROFILE"\"" );
+    FormatDuration( psz_buf, sizeof(psz_buf), p_group->i_seglen );
+    fprintf( fp, " minBufferTime=\"%s\"", psz_buf );
+    FormatDate( psz_buf, sizeof(psz_buf), time( NULL ) );
+    fprintf( fp, " publishTime=\"%s\"", psz_buf );
+    if( b_static )
+    {
+        FormatDuration( psz_buf, sizeof(psz_buf), i_duration );
+        fprintf( fp, " type=\"static\" mediaPresentationDuration=\"%s\"",
+                 psz_buf );
+    }
+    else
+    {
+        char psz_date[32];
+
+        FormatDate( psz_date, sizeof(psz_date),
+                    p_group->i_availability_start );
+        FormatDuration( psz_buf, sizeof(psz_buf), p_group->i_seglen );
+        fprintf( fp, " type=\"dynamic\" availabilityStartTime=\"%s\" "
+                 "minimumUpdatePeriod=\"%s\"", psz_date, psz_buf );
+        if( p_group->i_numsegs )
+        {
+            FormatDuration( psz_buf, sizeof(psz_buf),
+                            p_group->i_numsegs * p_group->i_seglen );
+            fprintf( fp, " timeShiftBufferDepth=\"%s\"", psz_buf );
+        }
+    }
+    fprintf( fp, ">\n <Period id=\"1\" start=\"PT0S\">\n"
+             "  <AdaptationSet mimeType=\""SEGMENT_MIME"\" "
+             "segmentAlignment=\"%s\" bitstreamSwitching=\"%s\">\n",
+             p_group->b_aligned ? "true" : "false",
+             p_group->b_aligned ? "true" : "false" );
+
+    for( int i = 0; i < p_group->i_renditions; i++ )
+    {
+        const packager_rendition_t *p_rend = p_group->pp_renditions[i];
+
+        if( p_rend->i_segments == 0 )
+            continue;
+
+        fprintf( fp, "   <Representation id=\"%s\" bandwidth=\"%u\"",
+                 p_rend->psz_name, RenditionBandwidth( p_rend ) );
+        if( p_rend->i_width && p_rend->i_height )
+            fprintf( fp, " width=\"%u\" height=\"%u\"",
+                     p_rend->i_width, p_rend->i_height );
+        fprintf( fp, ">\n    <SegmentTemplate timescale=\"90000\" "
+                 "media=\"%s-$Number$."SEGMENT_EXT"\" "
+                 "startNumber=\"%"PRIu32"\">\n"
+                 "     <SegmentTimeline>\n",
+                 p_rend->psz_name, p_rend->p_segments[0].i_number );
+
+        for( size_t j = 0; j < p_rend->i_segments; j++ )
+        {
+            const packager_segment_t *p_seg = &p_rend->p_segments[j];
+            fprintf( fp, "      <S t=\"%"PRId64"\" d=\"%"PRId64"\"/>\n",
+                     (p_seg->i_start - p_group->i_origin) * 9 / 100,
+                     p_seg->i_duration * 9 / 100 );
+        }
+        fputs( "     </SegmentTimeline>\n    </SegmentTemplate>\n"
+               "   </Representation>\n", fp );
+    }
+    fputs( "  </AdaptationSet>\n </Period>\n</MPD>\n", fp );
+
+    FileCommit( p_stream, fp, psz_tmp, psz_path );
+    free( psz_path );
+}
+
+/*****************************************************************************
+ * Segments
+ *****************************************************************************/
+static void SegmentOpen( sout_stream_t *p_stream, mtime_t i_dts )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    char *psz_name = SegmentName( p_sys->p_rend, p_sys->p_rend->i_segment + 1 );
+    char *psz_path = psz_name ? GroupPath( p_sys->p_group, psz_name ) : NULL;
+    char *psz_file = psz_path ? config_StringEscape( psz_path ) : NULL;
+    char *psz_output;
+
+    free( psz_name );
+    free( psz_path );
+    if( psz_file == NULL )
+        return;
+
+    p_sys->i_seg_start = i_dts;
+    p_sys->i_seg_end = i_dts;
+    p_sys->i_seg_size = 0;
+
+    if( asprintf( &psz_output, "std{access=file{no-append,no-format},"
+                  "mux="SEGMENT_MUX",dst='%s'}", psz_file ) < 0 )
+    {
+        free( psz_file );
+        return;
+    }
+    free( psz_file );
+
+    p_sys->p_out = sout_StreamChainNew( p_stream->p_sout, psz_output,
+                                        NULL, NULL );
+    if( p_sys->p_out == NULL )
+    {
+        msg_Err( p_stream, "cannot create segment output `%s'", psz_output );
+        free( psz_output );
+        return;
+    }
+    free( psz_output );
+
+    for( int i = 0; i < p_sys->i_id; i++ )
+    {
+        sout_stream_id_sys_t *id = p_sys->id[i];
+        id->id = sout_StreamIdAdd( p_sys->p_out, &id->fmt );
+    }
+}
+
+/* Deletes the removed segments but the last i_keep ones */
+static void DeleteDropped( sout_stream_sys_t *p_sys, int i_keep )
+{
+    while( p_sys->i_dropped > i_keep )
+    {
+        char *psz_path = p_sys->ppsz_dropped[0];
+
+        vlc_unlink( psz_path );
+        free( psz_path );
+        TAB_ERASE( p_sys->i_dropped, p_sys->ppsz_dropped, 0 );
+    }
+}
+
+static void SegmentClose( sout_stream_t *p_stream, bool b_end )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    packager_group_t *p_group = p_sys->p_group;
+    packager_rendition_t *p_rend = p_sys->p_rend;
+
+    if( p_sys->p_out == NULL )
+        return;
+
+    for( int i = 0; i < p_sys->i_id; i++ )
+    {
+        sout_stream_id_sys_t *id = p_sys->id[i];
+        if( id->id != NULL )
+            sout_StreamIdDel( p_sys->p_out, id->id );
+        id->id = NULL;
+    }
+    sout_StreamChainDelete( p_sys->p_out, p_sys->p_out );
+    p_sys->p_out = NULL;
+
+    vlc_mutex_lock( &p_group->lock );
+
+    packager_segment_t *p_segments = realloc( p_rend->p_segments,
+                    (p_rend->i_segments + 1) * sizeof(*p_segments) );
+    if( likely(p_segments != NULL) )
+    {
+        packager_segment_t *p_seg = &p_segments[p_rend->i_segments++];
+
+        p_rend->p_segments = p_segments;
+        p_seg->i_number = p_rend->i_segment + 1;
+        p_seg->i_start = p_sys->i_seg_start;
+        p_seg->i_duration = p_sys->i_seg_end - p_sys->i_seg_start;
+        p_seg->i_size = p_sys->i_seg_size;
+
+        if( p_seg->i_duration > 0 )
+        {
+            uint64_t i_rate = UINT64_C(8) * CLOCK_FREQ * p_seg->i_size
+                            / p_seg->i_duration;
+            if( i_rate > p_rend->i_peak_bandwidth )
+                p_rend->i_peak_bandwidth = __MIN(i_rate, UINT_MAX);
+        }
+    }
+
+    /* Slide the window */
+    if( p_group->i_numsegs && p_rend->i_segments > p_group->i_numsegs )
+    {
+        size_t i_drop = p_rend->i_segments - p_group->i_numsegs;
+
+        for( size_t i = 0; i < i_drop && p_sys->b_delsegs; i++ )
+        {
+            uint32_t i_number = p_rend->p_segments[i].i_number;
+            char *psz_name = SegmentName( p_rend, i_number );
+            char *psz_path = psz_name ? GroupPath( p_group, psz_name ) : NULL;
+
+            free( psz_name );
+            if( psz_path != NULL )
+                TAB_APPEND( p_sys->i_dropped, p_sys->ppsz_dropped, psz_path );
+        }
+        memmove( p_rend->p_segments, p_rend->p_segments + i_drop,
+                 p_group->i_numsegs * sizeof(*p_rend->p_segments) );
+        p_rend->i_segments = p_group->i_numsegs;
+    }
+    DeleteDropped( p_sys, b_end ? 0 : SEGMENT_GRACE );
+
+    p_rend->b_ended = b_end;
+    WriteVariant( p_stream, p_group, p_rend );
+    if( p_group->psz_master != NULL )
+        WriteMaster( p_stream, p_group );
+    if( p_group->psz_mpd != NULL )
+        WriteMPD( p_stream, p_group );
+
+    vlc_mutex_unlock( &p_group->lock );
+}
+
+/*****************************************************************************
+ * Open:
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    sout_stream_t     *p_stream = (sout_stream_t*)p_this;
+    sout_stream_sys_t *p_sys;
+
+    config_ChainParse( p_stream, SOUT_CFG_PREFIX, ppsz_sout_options,
+                       p_stream->p_cfg );
+
+    char *psz_name = var_GetNonEmptyString( p_stream, SOUT_CFG_PREFIX "name" );
+    if( psz_name == NULL )
+    {
+        msg_Err( p_stream, "no rendition name specified" );
+        return VLC_EGENERIC;
+    }
+
+    p_sys = calloc( 1, sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+    {
+        free( psz_name );
+        return VLC_ENOMEM;
+    }
+    p_sys->b_delsegs = var_GetBool( p_stream, SOUT_CFG_PREFIX "delsegs" );
+    TAB_INIT( p_sys->i_id, p_sys->id );
+    TAB_INIT( p_sys->i_dropped, p_sys->ppsz_dropped );
+
+    packager_group_t *p_group = GroupHold( p_stream );
+    if( p_group == NULL )
+    {
+        free( psz_name );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    p_sys->p_group = p_group;
+
+    vlc_mutex_lock( &p_group->lock );
+    packager_rendition_t *p_rend = NULL;
+    for( int i = 0; i < p_group->i_renditions; i++ )
+        if( !strcmp( p_group->pp_renditions[i]->psz_name, psz_name ) )
+        {
+            p_rend = p_group->pp_renditions[i];
+            break;
+        }
+
+    if( p_rend != NULL && p_rend->b_active )
+    {
+        vlc_mutex_unlock( &p_group->lock );
+        msg_Err( p_stream, "rendition `%s' already exists", psz_name );
+        goto error;
+    }
+    if( p_rend == NULL )
+    {
+        p_rend = calloc( 1, sizeof(*p_rend) );
+        if( unlikely(p_rend == NULL) )
+        {
+            vlc_mutex_unlock( &p_group->lock );
+            goto error;
+        }
+        p_rend->psz_name = psz_name;
+        psz_name = NULL;
+        TAB_APPEND( p_group->i_renditions, p_group->pp_renditions, p_rend );
+    }
+    else
+    {   /* A rendition restarting overwrites its previous segments */
+        free( p_rend->p_segments );
+        p_rend->p_segments = NULL;
+        p_rend->i_segments = 0;
+        p_rend->i_peak_bandwidth = 0;
+        p_rend->b_ended = false;
+        p_rend->b_started = false;
+    }
+    p_rend->i_bandwidth = var_GetInteger( p_stream,
+                                          SOUT_CFG_PREFIX "bandwidth" );
+    p_rend->b_active = true;
+    p_sys->p_rend = p_rend;
+    vlc_mutex_unlock( &p_group->lock );
+    free( psz_name );
+
+    p_stream->pf_add  = Add;
+    p_stream->pf_del  = Del;
+    p_stream->pf_send = Send;
+    p_stream->p_sys   = p_sys;
+
+    return VLC_SUCCESS;
+
+error:
+    GroupRelease( p_stream, p_group );
+    free( psz_name );
+    free( p_sys );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Close:
+ *****************************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    sout_stream_t     *p_stream = (sout_stream_t*)p_this;
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    packager_group_t  *p_group = p_sys->p_group;
+
+    SegmentClose( p_stream, true );
+
+    vlc_mutex_lock( &p_group->lock );
+    p_sys->p_rend->b_ended = true;
+    p_sys->p_rend->b_active = false;
+    vlc_mutex_unlock( &p_group->lock );
+    GroupRelease( p_stream, p_group );
+
+    DeleteDropped( p_sys, 0 );
+    TAB_CLEAN( p_sys->i_dropped, p_sys->ppsz_dropped );
+    TAB_CLEAN( p_sys->i_id, p_sys->id );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Add/Del/Send:
+ *****************************************************************************/
+static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
+                                  const es_format_t *p_fmt )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    sout_stream_id_sys_t *id = malloc( sizeof(*id) );
+
+    if( unlikely(id == NULL) )
+        return NULL;
+
+    es_format_Copy( &id->fmt, p_fmt );
+    id->id = NULL;
+    if( p_sys->p_out != NULL )
+        id->id = sout_StreamIdAdd( p_sys->p_out, &id->fmt );
+
+    if( p_fmt->i_cat == VIDEO_ES )
+    {
+        packager_group_t *p_group = p_sys->p_group;
+
+        vlc_mutex_lock( &p_group->lock );
+        p_sys->p_rend->i_width = p_fmt->video.i_visible_width;
+        p_sys->p_rend->i_height = p_fmt->video.i_visible_height;
+        vlc_mutex_unlock( &p_group->lock );
+    }
+
+    TAB_APPEND( p_sys->i_id, p_sys->id, id );
+    return id;
+}
+
+static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( id->id != NULL )
+        sout_StreamIdDel( p_sys->p_out, id->id );
+    TAB_REMOVE( p_sys->i_id, p_sys->id, id );
+    es_format_Clean( &id->fmt );
+    free( id );
+}
+
+/* Segments start on video keyframes, or anywhere for audio only renditions */
+static bool IsCutPoint( const sout_stream_sys_t *p_sys,
+                        const sout_stream_id_sys_t *id, const block_t *p_block )
+{
+    if( id->fmt.i_cat == VIDEO_ES )
+        return p_block->i_flags & BLOCK_FLAG_TYPE_I;
+    if( id->fmt.i_cat != AUDIO_ES )
+        return false;
+    for( int i = 0; i < p_sys->i_id; i++ )
+        if( p_sys->id[i]->fmt.i_cat == VIDEO_ES )
+            return false;
+    return true;
+}
+
+static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                 block_t *p_buffer )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    packager_group_t *p_group = p_sys->p_group;
+
+    while( p_buffer != NULL )
+    {
+        block_t *p_next = p_buffer->p_next;
+        p_buffer->p_next = NULL;
+
+        if( p_buffer->i_dts > VLC_TS_INVALID
+         && IsCutPoint( p_sys, id, p_buffer ) )
+        {
+            packager_rendition_t *p_rend = p_sys->p_rend;
+            bool b_started = p_rend->b_started;
+
+            vlc_mutex_lock( &p_group->lock );
+            uint32_t i_next = b_started ? p_rend->i_segment + 1
+                                        : p_group->i_cuts_base;
+            if( !b_started )
+            {   /* Join the group timeline on its next boundary */
+                while( i_next - p_group->i_cuts_base < p_group->i_cuts
+                    && p_group->p_cuts[i_next - p_group->i_cuts_base]
+                           < p_buffer->i_dts )
+                    i_next++;
+            }
+            bool b_cut = GroupCanCut( p_stream, p_group, i_next,
+                                      p_buffer->i_dts );
+            vlc_mutex_unlock( &p_group->lock );
+
+            if( b_cut )
+            {
+                if( b_started )
+                {
+                    p_sys->i_seg_end = p_buffer->i_dts;
+                    SegmentClose( p_stream, false );
+                }
+                vlc_mutex_lock( &p_group->lock );
+                p_rend->i_segment = i_next;
+                p_rend->b_started = true;
+                GroupTrimCuts( p_group );
+                vlc_mutex_unlock( &p_group->lock );
+                SegmentOpen( p_stream, p_buffer->i_dts );
+            }
+        }
+
+        if( p_sys->p_out == NULL || id->id == NULL )
+        {   /* Not started yet, or broken segment output */
+            block_Release( p_buffer );
+        }
+        else
+        {
+            mtime_t i_end = p_buffer->i_dts + p_buffer->i_length;
+            if( i_end > p_sys->i_seg_end )
+                p_sys->i_seg_end = i_end;
+            p_sys->i_seg_size += p_buffer->i_buffer;
+            sout_StreamIdSend( p_sys->p_out, id->id, p_buffer );
+        }
+
+        p_buffer = p_next;
+    }
+    return VLC_SUCCESS;
+}
@@ -1392,89 +1392,177 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
-static void* ThreadSend( void *data )
-{
+/* Maximum number of packets sent to a sink in one system call */
+#define RTP_BATCH_MAX 32
+
 #ifdef _WIN32
 # define ENOBUFS      WSAENOBUFS
 # define EAGAIN       WSAEWOULDBLOCK
 # define EWOULDBLOCK  WSAEWOULDBLOCK
 #endif
-    sout_stream_id_sys_t *id = data;
-    unsigned i_caching = id->i_caching;
 
-    for (;;)
-    {
-        block_t *out = block_FifoGet( id->p_fifo );
-        block_cleanup_push (out);
+typedef struct
+{
+    block_t *blocks[RTP_BATCH_MAX];
+    unsigned count;
+    block_t *pending; /* dequeued but due later than the batch */
+} rtp_batch_t;
 
-#ifdef HAVE_SRTP
-        if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
+/* Sends a batch of packets that are due at the same time to all sinks */
+static void SendBatch( sout_stream_id_sys_t *id, const rtp_batch_t *batch )
+{
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgv[RTP_BATCH_MAX];
+    struct iovec iov[RTP_BATCH_MAX];
 
-            int canc = vlc_savecancel ();
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            vlc_restorecancel (canc);
-            if( val )
-            {
-                msg_Dbg( id->p_stream, "SRTP sending error: %s",
-                         vlc_strerror_c(val) );
-                block_Release( out );
-                out = NULL;
-            }
-            else
-                out->i_buffer = len;
-        }
-        if (out)
-            mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
-        if (out == NULL)
-            continue;
-#else
-        mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
+    memset( msgv, 0, batch->count * sizeof (*msgv) );
+    for( unsigned j = 0; j < batch->count; j++ )
+    {
+        iov[j].iov_base = batch->blocks[j]->p_buffer;
+        iov[j].iov_len = batch->blocks[j]->i_buffer;
+        msgv[j].msg_hdr.msg_iov = &iov[j];
+        msgv[j].msg_hdr.msg_iovlen = 1;
+    }
 #endif
 
-        ssize_t len = out->i_buffer;
-        int canc = vlc_savecancel ();
+    vlc_mutex_lock( &id->lock_sink );
+    unsigned deadc = 0; /* How many dead sockets? */
+    int deadv[id->sinkc ? id->sinkc : 1]; /* Dead sockets list */
 
-        vlc_mutex_lock( &id->lock_sink );
-        unsigned deadc = 0; /* How many dead sockets? */
-        int deadv[id->sinkc ? id->sinkc : 1]; /* Dead sockets list */
+    for( int i = 0; i < id->sinkc; i++ )
+    {
+        int fd = id->sinkv[i].rtp_fd;
 
-        for( int i = 0; i < id->sinkc; i++ )
-        {
 #ifdef HAVE_SRTP
-            if( !id->srtp ) /* FIXME: SRTCP support */
+        if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+            for( unsigned j = 0; j < batch->count; j++ )
+                SendRTCP( id->sinkv[i].rtcp, batch->blocks[j] );
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
-             && net_errno != EAGAIN && net_errno != EWOULDBLOCK
+        for( unsigned j = 0; j < batch->count; )
+        {
+#ifdef HAVE_SENDMMSG
+            int val = sendmmsg( fd, msgv + j, batch->count - j, 0 );
+            if( val > 0 )
+            {
+                j += val;
+                continue;
+            }
+#else
+            if( send( fd, batch->blocks[j]->p_buffer,
+                      batch->blocks[j]->i_buffer, 0 ) != -1 )
+            {
+                j++;
+                continue;
+            }
+#endif
+            const block_t *out = batch->blocks[j++];
+
+            if( net_errno != EAGAIN && net_errno != EWOULDBLOCK
              && net_errno != ENOBUFS && net_errno != ENOMEM )
             {
                 int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
+                getsockopt( fd, SOL_SOCKET, SO_TYPE,
                             &type, &(socklen_t){ sizeof(type) });
                 if( type == SOCK_DGRAM )
                     /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
+                    send( fd, out->p_buffer, out->i_buffer, 0 );
                 else
-                    /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
+                {   /* Broken connection */
+                    deadv[deadc++] = fd;
+                    break;
+                }
             }
         }
-        id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
-        vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
+    }
+
+    const block_t *last = batch->blocks[batch->count - 1];
+    id->i_seq_sent_next = ntohs(((uint16_t *) last->p_buffer)[1]) + 1;
+    vlc_mutex_unlock( &id->lock_sink );
 
-        for( unsigned i = 0; i < deadc; i++ )
+    for( unsigned i = 0; i < deadc; i++ )
+    {
+        msg_Dbg( id->p_stream, "removing socket %d", deadv[i] );
+        rtp_del_sink( id, deadv[i] );
+    }
+}
+
+/* Waits until a packet is due, returns NULL if it cannot be sent */
+static block_t *WaitPacket( sout_stream_id_sys_t *id, block_t *out )
+{
+    block_cleanup_push (out);
+
+#ifdef HAVE_SRTP
+    if( id->srtp )
+    {   /* FIXME: this is awfully inefficient */
+        size_t len = out->i_buffer;
+        out = block_Realloc( out, 0, len + 10 );
+        out->i_buffer = len;
+
+        int canc = vlc_savecancel ();
+        int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
+        vlc_restorecancel (canc);
+        if( val )
         {
-            msg_Dbg( id->p_stream, "removing socket %d", deadv[i] );
-            rtp_del_sink( id, deadv[i] );
+            msg_Dbg( id->p_stream, "SRTP sending error: %s",
+                     vlc_strerror_c(val) );
+            block_Release( out );
+            out = NULL;
         }
+        else
+            out->i_buffer = len;
+    }
+    if (out)
+        mwait (out->i_dts + id->i_caching);
+#else
+    mwait (out->i_dts + id->i_caching);
+#endif
+    vlc_cleanup_pop ();
+    return out;
+}
+
+static void* ThreadSend( void *data )
+{
+    sout_stream_id_sys_t *id = data;
+    rtp_batch_t batch = { .count = 0, .pending = NULL };
+
+    for (;;)
+    {
+        block_t *out = batch.pending;
+        if (out == NULL)
+            out = block_FifoGet( id->p_fifo );
+        batch.pending = NULL;
+
+        out = WaitPacket( id, out );
+        if (out == NULL)
+            continue;
+
+        int canc = vlc_savecancel ();
+
+        batch.blocks[0] = out;
+        batch.count = 1;
+#ifdef HAVE_SRTP
+        if( !id->srtp )
+#endif
+        {   /* Take along the queued packets that are due by now too */
+            vlc_fifo_Lock( id->p_fifo );
+            while( batch.count < RTP_BATCH_MAX
+                && !vlc_fifo_IsEmpty( id->p_fifo ) )
+            {
+                block_t *next = vlc_fifo_DequeueUnlocked( id->p_fifo );
+                if( next->i_dts > out->i_dts )
+                {
+                    batch.pending = next;
+                    break;
+                }
+                batch.blocks[batch.count++] = next;
+            }
+            vlc_fifo_Unlock( id->p_fifo );
+        }
+
+        SendBatch( id, &batch );
+        for( unsigned j = 0; j < batch.count; j++ )
+            block_Release( batch.blocks[j] );
         vlc_restorecancel (canc);
     }
     return NULL;
@@ -94,6 +94,10 @@ struct filter_sys_t
 
     /* FFT window parameters */
     window_param wind_param;
+
+    /* FFT and window data */
+    fft_state *p_state;
+    window_context wind_ctx;
 };
 
 
@@ -134,6 +138,20 @@ static int Open(vlc_object_t * p_this)
     /* Fetch the FFT window parameters */
     window_get_param( VLC_OBJECT( p_filter ), &p_sys->wind_param );
 
+    /* Set the FFT and its window up once for all */
+    p_sys->p_state = visual_fft_init(FFT_BUFFER_SIZE_LOG);
+    if (p_sys->p_state == NULL)
+    {
+        free(p_sys);
+        return VLC_ENOMEM;
+    }
+    if (!window_init(FFT_BUFFER_SIZE, &p_sys->wind_param, &p_sys->wind_ctx))
+    {
+        fft_close(p_sys->p_state);
+        free(p_sys);
+        return VLC_ENOMEM;
+    }
+
     /* Create the FIFO for the audio data. */
     p_sys->fifo = block_FifoNew();
     if (p_sys->fifo == NULL)
@@ -164,6 +182,8 @@ static int Open(vlc_object_t * p_this)
     return VLC_SUCCESS;
 
 error:
+    window_close(&p_sys->wind_ctx);
+    fft_close(p_sys->p_state);
     free(p_sys);
     return VLC_EGENERIC;
 }
@@ -186,6 +206,8 @@ static void Close(vlc_object_t *p_this)
     vlc_gl_surface_Destroy(p_sys->gl);
     block_FifoRelease(p_sys->fifo);
     free(p_sys->p_prev_s16_buff);
+    window_close(&p_sys->wind_ctx);
+    fft_close(p_sys->p_state);
     free(p_sys);
 }
 
@@ -374,14 +396,11 @@ static void *Thread( void *p_data )
         const unsigned xscale[] = {0,1,2,3,4,5,6,7,8,11,15,20,27,
                                    36,47,62,82,107,141,184,255};
 
-        fft_state *p_state = NULL; /* internal FFT data */
-        DEFINE_WIND_CONTEXT(wind_ctx); /* internal window data */
-
-        unsigned i, j;
+        unsigned i;
         float p_output[FFT_BUFFER_SIZE];           /* Raw FFT Result  */
         int16_t p_buffer1[FFT_BUFFER_SIZE];        /* Buffer on which we perform
                                                       the FFT (first channel) */
-        int16_t p_dest[FFT_BUFFER_SIZE];           /* Adapted FFT result */
+        float p_bands[NB_BANDS];                   /* Maximum of each band */
         float *p_buffl = (float*)block->p_buffer;  /* Original buffer */
 
         int16_t  *p_buffs;                         /* int16_t converted buffer */
@@ -421,33 +440,18 @@ static void *Thread( void *p_data )
 
             p_buffl++; p_buffs++;
         }
-        p_state = visual_fft_init();
-        if (!p_state)
-        {
-            msg_Err(p_filter,"unable to initialize FFT transform");
-            goto release;
-        }
-        if (!window_init(FFT_BUFFER_SIZE, &p_sys->wind_param, &wind_ctx))
-        {
-            msg_Err(p_filter,"unable to initialize FFT window");
-            goto release;
-        }
         p_buffs = p_s16_buff;
         for (i = 0 ; i < FFT_BUFFER_SIZE; i++)
         {
-            p_output[i] = 0;
             p_buffer1[i] = *p_buffs;
 
             p_buffs += p_sys->i_channels;
             if (p_buffs >= &p_s16_buff[block->i_nb_samples * p_sys->i_channels])
                 p_buffs = p_s16_buff;
         }
-        window_scale_in_place (p_buffer1, &wind_ctx);
-        fft_perform (p_buffer1, p_output, p_state);
-
-        for (i = 0; i< FFT_BUFFER_SIZE; ++i)
-            p_dest[i] = p_output[i] *  (2 ^ 16)
-                        / ((FFT_BUFFER_SIZE / 2 * 32768) ^ 2);
+        window_scale_in_place (p_buffer1, &p_sys->wind_ctx);
+        fft_perform (p_buffer1, p_output, p_sys->p_state);
+        fft_bands_max (p_output, xscale, NB_BANDS, p_bands);
 
         for (i = 0 ; i < NB_BANDS; i++)
         {
@@ -456,14 +460,10 @@ static void *Thread( void *p_data )
             if (height[i] < 0)
                 height[i] = 0;
 
-            int y = 0;
-            /* We search the maximum on one scale
-               to determine the current size of the bar. */
-            for (j = xscale[i]; j < xscale[i + 1]; j++)
-            {
-                if (p_dest[j] > y)
-                     y = p_dest[j];
-            }
+            /* The maximum on one scale determines the current size of
+               the bar. */
+            int y = __MIN(p_bands[i] * (2 ^ 16)
+                          / ((FFT_BUFFER_SIZE / 2 * 32768) ^ 2), INT16_MAX);
             /* Calculate the height of the bar */
             float new_height = y != 0 ? logf(y) * 0.4f : 0;
             height[i] = new_height > height[i]
@@ -490,8 +490,6 @@ static void *Thread( void *p_data )
         vlc_gl_Swap(gl);
 
 release:
-        window_close(&wind_ctx);
-        fft_close(p_state);
         vlc_gl_ReleaseCurrent(gl);
         block_Release(block);
         vlc_restorecancel(canc);
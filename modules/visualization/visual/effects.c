@@ -62,6 +62,42 @@ static void dummy_Free( void *data )
     VLC_UNUSED(data);
 }
 
+/* Horizontal scale for 20-band equalizer */
+static const unsigned xscale1[]={0,1,2,3,4,5,6,7,8,11,15,20,27,
+                                 36,47,62,82,107,141,184,255};
+
+/* Horizontal scale for 80-band equalizer */
+static const unsigned xscale2[] =
+{0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,
+ 19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,
+ 35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51,
+ 52,53,54,55,56,57,58,59,61,63,67,72,77,82,87,93,99,105,
+ 110,115,121,130,141,152,163,174,185,200,255};
+
+/* The FFT and its window are set up once per effect */
+static int fft_Init( vlc_object_t *p_aout, window_param *p_wind_param,
+                     fft_state **pp_state, window_context *p_wind_ctx )
+{
+    window_get_param( p_aout, p_wind_param );
+
+    *pp_state = visual_fft_init( FFT_BUFFER_SIZE_LOG );
+    if( !*pp_state )
+    {
+        msg_Err(p_aout,"unable to initialize FFT transform");
+        return -1;
+    }
+    p_wind_ctx->pf_window_table = NULL;
+    p_wind_ctx->i_buffer_size = 0;
+    if( !window_init( FFT_BUFFER_SIZE, p_wind_param, p_wind_ctx ) )
+    {
+        fft_close( *pp_state );
+        *pp_state = NULL;
+        msg_Err(p_aout,"unable to initialize FFT window");
+        return -1;
+    }
+    return 0;
+}
+
 
 /*****************************************************************************
  * spectrum_Run: spectrum analyser
@@ -75,6 +111,8 @@ typedef struct spectrum_data
     int16_t *p_prev_s16_buff;
 
     window_param wind_param;
+    fft_state *p_state;                 /* internal FFT data */
+    window_context wind_ctx;            /* internal window data */
 } spectrum_data;
 
 static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
@@ -91,25 +129,11 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
     int i_start;                      /* first band horizontal position */
     int i_peak;                       /* Should we draw peaks ? */
 
-    /* Horizontal scale for 20-band equalizer */
-    const int xscale1[]={0,1,2,3,4,5,6,7,8,11,15,20,27,
-                        36,47,62,82,107,141,184,255};
-
-    /* Horizontal scale for 80-band equalizer */
-    const int xscale2[] =
-    {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,
-     19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,
-     35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51,
-     52,53,54,55,56,57,58,59,61,63,67,72,77,82,87,93,99,105,
-     110,115,121,130,141,152,163,174,185,200,255};
-    const int *xscale;
-
-    fft_state *p_state;                 /* internal FFT data */
-    DEFINE_WIND_CONTEXT( wind_ctx );    /* internal window data */
+    const unsigned *xscale;
+    float p_bands[80];                /* Maximum intensity of each band */
 
     int i , j , y , k;
     int i_line;
-    int16_t p_dest[FFT_BUFFER_SIZE];      /* Adapted FFT result */
     int16_t p_buffer1[FFT_BUFFER_SIZE];   /* Buffer on which we perform
                                              the FFT (first channel) */
 
@@ -137,7 +161,15 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         p_data->i_prev_nb_samples = 0;
         p_data->p_prev_s16_buff = NULL;
 
-        window_get_param( p_aout, &p_data->wind_param );
+        if( fft_Init( p_aout, &p_data->wind_param, &p_data->p_state,
+                      &p_data->wind_ctx ) )
+        {
+            free( p_data->peaks );
+            free( p_data->prev_heights );
+            free( p_data );
+            p_effect->p_data = NULL;
+            return -1;
+        }
     }
     peaks = (int *)p_data->peaks;
     prev_heights = (int *)p_data->prev_heights;
@@ -186,24 +218,9 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
 
         p_buffl++ ; p_buffs++ ;
     }
-    p_state  = visual_fft_init();
-    if( !p_state)
-    {
-        free( height );
-        msg_Err(p_aout,"unable to initialize FFT transform");
-        return -1;
-    }
-    if( !window_init( FFT_BUFFER_SIZE, &p_data->wind_param, &wind_ctx ) )
-    {
-        fft_close( p_state );
-        free( height );
-        msg_Err(p_aout,"unable to initialize FFT window");
-        return -1;
-    }
     p_buffs = p_s16_buff;
     for ( i = 0 ; i < FFT_BUFFER_SIZE ; i++)
     {
-        p_output[i]  = 0;
         p_buffer1[i] = *p_buffs;
 
         p_buffs += p_effect->i_nb_chans;
@@ -211,10 +228,9 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
             p_buffs = p_s16_buff;
 
     }
-    window_scale_in_place( p_buffer1, &wind_ctx );
-    fft_perform( p_buffer1, p_output, p_state);
-    for( i = 0; i< FFT_BUFFER_SIZE ; i++ )
-        p_dest[i] = p_output[i] *  ( 2 ^ 16 ) / ( ( FFT_BUFFER_SIZE / 2 * 32768 ) ^ 2 );
+    window_scale_in_place( p_buffer1, &p_data->wind_ctx );
+    fft_perform( p_buffer1, p_output, p_data->p_state );
+    fft_bands_max( p_output, xscale, i_nb_bands, p_bands );
 
     /* Compute the horizontal position of the first band */
     i_band_width = floor( p_effect->i_width / i_nb_bands);
@@ -222,12 +238,9 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
 
     for ( i = 0 ; i < i_nb_bands ;i++)
     {
-        /* We search the maximum on one scale */
-        for( j = xscale[i], y = 0; j< xscale[ i + 1 ]; j++ )
-        {
-            if ( p_dest[j] > y )
-                 y = p_dest[j];
-        }
+        /* Adapt the maximum on one scale */
+        y = __MIN( p_bands[i] * ( 2 ^ 16 )
+                   / ( ( FFT_BUFFER_SIZE / 2 * 32768 ) ^ 2 ), INT16_MAX );
         /* Calculate the height of the bar */
         if( y != 0 )
         {
@@ -359,10 +372,6 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         }
     }
 
-    window_close( &wind_ctx );
-
-    fft_close( p_state );
-
     free( height );
 
     return 0;
@@ -374,6 +383,8 @@ static void spectrum_Free( void *data )
 
     if( p_data != NULL )
     {
+        window_close( &p_data->wind_ctx );
+        fft_close( p_data->p_state );
         free( p_data->peaks );
         free( p_data->prev_heights );
         free( p_data->p_prev_s16_buff );
@@ -393,6 +404,8 @@ typedef struct
     int16_t *p_prev_s16_buff;
 
     window_param wind_param;
+    fft_state *p_state;                 /* internal FFT data */
+    window_context wind_ctx;            /* internal window data */
 } spectrometer_data;
 
 static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
@@ -428,26 +441,12 @@ static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
     char color1;             /* V slide on a YUV color cube */
     //char color2;             /* U slide.. ?  color2 fade color ? */
 
-    /* Horizontal scale for 20-band equalizer */
-    const int xscale1[]={0,1,2,3,4,5,6,7,8,11,15,20,27,
-                        36,47,62,82,107,141,184,255};
-
-    /* Horizontal scale for 80-band equalizer */
-    const int xscale2[] =
-    {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,
-     19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,
-     35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51,
-     52,53,54,55,56,57,58,59,61,63,67,72,77,82,87,93,99,105,
-     110,115,121,130,141,152,163,174,185,200,255};
-    const int *xscale;
+    const unsigned *xscale;
     const double y_scale =  3.60673760222;  /* (log 256) */
-
-    fft_state *p_state;                 /* internal FFT data */
-    DEFINE_WIND_CONTEXT( wind_ctx );    /* internal window data */
+    float p_bands[80];                /* Maximum intensity of each band */
 
     int i , j , k;
     int i_line = 0;
-    int16_t p_dest[FFT_BUFFER_SIZE];      /* Adapted FFT result */
     int16_t p_buffer1[FFT_BUFFER_SIZE];   /* Buffer on which we perform
                                              the FFT (first channel) */
     float *p_buffl =                     /* Original buffer */
@@ -476,7 +475,13 @@ static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         }
         p_data->i_prev_nb_samples = 0;
         p_data->p_prev_s16_buff = NULL;
-        window_get_param( p_aout, &p_data->wind_param );
+        if( fft_Init( p_aout, &p_data->wind_param, &p_data->p_state,
+                      &p_data->wind_ctx ) )
+        {
+            free( p_data->peaks );
+            free( p_data );
+            return -1;
+        }
         p_effect->p_data = (void*)p_data;
     }
     peaks = p_data->peaks;
@@ -534,48 +539,26 @@ static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
 
         p_buffl++ ; p_buffs++ ;
     }
-    p_state  = visual_fft_init();
-    if( !p_state)
-    {
-        msg_Err(p_aout,"unable to initialize FFT transform");
-        free( height );
-        return -1;
-    }
-    if( !window_init( FFT_BUFFER_SIZE, &p_data->wind_param, &wind_ctx ) )
-    {
-        fft_close( p_state );
-        free( height );
-        msg_Err(p_aout,"unable to initialize FFT window");
-        return -1;
-    }
     p_buffs = p_s16_buff;
     for ( i = 0 ; i < FFT_BUFFER_SIZE; i++)
     {
-        p_output[i]    = 0;
         p_buffer1[i] = *p_buffs;
 
         p_buffs += p_effect->i_nb_chans;
         if( p_buffs >= &p_s16_buff[p_buffer->i_nb_samples * p_effect->i_nb_chans] )
             p_buffs = p_s16_buff;
     }
-    window_scale_in_place( p_buffer1, &wind_ctx );
-    fft_perform( p_buffer1, p_output, p_state);
-    for(i = 0; i < FFT_BUFFER_SIZE; i++)
-    {
-        int sqrti = sqrt(p_output[i]);
-        p_dest[i] = sqrti >> 8;
-    }
+    window_scale_in_place( p_buffer1, &p_data->wind_ctx );
+    fft_perform( p_buffer1, p_output, p_data->p_state );
+    fft_bands_max( p_output, xscale, i_nb_bands, p_bands );
 
     i_nb_bands *= i_sections;
 
     for ( i = 0 ; i< i_nb_bands/i_sections ;i++)
     {
-        /* We search the maximum on one scale */
-        for( j = xscale[i] , y=0 ; j< xscale[ i + 1 ] ; j++ )
-        {
-            if ( p_dest[j] > y )
-                 y = p_dest[j];
-        }
+        /* Adapt the maximum on one scale */
+        y = sqrtf( p_bands[i] );
+        y >>= 8;
         /* Calculate the height of the bar */
         y >>=7;/* remove some noise */
         if( y != 0)
@@ -856,10 +839,6 @@ static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         }
     }
 
-    window_close( &wind_ctx );
-
-    fft_close( p_state );
-
     free( height );
 
     return 0;
@@ -871,6 +850,8 @@ static void spectrometer_Free( void *data )
 
     if( p_data != NULL )
     {
+        window_close( &p_data->wind_ctx );
+        fft_close( p_data->p_state );
         free( p_data->peaks );
         free( p_data->p_prev_s16_buff );
         free( p_data );
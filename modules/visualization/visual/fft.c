@@ -23,9 +23,16 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
 #include <stdlib.h>
+#include <vlc_common.h>
+#include <vlc_cpu.h>
 #include "fft.h"
 
+#include <assert.h>
 #include <math.h>
 #ifndef PI
  #ifdef M_PI
@@ -35,44 +42,80 @@
  #endif
 #endif
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+
 /******************************************************************************
  * Local prototypes
  *****************************************************************************/
 static void fft_prepare(const sound_sample *input, float * re, float * im,
-                        const unsigned int *bitReverse);
+                        const unsigned int *bitReverse, unsigned int size);
 static void fft_calculate(float * re, float * im,
-                          const float *costable, const float *sintable );
-static void fft_output(const float *re, const float *im, float *output);
-static int reverseBits(unsigned int initial);
+                          const float *costable, const float *sintable,
+                          unsigned int size);
+static void fft_output(const float *re, const float *im, float *output,
+                       const float *costable, const float *sintable,
+                       unsigned int size);
+static unsigned int reverseBits(unsigned int initial, unsigned int bits);
 
 /*****************************************************************************
  * These functions are the ones called externally
  *****************************************************************************/
 
 /*
- * Initialisation routine - sets up tables and space to work in.
+ * Initialisation routine - sets up tables and space to work in, for a
+ * transform of 2 ^ size_log samples (size_log >= 2).
  * Returns a pointer to internal state, to be used when performing calls.
  * On error, returns NULL.
  * The pointer should be freed when it is finished with, by fft_close().
  */
-fft_state *visual_fft_init(void)
+fft_state *visual_fft_init(unsigned int size_log)
 {
     fft_state *p_state;
-    unsigned int i;
+    /* The real FFT of N samples is computed with a complex FFT of N / 2 */
+    const unsigned int half = 1 << (size_log - 1);
 
+    assert(size_log >= 2);
     p_state = malloc( sizeof(*p_state) );
     if(! p_state )
         return NULL;
 
-    for(i = 0; i < FFT_BUFFER_SIZE; i++)
+    /* real, imag, costable, sintable, split_costable and split_sintable */
+    p_state->real = malloc( (6 * half + 2) * sizeof(float) );
+    p_state->bitReverse = malloc( half * sizeof(unsigned int) );
+    if( !p_state->real || !p_state->bitReverse )
     {
-        p_state->bitReverse[i] = reverseBits(i);
+        free( p_state->real );
+        free( p_state->bitReverse );
+        free( p_state );
+        return NULL;
     }
-    for(i = 0; i < FFT_BUFFER_SIZE / 2; i++)
+    p_state->size_log = size_log;
+    p_state->imag = p_state->real + half;
+    p_state->costable = p_state->imag + half;
+    p_state->sintable = p_state->costable + half;
+    p_state->split_costable = p_state->sintable + half;
+    p_state->split_sintable = p_state->split_costable + half + 1;
+
+    for(unsigned int i = 0; i < half; i++)
+        p_state->bitReverse[i] = reverseBits(i, size_log - 1);
+
+    /* Pass with 'exchanges' butterflies per group: its factors start at
+     * 'exchanges' - 1 in the tables */
+    for(unsigned int exchanges = 1; exchanges < half; exchanges <<= 1)
+        for(unsigned int j = 0; j < exchanges; j++)
+        {
+            double a = PI * j / exchanges;
+            p_state->costable[exchanges - 1 + j] = cos(a);
+            p_state->sintable[exchanges - 1 + j] = -sin(a);
+        }
+
+    for(unsigned int i = 0; i <= half; i++)
     {
-        float j = 2 * PI * i / FFT_BUFFER_SIZE;
-        p_state->costable[i] = cos(j);
-        p_state->sintable[i] = sin(j);
+        double a = PI * i / half;
+        p_state->split_costable[i] = cos(a);
+        p_state->split_sintable[i] = -sin(a);
     }
 
     return p_state;
@@ -81,30 +124,53 @@ fft_state *visual_fft_init(void)
 /*
  * Do all the steps of the FFT, taking as input sound data (as described in
  * sound.h) and returning the intensities of each frequency as floats in the
- * range 0 to ((FFT_BUFFER_SIZE / 2) * 32768) ^ 2
+ * range 0 to ((size / 2) * 32768) ^ 2
  *
- * The input array is assumed to have FFT_BUFFER_SIZE elements,
- * and the output array is assumed to have (FFT_BUFFER_SIZE / 2 + 1) elements.
+ * The input array is assumed to have 2 ^ size_log elements,
+ * and the output array is assumed to have (2 ^ size_log / 2 + 1) elements.
  * state is a (non-NULL) pointer returned by visual_fft_init.
  */
 void fft_perform(const sound_sample *input, float *output, fft_state *state) {
-    /* Convert data from sound format to be ready for FFT */
-    fft_prepare(input, state->real, state->imag, state->bitReverse );
+    const unsigned int half = 1 << (state->size_log - 1);
+
+    /* Pack the even and odd samples as the real and imaginary parts */
+    fft_prepare(input, state->real, state->imag, state->bitReverse, half);
 
     /* Do the actual FFT */
-    fft_calculate(state->real, state->imag, state->costable, state->sintable);
+    fft_calculate(state->real, state->imag, state->costable, state->sintable,
+                  half);
 
     /* Convert the FFT output into intensities */
-    fft_output(state->real, state->imag, output);
+    fft_output(state->real, state->imag, output,
+               state->split_costable, state->split_sintable, half);
 }
 
 /*
  * Free the state.
  */
 void fft_close(fft_state *state) {
+    free( state->bitReverse );
+    free( state->real );
     free( state );
 }
 
+/*
+ * Compute the maximum intensity of each band, band i spanning the
+ * intensities from xscale[i] included to xscale[i + 1] excluded.
+ */
+void fft_bands_max(const float *output, const unsigned int *xscale,
+                   unsigned int nb_bands, float *bands)
+{
+    for(unsigned int i = 0; i < nb_bands; i++)
+    {
+        float max = 0.f;
+        for(unsigned int j = xscale[i]; j < xscale[i + 1]; j++)
+            if(output[j] > max)
+                max = output[j];
+        bands[i] = max;
+    }
+}
+
 /*****************************************************************************
  * These functions are called from the other ones
  *****************************************************************************/
@@ -113,92 +179,115 @@ void fft_close(fft_state *state) {
  * Prepare data to perform an FFT on
  */
 static void fft_prepare( const sound_sample *input, float * re, float * im,
-                         const unsigned int *bitReverse ) {
-    unsigned int i;
-    float *p_real = re;
-    float *p_imag = im;
-
+                         const unsigned int *bitReverse, unsigned int size ) {
     /* Get input, in reverse bit order */
-    for(i = 0; i < FFT_BUFFER_SIZE; i++)
+    for(unsigned int i = 0; i < size; i++)
     {
-        *p_real++ = input[bitReverse[i]];
-        *p_imag++ = 0;
+        re[i] = input[2 * bitReverse[i]];
+        im[i] = input[2 * bitReverse[i] + 1];
     }
 }
 
 /*
  * Take result of an FFT and calculate the intensities of each frequency
+ * of the real input: X[k] = E[k] + W^k O[k] where E and O are the
+ * transforms of the even and odd samples, recovered from the complex one.
  * Note: only produces half as many data points as the input had.
  */
-static void fft_output(const float * re, const float * im, float *output)
+static void fft_output(const float * re, const float * im, float *output,
+                       const float *costable, const float *sintable,
+                       unsigned int size)
 {
-    float *p_output = output;
-    const float *p_real   = re;
-    const float *p_imag   = im;
-    float *p_end    = output + FFT_BUFFER_SIZE / 2;
-
-    while(p_output <= p_end)
+    for(unsigned int k = 0; k <= size; k++)
     {
-        *p_output = (*p_real * *p_real) + (*p_imag * *p_imag);
-        p_output++; p_real++; p_imag++;
+        const unsigned int a = k & (size - 1), b = (size - k) & (size - 1);
+        const float even_re = (re[a] + re[b]) * .5f;
+        const float even_im = (im[a] - im[b]) * .5f;
+        const float odd_re = (im[a] + im[b]) * .5f;
+        const float odd_im = (re[b] - re[a]) * .5f;
+        const float x_re = even_re + costable[k] * odd_re - sintable[k] * odd_im;
+        const float x_im = even_im + costable[k] * odd_im + sintable[k] * odd_re;
+
+        output[k] = x_re * x_re + x_im * x_im;
     }
     /* Do divisions to keep the constant and highest frequency terms in scale
      * with the other terms. */
-    *output /= 4;
-    *p_end /= 4;
+    output[0] /= 4;
+    output[size] /= 4;
 }
 
-
+#ifdef HAVE_SSE2_INTRINSICS
 /*
- * Actually perform the FFT
+ * Butterflies of one pass, four exchanges at a time (exchanges >= 4)
  */
-static void fft_calculate(float * re, float * im, const float *costable, const float *sintable )
+__attribute__ ((__target__ ("sse2")))
+static void fft_pass_SSE2(float * re, float * im,
+                          const float *costable, const float *sintable,
+                          unsigned int exchanges, unsigned int size)
 {
-    unsigned int i, j, k;
-    unsigned int exchanges;
-    float fact_real, fact_imag;
-    float tmp_real, tmp_imag;
-    unsigned int factfact;
+    for(unsigned int k = 0; k < size; k += exchanges << 1)
+        for(unsigned int j = 0; j < exchanges; j += 4)
+        {
+            float *re0 = &re[k + j], *im0 = &im[k + j];
+            float *re1 = re0 + exchanges, *im1 = im0 + exchanges;
+            const __m128 fact_real = _mm_loadu_ps(&costable[j]);
+            const __m128 fact_imag = _mm_loadu_ps(&sintable[j]);
+            const __m128 r1 = _mm_loadu_ps(re1), i1 = _mm_loadu_ps(im1);
+            const __m128 r0 = _mm_loadu_ps(re0), i0 = _mm_loadu_ps(im0);
+            const __m128 tmp_real = _mm_sub_ps(_mm_mul_ps(fact_real, r1),
+                                               _mm_mul_ps(fact_imag, i1));
+            const __m128 tmp_imag = _mm_add_ps(_mm_mul_ps(fact_real, i1),
+                                               _mm_mul_ps(fact_imag, r1));
 
-    /* Set up some variables to reduce calculation in the loops */
-    exchanges = 1;
-    factfact = FFT_BUFFER_SIZE / 2;
+            _mm_storeu_ps(re1, _mm_sub_ps(r0, tmp_real));
+            _mm_storeu_ps(im1, _mm_sub_ps(i0, tmp_imag));
+            _mm_storeu_ps(re0, _mm_add_ps(r0, tmp_real));
+            _mm_storeu_ps(im0, _mm_add_ps(i0, tmp_imag));
+        }
+}
+#endif
 
+/*
+ * Actually perform the FFT
+ */
+static void fft_calculate(float * re, float * im, const float *costable,
+                          const float *sintable, unsigned int size)
+{
     /* Loop through the divide and conquer steps */
-    for(i = FFT_BUFFER_SIZE_LOG; i != 0; i--) {
-        /* In this step, we have 2 ^ (i - 1) exchange groups, each with
-         * 2 ^ (FFT_BUFFER_SIZE_LOG - i) exchanges
-         */
-        /* Loop through the exchanges in a group */
-        for(j = 0; j != exchanges; j++) {
-            /* Work out factor for this exchange
-             * factor ^ (exchanges) = -1
-             * So, real = cos(j * PI / exchanges),
-             *     imag = sin(j * PI / exchanges)
-             */
-            fact_real = costable[j * factfact];
-            fact_imag = sintable[j * factfact];
-
-            /* Loop through all the exchange groups */
-            for(k = j; k < FFT_BUFFER_SIZE; k += exchanges << 1) {
-                int k1 = k + exchanges;
-                tmp_real = fact_real * re[k1] - fact_imag * im[k1];
-                tmp_imag = fact_real * im[k1] + fact_imag * re[k1];
-                re[k1] = re[k] - tmp_real;
-                im[k1] = im[k] - tmp_imag;
-                re[k]  += tmp_real;
-                im[k]  += tmp_imag;
+    for(unsigned int exchanges = 1; exchanges < size; exchanges <<= 1) {
+        /* In this step, there are size / (2 * exchanges) exchange groups,
+         * each with 'exchanges' exchanges, sharing the same factors
+         * cos(j * PI / exchanges) - i sin(j * PI / exchanges) */
+        const float *cos_pass = &costable[exchanges - 1];
+        const float *sin_pass = &sintable[exchanges - 1];
+
+#ifdef HAVE_SSE2_INTRINSICS
+        if (exchanges >= 4 && vlc_CPU_SSE2())
+        {
+            fft_pass_SSE2(re, im, cos_pass, sin_pass, exchanges, size);
+            continue;
+        }
+#endif
+        /* Loop through all the exchange groups */
+        for(unsigned int k = 0; k < size; k += exchanges << 1) {
+            /* Loop through the exchanges in a group */
+            for(unsigned int j = 0; j < exchanges; j++) {
+                const unsigned int k0 = k + j, k1 = k0 + exchanges;
+                const float tmp_real = cos_pass[j] * re[k1] - sin_pass[j] * im[k1];
+                const float tmp_imag = cos_pass[j] * im[k1] + sin_pass[j] * re[k1];
+                re[k1] = re[k0] - tmp_real;
+                im[k1] = im[k0] - tmp_imag;
+                re[k0] += tmp_real;
+                im[k0] += tmp_imag;
             }
         }
-        exchanges <<= 1;
-        factfact >>= 1;
     }
 }
 
-static int reverseBits(unsigned int initial)
+static unsigned int reverseBits(unsigned int initial, unsigned int bits)
 {
     unsigned int reversed = 0, loop;
-    for(loop = 0; loop < FFT_BUFFER_SIZE_LOG; loop++) {
+    for(loop = 0; loop < bits; loop++) {
         reversed <<= 1;
         reversed += (initial & 1);
         initial >>= 1;
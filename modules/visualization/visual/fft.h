@@ -33,24 +33,33 @@
 typedef short int sound_sample;
 
 struct _struct_fft_state {
-     /* Temporary data stores to perform FFT in. */
-     float real[FFT_BUFFER_SIZE];
-     float imag[FFT_BUFFER_SIZE];
+     /* The transform works on 2 ^ size_log real samples */
+     unsigned int size_log;
+
+     /* Temporary data stores to perform the half size complex FFT in. */
+     float *real;
+     float *imag;
 
      /* */
-     unsigned int bitReverse[FFT_BUFFER_SIZE];
+     unsigned int *bitReverse;
+
+     /* Twiddle factors of each complex FFT pass, one after the other, so
+      * that every pass reads them contiguously. */
+     float *costable;
+     float *sintable;
 
-     /* The next two tables could be made to use less space in memory, since they
-      * overlap hugely, but hey. */
-     float sintable[FFT_BUFFER_SIZE / 2];
-     float costable[FFT_BUFFER_SIZE / 2];
+     /* Twiddle factors turning the complex FFT into the real one */
+     float *split_costable;
+     float *split_sintable;
 };
 
 /* FFT prototypes */
 typedef struct _struct_fft_state fft_state;
-fft_state *visual_fft_init (void);
+fft_state *visual_fft_init (unsigned int size_log);
 void fft_perform (const sound_sample *input, float *output, fft_state *state);
 void fft_close (fft_state *state);
+void fft_bands_max (const float *output, const unsigned int *xscale,
+                    unsigned int nb_bands, float *bands);
 
 
 #endif /* include-guard */
@@ -91,6 +91,9 @@ typedef struct
 
     atomic_uint buffers_lost;
     atomic_uint buffers_played;
+    atomic_uint buffers_late; /**< Flushed by the synchronization */
+    atomic_uint buffers_early; /**< Preceded by silence */
+    atomic_int resampling; /**< Current resampling adjustment (Hz) */
     atomic_uchar restart;
 } aout_owner_t;
 
@@ -153,6 +156,8 @@ int aout_DecNew(audio_output_t *, const audio_sample_format_t *,
 void aout_DecDelete(audio_output_t *);
 int aout_DecPlay(audio_output_t *, block_t *, int i_input_rate);
 void aout_DecGetResetStats(audio_output_t *, unsigned *, unsigned *);
+void aout_DecGetResetSyncStats(audio_output_t *, unsigned *, unsigned *,
+                               float *);
 void aout_DecChangePause(audio_output_t *, bool b_paused, mtime_t i_date);
 void aout_DecFlush(audio_output_t *, bool wait);
 void aout_RequestRestart (audio_output_t *, unsigned);
@@ -112,6 +112,9 @@ error:
 
     atomic_init (&owner->buffers_lost, 0);
     atomic_init (&owner->buffers_played, 0);
+    atomic_init (&owner->buffers_late, 0);
+    atomic_init (&owner->buffers_early, 0);
+    atomic_init (&owner->resampling, 0);
     atomic_init (&owner->vp.update, false);
     return 0;
 }
@@ -168,6 +171,7 @@ static int aout_CheckReady (audio_output_t *aout)
         msg_Dbg (aout, "restarting filters...");
         owner->sync.end = VLC_TS_INVALID;
         owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
+        atomic_store (&owner->resampling, 0);
 
         if (owner->mixer_format.i_format)
         {
@@ -209,6 +213,7 @@ static void aout_StopResampling (audio_output_t *aout)
 
     owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
     aout_FiltersAdjustResampling (owner->filters, 0);
+    atomic_store (&owner->resampling, 0);
 }
 
 static void aout_DecSilence (audio_output_t *aout, mtime_t length, mtime_t pts)
@@ -273,6 +278,7 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
             msg_Dbg (aout, "playback too late (%"PRId64"): "
                      "flushing buffers", drift);
         aout_OutputFlush (aout, false);
+        atomic_fetch_add (&owner->buffers_late, 1);
 
         aout_StopResampling (aout);
         owner->sync.end = VLC_TS_INVALID;
@@ -293,6 +299,7 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
             msg_Warn (aout, "playback way too early (%"PRId64"): "
                       "playing silence", drift);
         aout_DecSilence (aout, -drift, dec_pts);
+        atomic_fetch_add (&owner->buffers_early, 1);
 
         aout_StopResampling (aout);
         owner->sync.discontinuity = true;
@@ -342,8 +349,11 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
          * value, then it is time to switch back the resampling direction. */
         adj *= -1;
 
-    if (!aout_FiltersAdjustResampling (owner->filters, adj))
+    if (aout_FiltersAdjustResampling (owner->filters, adj))
+        atomic_fetch_add (&owner->resampling, adj);
+    else
     {   /* Everything is back to normal: stop resampling. */
+        atomic_store (&owner->resampling, 0);
         owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
         msg_Dbg (aout, "resampling stopped (drift: %"PRId64" us)", drift);
     }
@@ -427,6 +437,17 @@ void aout_DecGetResetStats(audio_output_t *aout, unsigned *restrict lost,
     *played = atomic_exchange(&owner->buffers_played, 0);
 }
 
+void aout_DecGetResetSyncStats(audio_output_t *aout, unsigned *restrict late,
+                               unsigned *restrict early, float *restrict ratio)
+{
+    aout_owner_t *owner = aout_owner (aout);
+    unsigned rate = owner->input_format.i_rate;
+
+    *late = atomic_exchange(&owner->buffers_late, 0);
+    *early = atomic_exchange(&owner->buffers_early, 0);
+    *ratio = (float)((int)rate + atomic_load(&owner->resampling)) / rate;
+}
+
 void aout_DecChangePause (audio_output_t *aout, bool paused, mtime_t date)
 {
     aout_owner_t *owner = aout_owner (aout);
@@ -40,6 +40,7 @@
 
 vlc_rwlock_t config_lock = VLC_STATIC_RWLOCK;
 bool config_dirty = false;
+atomic_uint config_generation = ATOMIC_VAR_INIT(0);
 
 static inline char *strdupnull (const char *src)
 {
@@ -245,6 +246,7 @@ void config_PutPsz( vlc_object_t *p_this,
     oldstr = (char *)p_config->value.psz;
     p_config->value.psz = str;
     config_dirty = true;
+    atomic_fetch_add (&config_generation, 1);
     vlc_rwlock_unlock (&config_lock);
 
     free (oldstr);
@@ -286,6 +288,7 @@ void config_PutInt( vlc_object_t *p_this, const char *psz_name,
     vlc_rwlock_wrlock (&config_lock);
     p_config->value.i = i_value;
     config_dirty = true;
+    atomic_fetch_add (&config_generation, 1);
     vlc_rwlock_unlock (&config_lock);
 }
 
@@ -327,6 +330,7 @@ void config_PutFloat( vlc_object_t *p_this,
     vlc_rwlock_wrlock (&config_lock);
     p_config->value.f = f_value;
     config_dirty = true;
+    atomic_fetch_add (&config_generation, 1);
     vlc_rwlock_unlock (&config_lock);
 }
 
@@ -552,6 +556,7 @@ int config_SortConfig (void)
 
     config.list = clist;
     config.count = nconf;
+    atomic_fetch_add (&config_generation, 1);
     return VLC_SUCCESS;
 }
 
@@ -562,6 +567,7 @@ void config_UnsortConfig (void)
     clist = config.list;
     config.list = NULL;
     config.count = 0;
+    atomic_fetch_add (&config_generation, 1);
 
     free (clist);
 }
@@ -634,6 +640,7 @@ void config_ResetAll( vlc_object_t *p_this )
             }
         }
     }
+    atomic_fetch_add (&config_generation, 1);
     vlc_rwlock_unlock (&config_lock);
 
     VLC_UNUSED(p_this);
@@ -241,6 +241,7 @@ int config_LoadConfigFile( vlc_object_t *p_this )
                 break;
         }
     }
+    atomic_fetch_add (&config_generation, 1);
     vlc_rwlock_unlock (&config_lock);
     free (line);
 
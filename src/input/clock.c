@@ -165,6 +165,9 @@ struct input_clock_t
         unsigned i_index;
     } late;
 
+    /* Signed lateness of the last clock reference point */
+    mtime_t i_offset;
+
     /* Reference point */
     clock_point_t ref;
     bool          b_has_reference;
@@ -211,6 +214,7 @@ input_clock_t *input_clock_New( int i_rate )
     cl->late.i_index = 0;
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
         cl->late.pi_value[i] = 0;
+    cl->i_offset = 0;
 
     cl->i_rate = i_rate;
     cl->i_pts_delay = 0;
@@ -317,6 +321,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + AvgGet( &cl->drift ) );
     const mtime_t i_late = ( i_ck_system - cl->i_pts_delay ) - i_system_expected;
     *pb_late = i_late > 0;
+    cl->i_offset = i_late;
     if( i_late > 0 )
     {
         cl->late.pi_value[cl->late.i_index] = i_late;
@@ -598,6 +603,19 @@ mtime_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+void input_clock_GetMetrics( input_clock_t *cl, mtime_t *pi_offset,
+                             mtime_t *pi_drift, mtime_t *pi_jitter )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    const mtime_t *p = cl->late.pi_value;
+    *pi_offset = cl->i_offset;
+    *pi_drift = AvgGet( &cl->drift );
+    *pi_jitter = p[0] + p[1] + p[2] - __MIN(__MIN(p[0],p[1]),p[2]) - __MAX(__MAX(p[0],p[1]),p[2]);
+
+    vlc_mutex_unlock( &cl->lock );
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
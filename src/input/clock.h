@@ -136,4 +136,12 @@ void input_clock_SetJitter( input_clock_t *,
  */
 mtime_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function returns the current synchronisation metrics: the lateness of
+ * the last reference point, the estimated drift of the stream clock and the
+ * median reception jitter (without the pts_delay).
+ */
+void input_clock_GetMetrics( input_clock_t *, mtime_t *pi_offset,
+                             mtime_t *pi_drift, mtime_t *pi_jitter );
+
 #endif
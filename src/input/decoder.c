@@ -51,6 +51,9 @@
 #include "decoder.h"
 #include "event.h"
 #include "resource.h"
+#include "picture_cache.h"
+#include "libvlc.h"
+#include "misc/trace.h"
 
 #include "../video_output/vout_control.h"
 
@@ -141,6 +144,35 @@ struct decoder_owner_sys_t
 
     /* Delay */
     mtime_t i_ts_delay;
+
+    /* Trick play */
+    float f_trickplay_rate;
+    bool b_trickplay; /* decoder thread only */
+
+    /* Seek preview */
+    picture_cache_t *keyframes;
+    mtime_t keyframe_dates[8]; /* dates of the last random access blocks */
+    unsigned keyframe_index;
+    mtime_t preview_date; /* protected by the FIFO lock */
+
+    /* Decoded pictures cache */
+    picture_cache_t *frames;
+    mtime_t frames_last; /* date of the last cached picture */
+    mtime_t frames_replayed; /* pictures up to this date were replayed */
+    unsigned frames_flushes; /* number of flushes of the cache */
+    struct
+    {   /* decoder thread only */
+        bool b_armed; /* may start at the next random access block */
+        bool b_active;
+        mtime_t i_next; /* date of the next picture to replay */
+        mtime_t i_last; /* date of the last replayed picture */
+        block_t *p_held; /* blocks since the last random access block */
+        block_t **pp_held_last;
+    } replay;
+
+    /* Latency tracing */
+    vlc_trace_t *trace;
+    unsigned trace_es;
 };
 
 /* Pictures which are DECODER_BOGUS_VIDEO_DELAY or more in advance probably have
@@ -149,6 +181,13 @@ struct decoder_owner_sys_t
 
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
+/* Cached random access pictures further than this from a seek target are not
+ * shown as preview */
+#define DECODER_PREVIEW_DISTANCE ((mtime_t)(10*CLOCK_FREQ))
+/* Memory for the seek preview pictures of a track */
+#define DECODER_PREVIEW_CACHE_SIZE ((size_t)128 << 20)
+/* Maximum number of pictures in the decoded pictures cache */
+#define DECODER_FRAMES_CACHE_MAX 4096
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
 
 /**
@@ -253,6 +292,16 @@ static int ReloadDecoder( decoder_t *p_dec, bool b_packetizer,
     return VLC_SUCCESS;
 }
 
+static inline void DecoderTrace( decoder_t *p_dec, mtime_t i_ts,
+                                 enum vlc_trace_stage stage )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->trace != NULL && i_ts > VLC_TS_INVALID )
+        vlc_trace_Stamp( p_owner->trace, p_owner->trace_es, p_dec, i_ts,
+                         stage );
+}
+
 static void DecoderUpdateFormatLocked( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -486,6 +535,14 @@ static int vout_update_format( decoder_t *p_dec )
 
         p_vout = p_owner->p_vout;
         p_owner->p_vout = NULL;
+        if( p_owner->keyframes != NULL )
+            picture_cache_Flush( p_owner->keyframes );
+        if( p_owner->frames != NULL )
+        {
+            picture_cache_Flush( p_owner->frames );
+            p_owner->frames_last = VLC_TS_INVALID;
+            p_owner->frames_flushes++;
+        }
         vlc_mutex_unlock( &p_owner->lock );
 
         unsigned dpb_size;
@@ -974,17 +1031,94 @@ static int DecoderQueueCc( decoder_t *p_videodec, block_t *p_cc,
     return 0;
 }
 
+/**
+ * Keeps a copy of the pictures decoded from random access blocks, including
+ * the prerolled ones, for seek previews.
+ */
+static void DecoderCacheKeyframe( decoder_t *p_dec, const picture_t *p_picture )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    bool b_keyframe = false;
+
+    vlc_mutex_lock( &p_owner->lock );
+    for( size_t i = 0; i < ARRAY_SIZE(p_owner->keyframe_dates); i++ )
+        if( p_owner->keyframe_dates[i] == p_picture->date )
+        {
+            p_owner->keyframe_dates[i] = VLC_TS_INVALID;
+            b_keyframe = true;
+            break;
+        }
+    vlc_mutex_unlock( &p_owner->lock );
+
+    if( !b_keyframe )
+        return;
+
+    /* Do not block the input thread for the whole frame copy */
+    picture_t *p_copy = picture_cache_Copy( p_picture );
+    if( p_copy == NULL )
+        return;
+
+    vlc_mutex_lock( &p_owner->lock );
+    picture_cache_Add( p_owner->keyframes, p_copy );
+    vlc_mutex_unlock( &p_owner->lock );
+}
+
+/**
+ * Shows the cached random access picture nearest to a seek target, while
+ * the decoder prerolls up to the target itself.
+ */
+static void DecoderPreview( decoder_t *p_dec, mtime_t i_date )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    vout_thread_t *p_vout = p_owner->p_vout;
+    const video_format_t *p_fmt = &p_dec->fmt_out.video;
+
+    if( p_vout == NULL )
+        return;
+
+    vlc_mutex_lock( &p_owner->lock );
+    picture_t *p_cached = picture_cache_GetNearest( p_owner->keyframes, i_date,
+                                                    DECODER_PREVIEW_DISTANCE );
+    vlc_mutex_unlock( &p_owner->lock );
+    if( p_cached == NULL )
+        return;
+
+    picture_t *p_picture = NULL;
+    if( p_cached->format.i_chroma == p_fmt->i_chroma
+     && p_cached->format.i_width == p_fmt->i_width
+     && p_cached->format.i_height == p_fmt->i_height )
+        p_picture = vout_GetPicture( p_vout );
+    if( p_picture != NULL )
+    {
+        msg_Dbg( p_dec, "seek preview at %"PRId64" for %"PRId64,
+                 p_cached->date, i_date );
+        picture_Copy( p_picture, p_cached );
+        p_picture->date = mdate();
+        p_picture->b_force = true;
+        vout_PutPicture( p_vout, p_picture );
+    }
+    picture_Release( p_cached );
+}
+
 static int DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
                              unsigned *restrict pi_lost_sum )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
     vout_thread_t  *p_vout = p_owner->p_vout;
+    const mtime_t i_stream_date = p_picture->date;
     bool prerolled;
 
+    DecoderTrace( p_dec, i_stream_date, VLC_TRACE_DECODED );
+
+    if( p_owner->keyframes != NULL )
+        DecoderCacheKeyframe( p_dec, p_picture );
+
     vlc_mutex_lock( &p_owner->lock );
     if( p_owner->i_preroll_end > p_picture->date )
     {
         vlc_mutex_unlock( &p_owner->lock );
+        if( p_owner->trace != NULL )
+            vlc_trace_Drop( p_owner->trace, p_dec, i_stream_date );
         picture_Release( p_picture );
         return -1;
     }
@@ -1055,6 +1189,9 @@ static int DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
             vout_Flush( p_vout, p_picture->date );
             p_owner->i_last_rate = i_rate;
         }
+        if( p_owner->trace != NULL )
+            vlc_trace_Move( p_owner->trace, p_dec, i_stream_date,
+                            p_vout, p_picture->date );
         vout_PutPicture( p_vout, p_picture );
     }
     else
@@ -1069,6 +1206,8 @@ static int DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
     return 0;
 discard:
     *pi_lost_sum += 1;
+    if( p_owner->trace != NULL )
+        vlc_trace_Drop( p_owner->trace, p_dec, i_stream_date );
     picture_Release( p_picture );
     return 0;
 }
@@ -1098,12 +1237,65 @@ static void DecoderUpdateStatVideo( decoder_owner_sys_t *p_owner,
     vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
 }
 
+/**
+ * Copies a decoded picture to the decoded pictures cache.
+ *
+ * \return false if the picture was already replayed from the cache
+ */
+static bool DecoderCacheFrame( decoder_t *p_dec, const picture_t *p_picture )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->lock );
+    bool b_replayed = p_owner->frames_replayed > VLC_TS_INVALID
+                   && p_picture->date <= p_owner->frames_replayed;
+    const unsigned i_flushes = p_owner->frames_flushes;
+    vlc_mutex_unlock( &p_owner->lock );
+
+    if( b_replayed )
+        return false;
+
+    /* Do not hold the lock, which the input thread also takes, for the whole
+     * frame copy. If the decoder queues pictures from a thread of its own, a
+     * flush may happen meanwhile: the copy is then dropped, lest it be linked
+     * to the pictures following the flush. */
+    picture_t *p_copy = picture_cache_Copy( p_picture );
+
+    vlc_mutex_lock( &p_owner->lock );
+    if( p_copy != NULL && p_owner->frames_flushes != i_flushes )
+    {
+        picture_Release( p_copy );
+        vlc_mutex_unlock( &p_owner->lock );
+        return true;
+    }
+
+    if( p_copy != NULL
+     && picture_cache_Add( p_owner->frames, p_copy ) == VLC_SUCCESS )
+    {
+        if( p_owner->frames_last > VLC_TS_INVALID
+         && p_owner->frames_last < p_picture->date )
+            picture_cache_Link( p_owner->frames, p_owner->frames_last,
+                                p_picture->date );
+        p_owner->frames_last = p_picture->date;
+    }
+    else
+        p_owner->frames_last = VLC_TS_INVALID;
+    vlc_mutex_unlock( &p_owner->lock );
+    return true;
+}
+
 static int DecoderQueueVideo( decoder_t *p_dec, picture_t *p_pic )
 {
     assert( p_pic );
     unsigned i_lost = 0;
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    if( p_owner->frames != NULL && !DecoderCacheFrame( p_dec, p_pic ) )
+    {   /* Decoded again after the end of a replay */
+        picture_Release( p_pic );
+        return 0;
+    }
+
     int ret = DecoderPlayVideo( p_dec, p_pic, &i_lost );
 
     p_owner->pf_update_stat( p_owner, 1, i_lost );
@@ -1197,7 +1389,8 @@ static void DecoderUpdateStatAudio( decoder_owner_sys_t *p_owner,
                                     unsigned decoded, unsigned lost )
 {
     input_thread_t *p_input = p_owner->p_input;
-    unsigned played = 0;
+    unsigned played = 0, late = 0, early = 0;
+    float ratio = 1.f;
 
     /* Update ugly stat */
     if( p_input == NULL )
@@ -1208,12 +1401,16 @@ static void DecoderUpdateStatAudio( decoder_owner_sys_t *p_owner,
         unsigned aout_lost;
 
         aout_DecGetResetStats( p_owner->p_aout, &aout_lost, &played );
+        aout_DecGetResetSyncStats( p_owner->p_aout, &late, &early, &ratio );
         lost += aout_lost;
     }
 
     vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock);
     stats_Update( input_priv(p_input)->counters.p_lost_abuffers, lost, NULL );
     stats_Update( input_priv(p_input)->counters.p_played_abuffers, played, NULL );
+    stats_Update( input_priv(p_input)->counters.p_late_abuffers, late, NULL );
+    stats_Update( input_priv(p_input)->counters.p_early_abuffers, early, NULL );
+    input_priv(p_input)->counters.f_resample_ratio = ratio;
     stats_Update( input_priv(p_input)->counters.p_decoded_audio, decoded, NULL );
     vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock);
 }
@@ -1316,10 +1513,250 @@ static int DecoderQueueSpu( decoder_t *p_dec, subpicture_t *p_spu )
 }
 
 static void DecoderProcess( decoder_t *p_dec, block_t *p_block );
+static void DecoderDecodeBlock( decoder_t *p_dec, block_t *p_block );
+
+/**
+ * Queues the cached pictures up to the given date, in presentation order.
+ */
+static void DecoderReplayUpTo( decoder_t *p_dec, mtime_t i_date )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const video_format_t *p_fmt = &p_dec->fmt_out.video;
+
+    while( p_owner->replay.i_next > VLC_TS_INVALID
+        && p_owner->replay.i_next <= i_date )
+    {
+        const mtime_t i_pts = p_owner->replay.i_next;
+
+        vlc_mutex_lock( &p_owner->lock );
+        picture_t *p_cached = picture_cache_Get( p_owner->frames, i_pts );
+        p_owner->replay.i_next = picture_cache_GetNext( p_owner->frames, i_pts );
+        /* Prerolled pictures are not even copied */
+        bool b_preroll = p_owner->i_preroll_end > i_pts;
+        vlc_mutex_unlock( &p_owner->lock );
+
+        if( p_cached == NULL )
+        {   /* Evicted */
+            p_owner->replay.i_next = VLC_TS_INVALID;
+            break;
+        }
+        p_owner->replay.i_last = i_pts;
+
+        picture_t *p_picture = NULL;
+        if( !b_preroll && p_cached->format.i_chroma == p_dec->fmt_out.i_codec
+         && p_cached->format.i_width == p_fmt->i_width
+         && p_cached->format.i_height == p_fmt->i_height )
+            p_picture = decoder_NewPicture( p_dec );
+        if( p_picture != NULL )
+        {
+            unsigned i_lost = 0;
+
+            picture_Copy( p_picture, p_cached );
+            DecoderPlayVideo( p_dec, p_picture, &i_lost );
+            p_owner->pf_update_stat( p_owner, 1, i_lost );
+        }
+        picture_Release( p_cached );
+    }
+}
+
+/**
+ * Tells whether every picture of a codec is coded without reference to
+ * other pictures, so that any block is a random access point.
+ */
+static bool DecoderIsIntraOnly( vlc_fourcc_t i_codec )
+{
+    switch( i_codec )
+    {
+        case VLC_CODEC_MJPG:
+        case VLC_CODEC_MJPGB:
+        case VLC_CODEC_JPEG:
+        case VLC_CODEC_JPEG2000:
+        case VLC_CODEC_PNG:
+        case VLC_CODEC_DV:
+        case VLC_CODEC_PRORES:
+        case VLC_CODEC_DNXHD:
+        case VLC_CODEC_HUFFYUV:
+        case VLC_CODEC_FFVHUFF:
+        case VLC_CODEC_UTVIDEO:
+        case VLC_CODEC_CINEFORM:
+            return true;
+    }
+    /* Raw video */
+    return vlc_fourcc_GetChromaDescription( i_codec ) != NULL;
+}
+
+static void DecoderReplayRelease( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    block_ChainRelease( p_owner->replay.p_held );
+    p_owner->replay.p_held = NULL;
+    p_owner->replay.pp_held_last = &p_owner->replay.p_held;
+}
+
+/**
+ * Replays decoded pictures from the cache instead of decoding them.
+ *
+ * Replay starts at the first random access block after a flush, if its
+ * picture is cached, and follows the cached pictures in presentation order.
+ * The skipped blocks are kept from the last random access block on: when a
+ * picture is missing from the cache, they are decoded again, without
+ * showing the pictures which were already replayed.
+ *
+ * \return true if the block was consumed
+ */
+static bool DecoderReplay( decoder_t *p_dec, block_t *p_block )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const bool b_intra = DecoderIsIntraOnly( p_dec->fmt_in.i_codec );
+    const bool b_random_access = p_block != NULL
+        && (b_intra || (p_block->i_flags & BLOCK_FLAG_TYPE_I));
+    mtime_t i_pts = VLC_TS_INVALID;
+
+    if( p_block != NULL )
+    {   /* Intra-only pictures are not reordered */
+        i_pts = p_block->i_pts;
+        if( i_pts <= VLC_TS_INVALID && b_intra )
+            i_pts = p_block->i_dts;
+    }
+
+    if( p_owner->b_trickplay )
+    {   /* Only random access pictures are decoded, and shown */
+        p_owner->replay.b_armed = p_owner->replay.b_active = false;
+        DecoderReplayRelease( p_dec );
+        return false;
+    }
+
+    if( p_owner->replay.b_armed && b_random_access )
+    {
+        p_owner->replay.b_armed = false;
+
+        vlc_mutex_lock( &p_owner->lock );
+        picture_t *p_cached = i_pts > VLC_TS_INVALID
+            ? picture_cache_Get( p_owner->frames, i_pts ) : NULL;
+        vlc_mutex_unlock( &p_owner->lock );
+        if( p_cached == NULL )
+            return false;
+        picture_Release( p_cached );
+
+        msg_Dbg( p_dec, "replaying decoded pictures from %"PRId64, i_pts );
+        p_owner->replay.b_active = true;
+        p_owner->replay.i_next = i_pts;
+        p_owner->replay.i_last = VLC_TS_INVALID;
+    }
+    else if( !p_owner->replay.b_active )
+        return false;
+
+    if( p_block == NULL )
+    {   /* Drain: replay all the remaining pictures */
+        DecoderReplayUpTo( p_dec, INT64_MAX );
+        p_owner->replay.b_active = false;
+        DecoderReplayRelease( p_dec );
+        return false;
+    }
+
+    if( b_random_access )
+        DecoderReplayRelease( p_dec );
+    block_ChainLastAppend( &p_owner->replay.pp_held_last, p_block );
+
+    if( i_pts <= VLC_TS_INVALID )
+        return true;
+    DecoderReplayUpTo( p_dec, i_pts );
+    if( p_owner->replay.i_next > VLC_TS_INVALID
+     || (p_owner->replay.i_last > VLC_TS_INVALID
+      && i_pts <= p_owner->replay.i_last) )
+        return true;
+
+    /* This picture is not cached: decode again from the last random access
+     * block */
+    msg_Dbg( p_dec, "end of replay at %"PRId64, p_owner->replay.i_last );
+    vlc_mutex_lock( &p_owner->lock );
+    p_owner->frames_replayed = p_owner->replay.i_last;
+    p_owner->frames_last = p_owner->replay.i_last;
+    vlc_mutex_unlock( &p_owner->lock );
+    p_owner->replay.b_active = false;
+
+    block_t *p_held = p_owner->replay.p_held;
+    p_owner->replay.p_held = NULL;
+    p_owner->replay.pp_held_last = &p_owner->replay.p_held;
+    while( p_held != NULL )
+    {
+        block_t *p_next = p_held->p_next;
+
+        p_held->p_next = NULL;
+        DecoderDecodeBlock( p_dec, p_held );
+        p_held = p_next;
+    }
+    return true;
+}
+
+/**
+ * Decides whether a block is skipped in keyframe-only playback.
+ *
+ * Once trick play ends, pictures keep being skipped up to the next random
+ * access picture, as their references were never decoded.
+ */
+static bool DecoderSkipTrickPlay( decoder_t *p_dec, const block_t *p_block )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->f_trickplay_rate <= 0.f )
+        return false;
+
+    /* The clock rate is current even before the first rate change */
+    const bool b_keyframes_only = (float)INPUT_RATE_DEFAULT
+        / DecoderGetDisplayRate( p_dec ) >= p_owner->f_trickplay_rate;
+
+    if( b_keyframes_only )
+        p_owner->b_trickplay = true;
+    else if( !p_owner->b_trickplay )
+        return false;
+
+    if( p_block->i_flags & (BLOCK_FLAG_TYPE_P|BLOCK_FLAG_TYPE_B) )
+        return true;
+    if( p_block->i_flags & BLOCK_FLAG_TYPE_I )
+        p_owner->b_trickplay = b_keyframes_only;
+    return false;
+}
+
 static void DecoderDecode( decoder_t *p_dec, block_t *p_block )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    if( p_block != NULL && DecoderSkipTrickPlay( p_dec, p_block ) )
+    {
+        if( p_owner->trace != NULL && p_block->i_pts > VLC_TS_INVALID )
+        {   /* Packetized pictures are not traced yet */
+            DecoderTrace( p_dec, p_block->i_pts, VLC_TRACE_QUEUED );
+            vlc_trace_Drop( p_owner->trace, p_dec, p_block->i_pts );
+        }
+        block_Release( p_block );
+        return;
+    }
+
+    if( p_owner->keyframes != NULL && p_block != NULL
+     && (p_block->i_flags & BLOCK_FLAG_TYPE_I)
+     && p_block->i_pts > VLC_TS_INVALID )
+    {
+        vlc_mutex_lock( &p_owner->lock );
+        p_owner->keyframe_dates[p_owner->keyframe_index++
+                % ARRAY_SIZE(p_owner->keyframe_dates)] = p_block->i_pts;
+        vlc_mutex_unlock( &p_owner->lock );
+    }
+
+    if( p_owner->frames != NULL && DecoderReplay( p_dec, p_block ) )
+        return;
+
+    DecoderDecodeBlock( p_dec, p_block );
+}
+
+static void DecoderDecodeBlock( decoder_t *p_dec, block_t *p_block )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_block != NULL )
+        DecoderTrace( p_dec, p_block->i_pts, VLC_TRACE_DECODING );
+
     int ret = p_dec->pf_decode( p_dec, p_block );
     switch( ret )
     {
@@ -1491,6 +1928,21 @@ static void DecoderProcessFlush( decoder_t *p_dec )
     {
         if( p_owner->p_vout )
             vout_Flush( p_owner->p_vout, VLC_TS_INVALID+1 );
+
+        vlc_mutex_lock( &p_owner->lock );
+        for( size_t i = 0; i < ARRAY_SIZE(p_owner->keyframe_dates); i++ )
+            p_owner->keyframe_dates[i] = VLC_TS_INVALID;
+        p_owner->frames_last = VLC_TS_INVALID;
+        p_owner->frames_replayed = VLC_TS_INVALID;
+        p_owner->frames_flushes++;
+        vlc_mutex_unlock( &p_owner->lock );
+
+        if( p_owner->frames != NULL )
+        {
+            DecoderReplayRelease( p_dec );
+            p_owner->replay.b_active = false;
+            p_owner->replay.b_armed = true;
+        }
     }
     else if( p_dec->fmt_out.i_cat == SPU_ES )
     {
@@ -1549,6 +2001,20 @@ static void *DecoderThread( void *p_data )
             continue;
         }
 
+        if( p_owner->preview_date > VLC_TS_INVALID )
+        {   /* Show a cached picture near the seek target, before waiting for
+             * the decoder or resuming from pause */
+            int canc = vlc_savecancel();
+            mtime_t date = p_owner->preview_date;
+
+            p_owner->preview_date = VLC_TS_INVALID;
+            vlc_fifo_Unlock( p_owner->p_fifo );
+            DecoderPreview( p_dec, date );
+            vlc_fifo_Lock( p_owner->p_fifo );
+            vlc_restorecancel( canc );
+            continue;
+        }
+
         if( paused != p_owner->paused )
         {   /* Update playing/paused status of the output */
             int canc = vlc_savecancel();
@@ -1681,8 +2147,52 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     atomic_init( &p_owner->reload, RELOAD_NO_REQUEST );
     p_owner->b_idle = false;
 
+    p_owner->f_trickplay_rate = 0.f;
+    if( fmt->i_cat == VIDEO_ES && p_sout == NULL )
+        p_owner->f_trickplay_rate = var_InheritFloat( p_dec, "trickplay-rate" );
+    p_owner->b_trickplay = false;
+
+    p_owner->keyframes = NULL;
+    if( fmt->i_cat == VIDEO_ES && p_sout == NULL )
+    {
+        int i_preview = var_InheritInteger( p_dec, "seek-preview" );
+        if( i_preview > 0 )
+            p_owner->keyframes = picture_cache_New( i_preview,
+                                                    DECODER_PREVIEW_CACHE_SIZE );
+    }
+    for( size_t i = 0; i < ARRAY_SIZE(p_owner->keyframe_dates); i++ )
+        p_owner->keyframe_dates[i] = VLC_TS_INVALID;
+    p_owner->keyframe_index = 0;
+    p_owner->preview_date = VLC_TS_INVALID;
+
+    p_owner->frames = NULL;
+    if( fmt->i_cat == VIDEO_ES && p_sout == NULL )
+    {
+        int64_t i_size = var_InheritInteger( p_dec, "frame-cache-size" );
+        /* The size is in MiB, it may not fit in a 32-bit size_t in bytes */
+        if( i_size > (int64_t)(SIZE_MAX >> 20) )
+            i_size = SIZE_MAX >> 20;
+        if( i_size > 0 )
+            p_owner->frames = picture_cache_New( DECODER_FRAMES_CACHE_MAX,
+                                                 (size_t)i_size << 20 );
+    }
+    p_owner->frames_last = VLC_TS_INVALID;
+    p_owner->frames_replayed = VLC_TS_INVALID;
+    p_owner->frames_flushes = 0;
+    p_owner->replay.b_armed = true;
+    p_owner->replay.b_active = false;
+    p_owner->replay.p_held = NULL;
+    p_owner->replay.pp_held_last = &p_owner->replay.p_held;
+
     es_format_Init( &p_owner->fmt, fmt->i_cat, 0 );
 
+    p_owner->trace = NULL;
+    p_owner->trace_es = 0;
+    if( fmt->i_cat == VIDEO_ES && p_sout == NULL )
+        p_owner->trace = libvlc_priv( p_dec->obj.libvlc )->tracer;
+    if( p_owner->trace != NULL )
+        p_owner->trace_es = vlc_trace_AddEs( p_owner->trace, fmt );
+
     /* decoder fifo */
     p_owner->p_fifo = block_FifoNew();
     if( unlikely(p_owner->p_fifo == NULL) )
@@ -1802,6 +2312,16 @@ static void DeleteDecoder( decoder_t * p_dec )
     /* Free all packets still in the decoder fifo. */
     block_FifoRelease( p_owner->p_fifo );
 
+    if( p_owner->trace != NULL )
+        vlc_trace_DelEs( p_owner->trace, p_owner->trace_es );
+    if( p_owner->keyframes != NULL )
+        picture_cache_Delete( p_owner->keyframes );
+    if( p_owner->frames != NULL )
+    {
+        DecoderReplayRelease( p_dec );
+        picture_cache_Delete( p_owner->frames );
+    }
+
     /* Cleanup */
     if( p_owner->p_aout )
     {
@@ -2013,6 +2533,8 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    DecoderTrace( p_dec, p_block->i_pts, VLC_TRACE_QUEUED );
+
     vlc_fifo_Lock( p_owner->p_fifo );
     if( !b_do_pace )
     {
@@ -2228,6 +2750,19 @@ void input_DecoderChangeDelay( decoder_t *p_dec, mtime_t i_delay )
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+void input_DecoderSeekPreview( decoder_t *p_dec, mtime_t i_date )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->keyframes == NULL )
+        return;
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    p_owner->preview_date = i_date;
+    vlc_fifo_Signal( p_owner->p_fifo );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
 void input_DecoderStartWait( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -43,6 +43,14 @@ void input_DecoderChangePause( decoder_t *, bool b_paused, mtime_t i_date );
  */
 void input_DecoderChangeDelay( decoder_t *, mtime_t i_delay );
 
+/**
+ * This function shows the cached random access picture nearest to the
+ * target of a seek, if "seek-preview" is enabled, until the decoder reaches
+ * the target.
+ * It must be called after input_DecoderFlush().
+ */
+void input_DecoderSeekPreview( decoder_t *, mtime_t i_date );
+
 /**
  * This function makes the decoder start waiting for a valid data block from its fifo.
  */
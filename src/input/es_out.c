@@ -2239,6 +2239,19 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_GET_CLOCK_METRICS:
+    {
+        mtime_t *pi_offset = va_arg( args, mtime_t * );
+        mtime_t *pi_drift = va_arg( args, mtime_t * );
+        mtime_t *pi_jitter = va_arg( args, mtime_t * );
+
+        if( p_sys->p_pgrm == NULL )
+            return VLC_EGENERIC;
+        input_clock_GetMetrics( p_sys->p_pgrm->p_clock,
+                                pi_offset, pi_drift, pi_jitter );
+        return VLC_SUCCESS;
+    }
+
     case ES_OUT_SET_MODE:
     {
         const int i_mode = va_arg( args, int );
@@ -2524,6 +2537,13 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
 
         p_sys->i_preroll_end = i_date;
 
+        for( int i = 0; i < p_sys->i_es; i++ )
+        {
+            es_out_id_t *p_es = p_sys->es[i];
+
+            if( p_es->p_dec != NULL && p_es->fmt.i_cat == VIDEO_ES )
+                input_DecoderSeekPreview( p_es->p_dec, i_date );
+        }
         return VLC_SUCCESS;
     }
     case ES_OUT_SET_GROUP_META:
@@ -2695,6 +2715,10 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_SET_TIMESHIFT_TIME:
+        /* Only the timeshift can do that */
+        return VLC_EGENERIC;
+
     case ES_OUT_SET_FRAME_NEXT:
         EsOutFrameNext( out );
         return VLC_SUCCESS;
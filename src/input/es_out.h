@@ -68,6 +68,9 @@ enum es_out_query_private_e
     /* Set a new time */
     ES_OUT_SET_TIME,                                /* arg1=mtime_t             res=can fail */
 
+    /* Move within the timeshift buffer */
+    ES_OUT_SET_TIMESHIFT_TIME,                      /* arg1=mtime_t i_time      res=can fail */
+
     /* Set next frame */
     ES_OUT_SET_FRAME_NEXT,                          /*                          res=can fail */
 
@@ -80,6 +83,9 @@ enum es_out_query_private_e
     /* Get forced group */
     ES_OUT_GET_GROUP_FORCED,                        /* arg1=int * res=cannot fail */
 
+    /* Get clock synchronisation metrics of the current program */
+    ES_OUT_GET_CLOCK_METRICS,                       /* arg1=mtime_t *pi_offset arg2=mtime_t *pi_drift arg3=mtime_t *pi_jitter res=can fail */
+
     /* Set End Of Stream */
     ES_OUT_SET_EOS,                                 /* res=cannot fail */
 };
@@ -134,6 +140,10 @@ static inline int es_out_SetTime( es_out_t *p_out, mtime_t i_date )
 {
     return es_out_Control( p_out, ES_OUT_SET_TIME, i_date );
 }
+static inline int es_out_SetTimeshiftTime( es_out_t *p_out, mtime_t i_time )
+{
+    return es_out_Control( p_out, ES_OUT_SET_TIMESHIFT_TIME, i_time );
+}
 static inline int es_out_SetFrameNext( es_out_t *p_out )
 {
     return es_out_Control( p_out, ES_OUT_SET_FRAME_NEXT );
@@ -162,6 +172,12 @@ static inline int es_out_GetGroupForced( es_out_t *p_out )
     assert( !i_ret );
     return i_group;
 }
+static inline int es_out_GetClockMetrics( es_out_t *p_out, mtime_t *pi_offset,
+                                          mtime_t *pi_drift, mtime_t *pi_jitter )
+{
+    return es_out_Control( p_out, ES_OUT_GET_CLOCK_METRICS,
+                           pi_offset, pi_drift, pi_jitter );
+}
 static inline void es_out_Eos( es_out_t *p_out )
 {
     int i_ret = es_out_Control( p_out, ES_OUT_SET_EOS );
@@ -67,6 +67,7 @@ enum
     C_SEND,
     C_DEL,
     C_CONTROL,
+    C_NOP,      /* Already executed, must not be replayed */
 };
 
 typedef struct attribute_packed
@@ -161,6 +162,24 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
+/* Header of the blocks written to the storage files */
+typedef struct attribute_packed
+{
+    mtime_t  i_dts;
+    mtime_t  i_pts;
+    mtime_t  i_length;
+    uint32_t i_flags;
+    uint32_t i_nb_samples;
+    uint32_t i_buffer;
+} ts_block_header_t;
+
+/* Stream time of a ES_OUT_SET_TIMES command */
+typedef struct
+{
+    mtime_t i_time;
+    int     i_cmd;
+} ts_index_t;
+
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
@@ -180,6 +199,11 @@ struct ts_storage_t
     int      i_cmd_w;
     int      i_cmd_max;
     ts_cmd_t *p_cmd;
+
+    /* Stream time index (increasing) */
+    int        i_index;
+    int        i_index_max;
+    ts_index_t *p_index;
 };
 
 typedef struct
@@ -188,11 +212,13 @@ typedef struct
     input_thread_t *p_input;
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
+    int64_t        i_history_max;
     const char     *psz_tmp_path;
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
     vlc_cond_t     wait;
+    vlc_cond_t     wait_jump;
 
     /* */
     bool           b_paused;
@@ -207,9 +233,20 @@ typedef struct
     /* */
     mtime_t        i_buffering_delay;
 
-    /* */
+    /* Storages from the oldest command that can be replayed (history)
+     * to the last written command */
+    ts_storage_t   *p_storage_h;
     ts_storage_t   *p_storage_r;
     ts_storage_t   *p_storage_w;
+    int            i_cmd_h;
+    mtime_t        i_index_last;
+
+    /* Pending move of the read position, executed by the timeshift thread
+     * (p_jump_storage is NULL if none) */
+    ts_storage_t   *p_jump_storage;
+    int            i_jump_cmd;
+
+    mtime_t        i_buffering_date;
 
     mtime_t        i_cmd_delay;
 
@@ -227,6 +264,7 @@ struct es_out_sys_t
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    int64_t        i_history_max;     /* Maximal total size in byte, 0 if no history */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -263,6 +301,10 @@ static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, mtime_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
+static int          TsSetTime( ts_thread_t *, mtime_t i_time );
+static void         TsJumpLocked( ts_thread_t *, ts_storage_t *, int i_cmd );
+static void         TsJumpExecuteLocked( ts_thread_t * );
+static void         TsTrimLocked( ts_thread_t * );
 
 static void         *TsRun( void * );
 
@@ -273,9 +315,13 @@ static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
 static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
+static void         TsStorageIndex( ts_storage_t *, mtime_t i_time );
 
 static void CmdClean( ts_cmd_t * );
 static void cmd_cleanup_routine( void *p ) { CmdClean( p ); }
+static void CmdExecute( es_out_t *, ts_cmd_t * );
+static bool CmdIsTimed( const ts_cmd_t * );
+static bool CmdIsInformative( const ts_cmd_t * );
 
 static int  CmdInitAdd    ( ts_cmd_t *, es_out_id_t *, const es_format_t *, bool b_copy );
 static void CmdInitSend   ( ts_cmd_t *, es_out_id_t *, block_t * );
@@ -341,6 +387,15 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
         p_sys->i_tmp_size_max = 50*1024*1024;
     else
         p_sys->i_tmp_size_max = __MAX( i_tmp_size_max, 1*1024*1024 );
+    const int i_history_max = var_CreateGetInteger( p_input, "input-timeshift-size" );
+    p_sys->i_history_max = (int64_t)__MAX( i_history_max, 0 ) * 1024 * 1024;
+    if( p_sys->i_history_max > 0 )
+    {
+        /* Smaller files, so that the oldest data is discarded progressively */
+        p_sys->i_tmp_size_max = __MIN( p_sys->i_tmp_size_max,
+                                       __MAX( p_sys->i_history_max / 8, 1*1024*1024 ) );
+        msg_Dbg( p_input, "using timeshift history of %d MiB", i_history_max );
+    }
     msg_Dbg( p_input, "using timeshift granularity of %d MiB",
              (int)p_sys->i_tmp_size_max/(1024*1024) );
 
@@ -713,6 +768,14 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
 
         return ControlLockedSetTime( p_out, i_date );
     }
+    case ES_OUT_SET_TIMESHIFT_TIME:
+    {
+        const mtime_t i_time = (mtime_t)va_arg( args, mtime_t );
+
+        if( !p_sys->b_delayed )
+            return VLC_EGENERIC;
+        return TsSetTime( p_sys->p_ts, i_time );
+    }
     case ES_OUT_SET_FRAME_NEXT:
     {
         return ControlLockedSetFrameNext( p_out );
@@ -723,6 +786,7 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
             return VLC_EGENERIC;
         /* fall through */
     case ES_OUT_GET_GROUP_FORCED:
+    case ES_OUT_GET_CLOCK_METRICS:
     case ES_OUT_POST_SUBNODE:
         return es_out_vaControl( p_sys->p_out, i_query, args );
 
@@ -770,6 +834,7 @@ static int Control( es_out_t *p_out, int i_query, va_list args )
  *****************************************************************************/
 static void TsDestroy( ts_thread_t *p_ts )
 {
+    vlc_cond_destroy( &p_ts->wait_jump );
     vlc_cond_destroy( &p_ts->wait );
     vlc_mutex_destroy( &p_ts->lock );
     free( p_ts );
@@ -786,11 +851,13 @@ static int TsStart( es_out_t *p_out )
         return VLC_EGENERIC;
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
+    p_ts->i_history_max = p_sys->i_history_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
     vlc_mutex_init( &p_ts->lock );
     vlc_cond_init( &p_ts->wait );
+    vlc_cond_init( &p_ts->wait_jump );
     p_ts->b_paused = p_sys->b_input_paused && !p_sys->b_input_paused_source;
     p_ts->i_pause_date = p_ts->b_paused ? mdate() : -1;
     p_ts->i_rate_source = p_sys->i_input_rate_source;
@@ -799,8 +866,14 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
+    p_ts->p_storage_h = NULL;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->i_cmd_h = 0;
+    p_ts->i_index_last = INT64_MIN;
+    p_ts->p_jump_storage = NULL;
+    p_ts->i_jump_cmd = 0;
+    p_ts->i_buffering_date = -1;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -843,8 +916,13 @@ static void TsStop( ts_thread_t *p_ts )
         CmdClean( &cmd );
     }
     assert( !p_ts->p_storage_r || !p_ts->p_storage_r->p_next );
-    if( p_ts->p_storage_r )
-        TsStorageDelete( p_ts->p_storage_r );
+    while( p_ts->p_storage_h )
+    {
+        ts_storage_t *p_next = p_ts->p_storage_h->p_next;
+
+        TsStorageDelete( p_ts->p_storage_h );
+        p_ts->p_storage_h = p_next;
+    }
     vlc_mutex_unlock( &p_ts->lock );
 
     TsDestroy( p_ts );
@@ -867,23 +945,81 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 
         if( !p_ts->p_storage_w )
         {
-            p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
+            p_ts->p_storage_h = p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
         }
         else
         {
             TsStoragePack( p_ts->p_storage_w );
             p_ts->p_storage_w->p_next = p_storage;
             p_ts->p_storage_w = p_storage;
+            TsTrimLocked( p_ts );
         }
     }
 
     /* TODO return error and warn the user (but only once) */
     TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
 
+    /* The times are only indexed to move within the history */
+    if( p_ts->i_history_max > 0 &&
+        p_cmd->i_type == C_CONTROL && p_cmd->u.control.i_query == ES_OUT_SET_TIMES )
+    {
+        const mtime_t i_time = p_cmd->u.control.u.times.i_time;
+
+        if( i_time < p_ts->i_index_last )
+        {
+            /* Discontinuity, the older times cannot be reached anymore */
+            for( ts_storage_t *p = p_ts->p_storage_h; p != NULL; p = p->p_next )
+                p->i_index = 0;
+        }
+        p_ts->i_index_last = i_time;
+        TsStorageIndex( p_ts->p_storage_w, i_time );
+    }
+
     vlc_cond_signal( &p_ts->wait );
 
     vlc_mutex_unlock( &p_ts->lock );
 }
+/* Moves the read position past the consumed storages and the commands
+ * that must not be executed again */
+static void TsReadAdvanceLocked( ts_thread_t *p_ts )
+{
+    for( ;; )
+    {
+        ts_storage_t *p_storage = p_ts->p_storage_r;
+
+        if( !TsStorageIsEmpty( p_storage ) )
+        {
+            if( p_storage->p_cmd[p_storage->i_cmd_r].i_type != C_NOP )
+                return;
+            p_storage->i_cmd_r++;
+            continue;
+        }
+        if( !p_storage || !p_storage->p_next )
+            return;
+
+        ts_storage_t *p_next = p_storage->p_next;
+        if( p_ts->i_history_max <= 0 )
+        {
+            assert( p_ts->p_storage_h == p_storage );
+            TsStorageDelete( p_storage );
+            p_ts->p_storage_h = p_next;
+            p_ts->i_cmd_h = 0;
+        }
+        p_ts->p_storage_r = p_next;
+    }
+}
+/* Forgets the commands executed before the read position */
+static void TsHistoryResetLocked( ts_thread_t *p_ts )
+{
+    while( p_ts->p_storage_h != p_ts->p_storage_r )
+    {
+        ts_storage_t *p_next = p_ts->p_storage_h->p_next;
+
+        TsStorageDelete( p_ts->p_storage_h );
+        p_ts->p_storage_h = p_next;
+    }
+    p_ts->i_cmd_h = p_ts->p_storage_r->i_cmd_r;
+}
 static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 {
     vlc_assert_locked( &p_ts->lock );
@@ -891,17 +1027,18 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
     if( TsStorageIsEmpty( p_ts->p_storage_r ) )
         return VLC_EGENERIC;
 
-    TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
+    ts_storage_t *p_storage = p_ts->p_storage_r;
 
-    while( p_ts->p_storage_r && TsStorageIsEmpty( p_ts->p_storage_r ) )
-    {
-        ts_storage_t *p_next = p_ts->p_storage_r->p_next;
-        if( !p_next )
-            break;
+    TsStoragePopCmd( p_storage, p_cmd, b_flush );
 
-        TsStorageDelete( p_ts->p_storage_r );
-        p_ts->p_storage_r = p_next;
-    }
+    /* The commands that change the ES or the programs cannot be replayed,
+     * and neither can the commands preceding them */
+    if( CmdIsInformative( p_cmd ) )
+        p_storage->p_cmd[p_storage->i_cmd_r - 1].i_type = C_NOP;
+    else if( !CmdIsTimed( p_cmd ) )
+        TsHistoryResetLocked( p_ts );
+
+    TsReadAdvanceLocked( p_ts );
 
     return VLC_SUCCESS;
 }
@@ -910,7 +1047,7 @@ static bool TsHasCmd( ts_thread_t *p_ts )
     bool b_cmd;
 
     vlc_mutex_lock( &p_ts->lock );
-    b_cmd =  TsStorageIsEmpty( p_ts->p_storage_r );
+    b_cmd = !TsStorageIsEmpty( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_cmd;
@@ -920,8 +1057,10 @@ static bool TsIsUnused( ts_thread_t *p_ts )
     bool b_unused;
 
     vlc_mutex_lock( &p_ts->lock );
+    /* The history is kept as long as the input runs */
     b_unused = !p_ts->b_paused &&
                p_ts->i_rate == p_ts->i_rate_source &&
+               p_ts->i_history_max <= 0 &&
                TsStorageIsEmpty( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
 
@@ -977,16 +1116,168 @@ static int TsChangeRate( ts_thread_t *p_ts, int i_src_rate, int i_rate )
     return i_ret;
 }
 
+static int TsSetTime( ts_thread_t *p_ts, mtime_t i_time )
+{
+    vlc_mutex_lock( &p_ts->lock );
+
+    /* Find the first indexed command at or after the requested time */
+    for( ts_storage_t *p = p_ts->p_storage_h; p != NULL; p = p->p_next )
+    {
+        if( p->i_index <= 0 || p->p_index[p->i_index - 1].i_time < i_time )
+            continue;
+
+        int i_low = 0;
+        int i_high = p->i_index - 1;
+        while( i_low < i_high )
+        {
+            const int i_mid = ( i_low + i_high ) / 2;
+
+            if( p->p_index[i_mid].i_time < i_time )
+                i_low = i_mid + 1;
+            else
+                i_high = i_mid;
+        }
+        /* Skip the commands that cannot be replayed */
+        if( p == p_ts->p_storage_h )
+        {
+            while( i_low < p->i_index && p->p_index[i_low].i_cmd < p_ts->i_cmd_h )
+                i_low++;
+            if( i_low >= p->i_index )
+                continue;
+        }
+
+        msg_Dbg( p_ts->p_input, "timeshift jump to %"PRId64" ms",
+                 p->p_index[i_low].i_time / 1000 );
+        TsJumpLocked( p_ts, p, p->p_index[i_low].i_cmd );
+        vlc_mutex_unlock( &p_ts->lock );
+        return VLC_SUCCESS;
+    }
+
+    vlc_mutex_unlock( &p_ts->lock );
+    return VLC_EGENERIC;
+}
+/* Requests the timeshift thread to move the read position to the given
+ * command: the skipped commands that change the ES must be executed by that
+ * thread, not concurrently with it. */
+static void TsJumpLocked( ts_thread_t *p_ts, ts_storage_t *p_storage, int i_cmd )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    p_ts->p_jump_storage = p_storage;
+    p_ts->i_jump_cmd = i_cmd;
+    vlc_cond_signal( &p_ts->wait_jump );
+    vlc_cond_signal( &p_ts->wait );
+}
+/* Moves the read position as requested by TsJumpLocked() */
+static void TsJumpExecuteLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    ts_storage_t *p_storage = p_ts->p_jump_storage;
+    const int i_cmd = p_ts->i_jump_cmd;
+
+    p_ts->p_jump_storage = NULL;
+
+    bool b_forward = false;
+    for( ts_storage_t *p = p_ts->p_storage_r; p != NULL; p = p->p_next )
+    {
+        if( p == p_storage )
+        {
+            b_forward = p != p_ts->p_storage_r || i_cmd >= p->i_cmd_r;
+            break;
+        }
+    }
+
+    if( b_forward )
+    {
+        /* The skipped commands that change the ES must still be executed */
+        while( p_ts->p_storage_r != p_storage || p_storage->i_cmd_r < i_cmd )
+        {
+            ts_cmd_t cmd;
+
+            if( TsPopCmdLocked( p_ts, &cmd, true ) )
+                break;
+
+            if( CmdIsTimed( &cmd ) )
+                CmdClean( &cmd );
+            else
+                CmdExecute( p_ts->p_out, &cmd );
+        }
+    }
+    else
+    {
+        /* The commands between the target and the read position are
+         * played again */
+        for( ts_storage_t *p = p_storage; p != p_ts->p_storage_r; )
+        {
+            p = p->p_next;
+            p->i_cmd_r = 0;
+        }
+        p_storage->i_cmd_r = i_cmd;
+        p_ts->p_storage_r = p_storage;
+    }
+
+    /* Reset the decoders and clocks, and play the target command now */
+    es_out_SetTime( p_ts->p_out, -1 );
+
+    if( !TsStorageIsEmpty( p_ts->p_storage_r ) )
+    {
+        const mtime_t i_now = p_ts->b_paused ? p_ts->i_pause_date : mdate();
+
+        p_ts->i_cmd_delay = i_now - p_ts->p_storage_r->p_cmd[p_ts->p_storage_r->i_cmd_r].i_date;
+    }
+    p_ts->i_rate_date = -1;
+    p_ts->i_rate_delay = 0;
+    p_ts->i_buffering_delay = 0;
+    p_ts->i_buffering_date = -1;
+
+    /* The data could not be trimmed while the jump was pending */
+    TsTrimLocked( p_ts );
+}
+/* Enforces the total size limit, discarding the oldest data first */
+static void TsTrimLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    /* The storages must outlive the pending jump */
+    if( p_ts->i_history_max <= 0 || p_ts->p_jump_storage != NULL )
+        return;
+
+    for( ;; )
+    {
+        int64_t i_size = 0;
+        for( ts_storage_t *p = p_ts->p_storage_h; p != NULL; p = p->p_next )
+            i_size += p->i_file_size;
+
+        if( i_size <= p_ts->i_history_max || p_ts->p_storage_h == p_ts->p_storage_w )
+            return;
+
+        if( p_ts->p_storage_h == p_ts->p_storage_r )
+        {
+            /* Not played back yet */
+            msg_Warn( p_ts->p_input, "timeshift buffer full, dropping data" );
+            TsJumpLocked( p_ts, p_ts->p_storage_r->p_next, 0 );
+            return;
+        }
+
+        ts_storage_t *p_next = p_ts->p_storage_h->p_next;
+
+        TsStorageDelete( p_ts->p_storage_h );
+        p_ts->p_storage_h = p_next;
+        p_ts->i_cmd_h = 0;
+    }
+}
+
 static void *TsRun( void *p_data )
 {
     ts_thread_t *p_ts = p_data;
-    mtime_t i_buffering_date = -1;
 
     for( ;; )
     {
         ts_cmd_t cmd;
         mtime_t  i_deadline;
         bool b_buffering;
+        bool b_drop;
 
         /* Pop a command to execute */
         vlc_mutex_lock( &p_ts->lock );
@@ -995,6 +1286,8 @@ static void *TsRun( void *p_data )
         for( ;; )
         {
             const int canc = vlc_savecancel();
+            if( p_ts->p_jump_storage != NULL )
+                TsJumpExecuteLocked( p_ts );
             b_buffering = es_out_GetBuffering( p_ts->p_out );
 
             if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
@@ -1007,17 +1300,17 @@ static void *TsRun( void *p_data )
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
         }
 
-        if( b_buffering && i_buffering_date < 0 )
+        if( b_buffering && p_ts->i_buffering_date < 0 )
         {
-            i_buffering_date = cmd.i_date;
+            p_ts->i_buffering_date = cmd.i_date;
         }
-        else if( i_buffering_date > 0 )
+        else if( p_ts->i_buffering_date > 0 )
         {
-            p_ts->i_buffering_delay += i_buffering_date - cmd.i_date; /* It is < 0 */
+            p_ts->i_buffering_delay += p_ts->i_buffering_date - cmd.i_date; /* It is < 0 */
             if( b_buffering )
-                i_buffering_date = cmd.i_date;
+                p_ts->i_buffering_date = cmd.i_date;
             else
-                i_buffering_date = -1;
+                p_ts->i_buffering_date = -1;
         }
 
         if( p_ts->i_rate_date < 0 )
@@ -1056,40 +1349,29 @@ static void *TsRun( void *p_data )
         }
         i_deadline = cmd.i_date + p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay;
 
-        vlc_cleanup_pop();
-        vlc_mutex_unlock( &p_ts->lock );
-
         /* Regulate the speed of command processing to the same one than
-         * reading  */
+         * reading, unless the read position is moved meanwhile */
         vlc_cleanup_push( cmd_cleanup_routine, &cmd );
 
-        mwait( i_deadline );
+        while( p_ts->p_jump_storage == NULL &&
+               !vlc_cond_timedwait( &p_ts->wait_jump, &p_ts->lock, i_deadline ) );
 
         vlc_cleanup_pop();
 
-        /* Execute the command  */
-        const int canc = vlc_savecancel();
-        switch( cmd.i_type )
+        b_drop = p_ts->p_jump_storage != NULL && CmdIsTimed( &cmd );
+
+        vlc_cleanup_pop();
+        vlc_mutex_unlock( &p_ts->lock );
+
+        if( b_drop )
         {
-        case C_ADD:
-            CmdExecuteAdd( p_ts->p_out, &cmd );
-            CmdCleanAdd( &cmd );
-            break;
-        case C_SEND:
-            CmdExecuteSend( p_ts->p_out, &cmd );
-            CmdCleanSend( &cmd );
-            break;
-        case C_CONTROL:
-            CmdExecuteControl( p_ts->p_out, &cmd );
-            CmdCleanControl( &cmd );
-            break;
-        case C_DEL:
-            CmdExecuteDel( p_ts->p_out, &cmd );
-            break;
-        default:
-            vlc_assert_unreachable();
-            break;
+            CmdClean( &cmd );
+            continue;
         }
+
+        /* Execute the command  */
+        const int canc = vlc_savecancel();
+        CmdExecute( p_ts->p_out, &cmd );
         vlc_restorecancel( canc );
     }
 
@@ -1146,6 +1428,9 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     p_storage->i_cmd_r = 0;
     p_storage->i_cmd_max = 30000;
     p_storage->p_cmd = malloc( p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
+    p_storage->i_index = 0;
+    p_storage->i_index_max = 0;
+    p_storage->p_index = NULL;
     //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
 
     if( !p_storage->p_cmd )
@@ -1171,6 +1456,7 @@ static void TsStorageDelete( ts_storage_t *p_storage )
         CmdClean( &cmd );
     }
     free( p_storage->p_cmd );
+    free( p_storage->p_index );
 
     fclose( p_storage->p_filer );
     fclose( p_storage->p_filew );
@@ -1183,6 +1469,9 @@ static void TsStorageDelete( ts_storage_t *p_storage )
 
 static void TsStoragePack( ts_storage_t *p_storage )
 {
+    /* The storage may be read back later */
+    fflush( p_storage->p_filew );
+
     /* Try to release a bit of memory */
     if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
         return;
@@ -1197,7 +1486,7 @@ static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
     {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+        size_t i_size = sizeof(ts_block_header_t) + p_cmd->u.send.p_block->i_buffer;
 
         if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
             return true;
@@ -1217,16 +1506,24 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
     if( cmd.i_type == C_SEND )
     {
         block_t *p_block = cmd.u.send.p_block;
+        const ts_block_header_t header = {
+            .i_dts = p_block->i_dts,
+            .i_pts = p_block->i_pts,
+            .i_length = p_block->i_length,
+            .i_flags = p_block->i_flags,
+            .i_nb_samples = p_block->i_nb_samples,
+            .i_buffer = p_block->i_buffer,
+        };
 
         cmd.u.send.p_block = NULL;
         cmd.u.send.i_offset = ftell( p_storage->p_filew );
 
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
+        if( fwrite( &header, sizeof(header), 1, p_storage->p_filew ) != 1 )
         {
             block_Release( p_block );
             return;
         }
-        p_storage->i_file_size += sizeof(*p_block);
+        p_storage->i_file_size += sizeof(header);
         if( p_block->i_buffer > 0 )
         {
             if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
@@ -1250,21 +1547,21 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
     if( p_cmd->i_type == C_SEND )
     {
-        block_t block;
+        ts_block_header_t header;
 
         if( !b_flush &&
             !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
+            fread( &header, sizeof(header), 1, p_storage->p_filer ) == 1 )
         {
-            block_t *p_block = block_Alloc( block.i_buffer );
+            block_t *p_block = block_Alloc( header.i_buffer );
             if( p_block )
             {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
+                p_block->i_dts      = header.i_dts;
+                p_block->i_pts      = header.i_pts;
+                p_block->i_flags    = header.i_flags;
+                p_block->i_length   = header.i_length;
+                p_block->i_nb_samples = header.i_nb_samples;
+                p_block->i_buffer = fread( p_block->p_buffer, 1, header.i_buffer, p_storage->p_filer );
             }
             p_cmd->u.send.p_block = p_block;
         }
@@ -1276,6 +1573,24 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     }
 }
 
+static void TsStorageIndex( ts_storage_t *p_storage, mtime_t i_time )
+{
+    if( p_storage->i_index >= p_storage->i_index_max )
+    {
+        const int i_max = __MAX( 2 * p_storage->i_index_max, 64 );
+        ts_index_t *p_new = realloc( p_storage->p_index, i_max * sizeof(*p_new) );
+        if( !p_new )
+            return;
+
+        p_storage->p_index = p_new;
+        p_storage->i_index_max = i_max;
+    }
+    p_storage->p_index[p_storage->i_index++] = (ts_index_t){
+        .i_time = i_time,
+        .i_cmd = p_storage->i_cmd_w - 1,
+    };
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -1293,12 +1608,78 @@ static void CmdClean( ts_cmd_t *p_cmd )
         CmdCleanControl( p_cmd );
         break;
     case C_DEL:
+    case C_NOP:
+        break;
+    default:
+        vlc_assert_unreachable();
+        break;
+    }
+}
+/* Executes and releases a command */
+static void CmdExecute( es_out_t *p_out, ts_cmd_t *p_cmd )
+{
+    switch( p_cmd->i_type )
+    {
+    case C_ADD:
+        CmdExecuteAdd( p_out, p_cmd );
+        CmdCleanAdd( p_cmd );
+        break;
+    case C_SEND:
+        CmdExecuteSend( p_out, p_cmd );
+        CmdCleanSend( p_cmd );
+        break;
+    case C_CONTROL:
+        CmdExecuteControl( p_out, p_cmd );
+        CmdCleanControl( p_cmd );
+        break;
+    case C_DEL:
+        CmdExecuteDel( p_out, p_cmd );
         break;
     default:
         vlc_assert_unreachable();
         break;
     }
 }
+/* Commands that can be replayed or skipped when moving in the history */
+static bool CmdIsTimed( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type == C_SEND )
+        return true;
+    if( p_cmd->i_type != C_CONTROL )
+        return false;
+
+    switch( p_cmd->u.control.i_query )
+    {
+    case ES_OUT_SET_PCR:
+    case ES_OUT_SET_GROUP_PCR:
+    case ES_OUT_RESET_PCR:
+    case ES_OUT_SET_NEXT_DISPLAY_TIME:
+    case ES_OUT_SET_TIMES:
+    case ES_OUT_SET_JITTER:
+        return true;
+    default:
+        return false;
+    }
+}
+/* Commands that do not need to be replayed */
+static bool CmdIsInformative( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type != C_CONTROL )
+        return false;
+
+    switch( p_cmd->u.control.i_query )
+    {
+    case ES_OUT_SET_GROUP_META:
+    case ES_OUT_SET_GROUP_EPG:
+    case ES_OUT_SET_GROUP_EPG_EVENT:
+    case ES_OUT_SET_EPG_TIME:
+    case ES_OUT_SET_ES_SCRAMBLED_STATE:
+    case ES_OUT_SET_META:
+        return true;
+    default:
+        return false;
+    }
+}
 
 static int CmdInitAdd( ts_cmd_t *p_cmd, es_out_id_t *p_es, const es_format_t *p_fmt, bool b_copy )
 {
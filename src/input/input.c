@@ -314,6 +314,7 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
     priv->is_running = false;
     priv->is_stopped = false;
     priv->b_recording = false;
+    priv->b_keyframes_only = false;
     priv->i_rate = INPUT_RATE_DEFAULT;
     memset( &priv->bookmark, 0, sizeof(priv->bookmark) );
     TAB_INIT( priv->i_bookmark, priv->pp_bookmark );
@@ -663,7 +664,22 @@ static void MainLoopStatistics( input_thread_t *p_input )
     input_priv(p_input)->bookmark.i_time_offset = i_time;
     vlc_mutex_unlock( &input_priv(p_input)->p_item->lock );
 
+    /* update clock synchronisation metrics */
+    mtime_t i_offset, i_drift, i_jitter;
+    if( !es_out_GetClockMetrics( input_priv(p_input)->p_es_out,
+                                 &i_offset, &i_drift, &i_jitter ) )
+    {
+        vlc_mutex_lock( &input_priv(p_input)->counters.counters_lock );
+        input_priv(p_input)->counters.i_clock_offset = i_offset;
+        input_priv(p_input)->counters.i_clock_drift = i_drift;
+        input_priv(p_input)->counters.i_clock_jitter = i_jitter;
+        vlc_mutex_unlock( &input_priv(p_input)->counters.counters_lock );
+    }
+
     stats_ComputeInputStats( p_input, input_priv(p_input)->p_item->p_stats );
+    if( input_priv(p_input)->counters.p_history != NULL )
+        stats_HistoryRecord( input_priv(p_input)->counters.p_history,
+                             input_priv(p_input)->p_item->p_stats );
     input_SendEventStatistics( p_input );
 }
 
@@ -815,6 +831,9 @@ static void InitStatistics( input_thread_t *p_input )
         INIT_COUNTER( demux_discontinuity, COUNTER );
         INIT_COUNTER( played_abuffers, COUNTER );
         INIT_COUNTER( lost_abuffers, COUNTER );
+        INIT_COUNTER( late_abuffers, COUNTER );
+        INIT_COUNTER( early_abuffers, COUNTER );
+        priv->counters.f_resample_ratio = 1.f;
         INIT_COUNTER( displayed_pictures, COUNTER );
         INIT_COUNTER( lost_pictures, COUNTER );
         INIT_COUNTER( decoded_audio, COUNTER );
@@ -823,6 +842,11 @@ static void InitStatistics( input_thread_t *p_input )
         priv->counters.p_sout_send_bitrate = NULL;
         priv->counters.p_sout_sent_packets = NULL;
         priv->counters.p_sout_sent_bytes = NULL;
+
+        char *psz_path = var_InheritString( p_input, "clock-metrics-file" );
+        if( psz_path != NULL )
+            priv->counters.p_history = stats_HistoryNew();
+        free( psz_path );
     }
 }
 
@@ -1402,6 +1426,8 @@ error:
         EXIT_COUNTER( demux_discontinuity );
         EXIT_COUNTER( played_abuffers );
         EXIT_COUNTER( lost_abuffers );
+        EXIT_COUNTER( late_abuffers );
+        EXIT_COUNTER( early_abuffers );
         EXIT_COUNTER( displayed_pictures );
         EXIT_COUNTER( lost_pictures );
         EXIT_COUNTER( decoded_audio );
@@ -1415,6 +1441,8 @@ error:
             EXIT_COUNTER( sout_send_bitrate );
         }
 #undef EXIT_COUNTER
+        stats_HistoryDelete( input_priv(p_input)->counters.p_history );
+        input_priv(p_input)->counters.p_history = NULL;
     }
 
     /* Mark them deleted */
@@ -1469,6 +1497,21 @@ do { \
         {
             /* make sure we are up to date */
             stats_ComputeInputStats( p_input, priv->p_item->p_stats );
+            if( priv->counters.p_history != NULL )
+            {
+                char *psz_path = var_InheritString( p_input,
+                                                    "clock-metrics-file" );
+                char *psz_uri = input_item_GetURI( priv->p_item );
+
+                if( psz_path != NULL )
+                    stats_HistoryDump( VLC_OBJECT(p_input),
+                                       priv->counters.p_history, psz_path,
+                                       psz_uri ? psz_uri : "" );
+                free( psz_uri );
+                free( psz_path );
+                stats_HistoryDelete( priv->counters.p_history );
+                priv->counters.p_history = NULL;
+            }
             CL_CO( read_bytes );
             CL_CO( read_packets );
             CL_CO( demux_read );
@@ -1478,6 +1521,8 @@ do { \
             CL_CO( demux_discontinuity );
             CL_CO( played_abuffers );
             CL_CO( lost_abuffers );
+            CL_CO( late_abuffers );
+            CL_CO( early_abuffers );
             CL_CO( displayed_pictures );
             CL_CO( lost_pictures );
             CL_CO( decoded_audio) ;
@@ -1735,6 +1780,25 @@ static void ControlUnpause( input_thread_t *p_input, mtime_t i_control_date )
     es_out_SetPauseState( input_priv(p_input)->p_es_out, false, false, i_control_date );
 }
 
+/* Lets the demuxer skip the non random access pictures at trick play rates,
+ * as the decoders would drop them anyway (but not when streaming) */
+static void UpdateKeyframesOnly( input_thread_t *p_input )
+{
+    input_thread_private_t *priv = input_priv(p_input);
+    const float f_trickplay_rate = var_InheritFloat( p_input, "trickplay-rate" );
+    const bool b_keyframes_only = priv->p_sout == NULL && f_trickplay_rate > 0.f
+        && (float)INPUT_RATE_DEFAULT / priv->i_rate >= f_trickplay_rate;
+
+    if( b_keyframes_only == priv->b_keyframes_only )
+        return;
+
+    priv->b_keyframes_only = b_keyframes_only;
+    if( demux_Control( priv->master->p_demux, DEMUX_SET_KEYFRAMES_ONLY,
+                       b_keyframes_only ) == VLC_SUCCESS )
+        msg_Dbg( p_input, "demuxing %s", b_keyframes_only
+                 ? "random access pictures only" : "every picture" );
+}
+
 static bool Control( input_thread_t *p_input,
                      int i_type, vlc_value_t val )
 {
@@ -1794,6 +1858,14 @@ static bool Control( input_thread_t *p_input,
             if( i_time < 0 )
                 i_time = 0;
 
+            /* Try to move within the timeshift buffer first */
+            if( !es_out_SetTimeshiftTime( input_priv(p_input)->p_es_out,
+                                          i_time ) )
+            {
+                b_force_update = true;
+                break;
+            }
+
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_SetTime( input_priv(p_input)->p_es_out, -1 );
 
@@ -1916,6 +1988,7 @@ static bool Control( input_thread_t *p_input,
                 {
                     const int i_rate_source = (input_priv(p_input)->b_can_pace_control || input_priv(p_input)->b_can_rate_control ) ? i_rate : INPUT_RATE_DEFAULT;
                     es_out_SetRate( input_priv(p_input)->p_es_out, i_rate_source, i_rate );
+                    UpdateKeyframesOnly( p_input );
                 }
 
                 b_force_update = true;
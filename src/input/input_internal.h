@@ -97,6 +97,7 @@ typedef struct input_thread_private_t
     bool        is_running;
     bool        is_stopped;
     bool        b_recording;
+    bool        b_keyframes_only;
     int         i_rate;
 
     /* Playtime configuration and state */
@@ -161,8 +162,15 @@ typedef struct input_thread_private_t
         counter_t *p_sout_send_bitrate;
         counter_t *p_played_abuffers;
         counter_t *p_lost_abuffers;
+        counter_t *p_late_abuffers;
+        counter_t *p_early_abuffers;
+        float f_resample_ratio;
         counter_t *p_displayed_pictures;
         counter_t *p_lost_pictures;
+        mtime_t i_clock_offset;
+        mtime_t i_clock_drift;
+        mtime_t i_clock_jitter;
+        stats_history_t *p_history; /**< only with --clock-metrics-file */
         vlc_mutex_t counters_lock;
     } counters;
 
@@ -0,0 +1,215 @@
+/*****************************************************************************
+ * picture_cache.c: bounded cache of decoded pictures
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_fourcc.h>
+#include <vlc_picture.h>
+
+#include "picture_cache.h"
+
+struct picture_cache_entry
+{
+    picture_t *picture;
+    size_t size;
+    uint64_t last_use;
+    mtime_t next; /* date of the following picture */
+};
+
+struct picture_cache_t
+{
+    struct picture_cache_entry *entries;
+    unsigned count;
+    unsigned max_count;
+    size_t size;
+    size_t max_size;
+    uint64_t clock; /* LRU counter */
+};
+
+picture_cache_t *picture_cache_New( unsigned max_count, size_t max_size )
+{
+    picture_cache_t *cache = malloc( sizeof (*cache) );
+    if( unlikely(cache == NULL) )
+        return NULL;
+
+    cache->entries = calloc( max_count, sizeof (*cache->entries) );
+    if( unlikely(cache->entries == NULL && max_count > 0) )
+    {
+        free( cache );
+        return NULL;
+    }
+    cache->count = 0;
+    cache->max_count = max_count;
+    cache->size = 0;
+    cache->max_size = max_size;
+    cache->clock = 0;
+    return cache;
+}
+
+void picture_cache_Delete( picture_cache_t *cache )
+{
+    picture_cache_Flush( cache );
+    free( cache->entries );
+    free( cache );
+}
+
+static void picture_cache_Remove( picture_cache_t *cache, unsigned i )
+{
+    assert( i < cache->count );
+
+    picture_Release( cache->entries[i].picture );
+    cache->size -= cache->entries[i].size;
+    cache->entries[i] = cache->entries[--cache->count];
+}
+
+static void picture_cache_Evict( picture_cache_t *cache )
+{
+    unsigned lru = 0;
+
+    for( unsigned i = 1; i < cache->count; i++ )
+        if( cache->entries[i].last_use < cache->entries[lru].last_use )
+            lru = i;
+    picture_cache_Remove( cache, lru );
+}
+
+static int picture_cache_Find( const picture_cache_t *cache, mtime_t date )
+{
+    for( unsigned i = 0; i < cache->count; i++ )
+        if( cache->entries[i].picture->date == date )
+            return i;
+    return -1;
+}
+
+picture_t *picture_cache_Copy( const picture_t *src )
+{
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription( src->format.i_chroma );
+
+    /* Hardware surfaces have no planes in system memory */
+    if( dsc == NULL || dsc->plane_count == 0
+     || src->i_planes != (int)dsc->plane_count
+     || src->date <= VLC_TS_INVALID )
+        return NULL;
+
+    picture_t *pic = picture_NewFromFormat( &src->format );
+    if( likely(pic != NULL) )
+        picture_Copy( pic, src );
+    return pic;
+}
+
+int picture_cache_Add( picture_cache_t *cache, picture_t *pic )
+{
+    size_t size = 0;
+    for( int i = 0; i < pic->i_planes; i++ )
+        size += (size_t)pic->p[i].i_pitch * pic->p[i].i_lines;
+    if( cache->max_count == 0 || size > cache->max_size )
+    {
+        picture_Release( pic );
+        return VLC_EGENERIC;
+    }
+
+    int i = picture_cache_Find( cache, pic->date );
+    if( i >= 0 )
+        picture_cache_Remove( cache, i );
+    while( cache->count > 0 && (cache->count >= cache->max_count
+                             || cache->size + size > cache->max_size) )
+        picture_cache_Evict( cache );
+
+    cache->entries[cache->count++] = (struct picture_cache_entry) {
+        .picture = pic, .size = size, .last_use = ++cache->clock,
+        .next = VLC_TS_INVALID,
+    };
+    cache->size += size;
+    return VLC_SUCCESS;
+}
+
+int picture_cache_Put( picture_cache_t *cache, const picture_t *src )
+{
+    picture_t *pic = picture_cache_Copy( src );
+
+    return (pic != NULL) ? picture_cache_Add( cache, pic ) : VLC_EGENERIC;
+}
+
+static picture_t *picture_cache_Use( picture_cache_t *cache, unsigned i )
+{
+    cache->entries[i].last_use = ++cache->clock;
+    return picture_Hold( cache->entries[i].picture );
+}
+
+picture_t *picture_cache_Get( picture_cache_t *cache, mtime_t date )
+{
+    int i = picture_cache_Find( cache, date );
+
+    return (i >= 0) ? picture_cache_Use( cache, i ) : NULL;
+}
+
+picture_t *picture_cache_GetNearest( picture_cache_t *cache, mtime_t date,
+                                     mtime_t max_distance )
+{
+    int best = -1;
+    mtime_t best_distance = max_distance;
+
+    for( unsigned i = 0; i < cache->count; i++ )
+    {
+        mtime_t distance = cache->entries[i].picture->date - date;
+        if( distance < 0 )
+            distance = -distance;
+        if( distance <= best_distance )
+        {
+            best = i;
+            best_distance = distance;
+        }
+    }
+    return (best >= 0) ? picture_cache_Use( cache, best ) : NULL;
+}
+
+void picture_cache_Link( picture_cache_t *cache, mtime_t date, mtime_t next )
+{
+    int i = picture_cache_Find( cache, date );
+
+    if( i >= 0 )
+        cache->entries[i].next = next;
+}
+
+mtime_t picture_cache_GetNext( const picture_cache_t *cache, mtime_t date )
+{
+    int i = picture_cache_Find( cache, date );
+
+    return (i >= 0) ? cache->entries[i].next : VLC_TS_INVALID;
+}
+
+void picture_cache_Flush( picture_cache_t *cache )
+{
+    while( cache->count > 0 )
+        picture_cache_Remove( cache, cache->count - 1 );
+}
+
+unsigned picture_cache_GetCount( const picture_cache_t *cache, size_t *size )
+{
+    if( size != NULL )
+        *size = cache->size;
+    return cache->count;
+}
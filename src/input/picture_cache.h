@@ -0,0 +1,118 @@
+/*****************************************************************************
+ * picture_cache.h: bounded cache of decoded pictures
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_INPUT_PICTURE_CACHE_H
+#define LIBVLC_INPUT_PICTURE_CACHE_H 1
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+/**
+ * Cache of decoded pictures, keyed by their date.
+ *
+ * Pictures are copied to memory owned by the cache, so that they never hold
+ * buffers from the decoder or video output pools. Only pictures with pixels
+ * in system memory can be cached, not hardware surfaces. When the cache is
+ * full, the least recently used pictures are evicted first.
+ *
+ * The cache is not thread-safe: the owner serializes the calls.
+ */
+typedef struct picture_cache_t picture_cache_t;
+
+/**
+ * Creates a picture cache.
+ *
+ * \param max_count maximum number of pictures
+ * \param max_size maximum size of the cached pixels in bytes
+ */
+picture_cache_t *picture_cache_New( unsigned max_count, size_t max_size );
+
+void picture_cache_Delete( picture_cache_t * );
+
+/**
+ * Copies a picture to memory that can be cached.
+ *
+ * This does not access any cache, so that the copy can be made without
+ * holding the lock serializing the cache calls.
+ *
+ * \return the copy, or NULL if the picture cannot be cached or on error
+ */
+picture_t *picture_cache_Copy( const picture_t * );
+
+/**
+ * Adds a copy made by picture_cache_Copy() to the cache.
+ *
+ * The cache takes ownership of the picture, even on error. A cached picture
+ * with the same date is replaced.
+ *
+ * \return VLC_SUCCESS, or VLC_EGENERIC if the picture is larger than the
+ * whole cache
+ */
+int picture_cache_Add( picture_cache_t *, picture_t * );
+
+/**
+ * Copies a picture into the cache, as picture_cache_Copy() then
+ * picture_cache_Add().
+ *
+ * \return VLC_SUCCESS or VLC_EGENERIC
+ */
+int picture_cache_Put( picture_cache_t *, const picture_t * );
+
+/**
+ * Returns the cached picture of the given date, or NULL.
+ *
+ * The caller must release the picture. It must not modify it.
+ */
+picture_t *picture_cache_Get( picture_cache_t *, mtime_t date );
+
+/**
+ * Returns the cached picture nearest to the given date, at most max_distance
+ * before or after it, or NULL.
+ *
+ * The caller must release the picture. It must not modify it.
+ */
+picture_t *picture_cache_GetNearest( picture_cache_t *, mtime_t date,
+                                     mtime_t max_distance );
+
+/**
+ * Records the date of the picture following a cached picture in
+ * presentation order.
+ */
+void picture_cache_Link( picture_cache_t *, mtime_t date, mtime_t next );
+
+/**
+ * Returns the date of the picture following a cached picture, as recorded
+ * by picture_cache_Link(), or VLC_TS_INVALID.
+ *
+ * The following picture may have been evicted since.
+ */
+mtime_t picture_cache_GetNext( const picture_cache_t *, mtime_t date );
+
+/**
+ * Removes all the pictures from the cache.
+ */
+void picture_cache_Flush( picture_cache_t * );
+
+/**
+ * Returns the number of cached pictures and their size in bytes.
+ */
+unsigned picture_cache_GetCount( const picture_cache_t *, size_t *size );
+
+#endif
@@ -25,7 +25,13 @@
 # include "config.h"
 #endif
 
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
 #include <vlc_common.h>
+#include <vlc_charset.h>
+#include <vlc_fs.h>
 #include "input/input_internal.h"
 
 /**
@@ -112,6 +118,14 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     /* Aout */
     st->i_played_abuffers = stats_GetTotal(priv->counters.p_played_abuffers);
     st->i_lost_abuffers = stats_GetTotal(priv->counters.p_lost_abuffers);
+    st->i_late_abuffers = stats_GetTotal(priv->counters.p_late_abuffers);
+    st->i_early_abuffers = stats_GetTotal(priv->counters.p_early_abuffers);
+    st->f_resample_ratio = priv->counters.f_resample_ratio;
+
+    /* Clock */
+    st->i_clock_offset = priv->counters.i_clock_offset;
+    st->i_clock_drift = priv->counters.i_clock_drift;
+    st->i_clock_jitter = priv->counters.i_clock_jitter;
 
     /* Vouts */
     st->i_displayed_pictures = stats_GetTotal(priv->counters.p_displayed_pictures);
@@ -131,12 +145,178 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     p_stats->i_demux_corrupted = p_stats->i_demux_discontinuity =
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
+    p_stats->i_late_abuffers = p_stats->i_early_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
-    p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate
+    p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate =
+    p_stats->i_clock_offset = p_stats->i_clock_drift = p_stats->i_clock_jitter
      = 0;
+    p_stats->f_resample_ratio = 1.f;
+    vlc_mutex_unlock( &p_stats->lock );
+}
+
+/*****************************************************************************
+ * Synchronisation history
+ *****************************************************************************/
+/* One hour of samples, at the input statistics period */
+#define STATS_HISTORY_SIZE (3600 * 4)
+
+typedef struct
+{
+    mtime_t i_date;
+    mtime_t i_clock_offset;
+    mtime_t i_clock_drift;
+    mtime_t i_clock_jitter;
+    float   f_resample_ratio;
+    int64_t i_late_abuffers;
+    int64_t i_early_abuffers;
+    int64_t i_lost_pictures;
+} stats_sample_t;
+
+struct stats_history_t
+{
+    unsigned       i_first;
+    unsigned       i_count;
+    stats_sample_t p_samples[STATS_HISTORY_SIZE];
+};
+
+stats_history_t *stats_HistoryNew( void )
+{
+    stats_history_t *p_history = malloc( sizeof(*p_history) );
+    if( p_history != NULL )
+        p_history->i_first = p_history->i_count = 0;
+    return p_history;
+}
+
+void stats_HistoryDelete( stats_history_t *p_history )
+{
+    free( p_history );
+}
+
+/**
+ * Records the synchronisation metrics of the input statistics, overwriting
+ * the oldest sample once the history is full.
+ */
+void stats_HistoryRecord( stats_history_t *p_history, input_stats_t *p_stats )
+{
+    stats_sample_t *p_sample;
+
+    if( p_history->i_count < STATS_HISTORY_SIZE )
+        p_sample = &p_history->p_samples[p_history->i_count++];
+    else
+    {
+        p_sample = &p_history->p_samples[p_history->i_first];
+        p_history->i_first = (p_history->i_first + 1) % STATS_HISTORY_SIZE;
+    }
+
+    p_sample->i_date = mdate();
+    vlc_mutex_lock( &p_stats->lock );
+    p_sample->i_clock_offset = p_stats->i_clock_offset;
+    p_sample->i_clock_drift = p_stats->i_clock_drift;
+    p_sample->i_clock_jitter = p_stats->i_clock_jitter;
+    p_sample->f_resample_ratio = p_stats->f_resample_ratio;
+    p_sample->i_late_abuffers = p_stats->i_late_abuffers;
+    p_sample->i_early_abuffers = p_stats->i_early_abuffers;
+    p_sample->i_lost_pictures = p_stats->i_lost_pictures;
     vlc_mutex_unlock( &p_stats->lock );
 }
 
+static void HistoryWriteString( FILE *stream, const char *psz, bool b_json )
+{
+    fputc( '"', stream );
+    for( ; *psz; psz++ )
+    {
+        unsigned char c = *psz;
+
+        if( !b_json )
+        {   /* CSV only needs the quotes to be doubled */
+            if( c == '"' )
+                fputc( '"', stream );
+            fputc( c, stream );
+        }
+        else if( c == '"' || c == '\\' )
+            fprintf( stream, "\\%c", c );
+        else if( c < 0x20 )
+            fprintf( stream, "\\u%04x", c );
+        else
+            fputc( c, stream );
+    }
+    fputc( '"', stream );
+}
+
+/**
+ * Appends the recorded history to a file, as one JSON object per input if the
+ * file name ends with ".json", or as CSV rows otherwise.
+ */
+void stats_HistoryDump( vlc_object_t *p_obj, stats_history_t *p_history,
+                        const char *psz_path, const char *psz_uri )
+{
+    static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+    const char *psz_ext = strrchr( psz_path, '.' );
+    const bool b_json = psz_ext != NULL && !strcasecmp( psz_ext, ".json" );
+
+    vlc_mutex_lock( &lock );
+    FILE *stream = vlc_fopen( psz_path, "at" );
+    if( stream == NULL )
+    {
+        msg_Err( p_obj, "cannot write synchronisation history to %s: %s",
+                 psz_path, vlc_strerror_c(errno) );
+        vlc_mutex_unlock( &lock );
+        return;
+    }
+
+    if( b_json )
+    {
+        fputs( "{\"uri\":", stream );
+        HistoryWriteString( stream, psz_uri, true );
+        fputs( ",\"samples\":[", stream );
+    }
+    else if( fseek( stream, 0, SEEK_END ) == 0 && ftell( stream ) == 0 )
+        fputs( "uri,date,clock_offset,clock_drift,clock_jitter,"
+               "resample_ratio,late_abuffers,early_abuffers,lost_pictures\n",
+               stream );
+
+    for( unsigned i = 0; i < p_history->i_count; i++ )
+    {
+        const stats_sample_t *p = &p_history->p_samples[
+            (p_history->i_first + i) % STATS_HISTORY_SIZE];
+
+        char *psz_row;
+        int i_len;
+
+        /* The ratio must not depend on the locale decimal separator */
+        if( b_json )
+            i_len = us_asprintf( &psz_row, "%s{\"date\":%"PRId64
+                     ",\"clock_offset\":%"PRId64",\"clock_drift\":%"PRId64
+                     ",\"clock_jitter\":%"PRId64",\"resample_ratio\":%f"
+                     ",\"late_abuffers\":%"PRId64
+                     ",\"early_abuffers\":%"PRId64
+                     ",\"lost_pictures\":%"PRId64"}",
+                     i ? "," : "", p->i_date, p->i_clock_offset,
+                     p->i_clock_drift, p->i_clock_jitter, p->f_resample_ratio,
+                     p->i_late_abuffers, p->i_early_abuffers,
+                     p->i_lost_pictures );
+        else
+            i_len = us_asprintf( &psz_row, ",%"PRId64",%"PRId64",%"PRId64
+                     ",%"PRId64",%f,%"PRId64",%"PRId64",%"PRId64"\n",
+                     p->i_date, p->i_clock_offset, p->i_clock_drift,
+                     p->i_clock_jitter, p->f_resample_ratio,
+                     p->i_late_abuffers, p->i_early_abuffers,
+                     p->i_lost_pictures );
+        if( unlikely(i_len == -1) )
+            break;
+
+        if( !b_json )
+            HistoryWriteString( stream, psz_uri, false );
+        fputs( psz_row, stream );
+        free( psz_row );
+    }
+
+    if( b_json )
+        fputs( "]}\n", stream );
+    fclose( stream );
+    vlc_mutex_unlock( &lock );
+}
+
 void stats_CounterClean( counter_t *p_c )
 {
     if( p_c )
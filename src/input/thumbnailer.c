@@ -0,0 +1,564 @@
+/*****************************************************************************
+ * thumbnailer.c: headless thumbnail generation
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_codec.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_interrupt.h>
+#include <vlc_meta.h>
+#include <vlc_modules.h>
+#include <vlc_picture.h>
+#include <vlc_stream.h>
+#include <vlc_thumbnailer.h>
+
+#include "libvlc.h"
+#include "misc/background_worker.h"
+
+struct vlc_thumbnailer_t
+{
+    vlc_object_t *parent;
+    struct background_worker *worker;
+};
+
+/* A queued thumbnail, held by the caller and by the background worker */
+struct thumbnail_request
+{
+    vlc_thumbnailer_t *thumbnailer;
+    input_item_t *item;
+    bool b_by_pos;
+    mtime_t i_time;
+    float f_pos;
+    vlc_fourcc_t i_codec;
+    unsigned i_width;
+    unsigned i_height;
+
+    vlc_thumbnailer_cb pf_done;
+    void *data;
+    bool b_done; /* the callback was called */
+    atomic_uint refs;
+};
+
+/* A running thumbnail */
+struct thumbnail_task
+{
+    struct thumbnail_request *req;
+    vlc_thread_t thread;
+    vlc_interrupt_t *interrupt;
+    atomic_bool finished;
+};
+
+/*****************************************************************************
+ * Decoding pipeline
+ *****************************************************************************/
+struct es_out_id_t
+{
+    bool b_video;
+};
+
+struct es_out_sys_t
+{
+    vlc_object_t *obj;
+    es_out_id_t *video; /* the decoded track */
+    decoder_t *packetizer;
+    decoder_t *decoder;
+    bool b_keyframe; /* a random access picture was reached */
+    picture_t *picture;
+};
+
+static int VideoUpdateFormat( decoder_t *p_dec )
+{
+    p_dec->fmt_out.video.i_chroma = p_dec->fmt_out.i_codec;
+    return 0;
+}
+
+static picture_t *VideoNewBuffer( decoder_t *p_dec )
+{
+    return picture_NewFromFormat( &p_dec->fmt_out.video );
+}
+
+static int VideoQueue( decoder_t *p_dec, picture_t *p_pic )
+{
+    struct es_out_sys_t *p_sys = p_dec->p_queue_ctx;
+
+    if( p_sys->picture == NULL )
+        p_sys->picture = p_pic;
+    else
+        picture_Release( p_pic );
+    return 0;
+}
+
+static void DeleteDecoder( decoder_t *p_dec )
+{
+    if( p_dec->p_module != NULL )
+        module_unneed( p_dec, p_dec->p_module );
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+    if( p_dec->p_description != NULL )
+        vlc_meta_Delete( p_dec->p_description );
+    vlc_object_release( p_dec );
+}
+
+static decoder_t *CreatePacketizer( vlc_object_t *p_obj,
+                                    const es_format_t *p_fmt )
+{
+    decoder_t *p_pack = vlc_custom_create( p_obj, sizeof( *p_pack ),
+                                           "packetizer" );
+    if( unlikely(p_pack == NULL) )
+        return NULL;
+
+    es_format_Copy( &p_pack->fmt_in, p_fmt );
+    es_format_Init( &p_pack->fmt_out, p_fmt->i_cat, 0 );
+
+    p_pack->p_module = module_need( p_pack, "packetizer", NULL, false );
+    if( p_pack->p_module == NULL )
+    {
+        DeleteDecoder( p_pack );
+        return NULL;
+    }
+    return p_pack;
+}
+
+static decoder_t *CreateDecoder( struct es_out_sys_t *p_sys,
+                                 const es_format_t *p_fmt )
+{
+    decoder_t *p_dec = vlc_custom_create( p_sys->obj, sizeof( *p_dec ),
+                                          "decoder" );
+    if( unlikely(p_dec == NULL) )
+        return NULL;
+
+    es_format_Copy( &p_dec->fmt_in, p_fmt );
+    es_format_Init( &p_dec->fmt_out, VIDEO_ES, 0 );
+    p_dec->b_frame_drop_allowed = false;
+    p_dec->pf_vout_format_update = VideoUpdateFormat;
+    p_dec->pf_vout_buffer_new = VideoNewBuffer;
+    p_dec->pf_queue_video = VideoQueue;
+    p_dec->p_queue_ctx = p_sys;
+
+    /* Hints for the decoders supporting them: a single picture is needed, in
+     * system memory, and the other jobs use the other CPU cores. */
+    var_Create( p_dec, "avcodec-fast", VLC_VAR_BOOL );
+    var_SetBool( p_dec, "avcodec-fast", true );
+    var_Create( p_dec, "avcodec-skiploopfilter", VLC_VAR_INTEGER );
+    var_SetInteger( p_dec, "avcodec-skiploopfilter", 4 );
+    var_Create( p_dec, "avcodec-threads", VLC_VAR_INTEGER );
+    var_SetInteger( p_dec, "avcodec-threads", 1 );
+    var_Create( p_dec, "avcodec-hw", VLC_VAR_STRING );
+    var_SetString( p_dec, "avcodec-hw", "none" );
+
+    p_dec->p_module = module_need( p_dec, "video decoder", "$codec", false );
+    if( p_dec->p_module == NULL )
+    {
+        msg_Err( p_dec, "no suitable decoder module for fourcc `%4.4s'",
+                 (const char *)&p_fmt->i_codec );
+        DeleteDecoder( p_dec );
+        return NULL;
+    }
+    return p_dec;
+}
+
+static void Decode( struct es_out_sys_t *p_sys, block_t *p_block )
+{
+    if( p_sys->picture != NULL )
+    {
+        if( p_block != NULL )
+            block_Release( p_block );
+        return;
+    }
+
+    /* Skip up to the first random access picture after the seek */
+    if( p_block != NULL && !p_sys->b_keyframe )
+    {
+        if( p_block->i_flags & (BLOCK_FLAG_TYPE_P|BLOCK_FLAG_TYPE_B) )
+        {
+            block_Release( p_block );
+            return;
+        }
+        if( p_block->i_flags & BLOCK_FLAG_TYPE_I )
+            p_sys->b_keyframe = true;
+    }
+
+    p_sys->decoder->pf_decode( p_sys->decoder, p_block );
+}
+
+static void Packetize( struct es_out_sys_t *p_sys, block_t *p_block )
+{
+    decoder_t *p_pack = p_sys->packetizer;
+    block_t **pp_block = p_block != NULL ? &p_block : NULL;
+    block_t *p_chain;
+
+    while( (p_chain = p_pack->pf_packetize( p_pack, pp_block )) != NULL )
+    {
+        while( p_chain != NULL )
+        {
+            block_t *p_next = p_chain->p_next;
+
+            p_chain->p_next = NULL;
+            Decode( p_sys, p_chain );
+            p_chain = p_next;
+        }
+    }
+}
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *p_fmt )
+{
+    struct es_out_sys_t *p_sys = out->p_sys;
+    es_out_id_t *id = malloc( sizeof( *id ) );
+
+    if( unlikely(id == NULL) )
+        return NULL;
+    id->b_video = false;
+
+    if( p_fmt->i_cat != VIDEO_ES || p_sys->decoder != NULL )
+        return id;
+
+    if( !p_fmt->b_packetized )
+    {
+        p_sys->packetizer = CreatePacketizer( p_sys->obj, p_fmt );
+        if( p_sys->packetizer == NULL )
+            return id;
+        p_fmt = &p_sys->packetizer->fmt_out;
+    }
+
+    p_sys->decoder = CreateDecoder( p_sys, p_fmt );
+    if( p_sys->decoder == NULL )
+    {
+        if( p_sys->packetizer != NULL )
+            DeleteDecoder( p_sys->packetizer );
+        p_sys->packetizer = NULL;
+        return id;
+    }
+
+    id->b_video = true;
+    p_sys->video = id;
+    return id;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *p_block )
+{
+    struct es_out_sys_t *p_sys = out->p_sys;
+
+    if( !id->b_video )
+        block_Release( p_block );
+    else if( p_sys->packetizer != NULL )
+        Packetize( p_sys, p_block );
+    else
+        Decode( p_sys, p_block );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    struct es_out_sys_t *p_sys = out->p_sys;
+
+    if( id == p_sys->video )
+        p_sys->video = NULL;
+    free( id );
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    (void) out;
+
+    switch( i_query )
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            es_out_id_t *id = va_arg( args, es_out_id_t * );
+            bool *pb_selected = va_arg( args, bool * );
+
+            *pb_selected = id->b_video;
+            return VLC_SUCCESS;
+        }
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_RESET_PCR:
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static picture_t *DecodePicture( vlc_object_t *p_obj,
+                                 const struct thumbnail_request *req )
+{
+    picture_t *p_pic = NULL;
+    char *psz_uri = input_item_GetURI( req->item );
+    if( psz_uri == NULL )
+        return NULL;
+
+    struct es_out_sys_t sys = {
+        .obj = p_obj,
+    };
+    es_out_t out = {
+        .pf_add = EsOutAdd,
+        .pf_send = EsOutSend,
+        .pf_del = EsOutDel,
+        .pf_control = EsOutControl,
+        .p_sys = &sys,
+    };
+
+    stream_t *s = vlc_stream_NewURL( p_obj, psz_uri );
+    if( s == NULL )
+        goto out;
+
+    const char *psz_location = strstr( psz_uri, "://" );
+    psz_location = psz_location != NULL ? psz_location + 3 : psz_uri;
+
+    demux_t *p_demux = demux_New( p_obj, "any", psz_location, s, &out );
+    if( p_demux == NULL )
+    {
+        vlc_stream_Delete( s );
+        goto out;
+    }
+
+    /* Not precise: the demuxer stops at the preceding random access point */
+    int i_ret = VLC_SUCCESS;
+    if( req->b_by_pos && req->f_pos > 0.f )
+        i_ret = demux_Control( p_demux, DEMUX_SET_POSITION,
+                               (double)req->f_pos, false );
+    else if( !req->b_by_pos && req->i_time > 0 )
+        i_ret = demux_Control( p_demux, DEMUX_SET_TIME, req->i_time, false );
+    if( i_ret != VLC_SUCCESS )
+        msg_Warn( p_obj, "cannot seek %s", psz_uri );
+
+    while( sys.picture == NULL && !vlc_killed()
+        && demux_Demux( p_demux ) > 0 );
+
+    /* Flush the pictures held back by the decoder at the end of the input */
+    if( sys.picture == NULL && sys.decoder != NULL && !vlc_killed() )
+    {
+        if( sys.packetizer != NULL )
+            Packetize( &sys, NULL );
+        Decode( &sys, NULL );
+    }
+
+    p_pic = sys.picture;
+    demux_Delete( p_demux );
+    if( sys.decoder != NULL )
+        DeleteDecoder( sys.decoder );
+    if( sys.packetizer != NULL )
+        DeleteDecoder( sys.packetizer );
+out:
+    free( psz_uri );
+    return p_pic;
+}
+
+static block_t *Thumbnail( vlc_object_t *p_obj,
+                           const struct thumbnail_request *req )
+{
+    picture_t *p_pic = DecodePicture( p_obj, req );
+    if( p_pic == NULL )
+        return NULL;
+
+    /* picture_Export() keeps the aspect ratio for null dimensions */
+    int i_width = req->i_width, i_height = req->i_height;
+    if( i_width == 0 && i_height == 0 )
+        i_width = i_height = -1;
+
+    block_t *p_image;
+    if( picture_Export( p_obj, &p_image, NULL, p_pic, req->i_codec,
+                        i_width, i_height ) )
+        p_image = NULL;
+    picture_Release( p_pic );
+    return p_image;
+}
+
+/*****************************************************************************
+ * Jobs
+ *****************************************************************************/
+static void RequestHold( void *entity )
+{
+    struct thumbnail_request *req = entity;
+
+    atomic_fetch_add( &req->refs, 1 );
+}
+
+static void RequestRelease( void *entity )
+{
+    struct thumbnail_request *req = entity;
+
+    if( atomic_fetch_sub( &req->refs, 1 ) != 1 )
+        return;
+
+    /* Cancelled before completion */
+    if( !req->b_done )
+        req->pf_done( req->data, NULL );
+    input_item_Release( req->item );
+    free( req );
+}
+
+static void *Thread( void *data )
+{
+    struct thumbnail_task *task = data;
+    struct thumbnail_request *req = task->req;
+    vlc_thumbnailer_t *thumbnailer = req->thumbnailer;
+
+    vlc_interrupt_set( task->interrupt );
+
+    block_t *p_image = Thumbnail( thumbnailer->parent, req );
+    req->b_done = true;
+    req->pf_done( req->data, p_image );
+
+    atomic_store( &task->finished, true );
+    background_worker_RequestProbe( thumbnailer->worker );
+    return NULL;
+}
+
+static int TaskStart( void *owner, void *entity, void **out )
+{
+    struct thumbnail_task *task = malloc( sizeof( *task ) );
+    (void) owner;
+
+    if( unlikely(task == NULL) )
+        return VLC_ENOMEM;
+
+    task->req = entity;
+    task->interrupt = vlc_interrupt_create();
+    atomic_init( &task->finished, false );
+    if( unlikely(task->interrupt == NULL) )
+    {
+        free( task );
+        return VLC_ENOMEM;
+    }
+
+    if( vlc_clone( &task->thread, Thread, task, VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_interrupt_destroy( task->interrupt );
+        free( task );
+        return VLC_EGENERIC;
+    }
+
+    *out = task;
+    return VLC_SUCCESS;
+}
+
+static int TaskProbe( void *owner, void *handle )
+{
+    struct thumbnail_task *task = handle;
+    (void) owner;
+
+    return atomic_load( &task->finished );
+}
+
+static void TaskStop( void *owner, void *handle )
+{
+    struct thumbnail_task *task = handle;
+    (void) owner;
+
+    vlc_interrupt_kill( task->interrupt );
+    vlc_join( task->thread, NULL );
+    vlc_interrupt_destroy( task->interrupt );
+    free( task );
+}
+
+#undef vlc_thumbnailer_Create
+vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t *parent,
+                                           unsigned jobs, int timeout )
+{
+    vlc_thumbnailer_t *thumbnailer = malloc( sizeof( *thumbnailer ) );
+
+    if( unlikely(thumbnailer == NULL) )
+        return NULL;
+
+    struct background_worker_config conf = {
+        .default_timeout = timeout,
+        .max_threads = jobs > 0 ? jobs : vlc_GetCPUCount(),
+        .pf_start = TaskStart,
+        .pf_probe = TaskProbe,
+        .pf_stop = TaskStop,
+        .pf_release = RequestRelease,
+        .pf_hold = RequestHold,
+    };
+
+    thumbnailer->parent = parent;
+    thumbnailer->worker = background_worker_New( thumbnailer, &conf );
+    if( unlikely(thumbnailer->worker == NULL) )
+    {
+        free( thumbnailer );
+        return NULL;
+    }
+    return thumbnailer;
+}
+
+static int Request( vlc_thumbnailer_t *thumbnailer, input_item_t *item,
+                    bool b_by_pos, mtime_t i_time, float f_pos,
+                    vlc_fourcc_t i_codec,
+                    unsigned i_width, unsigned i_height,
+                    vlc_thumbnailer_cb pf_done, void *data )
+{
+    struct thumbnail_request *req = malloc( sizeof( *req ) );
+
+    if( unlikely(req == NULL) )
+        return VLC_ENOMEM;
+
+    req->thumbnailer = thumbnailer;
+    req->item = input_item_Hold( item );
+    req->b_by_pos = b_by_pos;
+    req->i_time = i_time;
+    req->f_pos = f_pos;
+    req->i_codec = i_codec;
+    req->i_width = i_width;
+    req->i_height = i_height;
+    req->pf_done = pf_done;
+    req->data = data;
+    req->b_done = false;
+    atomic_init( &req->refs, 1 );
+
+    int i_ret = background_worker_Push( thumbnailer->worker, req, NULL, -1,
+                                        BACKGROUND_WORKER_PRIORITY_NORMAL );
+    if( i_ret != VLC_SUCCESS )
+        req->b_done = true; /* the caller is not called back */
+    RequestRelease( req );
+    return i_ret;
+}
+
+int vlc_thumbnailer_RequestByTime( vlc_thumbnailer_t *thumbnailer,
+                                   input_item_t *item, mtime_t time,
+                                   vlc_fourcc_t codec,
+                                   unsigned width, unsigned height,
+                                   vlc_thumbnailer_cb pf_done, void *data )
+{
+    return Request( thumbnailer, item, false, time, 0.f, codec, width, height,
+                    pf_done, data );
+}
+
+int vlc_thumbnailer_RequestByPos( vlc_thumbnailer_t *thumbnailer,
+                                  input_item_t *item, float pos,
+                                  vlc_fourcc_t codec,
+                                  unsigned width, unsigned height,
+                                  vlc_thumbnailer_cb pf_done, void *data )
+{
+    return Request( thumbnailer, item, true, 0, pos, codec,
+                    width, height, pf_done, data );
+}
+
+void vlc_thumbnailer_Release( vlc_thumbnailer_t *thumbnailer )
+{
+    background_worker_Delete( thumbnailer->worker );
+    free( thumbnailer );
+}
@@ -85,6 +85,18 @@ static const char *const ppsz_snap_formats[] =
     "This is the verbosity level (0=only errors and " \
     "standard messages, 1=warnings, 2=debug).")
 
+#define LOG_ASYNC_TEXT N_("Asynchronous logging")
+#define LOG_ASYNC_LONGTEXT N_( \
+    "Hand log messages over to a dedicated thread instead of writing " \
+    "them from the emitting thread. Messages are dropped (and counted) " \
+    "if a thread emits them faster than they can be written.")
+
+#define LOG_RATE_TEXT N_("Log messages rate limit")
+#define LOG_RATE_LONGTEXT N_( \
+    "Maximum number of messages per second from a given source code " \
+    "location. Excess messages are suppressed (0=unlimited, the default). " \
+    "This only applies to asynchronous logging.")
+
 #define OPEN_TEXT N_("Default stream")
 #define OPEN_LONGTEXT N_( \
     "This stream will always be opened at VLC startup." )
@@ -472,6 +484,12 @@ static const char *const ppsz_pos_descriptions[] =
     "Enables framedropping on MPEG2 stream. Framedropping " \
     "occurs when your computer is not powerful enough" )
 
+#define PREPARE_AHEAD_TEXT N_("Pictures filtered ahead")
+#define PREPARE_AHEAD_LONGTEXT N_( \
+    "Number of pictures the deinterlacing and post-processing filters are " \
+    "applied to ahead of their display, on a separate thread. " \
+    "0 filters pictures only when they are about to be displayed.")
+
 #define DROP_LATE_FRAMES_TEXT N_("Drop late frames")
 #define DROP_LATE_FRAMES_LONGTEXT N_( \
     "This drops frames that are late (arrive to the video output after " \
@@ -649,6 +667,25 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
 
+#define TRICKPLAY_RATE_TEXT N_("Keyframe-only playback speed")
+#define TRICKPLAY_RATE_LONGTEXT N_( \
+    "At or above this playback speed, only the random access pictures of " \
+    "video tracks are decoded, and read if the demuxer supports it " \
+    "(0, the default, to disable)." )
+
+#define SEEK_PREVIEW_TEXT N_("Seek preview pictures")
+#define SEEK_PREVIEW_LONGTEXT N_( \
+    "Number of decoded random access pictures kept in memory per video " \
+    "track, within 128 MiB. After a seek, the nearest one is shown at once while the exact " \
+    "picture is being decoded (0 to disable)." )
+
+#define FRAME_CACHE_SIZE_TEXT N_("Decoded pictures cache size (MiB)")
+#define FRAME_CACHE_SIZE_LONGTEXT N_( \
+    "Memory for the recently decoded pictures of each video track. When " \
+    "playback comes back to cached pictures, e.g. in A-B loops or when " \
+    "stepping backward, they are shown again without decoding (0 to " \
+    "disable)." )
+
 #define INPUT_LIST_TEXT N_("Input list")
 #define INPUT_LIST_LONGTEXT N_( \
     "You can give a comma-separated list " \
@@ -684,6 +721,13 @@ static const char *const ppsz_prefres[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_SIZE_TEXT N_("Timeshift history size (MiB)")
+#define INPUT_TIMESHIFT_SIZE_LONGTEXT N_( \
+    "Maximum total size of the timeshift temporary files. When non-zero, " \
+    "data already played back is kept up to that size, so that seeking " \
+    "back and forth within the timeshift buffer is possible. The oldest " \
+    "data is discarded first. Zero means no history and no size limit." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -703,6 +747,11 @@ static const char *const ppsz_prefres[] = {
     "You can use this option to place the subtitles under the movie, " \
     "instead of over the movie. Try several positions.")
 
+#define SUB_RENDER_THREADS_TEXT N_("Subtitles rendering threads")
+#define SUB_RENDER_THREADS_LONGTEXT N_( \
+    "Number of threads rendering subtitles ahead of their display date. " \
+    "0 (the default) renders subtitles only when displayed.")
+
 #define SUB_TEXT_SCALE_TEXT N_("Subtitles text scaling factor")
 #define SUB_TEXT_SCALE_LONGTEXT N_("Set value to alter subtitles size where possible")
 
@@ -1050,6 +1099,24 @@ static const char *const ppsz_prefres[] = {
 #define STATS_LONGTEXT N_( \
      "Collect miscellaneous local statistics about the playing media.")
 
+#define LATENCY_TRACE_TEXT N_("Trace playback latency")
+#define LATENCY_TRACE_LONGTEXT N_( \
+     "Measure the time spent by video frames in each stage of the " \
+     "playback pipeline, and log latency statistics for each stream.")
+
+#define LATENCY_TRACE_FILE_TEXT N_("Latency trace file")
+#define LATENCY_TRACE_FILE_LONGTEXT N_( \
+     "Write the playback latency trace to this file, in the Chrome " \
+     "trace event format. This implies latency tracing.")
+
+#define CLOCK_METRICS_FILE_TEXT N_("Clock metrics file")
+#define CLOCK_METRICS_FILE_LONGTEXT N_( \
+     "Append the clock synchronisation metrics of each input (clock " \
+     "offset, drift and jitter, audio resampling ratio, late and early " \
+     "buffers), sampled over the last hour of playback, to this file. " \
+     "The file is written as JSON if its name ends with .json, as CSV " \
+     "otherwise.")
+
 #define DAEMON_TEXT N_("Run as daemon process")
 #define DAEMON_LONGTEXT N_( \
      "Runs VLC as a background daemon process.")
@@ -1110,6 +1177,11 @@ static const char *const ppsz_prefres[] = {
 #define PREPARSE_TIMEOUT_LONGTEXT N_( \
     "Maximum time (in milliseconds) allowed to preparse an item" )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of items preparsed concurrently " \
+    "(0 = number of CPU cores)." )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
 #define SD_TEXT N_( "Services discovery modules")
@@ -1527,6 +1599,8 @@ vlc_module_begin ()
         change_private ()
     add_bool( "drop-late-frames", 1, DROP_LATE_FRAMES_TEXT,
               DROP_LATE_FRAMES_LONGTEXT, true )
+    add_integer_with_range( "vout-prepare-ahead", 0, 0, 8,
+                            PREPARE_AHEAD_TEXT, PREPARE_AHEAD_LONGTEXT, true )
     /* Used in vout_synchro */
     add_bool( "skip-frames", 1, SKIP_FRAMES_TEXT,
               SKIP_FRAMES_LONGTEXT, true )
@@ -1661,6 +1735,8 @@ vlc_module_begin ()
                  SUB_PATH_TEXT, SUB_PATH_LONGTEXT, true )
     add_integer( "sub-margin", 0, SUB_MARGIN_TEXT,
                  SUB_MARGIN_LONGTEXT, true )
+    add_integer_with_range( "sub-render-threads", 0, 0, 16,
+               SUB_RENDER_THREADS_TEXT, SUB_RENDER_THREADS_LONGTEXT, true )
     add_integer_with_range( "sub-text-scale", 100, 10, 500,
                SUB_TEXT_SCALE_TEXT, SUB_TEXT_SCALE_LONGTEXT, false )
         change_volatile  ()
@@ -1729,6 +1805,13 @@ vlc_module_begin ()
         change_safe ()
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT, false )
+    add_float( "trickplay-rate", 0.,
+               TRICKPLAY_RATE_TEXT, TRICKPLAY_RATE_LONGTEXT, true )
+    add_integer_with_range( "seek-preview", 0, 0, 256,
+                            SEEK_PREVIEW_TEXT, SEEK_PREVIEW_LONGTEXT, true )
+    add_integer_with_range( "frame-cache-size", 0, 0, 65536,
+                            FRAME_CACHE_SIZE_TEXT, FRAME_CACHE_SIZE_LONGTEXT,
+                            true )
 
     add_string( "input-list", NULL,
                  INPUT_LIST_TEXT, INPUT_LIST_LONGTEXT, true )
@@ -1874,6 +1957,9 @@ vlc_module_begin ()
                 INPUT_TIMESHIFT_PATH_LONGTEXT, true )
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-size", 0, INPUT_TIMESHIFT_SIZE_TEXT,
+                 INPUT_TIMESHIFT_SIZE_LONGTEXT, true )
+        change_integer_range( 0, 1 << 20 )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -2057,6 +2143,9 @@ vlc_module_begin ()
 
     add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
                  PREPARSE_TIMEOUT_LONGTEXT, false )
+    add_integer( "preparse-threads", 0, PREPARSE_THREADS_TEXT,
+                 PREPARSE_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 64 )
 
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
@@ -2074,6 +2163,9 @@ vlc_module_begin ()
         change_short('v')
         change_volatile ()
     add_obsolete_string( "verbose-objects" ) /* since 2.1.0 */
+    add_bool( "log-async", false, LOG_ASYNC_TEXT, LOG_ASYNC_LONGTEXT, true )
+    add_integer_with_range( "log-rate-limit", 0, 0, 1000000,
+                            LOG_RATE_TEXT, LOG_RATE_LONGTEXT, true )
 #if !defined(_WIN32) && !defined(__OS2__)
     add_bool( "daemon", 0, DAEMON_TEXT, DAEMON_LONGTEXT, true )
         change_short('d')
@@ -2094,6 +2186,12 @@ vlc_module_begin ()
               INTERACTION_LONGTEXT, false )
 
     add_bool ( "stats", true, STATS_TEXT, STATS_LONGTEXT, true )
+    add_bool( "latency-trace", false, LATENCY_TRACE_TEXT,
+              LATENCY_TRACE_LONGTEXT, true )
+    add_savefile( "latency-trace-file", NULL, LATENCY_TRACE_FILE_TEXT,
+                  LATENCY_TRACE_FILE_LONGTEXT, true )
+    add_savefile( "clock-metrics-file", NULL, CLOCK_METRICS_FILE_TEXT,
+                  CLOCK_METRICS_FILE_LONGTEXT, true )
 
     set_subcategory( SUBCAT_INTERFACE_MAIN )
     add_module_cat( "intf", SUBCAT_INTERFACE_MAIN, NULL, INTF_TEXT,
@@ -43,6 +43,8 @@
 #include "modules/modules.h"
 #include "config/configuration.h"
 #include "playlist/preparser.h"
+#include "misc/trace.h"
+#include "misc/picture.h"
 
 #include <stdio.h>                                              /* sprintf() */
 #include <string.h>
@@ -92,6 +94,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv = libvlc_priv (p_libvlc);
     priv->playlist = NULL;
     priv->p_vlm = NULL;
+    priv->tracer = NULL;
 
     vlc_ExitInit( &priv->exit );
 
@@ -229,6 +232,7 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     vlc_CPU_dump( VLC_OBJECT(p_libvlc) );
 
     priv->b_stats = var_InheritBool( p_libvlc, "stats" );
+    priv->tracer = vlc_trace_New( VLC_OBJECT(p_libvlc) );
 
     /*
      * Initialize hotkey handling
@@ -416,7 +420,11 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if (priv->parser != NULL)
         playlist_preparser_Delete(priv->parser);
 
+    if (priv->tracer != NULL)
+        vlc_trace_Delete(priv->tracer);
+
     vlc_DeinitActions( p_libvlc, priv->actions );
+    picture_arena_Purge();
 
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
@@ -193,6 +193,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     struct vlc_actions *actions; ///< Hotkeys handler
+    struct vlc_trace *tracer; ///< Latency tracer (or NULL)
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -268,4 +269,11 @@ void stats_CounterClean (counter_t * );
 void stats_ComputeInputStats(input_thread_t*, input_stats_t*);
 void stats_ReinitInputStats(input_stats_t *);
 
+typedef struct stats_history_t stats_history_t;
+stats_history_t *stats_HistoryNew(void);
+void stats_HistoryDelete(stats_history_t *);
+void stats_HistoryRecord(stats_history_t *, input_stats_t *);
+void stats_HistoryDump(vlc_object_t *, stats_history_t *, const char *path,
+                       const char *uri);
+
 #endif
@@ -100,6 +100,8 @@ static void vlc_CPU_init (void)
                 core_caps |= VLC_CPU_XOP;
             if (!strcmp (cap, "fma4"))
                 core_caps |= VLC_CPU_FMA4;
+            if (!strcmp (cap, "pclmulqdq"))
+                core_caps |= VLC_CPU_PCLMUL;
 
 #elif defined (__powerpc__) || defined (__powerpc64__)
             if (!strcmp (cap, "altivec supported"))
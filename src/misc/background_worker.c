@@ -20,6 +20,8 @@
 #  include "config.h"
 #endif
 
+#include <search.h>
+
 #include <vlc_common.h>
 #include <vlc_threads.h>
 #include <vlc_arrays.h>
@@ -27,82 +29,206 @@
 #include "libvlc.h"
 #include "background_worker.h"
 
+struct bg_id;
+
 struct bg_queued_item {
     void* id; /**< id associated with entity */
     void* entity; /**< the entity to process */
     int timeout; /**< timeout duration in microseconds */
+    int priority; /**< lane of the entity */
+
+    struct bg_queued_item* prev; /**< previous entity of the lane */
+    struct bg_queued_item* next; /**< next entity of the lane */
+
+    struct bg_id* id_entry; /**< queued entities sharing the id, if any */
+    struct bg_queued_item* id_prev;
+    struct bg_queued_item* id_next;
+};
+
+/** Queued entities associated with a given (non-NULL) id */
+struct bg_id {
+    void* id;
+    struct bg_queued_item* first;
+};
+
+struct bg_thread {
+    struct background_worker* worker;
+    struct bg_queued_item* item; /**< entity being processed, or NULL */
+    mtime_t deadline; /**< deadline of the current task */
+    bool probe_request; /**< true if a probe is requested */
 };
 
 struct background_worker {
     void* owner;
     struct background_worker_config conf;
 
-    struct {
-        bool probe_request; /**< true if a probe is requested */
-        vlc_mutex_t lock; /**< acquire to inspect members that follow */
-        vlc_cond_t wait; /**< wait for update in terms of head */
-        mtime_t deadline; /**< deadline of the current task */
-        void* id; /**< id of the current task */
-        bool active; /**< true if there is an active thread */
-    } head;
+    vlc_mutex_t lock; /**< acquire to inspect members that follow */
+    vlc_cond_t wait; /**< wait for update in terms of running tasks */
 
     struct {
-        vlc_mutex_t lock; /**< acquire to inspect members that follow */
-        vlc_array_t data; /**< queue of pending entities to process */
-    } tail;
+        struct bg_queued_item* first;
+        struct bg_queued_item* last;
+    } lanes[BACKGROUND_WORKER_PRIORITY_COUNT]; /**< pending entities */
+    void* ids; /**< tree of \ref bg_id, indexing the pending entities */
+
+    vlc_array_t threads; /**< running \ref bg_thread */
 };
 
-static void* Thread( void* data )
+static int IdCmp( const void* a, const void* b )
 {
-    struct background_worker* worker = data;
+    const struct bg_id* ea = a, * eb = b;
+    uintptr_t ia = (uintptr_t)ea->id, ib = (uintptr_t)eb->id;
 
-    for( ;; )
-    {
-        struct bg_queued_item* item = NULL;
-        void* handle;
+    return ( ia > ib ) - ( ia < ib );
+}
+
+static void QueueAppend( struct background_worker* worker,
+                         struct bg_queued_item* item )
+{
+    struct bg_queued_item** last = &worker->lanes[item->priority].last;
+
+    item->prev = *last;
+    item->next = NULL;
+    if( *last )
+        (*last)->next = item;
+    else
+        worker->lanes[item->priority].first = item;
+    *last = item;
 
-        vlc_mutex_lock( &worker->tail.lock );
+    item->id_entry = NULL;
+    item->id_prev = item->id_next = NULL;
+
+    if( item->id == NULL )
+        return;
+
+    struct bg_id key = { .id = item->id };
+    struct bg_id** pp = tfind( &key, &worker->ids, IdCmp );
+
+    if( pp == NULL )
+    {
+        struct bg_id* entry = malloc( sizeof( *entry ) );
+        if( unlikely( !entry ) )
+            return; /* not cancellable by id, but still processed */
+
+        entry->id = item->id;
+        entry->first = NULL;
+        pp = tsearch( entry, &worker->ids, IdCmp );
+        if( unlikely( !pp ) )
         {
-            if( vlc_array_count( &worker->tail.data ) )
-            {
-                item = vlc_array_item_at_index( &worker->tail.data, 0 );
-                handle = NULL;
+            free( entry );
+            return;
+        }
+    }
 
-                vlc_array_remove( &worker->tail.data, 0 );
-            }
+    struct bg_id* entry = *pp;
 
-            vlc_mutex_lock( &worker->head.lock );
-            {
-                worker->head.deadline = INT64_MAX;
-                worker->head.active = item != NULL;
-                worker->head.id = item ? item->id : NULL;
+    item->id_entry = entry;
+    item->id_next = entry->first;
+    if( entry->first )
+        entry->first->id_prev = item;
+    entry->first = item;
+}
 
-                if( item && item->timeout > 0 )
-                    worker->head.deadline = mdate() + item->timeout * 1000;
-            }
-            vlc_cond_broadcast( &worker->head.wait );
-            vlc_mutex_unlock( &worker->head.lock );
+static void QueueRemove( struct background_worker* worker,
+                         struct bg_queued_item* item )
+{
+    if( item->prev )
+        item->prev->next = item->next;
+    else
+        worker->lanes[item->priority].first = item->next;
+
+    if( item->next )
+        item->next->prev = item->prev;
+    else
+        worker->lanes[item->priority].last = item->prev;
+
+    struct bg_id* entry = item->id_entry;
+    if( entry == NULL )
+        return;
+
+    if( item->id_prev )
+        item->id_prev->id_next = item->id_next;
+    else
+        entry->first = item->id_next;
+
+    if( item->id_next )
+        item->id_next->id_prev = item->id_prev;
+
+    if( entry->first == NULL )
+    {
+        tdelete( entry, &worker->ids, IdCmp );
+        free( entry );
+    }
+}
+
+static struct bg_queued_item* QueuePop( struct background_worker* worker )
+{
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITY_COUNT; ++i )
+    {
+        struct bg_queued_item* item = worker->lanes[i].first;
+
+        if( item )
+        {
+            QueueRemove( worker, item );
+            return item;
         }
-        vlc_mutex_unlock( &worker->tail.lock );
+    }
+    return NULL;
+}
+
+static bool HasRunningTask( struct background_worker* worker, void* id )
+{
+    for( size_t i = 0; i < vlc_array_count( &worker->threads ); ++i )
+    {
+        struct bg_thread* th = vlc_array_item_at_index( &worker->threads, i );
+
+        if( id == NULL || ( th->item && th->item->id == id ) )
+            return true;
+    }
+    return false;
+}
+
+static void* Thread( void* data )
+{
+    struct bg_thread* th = data;
+    struct background_worker* worker = th->worker;
+
+    vlc_mutex_lock( &worker->lock );
+    for( ;; )
+    {
+        struct bg_queued_item* item = QueuePop( worker );
+        void* handle = NULL;
 
         if( item == NULL )
             break;
 
+        th->item = item;
+        th->probe_request = false;
+        th->deadline = INT64_MAX;
+        if( item->timeout > 0 )
+            th->deadline = mdate() + item->timeout * 1000;
+
+        vlc_mutex_unlock( &worker->lock );
+
         if( worker->conf.pf_start( worker->owner, item->entity, &handle ) )
         {
             worker->conf.pf_release( item->entity );
             free( item );
+
+            vlc_mutex_lock( &worker->lock );
+            th->item = NULL;
+            vlc_cond_broadcast( &worker->wait );
             continue;
         }
 
         for( ;; )
         {
-            vlc_mutex_lock( &worker->head.lock );
+            vlc_mutex_lock( &worker->lock );
 
-            bool const b_timeout = worker->head.deadline <= mdate();
-            worker->head.probe_request = false;
+            bool const b_timeout = th->deadline <= mdate();
+            th->probe_request = false;
 
-            vlc_mutex_unlock( &worker->head.lock );
+            vlc_mutex_unlock( &worker->lock );
 
             if( b_timeout ||
                 worker->conf.pf_probe( worker->owner, handle ) )
@@ -113,49 +239,76 @@ static void* Thread( void* data )
                 break;
             }
 
-            vlc_mutex_lock( &worker->head.lock );
-            if( worker->head.probe_request == false &&
-                worker->head.deadline > mdate() )
+            vlc_mutex_lock( &worker->lock );
+            if( th->probe_request == false &&
+                th->deadline > mdate() )
             {
-                vlc_cond_timedwait( &worker->head.wait, &worker->head.lock,
-                                     worker->head.deadline );
+                vlc_cond_timedwait( &worker->wait, &worker->lock,
+                                     th->deadline );
             }
-            vlc_mutex_unlock( &worker->head.lock );
+            vlc_mutex_unlock( &worker->lock );
         }
+
+        vlc_mutex_lock( &worker->lock );
+        th->item = NULL;
+        vlc_cond_broadcast( &worker->wait );
     }
 
+    vlc_array_remove( &worker->threads,
+                      vlc_array_index_of_item( &worker->threads, th ) );
+    vlc_cond_broadcast( &worker->wait );
+    vlc_mutex_unlock( &worker->lock );
+
+    free( th );
     return NULL;
 }
 
 static void BackgroundWorkerCancel( struct background_worker* worker, void* id)
 {
-    vlc_mutex_lock( &worker->tail.lock );
-    for( size_t i = 0; i < vlc_array_count( &worker->tail.data ); )
+    vlc_mutex_lock( &worker->lock );
+    if( id == NULL )
     {
-        struct bg_queued_item* item =
-            vlc_array_item_at_index( &worker->tail.data, i );
+        struct bg_queued_item* item;
 
-        if( id == NULL || item->id == id )
+        while( ( item = QueuePop( worker ) ) != NULL )
         {
-            vlc_array_remove( &worker->tail.data, i );
             worker->conf.pf_release( item->entity );
             free( item );
-            continue;
         }
+    }
+    else
+    {
+        struct bg_id key = { .id = id };
+        struct bg_id** pp = tfind( &key, &worker->ids, IdCmp );
+
+        /* The entry is freed along with its last entity */
+        while( pp != NULL && (*pp)->first != NULL )
+        {
+            struct bg_queued_item* item = (*pp)->first;
+            bool last = item->id_next == NULL;
 
-        ++i;
+            QueueRemove( worker, item );
+            worker->conf.pf_release( item->entity );
+            free( item );
+            if( last )
+                break;
+        }
     }
-    vlc_mutex_unlock( &worker->tail.lock );
 
-    vlc_mutex_lock( &worker->head.lock );
-    while( ( id == NULL && worker->head.active )
-        || ( id != NULL && worker->head.id == id ) )
+    while( HasRunningTask( worker, id ) )
     {
-        worker->head.deadline = VLC_TS_0;
-        vlc_cond_broadcast( &worker->head.wait );
-        vlc_cond_wait( &worker->head.wait, &worker->head.lock );
+        for( size_t i = 0; i < vlc_array_count( &worker->threads ); ++i )
+        {
+            struct bg_thread* th =
+                vlc_array_item_at_index( &worker->threads, i );
+
+            if( th->item && ( id == NULL || th->item->id == id ) )
+                th->deadline = VLC_TS_0;
+        }
+        vlc_cond_broadcast( &worker->wait );
+        vlc_cond_wait( &worker->wait, &worker->lock );
     }
-    vlc_mutex_unlock( &worker->head.lock );
+    vlc_mutex_unlock( &worker->lock );
 }
 
 struct background_worker* background_worker_New( void* owner,
@@ -168,21 +321,47 @@ struct background_worker* background_worker_New( void* owner,
 
     worker->conf = *conf;
     worker->owner = owner;
-    worker->head.id = NULL;
-    worker->head.active = false;
-    worker->head.deadline = VLC_TS_INVALID;
+    if( worker->conf.max_threads == 0 )
+        worker->conf.max_threads = 1;
 
-    vlc_mutex_init( &worker->head.lock );
-    vlc_cond_init( &worker->head.wait );
+    for( int i = 0; i < BACKGROUND_WORKER_PRIORITY_COUNT; ++i )
+        worker->lanes[i].first = worker->lanes[i].last = NULL;
+    worker->ids = NULL;
 
-    vlc_array_init( &worker->tail.data );
-    vlc_mutex_init( &worker->tail.lock );
+    vlc_mutex_init( &worker->lock );
+    vlc_cond_init( &worker->wait );
+    vlc_array_init( &worker->threads );
 
     return worker;
 }
 
+static int SpawnThread( struct background_worker* worker )
+{
+    struct bg_thread* th = malloc( sizeof( *th ) );
+
+    if( unlikely( !th ) )
+        return VLC_ENOMEM;
+
+    th->worker = worker;
+    th->item = NULL;
+    th->deadline = INT64_MAX;
+    th->probe_request = false;
+
+    vlc_array_append( &worker->threads, th );
+
+    if( vlc_clone_detach( NULL, Thread, th, VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_array_remove( &worker->threads,
+                          vlc_array_count( &worker->threads ) - 1 );
+        free( th );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
 int background_worker_Push( struct background_worker* worker, void* entity,
-                        void* id, int timeout )
+                        void* id, int timeout,
+                        enum background_worker_priority priority )
 {
     struct bg_queued_item* item = malloc( sizeof( *item ) );
 
@@ -192,26 +371,26 @@ int background_worker_Push( struct background_worker* worker, void* entity,
     item->id = id;
     item->entity = entity;
     item->timeout = timeout < 0 ? worker->conf.default_timeout : timeout;
+    item->priority = priority;
 
-    vlc_mutex_lock( &worker->tail.lock );
-    vlc_array_append( &worker->tail.data, item );
-    vlc_mutex_unlock( &worker->tail.lock );
+    vlc_mutex_lock( &worker->lock );
+    QueueAppend( worker, item );
 
-    vlc_mutex_lock( &worker->head.lock );
-    if( worker->head.active == false )
+    if( vlc_array_count( &worker->threads ) < worker->conf.max_threads &&
+        SpawnThread( worker ) != VLC_SUCCESS &&
+        vlc_array_count( &worker->threads ) == 0 )
     {
-        worker->head.probe_request = false;
-        worker->head.active =
-            !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW );
+        /* Nobody to process the entity */
+        QueueRemove( worker, item );
+        vlc_mutex_unlock( &worker->lock );
+        free( item );
+        return VLC_EGENERIC;
     }
 
-    if( worker->head.active )
-        worker->conf.pf_hold( item->entity );
-
-    int ret = worker->head.active ? VLC_SUCCESS : VLC_EGENERIC;
-    vlc_mutex_unlock( &worker->head.lock );
+    worker->conf.pf_hold( item->entity );
+    vlc_mutex_unlock( &worker->lock );
 
-    return ret;
+    return VLC_SUCCESS;
 }
 
 void background_worker_Cancel( struct background_worker* worker, void* id )
@@ -221,15 +400,21 @@ void background_worker_Cancel( struct background_worker* worker, void* id )
 
 void background_worker_RequestProbe( struct background_worker* worker )
 {
-    vlc_mutex_lock( &worker->head.lock );
-    worker->head.probe_request = true;
-    vlc_cond_broadcast( &worker->head.wait );
-    vlc_mutex_unlock( &worker->head.lock );
+    vlc_mutex_lock( &worker->lock );
+    for( size_t i = 0; i < vlc_array_count( &worker->threads ); ++i )
+    {
+        struct bg_thread* th = vlc_array_item_at_index( &worker->threads, i );
+        th->probe_request = true;
+    }
+    vlc_cond_broadcast( &worker->wait );
+    vlc_mutex_unlock( &worker->lock );
 }
 
 void background_worker_Delete( struct background_worker* worker )
 {
     BackgroundWorkerCancel( worker, NULL );
-    vlc_array_clear( &worker->tail.data );
+    vlc_array_clear( &worker->threads );
+    vlc_cond_destroy( &worker->wait );
+    vlc_mutex_destroy( &worker->lock );
     free( worker );
 }
@@ -19,6 +19,36 @@
 #ifndef BACKGROUND_WORKER_H__
 #define BACKGROUND_WORKER_H__
 
+#include <vlc_input_item.h>
+
+/**
+ * Priority lanes of the background-worker
+ *
+ * Queued entities of a higher priority lane are always started before the
+ * ones of a lower priority lane. Within a lane, entities are started in the
+ * order in which they were pushed.
+ **/
+enum background_worker_priority {
+    BACKGROUND_WORKER_PRIORITY_HIGH, /**< e.g. visible or selected items */
+    BACKGROUND_WORKER_PRIORITY_NORMAL,
+    BACKGROUND_WORKER_PRIORITY_LOW, /**< bulk background work */
+};
+#define BACKGROUND_WORKER_PRIORITY_COUNT 3
+
+/**
+ * Priority lane of a metadata request, from its META_REQUEST_OPTION_PRIORITY
+ * flags
+ */
+static inline enum background_worker_priority
+background_worker_RequestPriority( input_item_meta_request_option_t options )
+{
+    if( options & META_REQUEST_OPTION_PRIORITY_HIGH )
+        return BACKGROUND_WORKER_PRIORITY_HIGH;
+    if( options & META_REQUEST_OPTION_PRIORITY_LOW )
+        return BACKGROUND_WORKER_PRIORITY_LOW;
+    return BACKGROUND_WORKER_PRIORITY_NORMAL;
+}
+
 struct background_worker_config {
     /**
      * Default timeout for completing a task
@@ -29,6 +59,14 @@ struct background_worker_config {
      **/
     mtime_t default_timeout;
 
+    /**
+     * Maximum number of tasks running concurrently
+     *
+     * Each running task is handled by its own thread of the
+     * background-worker. A value of 0 is treated as 1.
+     **/
+    unsigned max_threads;
+
     /**
      * Release an entity
      *
@@ -122,7 +160,7 @@ struct background_worker* background_worker_New( void* owner,
  * Request the background-worker to probe the current task
  *
  * This function is used to signal the background-worker that it should do
- * another probe to see whether the current task is still alive.
+ * another probe to see whether the current tasks are still alive.
  *
  * \warning Note that the function will not wait for the probing to finish, it
  *          will simply ask the background worker to recheck it as soon as
@@ -136,8 +174,9 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * Push an entity into the background-worker
  *
  * This function is used to push an entity into the queue of pending work. The
- * entities will be processed in the order in which they are received (in terms
- * of the order of invocations in a single-threaded environment).
+ * entities of a given priority will be started in the order in which they are
+ * received (in terms of the order of invocations in a single-threaded
+ * environment).
  *
  * \param worker the background-worker
  * \param entity the entity which is to be queued
@@ -145,11 +184,12 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * \param timeout the timeout of the entity in milliseconds, `0` denotes no
  *                timeout, a negative value will use the default timeout
  *                associated with the background-worker.
+ * \param priority the lane of the entity, see \ref background_worker_priority
  * \return VLC_SUCCESS if the entity was successfully queued, an error-code on
  *         failure.
  **/
 int background_worker_Push( struct background_worker* worker, void* entity,
-    void* id, int timeout );
+    void* id, int timeout, enum background_worker_priority priority );
 
 /**
  * Remove entities from the background-worker
@@ -163,7 +203,7 @@ int background_worker_Push( struct background_worker* worker, void* entity,
  *
  * \param worker the background-worker
  * \param id NULL if every entity shall be removed, and the currently running
- *        task (if any) shall be cancelled.
+ *        tasks (if any) shall be cancelled.
  **/
 void background_worker_Cancel( struct background_worker* worker, void* id );
 
@@ -171,11 +211,11 @@ void background_worker_Cancel( struct background_worker* worker, void* id );
  * Delete a background-worker
  *
  * This function will destroy a background-worker created through \ref
- * background_worker_New. It will effectively stop the currently running task,
+ * background_worker_New. It will effectively stop the currently running tasks,
  * if any, and empty the queue of pending entities.
  *
- * \warning If there is a currently running task, the function will block until
- *          it has been stopped.
+ * \warning If there are currently running tasks, the function will block until
+ *          they have been stopped.
  *
  * \param worker the background-worker
  **/
@@ -32,6 +32,7 @@
 #include <fcntl.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
 
@@ -143,6 +144,10 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
 
+    /* The spare space around the payload of a shared block is common to all
+     * references: it cannot be written into. */
+    const bool b_shared = block_IsShared( p_block );
+
     /* Corner case: empty block requested */
     if( i_prebody <= 0 && i_body <= (size_t)(-i_prebody) )
         i_prebody = i_body = 0;
@@ -175,7 +180,7 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 
     if( p_block->i_buffer == 0 )
     {   /* Corner case: nothing to preserve */
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && !b_shared )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -200,7 +205,8 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
     /* Second, reallocate the buffer if we lack space. */
     assert( i_prebody >= 0 );
     if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
-     || (size_t)(p_end - p_block->p_buffer) < i_body )
+     || (size_t)(p_end - p_block->p_buffer) < i_body
+     || (b_shared && (i_prebody > 0 || i_body > p_block->i_buffer)) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea == NULL )
@@ -259,6 +265,146 @@ block_t *block_heap_Alloc (void *addr, size_t length)
     return block;
 }
 
+typedef struct
+{
+    atomic_uint refs;
+    block_t    *block; /**< Owner of the shared buffer */
+} block_payload_t;
+
+typedef struct
+{
+    block_t          self;
+    block_payload_t *payload;
+} block_shared_t;
+
+static void block_shared_Release (block_t *block)
+{
+    block_payload_t *payload = ((block_shared_t *)block)->payload;
+
+    block_Invalidate (block);
+    free (block);
+
+    if (atomic_fetch_sub (&payload->refs, 1) == 1)
+    {
+        block_Release (payload->block);
+        free (payload);
+    }
+}
+
+static block_t *block_shared_New (block_payload_t *payload,
+                                  const block_t *ref)
+{
+    block_shared_t *shared = malloc (sizeof (*shared));
+    if (unlikely(shared == NULL))
+        return NULL;
+
+    block_t *block = &shared->self;
+    const block_t *owner = payload->block;
+
+    block_Init (block, owner->p_start, owner->i_size);
+    BlockMetaCopy (block, ref);
+    block->p_next = NULL;
+    block->p_buffer = ref->p_buffer;
+    block->i_buffer = ref->i_buffer;
+    block->pf_release = block_shared_Release;
+    shared->payload = payload;
+    return block;
+}
+
+block_t *block_shared_Alloc (block_t *owner)
+{
+    block_Check (owner);
+
+    if (owner->pf_release == block_shared_Release)
+        return owner; /* Already shared */
+
+    block_payload_t *payload = malloc (sizeof (*payload));
+    if (unlikely(payload == NULL))
+    {
+        block_Release (owner);
+        return NULL;
+    }
+
+    atomic_init (&payload->refs, 1);
+    payload->block = owner;
+
+    block_t *block = block_shared_New (payload, owner);
+    if (unlikely(block == NULL))
+    {
+        block_Release (owner);
+        free (payload);
+        return NULL;
+    }
+    block->p_next = owner->p_next;
+    owner->p_next = NULL;
+    return block;
+}
+
+block_t *block_Share (block_t *block)
+{
+    block_Check (block);
+
+    if (block->pf_release != block_shared_Release)
+        return block_Duplicate (block);
+
+    block_payload_t *payload = ((block_shared_t *)block)->payload;
+    block_t *dup = block_shared_New (payload, block);
+    if (likely(dup != NULL))
+        atomic_fetch_add (&payload->refs, 1);
+    return dup;
+}
+
+block_t *block_shared_Gather (block_t *list)
+{
+    block_Check (list);
+
+    if (list->pf_release != block_shared_Release)
+        return NULL;
+
+    const block_payload_t *payload = ((block_shared_t *)list)->payload;
+    size_t size = list->i_buffer;
+    mtime_t length = list->i_length;
+
+    for (const block_t *prev = list, *b = list->p_next;
+         b != NULL;
+         prev = b, b = b->p_next)
+    {
+        if (b->pf_release != block_shared_Release
+         || ((const block_shared_t *)b)->payload != payload
+         || b->p_buffer != prev->p_buffer + prev->i_buffer)
+            return NULL;
+        size += b->i_buffer;
+        length += b->i_length;
+    }
+
+    block_ChainRelease (list->p_next);
+    list->p_next = NULL;
+    list->i_buffer = size;
+    list->i_length = length;
+    return list;
+}
+
+bool block_IsShared (const block_t *block)
+{
+    if (block->pf_release != block_shared_Release)
+        return false;
+
+    const block_payload_t *payload = ((const block_shared_t *)block)->payload;
+    return atomic_load (&payload->refs) > 1;
+}
+
+block_t *block_Unshare (block_t *block)
+{
+    if (!block_IsShared (block))
+        return block;
+
+    block_t *dup = block_Duplicate (block);
+    if (likely(dup != NULL))
+        dup->p_next = block->p_next;
+    block_Release (block);
+    return dup;
+}
+
 #ifdef HAVE_MMAP
 # include <sys/mman.h>
 
@@ -210,6 +210,8 @@ void vlc_CPU_init (void)
             i_capabilities |= VLC_CPU_SSE4_1;
         if (i_ecx & 0x00100000)
             i_capabilities |= VLC_CPU_SSE4_2;
+        if (i_ecx & 0x00000002)
+            i_capabilities |= VLC_CPU_PCLMUL;
     }
 
     /* test for additional capabilities */
@@ -313,6 +315,8 @@ void vlc_CPU_dump (vlc_object_t *obj)
         vlc_memstream_puts(&stream, "XOP ");
     if (vlc_CPU_FMA4())
         vlc_memstream_puts(&stream, "FMA4 ");
+    if (vlc_CPU_PCLMUL())
+        vlc_memstream_puts(&stream, "PCLMUL ");
 
 #elif defined (__powerpc__) || defined (__ppc__) || defined (__ppc64__)
     if (vlc_CPU_ALTIVEC())
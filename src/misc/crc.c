@@ -0,0 +1,242 @@
+/*****************************************************************************
+ * crc.c: cyclic redundancy checks
+ *****************************************************************************
+ * Copyright © 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_cpu.h>
+#include <vlc_crc.h>
+
+#if defined (HAVE_SSE2_INTRINSICS) && (defined (__i386__) || defined (__x86_64__))
+# define CAN_COMPILE_PCLMUL 1
+# include <tmmintrin.h>
+# include <wmmintrin.h>
+#endif
+
+/*
+ * All the CRCs are computed as a 32 bits CRC: a CRC of width w and
+ * generator G is the 32 bits CRC of generator G * x^(32 - w), shifted right
+ * by 32 - w bits.
+ */
+struct crc_engine
+{
+    uint32_t poly; /* generator, without its x^32 term */
+    /* table[k][i] is i * x^(32 + 8 * k) modulo the generator */
+    uint32_t table[8][256];
+#ifdef CAN_COMPILE_PCLMUL
+    /* x^(n + 64) and x^n modulo the generator, to fold 4 and 1 blocks */
+    uint64_t fold4[2];
+    uint64_t fold1[2];
+    /* final reduction: x^96, x^64 modulo the generator and floor(x^64 / G) */
+    uint64_t x96, x64, mu;
+#endif
+};
+
+static struct
+{
+    atomic_bool init;
+    vlc_mutex_t lock;
+    struct crc_engine crc8, crc16, crc32;
+} engines = { .init = false, .lock = VLC_STATIC_MUTEX };
+
+/* x^n modulo the generator, n >= 32 */
+static uint32_t crc_xpow( uint32_t poly, unsigned n )
+{
+    uint32_t r = poly;
+
+    for( n -= 32; n > 0; n-- )
+        r = (r << 1) ^ ((r & 0x80000000) ? poly : 0);
+    return r;
+}
+
+static void crc_engine_init( struct crc_engine *e, uint32_t poly )
+{
+    e->poly = poly;
+    for( unsigned i = 0; i < 256; i++ )
+    {
+        uint32_t r = i << 24;
+
+        for( unsigned j = 0; j < 8; j++ )
+            r = (r << 1) ^ ((r & 0x80000000) ? poly : 0);
+        e->table[0][i] = r;
+    }
+    for( unsigned k = 1; k < 8; k++ )
+        for( unsigned i = 0; i < 256; i++ )
+        {
+            uint32_t r = e->table[k - 1][i];
+            e->table[k][i] = (r << 8) ^ e->table[0][r >> 24];
+        }
+
+#ifdef CAN_COMPILE_PCLMUL
+    e->fold4[0] = crc_xpow( poly, 512 + 64 );
+    e->fold4[1] = crc_xpow( poly, 512 );
+    e->fold1[0] = crc_xpow( poly, 128 + 64 );
+    e->fold1[1] = crc_xpow( poly, 128 );
+    e->x96 = crc_xpow( poly, 96 );
+    e->x64 = crc_xpow( poly, 64 );
+
+    /* Polynomial long division of x^64 by the generator */
+    const uint64_t g = (UINT64_C(1) << 32) | poly;
+    uint64_t r = UINT64_C(1) << 32, q = 0;
+    for( int i = 32; i >= 0; i-- )
+    {
+        if( r & (UINT64_C(1) << 32) )
+        {
+            q |= UINT64_C(1) << i;
+            r ^= g;
+        }
+        r <<= 1;
+    }
+    e->mu = q;
+#endif
+}
+
+static void crc_init( void )
+{
+    if( likely(atomic_load_explicit( &engines.init, memory_order_acquire )) )
+        return;
+
+    vlc_mutex_lock( &engines.lock );
+    if( !atomic_load_explicit( &engines.init, memory_order_relaxed ) )
+    {
+        crc_engine_init( &engines.crc8, UINT32_C(0x07) << 24 );
+        crc_engine_init( &engines.crc16, UINT32_C(0x8005) << 16 );
+        crc_engine_init( &engines.crc32, UINT32_C(0x04C11DB7) );
+        atomic_store_explicit( &engines.init, true, memory_order_release );
+    }
+    vlc_mutex_unlock( &engines.lock );
+}
+
+/* Slice-by-8: eight table lookups per eight bytes, without dependencies
+ * between them */
+static uint32_t crc_slice8( const struct crc_engine *e, uint32_t crc,
+                            const uint8_t *p, size_t len )
+{
+    const uint32_t (*t)[256] = e->table;
+
+    for( ; len >= 8; p += 8, len -= 8 )
+    {
+        uint32_t a = crc ^ GetDWBE( p ), b = GetDWBE( p + 4 );
+
+        crc = t[7][a >> 24] ^ t[6][(a >> 16) & 0xff]
+            ^ t[5][(a >> 8) & 0xff] ^ t[4][a & 0xff]
+            ^ t[3][b >> 24] ^ t[2][(b >> 16) & 0xff]
+            ^ t[1][(b >> 8) & 0xff] ^ t[0][b & 0xff];
+    }
+    while( len-- > 0 )
+        crc = (crc << 8) ^ t[0][(crc >> 24) ^ *(p++)];
+    return crc;
+}
+
+#ifdef CAN_COMPILE_PCLMUL
+/* Carry-less multiplication folding, as described by Intel in "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction": each
+ * 128 bits block A * x^64 + B is folded 512 (or 128) bits further as
+ * A * (x^(512 + 64) mod G) + B * (x^512 mod G). */
+__attribute__ ((__target__ ("ssse3,pclmul")))
+static inline __m128i crc_fold( __m128i v, __m128i k )
+{
+    return _mm_xor_si128( _mm_clmulepi64_si128( v, k, 0x11 ),
+                          _mm_clmulepi64_si128( v, k, 0x00 ) );
+}
+
+__attribute__ ((__target__ ("ssse3,pclmul")))
+static uint32_t crc_pclmul( const struct crc_engine *e, uint32_t crc,
+                            const uint8_t *p, size_t len )
+{
+    /* The first bit of the data is the most significant */
+    const __m128i bswap = _mm_set_epi8( 0, 1, 2, 3, 4, 5, 6, 7,
+                                        8, 9, 10, 11, 12, 13, 14, 15 );
+#define LOAD(p) _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *)(p) ), bswap )
+    const __m128i k4 = _mm_set_epi64x( e->fold4[0], e->fold4[1] );
+    const __m128i k1 = _mm_set_epi64x( e->fold1[0], e->fold1[1] );
+
+    assert( len >= 64 );
+    __m128i x0 = _mm_xor_si128( LOAD(p),
+                        _mm_slli_si128( _mm_cvtsi32_si128( crc ), 12 ) );
+    __m128i x1 = LOAD(p + 16), x2 = LOAD(p + 32), x3 = LOAD(p + 48);
+
+    for( p += 64, len -= 64; len >= 64; p += 64, len -= 64 )
+    {
+        x0 = _mm_xor_si128( crc_fold( x0, k4 ), LOAD(p) );
+        x1 = _mm_xor_si128( crc_fold( x1, k4 ), LOAD(p + 16) );
+        x2 = _mm_xor_si128( crc_fold( x2, k4 ), LOAD(p + 32) );
+        x3 = _mm_xor_si128( crc_fold( x3, k4 ), LOAD(p + 48) );
+    }
+
+    x0 = _mm_xor_si128( crc_fold( x0, k1 ), x1 );
+    x0 = _mm_xor_si128( crc_fold( x0, k1 ), x2 );
+    x0 = _mm_xor_si128( crc_fold( x0, k1 ), x3 );
+    for( ; len >= 16; p += 16, len -= 16 )
+        x0 = _mm_xor_si128( crc_fold( x0, k1 ), LOAD(p) );
+#undef LOAD
+
+    /* (A * x^64 + B) * x^32 = A * (x^96 mod G) + B * x^32, on 96 bits */
+    const __m128i k = _mm_set_epi64x( e->mu, e->x96 );
+    __m128i t = _mm_xor_si128( _mm_clmulepi64_si128( x0, k, 0x01 ),
+                               _mm_slli_si128( _mm_move_epi64( x0 ), 4 ) );
+    /* C * x^64 + D = C * (x^64 mod G) + D, on 64 bits */
+    t = _mm_xor_si128( _mm_clmulepi64_si128( _mm_srli_si128( t, 8 ),
+                                             _mm_cvtsi32_si128( e->x64 ),
+                                             0x00 ),
+                       _mm_move_epi64( t ) );
+    /* Barrett reduction: the quotient is (t / x^32) * mu / x^32 */
+    __m128i q = _mm_srli_epi64( _mm_clmulepi64_si128( _mm_srli_epi64( t, 32 ),
+                                                      k, 0x10 ), 32 );
+    const __m128i g = _mm_set_epi64x( 0, (INT64_C(1) << 32) | e->poly );
+    t = _mm_xor_si128( t, _mm_clmulepi64_si128( q, g, 0x00 ) );
+    crc = _mm_cvtsi128_si32( t );
+
+    return crc_slice8( e, crc, p, len );
+}
+#endif
+
+static uint32_t crc_compute( const struct crc_engine *e, uint32_t crc,
+                             const void *buf, size_t len )
+{
+#ifdef CAN_COMPILE_PCLMUL
+    if( len >= 64 && vlc_CPU_PCLMUL() && vlc_CPU_SSSE3() )
+        return crc_pclmul( e, crc, buf, len );
+#endif
+    return crc_slice8( e, crc, buf, len );
+}
+
+uint8_t vlc_crc8( uint8_t crc, const void *buf, size_t len )
+{
+    crc_init();
+    return crc_compute( &engines.crc8, (uint32_t)crc << 24, buf, len ) >> 24;
+}
+
+uint16_t vlc_crc16( uint16_t crc, const void *buf, size_t len )
+{
+    crc_init();
+    return crc_compute( &engines.crc16, (uint32_t)crc << 16, buf, len ) >> 16;
+}
+
+uint32_t vlc_crc32_mpeg( uint32_t crc, const void *buf, size_t len )
+{
+    crc_init();
+    return crc_compute( &engines.crc32, crc, buf, len );
+}
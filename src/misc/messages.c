@@ -41,8 +41,11 @@
 #include <vlc_interface.h>
 #include <vlc_charset.h>
 #include <vlc_modules.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
+typedef struct vlc_logger_async_t vlc_logger_async_t;
+
 struct vlc_logger_t
 {
     VLC_COMMON_MEMBERS
@@ -50,8 +53,12 @@ struct vlc_logger_t
     vlc_log_cb log;
     void *sys;
     module_t *module;
+    vlc_logger_async_t *async; /**< protected by lock once emitters run */
 };
 
+static bool vlc_LogAsyncPush(vlc_logger_async_t *, int, const vlc_log_t *,
+                             const char *, va_list);
+
 static void vlc_vaLogCallback(libvlc_int_t *vlc, int type,
                               const vlc_log_t *item, const char *format,
                               va_list ap)
@@ -137,7 +144,21 @@ void vlc_vaLog (vlc_object_t *obj, int type, const char *module,
 
     /* Pass message to the callback */
     if (obj != NULL)
-        vlc_vaLogCallback(obj->obj.libvlc, type, &msg, format, args);
+    {
+        vlc_logger_t *logger = libvlc_priv(obj->obj.libvlc)->logger;
+        bool queued = false;
+        int canc = vlc_savecancel();
+
+        /* The asynchronous logger may be stopped concurrently */
+        vlc_rwlock_rdlock(&logger->lock);
+        if (logger->async != NULL)
+            queued = vlc_LogAsyncPush(logger->async, type, &msg, format, args);
+        vlc_rwlock_unlock(&logger->lock);
+        vlc_restorecancel(canc);
+
+        if (!queued)
+            vlc_vaLogCallback(obj->obj.libvlc, type, &msg, format, args);
+    }
 }
 
 /**
@@ -311,6 +332,486 @@ static void vlc_logger_unload(void *func, va_list ap)
     deactivate(sys);
 }
 
+/*** Asynchronous logging ***/
+
+/* Each emitting thread owns a single-producer single-consumer ring of log
+ * records. The logger thread merges the rings in emission order and passes
+ * the records to the logger callback, so that slow loggers do not stall the
+ * emitting threads (nor serialize them on the logger lock). */
+#define VLC_LOG_RING_SIZE 128 /* records per thread, must be a power of 2 */
+#define VLC_LOG_SITES     256 /* rate limiter hash table size */
+
+typedef struct vlc_log_record_t
+{
+    unsigned seq;
+    int type;
+    vlc_log_t meta;
+    char *header;
+    char *msg; /* points to text or to a heap buffer if text is too small */
+    char module[48];
+    char text[192];
+} vlc_log_record_t;
+
+typedef struct vlc_log_ring_t
+{
+    struct vlc_log_ring_t *next;
+    atomic_uint head; /* next record to write (emitting thread) */
+    atomic_uint tail; /* next record to read (logger thread) */
+    atomic_uint dropped;
+    atomic_bool dead;
+    unsigned dropped_seen;
+    unsigned drain_end; /* head when the current drain pass started */
+    unsigned long tid;
+    vlc_log_record_t records[VLC_LOG_RING_SIZE];
+} vlc_log_ring_t;
+
+typedef struct
+{
+    atomic_uintptr_t key;
+    atomic_uint second;
+    atomic_uint count;
+    atomic_uint suppressed;
+} vlc_log_site_t;
+
+struct vlc_logger_async_t
+{
+    vlc_thread_t thread;
+    vlc_threadvar_t ring_key;
+    vlc_sem_t wait;
+    atomic_bool waiting;
+    atomic_bool quit;
+    atomic_bool discard;
+    atomic_uint seq;
+    unsigned rate_limit;
+
+    vlc_mutex_t lock; /* protects the rings list and the flush counters */
+    vlc_cond_t flushed;
+    vlc_log_ring_t *rings;
+    unsigned flush_req;
+    unsigned flush_done;
+    unsigned long dropped;
+
+    vlc_log_site_t sites[VLC_LOG_SITES];
+};
+
+static void vlc_LogRingRelease(void *data)
+{
+    vlc_log_ring_t *ring = data;
+
+    /* The emitting thread is exiting, the logger thread will free the ring */
+    atomic_store(&ring->dead, true);
+}
+
+static vlc_log_ring_t *vlc_LogRingGet(vlc_logger_async_t *async)
+{
+    vlc_log_ring_t *ring = vlc_threadvar_get(async->ring_key);
+    if (likely(ring != NULL))
+        return ring;
+
+    ring = malloc(sizeof (*ring));
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->dead, false);
+    ring->dropped_seen = 0;
+    ring->tid = vlc_thread_id();
+
+    if (vlc_threadvar_set(async->ring_key, ring))
+    {
+        free(ring);
+        return NULL;
+    }
+
+    vlc_mutex_lock(&async->lock);
+    ring->next = async->rings;
+    async->rings = ring;
+    vlc_mutex_unlock(&async->lock);
+    return ring;
+}
+
+/**
+ * Checks the per call site rate limit.
+ * \param suppressed number of messages suppressed during the previous period
+ *                   at this call site [OUT]
+ * \return true if the message must be suppressed, false otherwise
+ */
+static bool vlc_LogAsyncThrottle(vlc_logger_async_t *async,
+                                 const vlc_log_t *item, const char *format,
+                                 unsigned *suppressed)
+{
+    uintptr_t key = (item->file != NULL) ? (uintptr_t)item->file + item->line
+                                         : (uintptr_t)format;
+    vlc_log_site_t *site =
+        &async->sites[((uint32_t)key * UINT32_C(2654435761)) >> 24];
+    unsigned now = mdate() / CLOCK_FREQ;
+    unsigned second = atomic_load_explicit(&site->second,
+                                           memory_order_relaxed);
+
+    *suppressed = 0;
+
+    if (atomic_load_explicit(&site->key, memory_order_relaxed) != key)
+    {   /* Hash collision (or first use): take the slot over */
+        atomic_store_explicit(&site->key, key, memory_order_relaxed);
+        atomic_store_explicit(&site->second, now, memory_order_relaxed);
+        atomic_store_explicit(&site->count, 0, memory_order_relaxed);
+        atomic_store_explicit(&site->suppressed, 0, memory_order_relaxed);
+    }
+    else
+    if (second != now
+     && atomic_compare_exchange_strong(&site->second, &second, now))
+    {   /* New period */
+        *suppressed = atomic_exchange(&site->suppressed, 0);
+        atomic_store(&site->count, 0);
+    }
+
+    if (atomic_fetch_add(&site->count, 1) < async->rate_limit)
+        return false;
+
+    atomic_fetch_add(&site->suppressed, 1);
+    return true;
+}
+
+static void vlc_LogAsyncWrite(vlc_logger_async_t *async, vlc_log_ring_t *ring,
+                              int type, const vlc_log_t *item,
+                              const char *format, va_list ap)
+{
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail >= VLC_LOG_RING_SIZE)
+    {   /* Ring full: the logger thread will report the loss */
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    vlc_log_record_t *rec = &ring->records[head & (VLC_LOG_RING_SIZE - 1)];
+
+    rec->seq = atomic_fetch_add_explicit(&async->seq, 1,
+                                         memory_order_relaxed);
+    rec->type = type;
+    rec->meta = *item;
+    /* The module name may be on the stack, and objects may be destroyed
+     * before the record is processed: copy the strings. */
+    strlcpy(rec->module, item->psz_module, sizeof (rec->module));
+    rec->meta.psz_module = rec->module;
+    rec->header = (item->psz_header != NULL) ? strdup(item->psz_header)
+                                             : NULL;
+    rec->meta.psz_header = rec->header;
+
+    /* Only the message text is formatted here, as the arguments may not
+     * outlive the call. Everything else is formatted by the logger thread. */
+    va_list aq;
+    int len;
+
+    va_copy(aq, ap);
+    len = vsnprintf(rec->text, sizeof (rec->text), format, aq);
+    va_end(aq);
+
+    rec->msg = rec->text;
+    if (unlikely(len < 0))
+        strcpy(rec->text, "message lost");
+    else if ((size_t)len >= sizeof (rec->text))
+    {
+        char *msg;
+
+        if (vasprintf(&msg, format, ap) != -1)
+            rec->msg = msg; /* otherwise, keep the truncated message */
+    }
+
+    /* Sequentially consistent to pair with the waiting flag */
+    atomic_store(&ring->head, head + 1);
+    if (atomic_exchange(&async->waiting, false))
+        vlc_sem_post(&async->wait);
+}
+
+static void vlc_LogAsyncWritef(vlc_logger_async_t *async, vlc_log_ring_t *ring,
+                               int type, const vlc_log_t *item,
+                               const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    vlc_LogAsyncWrite(async, ring, type, item, format, ap);
+    va_end(ap);
+}
+
+/**
+ * Queues a log message for the logger thread.
+ * \return false if the message must be logged synchronously
+ */
+static bool vlc_LogAsyncPush(vlc_logger_async_t *async, int type,
+                             const vlc_log_t *item, const char *format,
+                             va_list ap)
+{
+    if (atomic_load_explicit(&async->discard, memory_order_relaxed))
+        return true;
+
+    vlc_log_ring_t *ring = vlc_LogRingGet(async);
+    if (unlikely(ring == NULL))
+        return false;
+
+    if (async->rate_limit > 0)
+    {
+        unsigned suppressed;
+        bool throttled = vlc_LogAsyncThrottle(async, item, format,
+                                              &suppressed);
+
+        if (suppressed > 0)
+            vlc_LogAsyncWritef(async, ring, type, item,
+                               "(%u similar messages suppressed)",
+                               suppressed);
+        if (throttled)
+            return true;
+    }
+
+    vlc_LogAsyncWrite(async, ring, type, item, format, ap);
+    return true;
+}
+
+static void vlc_LogEmit(vlc_logger_t *logger, int type, const vlc_log_t *item,
+                        const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    logger->log(logger->sys, type, item, format, ap);
+    va_end(ap);
+}
+
+/**
+ * Passes the records pending when called to the logger callback, oldest
+ * first. Records queued meanwhile are left for the next pass, so that busy
+ * emitters cannot hold a pass (and the flushes waiting for it) forever.
+ * \return the number of records
+ */
+static unsigned vlc_LogAsyncDrain(vlc_logger_t *logger,
+                                  vlc_logger_async_t *async,
+                                  vlc_log_ring_t *rings)
+{
+    unsigned count = 0;
+
+    for (vlc_log_ring_t *ring = rings; ring != NULL; ring = ring->next)
+        ring->drain_end = atomic_load(&ring->head);
+
+    vlc_rwlock_rdlock(&logger->lock);
+    for (;;)
+    {
+        vlc_log_ring_t *oldest = NULL;
+        vlc_log_record_t *rec = NULL;
+
+        for (vlc_log_ring_t *ring = rings; ring != NULL; ring = ring->next)
+        {
+            unsigned tail = atomic_load_explicit(&ring->tail,
+                                                 memory_order_relaxed);
+
+            if (ring->drain_end == tail)
+                continue;
+
+            vlc_log_record_t *r =
+                &ring->records[tail & (VLC_LOG_RING_SIZE - 1)];
+
+            if (rec == NULL || (int)(r->seq - rec->seq) < 0)
+            {
+                rec = r;
+                oldest = ring;
+            }
+        }
+
+        if (rec == NULL)
+            break;
+
+        vlc_LogEmit(logger, rec->type, &rec->meta, "%s", rec->msg);
+        if (rec->msg != rec->text)
+            free(rec->msg);
+        free(rec->header);
+        atomic_fetch_add_explicit(&oldest->tail, 1, memory_order_release);
+        count++;
+    }
+
+    for (vlc_log_ring_t *ring = rings; ring != NULL; ring = ring->next)
+    {
+        unsigned dropped = atomic_load_explicit(&ring->dropped,
+                                                memory_order_relaxed);
+        if (dropped == ring->dropped_seen)
+            continue;
+
+        const vlc_log_t meta = {
+            .i_object_id = (uintptr_t)logger,
+            .psz_object_type = "logger",
+            .psz_module = "core",
+            .file = __FILE__,
+            .line = __LINE__,
+            .func = __func__,
+            .tid = ring->tid,
+        };
+
+        vlc_LogEmit(logger, VLC_MSG_WARN, &meta,
+                    "%u log messages dropped (thread %lu)",
+                    dropped - ring->dropped_seen, ring->tid);
+        async->dropped += dropped - ring->dropped_seen;
+        ring->dropped_seen = dropped;
+    }
+    vlc_rwlock_unlock(&logger->lock);
+    return count;
+}
+
+static void *vlc_LogAsyncThread(void *data)
+{
+    vlc_logger_t *logger = data;
+    vlc_logger_async_t *async = logger->async;
+    bool armed = false;
+
+    for (;;)
+    {
+        vlc_log_ring_t *rings;
+        unsigned req;
+
+        vlc_mutex_lock(&async->lock);
+        /* Free the rings of exited threads, once they are empty */
+        for (vlc_log_ring_t **pp = &async->rings, *ring; (ring = *pp) != NULL;)
+        {
+            if (atomic_load(&ring->dead)
+             && atomic_load(&ring->head) == atomic_load(&ring->tail)
+             && atomic_load(&ring->dropped) == ring->dropped_seen)
+            {
+                *pp = ring->next;
+                free(ring);
+            }
+            else
+                pp = &ring->next;
+        }
+        rings = async->rings;
+        req = async->flush_req;
+        vlc_mutex_unlock(&async->lock);
+
+        /* One pass covers everything queued before the flush request */
+        unsigned count = vlc_LogAsyncDrain(logger, async, rings);
+
+        vlc_mutex_lock(&async->lock);
+        async->flush_done = req;
+        vlc_cond_broadcast(&async->flushed);
+        vlc_mutex_unlock(&async->lock);
+
+        if (count > 0)
+            continue;
+
+        if (atomic_load(&async->quit))
+            break;
+
+        if (!armed)
+        {   /* Check once more after announcing the wait to emitters */
+            atomic_store(&async->waiting, true);
+            armed = true;
+            continue;
+        }
+
+        vlc_sem_wait(&async->wait);
+        armed = false;
+    }
+    return NULL;
+}
+
+/**
+ * Waits until all messages queued so far are processed, but not the ones
+ * queued afterwards.
+ */
+static void vlc_LogAsyncFlush(vlc_logger_async_t *async)
+{
+    vlc_mutex_lock(&async->lock);
+    unsigned req = ++async->flush_req;
+
+    vlc_sem_post(&async->wait);
+    while ((int)(async->flush_done - req) < 0)
+        vlc_cond_wait(&async->flushed, &async->lock);
+    vlc_mutex_unlock(&async->lock);
+}
+
+static vlc_logger_async_t *vlc_LogAsyncStart(vlc_logger_t *logger)
+{
+    vlc_logger_async_t *async = malloc(sizeof (*async));
+    if (unlikely(async == NULL))
+        return NULL;
+
+    if (vlc_threadvar_create(&async->ring_key, vlc_LogRingRelease))
+    {
+        free(async);
+        return NULL;
+    }
+
+    vlc_sem_init(&async->wait, 0);
+    atomic_init(&async->waiting, false);
+    atomic_init(&async->quit, false);
+    atomic_init(&async->discard, false);
+    atomic_init(&async->seq, 0);
+    async->rate_limit = var_InheritInteger(logger, "log-rate-limit");
+    vlc_mutex_init(&async->lock);
+    vlc_cond_init(&async->flushed);
+    async->rings = NULL;
+    async->flush_req = async->flush_done = 0;
+    async->dropped = 0;
+
+    for (size_t i = 0; i < VLC_LOG_SITES; i++)
+    {
+        vlc_log_site_t *site = &async->sites[i];
+
+        atomic_init(&site->key, 0);
+        atomic_init(&site->second, 0);
+        atomic_init(&site->count, 0);
+        atomic_init(&site->suppressed, 0);
+    }
+
+    logger->async = async;
+
+    if (vlc_clone(&async->thread, vlc_LogAsyncThread, logger,
+                  VLC_THREAD_PRIORITY_LOW))
+    {
+        logger->async = NULL;
+        vlc_cond_destroy(&async->flushed);
+        vlc_mutex_destroy(&async->lock);
+        vlc_sem_destroy(&async->wait);
+        vlc_threadvar_delete(&async->ring_key);
+        free(async);
+        return NULL;
+    }
+    return async;
+}
+
+static void vlc_LogAsyncStop(vlc_logger_t *logger)
+{
+    vlc_logger_async_t *async = logger->async;
+
+    atomic_store(&async->quit, true);
+    vlc_sem_post(&async->wait);
+    vlc_join(async->thread, NULL);
+
+    /* Messages emitted from now on are logged synchronously */
+    vlc_rwlock_wrlock(&logger->lock);
+    logger->async = NULL;
+    vlc_rwlock_unlock(&logger->lock);
+
+    /* No emitters can queue messages anymore */
+    vlc_LogAsyncDrain(logger, async, async->rings);
+    vlc_threadvar_delete(&async->ring_key);
+
+    if (async->dropped > 0)
+        msg_Warn(logger, "%lu log messages dropped in total",
+                 async->dropped);
+
+    for (vlc_log_ring_t *ring = async->rings, *next; ring != NULL; ring = next)
+    {
+        next = ring->next;
+        free(ring);
+    }
+
+    vlc_cond_destroy(&async->flushed);
+    vlc_mutex_destroy(&async->lock);
+    vlc_sem_destroy(&async->wait);
+    free(async);
+}
+
 /**
  * Performs preinitialization of the messages logging subsystem.
  *
@@ -330,6 +831,7 @@ int vlc_LogPreinit(libvlc_int_t *vlc)
         return -1;
 
     vlc_rwlock_init(&logger->lock);
+    logger->async = NULL;
 
     if (vlc_LogEarlyOpen(logger))
     {
@@ -379,6 +881,11 @@ int vlc_LogInit(libvlc_int_t *vlc)
     if (early_sys != NULL)
         vlc_LogEarlyClose(logger, early_sys);
 
+    /* No other threads yet: the pipeline can be set up without locking */
+    if (var_InheritBool(vlc, "log-async")
+     && vlc_LogAsyncStart(logger) != NULL)
+        atomic_store(&logger->async->discard, cb == vlc_vaLogDiscard);
+
     return 0;
 }
 
@@ -400,6 +907,10 @@ void vlc_LogSet(libvlc_int_t *vlc, vlc_log_cb cb, void *opaque)
     if (cb == NULL)
         cb = vlc_vaLogDiscard;
 
+    /* Pending messages belong to the previous callback */
+    if (logger->async != NULL)
+        vlc_LogAsyncFlush(logger->async);
+
     vlc_rwlock_wrlock(&logger->lock);
     sys = logger->sys;
     module = logger->module;
@@ -407,6 +918,8 @@ void vlc_LogSet(libvlc_int_t *vlc, vlc_log_cb cb, void *opaque)
     logger->log = cb;
     logger->sys = opaque;
     logger->module = NULL;
+    if (logger->async != NULL)
+        atomic_store(&logger->async->discard, cb == vlc_vaLogDiscard);
     vlc_rwlock_unlock(&logger->lock);
 
     if (module != NULL)
@@ -426,6 +939,9 @@ void vlc_LogDeinit(libvlc_int_t *vlc)
     if (unlikely(logger == NULL))
         return;
 
+    if (logger->async != NULL)
+        vlc_LogAsyncStop(logger);
+
     if (logger->module != NULL)
         vlc_module_unload(vlc, logger->module, vlc_logger_unload, logger->sys);
     else
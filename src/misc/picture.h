@@ -31,3 +31,21 @@ typedef struct
         void *opaque;
     } gc;
 } picture_priv_t;
+
+/**
+ * Allocates a picture buffer, aligned on 64 bytes.
+ *
+ * Large buffers are recycled from previously freed pictures of a similar
+ * size, if any.
+ */
+void *picture_arena_Alloc(size_t);
+
+/**
+ * Frees or recycles a buffer allocated with picture_arena_Alloc().
+ */
+void picture_arena_Free(void *);
+
+/**
+ * Frees all unused recycled buffers.
+ */
+void picture_arena_Purge(void);
@@ -0,0 +1,293 @@
+/*****************************************************************************
+ * picture_arena.c: recycled picture buffers
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include "picture.h"
+
+/*
+ * Picture buffers are freed and reallocated whenever a picture pool or
+ * filter chain is rebuilt, typically on resolution changes. Large buffers
+ * are kept in size classes instead, so that they can be reused without
+ * going through the system allocator and faulting the pages in again.
+ *
+ * Size classes have 8 steps per power of two, so at most 12.5% of a buffer
+ * is wasted. Small buffers are not worth keeping.
+ */
+#define ARENA_MIN_LOG2   16 /* 64 KiB */
+#define ARENA_MAX_LOG2   31 /* 2 GiB */
+#define ARENA_CLASSES    ((ARENA_MAX_LOG2 - ARENA_MIN_LOG2 + 1) * 8)
+#define ARENA_NO_CLASS   ARENA_CLASSES
+
+/* High-water marks: unused buffers are freed (least recently used first)
+ * beyond the following total size, or after the following delay. The delay
+ * is enforced by a timer, so that idle buffers do not linger until the next
+ * allocation. */
+#define ARENA_MAX_SIZE   (64 << 20)
+#define ARENA_MAX_AGE    (5 * CLOCK_FREQ)
+
+#define ARENA_ALIGN      64
+
+struct picture_buffer
+{
+    size_t size; /**< usable size */
+    unsigned cls; /**< size class, or ARENA_NO_CLASS */
+    mtime_t freed;
+    /* Unused buffers only: */
+    struct picture_buffer *lru_prev, *lru_next;
+    struct picture_buffer *cls_next; /**< unused buffers of the same class */
+};
+
+static_assert(sizeof (struct picture_buffer) <= ARENA_ALIGN,
+              "Buffer header too large");
+
+static struct
+{
+    vlc_mutex_t lock;
+    struct picture_buffer *classes[ARENA_CLASSES]; /**< most recent first */
+    struct picture_buffer *oldest, *newest;
+    size_t size; /**< total size of unused buffers */
+    vlc_timer_t timer;
+    bool has_timer; /**< whether the timer was created */
+    bool armed; /**< whether the timer is scheduled */
+} arena = { VLC_STATIC_MUTEX, { NULL }, NULL, NULL, 0, NULL, false, false };
+
+static unsigned log2_floor(size_t size)
+{
+    unsigned n = 0;
+
+    while (size >>= 1)
+        n++;
+    return n;
+}
+
+/**
+ * Rounds a size up to its class size.
+ * \return the size class, or ARENA_NO_CLASS if not recycled
+ */
+static unsigned ArenaClass(size_t *restrict sizep)
+{
+    size_t size = *sizep;
+
+    if (size < ((size_t)1 << ARENA_MIN_LOG2)
+     || size > ((size_t)1 << ARENA_MAX_LOG2))
+        return ARENA_NO_CLASS;
+
+    unsigned shift = log2_floor(size) - 3;
+    size = ((size + ((size_t)1 << shift) - 1) >> shift) << shift;
+
+    unsigned log2 = log2_floor(size);
+    unsigned cls = (log2 - ARENA_MIN_LOG2) * 8 + ((size >> (log2 - 3)) & 7);
+
+    if (cls >= ARENA_CLASSES)
+        return ARENA_NO_CLASS;
+    *sizep = size;
+    return cls;
+}
+
+static void ArenaUnlink(struct picture_buffer *buf)
+{
+    struct picture_buffer **pp = &arena.classes[buf->cls];
+
+    while (*pp != buf)
+        pp = &(*pp)->cls_next;
+    *pp = buf->cls_next;
+
+    if (buf->lru_prev != NULL)
+        buf->lru_prev->lru_next = buf->lru_next;
+    else
+        arena.oldest = buf->lru_next;
+    if (buf->lru_next != NULL)
+        buf->lru_next->lru_prev = buf->lru_prev;
+    else
+        arena.newest = buf->lru_prev;
+
+    assert(arena.size >= buf->size);
+    arena.size -= buf->size;
+}
+
+/* Detaches the buffers to be freed */
+static struct picture_buffer *ArenaTrim(mtime_t now)
+{
+    struct picture_buffer *list = NULL;
+
+    while (arena.oldest != NULL
+        && (arena.size > ARENA_MAX_SIZE
+         || arena.oldest->freed + ARENA_MAX_AGE < now))
+    {
+        struct picture_buffer *buf = arena.oldest;
+
+        ArenaUnlink(buf);
+        buf->cls_next = list;
+        list = buf;
+    }
+    return list;
+}
+
+static void ArenaFreeList(struct picture_buffer *list)
+{
+    while (list != NULL)
+    {
+        struct picture_buffer *next = list->cls_next;
+
+        aligned_free(list);
+        list = next;
+    }
+}
+
+/* Schedules the next age trim if needed, with the lock held */
+static void ArenaSchedule(void)
+{
+    if (arena.armed || arena.oldest == NULL || !arena.has_timer)
+        return;
+
+    vlc_timer_schedule(arena.timer, true,
+                       arena.oldest->freed + ARENA_MAX_AGE + 1, 0);
+    arena.armed = true;
+}
+
+static void ArenaTimer(void *data)
+{
+    struct picture_buffer *list;
+
+    (void) data;
+    vlc_mutex_lock(&arena.lock);
+    arena.armed = false;
+    list = ArenaTrim(mdate());
+    ArenaSchedule();
+    vlc_mutex_unlock(&arena.lock);
+
+    ArenaFreeList(list);
+}
+
+void *picture_arena_Alloc(size_t size)
+{
+    struct picture_buffer *buf = NULL;
+    unsigned cls;
+
+    if (size == 0)
+        return NULL;
+
+    cls = ArenaClass(&size);
+    if (cls != ARENA_NO_CLASS)
+    {
+        struct picture_buffer *list;
+
+        vlc_mutex_lock(&arena.lock);
+        buf = arena.classes[cls];
+        if (buf != NULL)
+            ArenaUnlink(buf);
+        list = ArenaTrim(mdate());
+        vlc_mutex_unlock(&arena.lock);
+
+        ArenaFreeList(list);
+    }
+
+    if (buf == NULL)
+    {
+        if (unlikely(size > SIZE_MAX - 2 * ARENA_ALIGN))
+            return NULL;
+
+        /* The size must be a multiple of the alignment */
+        buf = aligned_alloc(ARENA_ALIGN, ARENA_ALIGN
+                            + ((size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1)));
+        if (unlikely(buf == NULL))
+            return NULL;
+
+        buf->size = size;
+        buf->cls = cls;
+    }
+    assert(buf->cls == cls && buf->size == size);
+    return ((unsigned char *)buf) + ARENA_ALIGN;
+}
+
+void picture_arena_Free(void *data)
+{
+    if (data == NULL)
+        return;
+
+    struct picture_buffer *buf =
+        (void *)(((unsigned char *)data) - ARENA_ALIGN);
+
+    if (buf->cls == ARENA_NO_CLASS || buf->size > ARENA_MAX_SIZE)
+    {
+        aligned_free(buf);
+        return;
+    }
+
+    mtime_t now = mdate();
+
+    buf->freed = now;
+    vlc_mutex_lock(&arena.lock);
+    buf->cls_next = arena.classes[buf->cls];
+    arena.classes[buf->cls] = buf;
+    buf->lru_prev = arena.newest;
+    buf->lru_next = NULL;
+    if (arena.newest != NULL)
+        arena.newest->lru_next = buf;
+    else
+        arena.oldest = buf;
+    arena.newest = buf;
+    arena.size += buf->size;
+
+    struct picture_buffer *list = ArenaTrim(now);
+
+    if (!arena.has_timer)
+        arena.has_timer = !vlc_timer_create(&arena.timer, ArenaTimer, NULL);
+    ArenaSchedule();
+    vlc_mutex_unlock(&arena.lock);
+
+    ArenaFreeList(list);
+}
+
+void picture_arena_Purge(void)
+{
+    struct picture_buffer *list = NULL;
+    vlc_timer_t timer;
+    bool has_timer;
+
+    vlc_mutex_lock(&arena.lock);
+    while (arena.oldest != NULL)
+    {
+        struct picture_buffer *buf = arena.oldest;
+
+        ArenaUnlink(buf);
+        buf->cls_next = list;
+        list = buf;
+    }
+    assert(arena.size == 0);
+
+    timer = arena.timer;
+    has_timer = arena.has_timer;
+    arena.has_timer = false;
+    arena.armed = false;
+    vlc_mutex_unlock(&arena.lock);
+
+    /* The timer callback may be waiting for the lock: destroy it unlocked */
+    if (has_timer)
+        vlc_timer_destroy(timer);
+    ArenaFreeList(list);
+}
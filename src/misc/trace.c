@@ -0,0 +1,486 @@
+/*****************************************************************************
+ * trace.c: playback latency tracing
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <search.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_fs.h>
+#include <vlc_arrays.h>
+
+#include "misc/trace.h"
+
+/* Frames that neither get displayed nor dropped (e.g. on flush) are
+ * forgotten after a while. */
+#define TRACE_MAX_FRAMES 256
+#define TRACE_MAX_AGE    (10 * CLOCK_FREQ)
+
+/* Latency histograms have power-of-two buckets: [0, 2) us, [2, 4) us...
+ * The last bucket also counts latencies of more than 8 seconds. */
+#define TRACE_BUCKETS 24
+
+/* Spans between two consecutive stages, and a total span */
+#define TRACE_SPANS VLC_TRACE_STAGES
+#define TRACE_TOTAL (TRACE_SPANS - 1)
+
+static const char span_names[TRACE_SPANS][11] = {
+    "fifo", "decode", "vout queue", "filter", "wait", "render", "sleep",
+    "display", "total",
+};
+
+struct vlc_trace_frame
+{
+    const void *owner;
+    mtime_t ts;
+    unsigned es;
+    mtime_t created;
+    mtime_t stamps[VLC_TRACE_STAGES]; /**< 0 if the stage was not reached */
+    struct vlc_trace_frame *prev, *next; /**< in creation order */
+};
+
+struct vlc_trace_span
+{
+    uint64_t count;
+    mtime_t sum;
+    mtime_t max;
+    uint64_t buckets[TRACE_BUCKETS];
+};
+
+struct vlc_trace_es
+{
+    unsigned id;
+    vlc_fourcc_t codec;
+    bool deleted;
+    uint64_t displayed;
+    uint64_t dropped;
+    struct vlc_trace_span spans[TRACE_SPANS];
+};
+
+struct vlc_trace
+{
+    vlc_object_t *obj;
+    FILE *stream; /**< Chrome trace file, or NULL */
+    bool first_event;
+    unsigned pid;
+
+    vlc_mutex_t lock;
+    void *frames; /**< tree of in-flight frames by owner and timestamp */
+    struct vlc_trace_frame *oldest, *newest;
+    unsigned count;
+    vlc_array_t es; /**< struct vlc_trace_es */
+    unsigned last_id;
+};
+
+static int FrameCmp(const void *a, const void *b)
+{
+    const struct vlc_trace_frame *fa = a, *fb = b;
+    uintptr_t oa = (uintptr_t)fa->owner, ob = (uintptr_t)fb->owner;
+
+    if (oa != ob)
+        return (oa < ob) ? -1 : 1;
+    if (fa->ts != fb->ts)
+        return (fa->ts < fb->ts) ? -1 : 1;
+    return 0;
+}
+
+static struct vlc_trace_frame *FrameFind(vlc_trace_t *t, const void *owner,
+                                         mtime_t ts)
+{
+    struct vlc_trace_frame key = { .owner = owner, .ts = ts };
+    struct vlc_trace_frame **pf = tfind(&key, &t->frames, FrameCmp);
+
+    return (pf != NULL) ? *pf : NULL;
+}
+
+static void FrameRemove(vlc_trace_t *t, struct vlc_trace_frame *f)
+{
+    tdelete(f, &t->frames, FrameCmp);
+
+    if (f->prev != NULL)
+        f->prev->next = f->next;
+    else
+        t->oldest = f->next;
+    if (f->next != NULL)
+        f->next->prev = f->prev;
+    else
+        t->newest = f->prev;
+    t->count--;
+    free(f);
+}
+
+static struct vlc_trace_es *EsFind(vlc_trace_t *t, unsigned id)
+{
+    for (size_t i = 0; i < vlc_array_count(&t->es); i++)
+    {
+        struct vlc_trace_es *es = vlc_array_item_at_index(&t->es, i);
+        if (es->id == id)
+            return es;
+    }
+    return NULL;
+}
+
+static void Event(vlc_trace_t *t, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (!t->first_event)
+        fputs(",\n", t->stream);
+    t->first_event = false;
+
+    va_start(ap, fmt);
+    vfprintf(t->stream, fmt, ap);
+    va_end(ap);
+}
+
+static void SpanAdd(struct vlc_trace_span *span, mtime_t duration)
+{
+    unsigned bucket = 0;
+
+    if (duration < 0)
+        duration = 0;
+    while ((duration >> (bucket + 1)) != 0 && bucket < TRACE_BUCKETS - 1)
+        bucket++;
+
+    span->count++;
+    span->sum += duration;
+    if (duration > span->max)
+        span->max = duration;
+    span->buckets[bucket]++;
+}
+
+/* Upper bound of the given percentile */
+static mtime_t SpanPercentile(const struct vlc_trace_span *span,
+                              unsigned percent)
+{
+    uint64_t rank = (span->count * percent + 99) / 100, n = 0;
+
+    for (unsigned i = 0; i < TRACE_BUCKETS - 1; i++)
+    {
+        n += span->buckets[i];
+        if (n >= rank)
+            return __MIN(INT64_C(2) << i, span->max);
+    }
+    return span->max;
+}
+
+static void FrameComplete(vlc_trace_t *t, struct vlc_trace_frame *f,
+                          bool dropped)
+{
+    struct vlc_trace_es *es = EsFind(t, f->es);
+    mtime_t first = 0, last = 0, prev = 0;
+    int prev_stage = -1;
+
+    if (es == NULL)
+        goto out;
+
+    for (unsigned i = 0; i < VLC_TRACE_STAGES; i++)
+    {
+        mtime_t date = f->stamps[i];
+
+        if (date == 0)
+            continue;
+        if (first == 0)
+            first = date;
+        last = date;
+
+        /* Spans are only accounted between consecutive stages */
+        if (prev_stage >= 0 && prev_stage == (int)i - 1)
+        {
+            SpanAdd(&es->spans[i - 1], date - prev);
+            if (t->stream != NULL)
+                Event(t, "{\"name\":\"%s\",\"cat\":\"video\",\"ph\":\"X\","
+                      "\"ts\":%"PRId64",\"dur\":%"PRId64",\"pid\":%u,"
+                      "\"tid\":%u}", span_names[i - 1], prev, date - prev,
+                      t->pid, es->id);
+        }
+        prev = date;
+        prev_stage = i;
+    }
+
+    if (dropped)
+    {
+        es->dropped++;
+        if (t->stream != NULL)
+            Event(t, "{\"name\":\"drop\",\"cat\":\"video\",\"ph\":\"i\","
+                  "\"s\":\"t\",\"ts\":%"PRId64",\"pid\":%u,\"tid\":%u,"
+                  "\"args\":{\"pts\":%"PRId64"}}", last, t->pid, es->id,
+                  f->ts);
+    }
+    else
+    {
+        es->displayed++;
+        if (f->stamps[VLC_TRACE_QUEUED] != 0)
+            SpanAdd(&es->spans[TRACE_TOTAL],
+                    last - f->stamps[VLC_TRACE_QUEUED]);
+        if (t->stream != NULL)
+            Event(t, "{\"name\":\"frame\",\"cat\":\"video\",\"ph\":\"X\","
+                  "\"ts\":%"PRId64",\"dur\":%"PRId64",\"pid\":%u,"
+                  "\"tid\":%u,\"args\":{\"pts\":%"PRId64"}}", first,
+                  last - first, t->pid, es->id, f->ts);
+    }
+out:
+    FrameRemove(t, f);
+}
+
+static void PurgeOld(vlc_trace_t *t, mtime_t now)
+{
+    while (t->oldest != NULL
+        && (t->count > TRACE_MAX_FRAMES
+         || t->oldest->created + TRACE_MAX_AGE < now))
+        FrameRemove(t, t->oldest);
+}
+
+void vlc_trace_Stamp(vlc_trace_t *t, unsigned es, const void *owner,
+                     mtime_t ts, enum vlc_trace_stage stage)
+{
+    mtime_t now = mdate();
+
+    assert(stage < VLC_TRACE_STAGES);
+
+    vlc_mutex_lock(&t->lock);
+    struct vlc_trace_frame *f = FrameFind(t, owner, ts);
+
+    if (f == NULL)
+    {
+        if (stage > VLC_TRACE_DECODED || es == 0)
+            goto out; /* not traced */
+
+        f = calloc(1, sizeof (*f));
+        if (unlikely(f == NULL))
+            goto out;
+        f->owner = owner;
+        f->ts = ts;
+        f->es = es;
+        f->created = now;
+
+        if (unlikely(tsearch(f, &t->frames, FrameCmp) == NULL))
+        {
+            free(f);
+            goto out;
+        }
+        f->prev = t->newest;
+        if (t->newest != NULL)
+            t->newest->next = f;
+        else
+            t->oldest = f;
+        t->newest = f;
+        t->count++;
+        PurgeOld(t, now);
+    }
+
+    if (f->stamps[stage] == 0)
+        f->stamps[stage] = now;
+    if (stage == VLC_TRACE_DISPLAYED)
+        FrameComplete(t, f, false);
+out:
+    vlc_mutex_unlock(&t->lock);
+}
+
+void vlc_trace_Move(vlc_trace_t *t, const void *owner, mtime_t ts,
+                    const void *new_owner, mtime_t new_ts)
+{
+    vlc_mutex_lock(&t->lock);
+    struct vlc_trace_frame *f = FrameFind(t, owner, ts);
+
+    if (f != NULL)
+    {
+        struct vlc_trace_frame *dup = FrameFind(t, new_owner, new_ts);
+        if (dup != NULL)
+            FrameRemove(t, dup); /* stale entry with the same key */
+
+        tdelete(f, &t->frames, FrameCmp);
+        f->owner = new_owner;
+        f->ts = new_ts;
+        if (unlikely(tsearch(f, &t->frames, FrameCmp) == NULL))
+            FrameRemove(t, f);
+    }
+    vlc_mutex_unlock(&t->lock);
+}
+
+void vlc_trace_Drop(vlc_trace_t *t, const void *owner, mtime_t ts)
+{
+    vlc_mutex_lock(&t->lock);
+    struct vlc_trace_frame *f = FrameFind(t, owner, ts);
+
+    if (f != NULL)
+        FrameComplete(t, f, true);
+    vlc_mutex_unlock(&t->lock);
+}
+
+unsigned vlc_trace_AddEs(vlc_trace_t *t, const es_format_t *fmt)
+{
+    struct vlc_trace_es *es = calloc(1, sizeof (*es));
+    unsigned id;
+
+    if (unlikely(es == NULL))
+        return 0;
+    es->codec = fmt->i_codec;
+
+    vlc_mutex_lock(&t->lock);
+    id = es->id = ++t->last_id;
+    vlc_array_append(&t->es, es);
+    if (t->stream != NULL)
+        Event(t, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,"
+              "\"tid\":%u,\"args\":{\"name\":\"ES %u (%4.4s)\"}}",
+              t->pid, id, id, (const char *)&es->codec);
+    vlc_mutex_unlock(&t->lock);
+    return id;
+}
+
+void vlc_trace_DelEs(vlc_trace_t *t, unsigned id)
+{
+    vlc_mutex_lock(&t->lock);
+    struct vlc_trace_es *es = EsFind(t, id);
+
+    if (es == NULL)
+    {
+        vlc_mutex_unlock(&t->lock);
+        return;
+    }
+
+    /* The frames of the ES still in flight will never complete */
+    for (struct vlc_trace_frame *f = t->oldest, *next; f != NULL; f = next)
+    {
+        next = f->next;
+        if (f->es == id)
+            FrameRemove(t, f);
+    }
+
+    es->deleted = true;
+    msg_Dbg(t->obj, "latency of ES %u (%4.4s): %"PRIu64" frames displayed, "
+            "%"PRIu64" dropped", id, (const char *)&es->codec, es->displayed,
+            es->dropped);
+    for (unsigned i = 0; i < TRACE_SPANS; i++)
+    {
+        const struct vlc_trace_span *span = &es->spans[i];
+
+        if (span->count == 0)
+            continue;
+        msg_Dbg(t->obj, " %-10s: mean %"PRId64" us, median < %"PRId64" us, "
+                "99%% < %"PRId64" us, max %"PRId64" us", span_names[i],
+                span->sum / (mtime_t)span->count, SpanPercentile(span, 50),
+                SpanPercentile(span, 99), span->max);
+    }
+    vlc_mutex_unlock(&t->lock);
+}
+
+static void WriteHistograms(vlc_trace_t *t)
+{
+    fputs("],\n\"displayTimeUnit\":\"ms\",\n\"vlcLatency\":[", t->stream);
+
+    for (size_t i = 0; i < vlc_array_count(&t->es); i++)
+    {
+        const struct vlc_trace_es *es = vlc_array_item_at_index(&t->es, i);
+
+        fprintf(t->stream, "%s\n{\"es\":%u,\"codec\":\"%4.4s\","
+                "\"displayed\":%"PRIu64",\"dropped\":%"PRIu64",\"spans\":{",
+                i ? "," : "", es->id, (const char *)&es->codec,
+                es->displayed, es->dropped);
+
+        for (unsigned j = 0; j < TRACE_SPANS; j++)
+        {
+            const struct vlc_trace_span *span = &es->spans[j];
+
+            fprintf(t->stream, "%s\"%s\":{\"count\":%"PRIu64",\"sum\":%"PRId64
+                    ",\"max\":%"PRId64",\"buckets\":[", j ? "," : "",
+                    span_names[j], span->count, span->sum, span->max);
+            for (unsigned k = 0; k < TRACE_BUCKETS; k++)
+                fprintf(t->stream, "%s%"PRIu64, k ? "," : "",
+                        span->buckets[k]);
+            fputs("]}", t->stream);
+        }
+        fputs("}}", t->stream);
+    }
+    fputs("]}\n", t->stream);
+}
+
+vlc_trace_t *vlc_trace_New(vlc_object_t *obj)
+{
+    bool enabled = var_InheritBool(obj, "latency-trace");
+    char *path = var_InheritString(obj, "latency-trace-file");
+
+    if (!enabled && path == NULL)
+        return NULL;
+
+    vlc_trace_t *t = malloc(sizeof (*t));
+    if (unlikely(t == NULL))
+    {
+        free(path);
+        return NULL;
+    }
+
+    t->obj = obj;
+    t->stream = NULL;
+    t->first_event = true;
+    t->pid = getpid();
+    vlc_mutex_init(&t->lock);
+    t->frames = NULL;
+    t->oldest = t->newest = NULL;
+    t->count = 0;
+    vlc_array_init(&t->es);
+    t->last_id = 0;
+
+    if (path != NULL)
+    {
+        t->stream = vlc_fopen(path, "wt");
+        if (t->stream != NULL)
+        {
+            fputs("{\"traceEvents\":[\n", t->stream);
+            msg_Dbg(obj, "writing latency trace to %s", path);
+        }
+        else
+            msg_Err(obj, "cannot create latency trace %s: %s", path,
+                    vlc_strerror_c(errno));
+        free(path);
+    }
+    return t;
+}
+
+void vlc_trace_Delete(vlc_trace_t *t)
+{
+    while (t->oldest != NULL)
+        FrameRemove(t, t->oldest);
+    assert(t->frames == NULL);
+
+    if (t->stream != NULL)
+    {
+        WriteHistograms(t);
+        fclose(t->stream);
+    }
+
+    for (size_t i = 0; i < vlc_array_count(&t->es); i++)
+    {
+        struct vlc_trace_es *es = vlc_array_item_at_index(&t->es, i);
+
+        assert(es->deleted);
+        free(es);
+    }
+    vlc_array_clear(&t->es);
+    vlc_mutex_destroy(&t->lock);
+    free(t);
+}
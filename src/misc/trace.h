@@ -0,0 +1,104 @@
+/*****************************************************************************
+ * trace.h: playback latency tracing
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_TRACE_H
+# define LIBVLC_TRACE_H 1
+
+/**
+ * \defgroup trace Latency tracing
+ * \ingroup misc
+ * Per-stage latency tracing of video frames
+ *
+ * Frames are identified by their current owner (decoder or video output)
+ * and timestamp, and are stamped at each stage boundary of the playback
+ * pipeline. Once a frame is displayed or dropped, the time it spent in each
+ * stage is accounted in per-ES histograms, and optionally written to a file
+ * as Chrome trace events (chrome://tracing).
+ * @{
+ */
+
+enum vlc_trace_stage
+{
+    VLC_TRACE_QUEUED,     /**< Queued to the decoder */
+    VLC_TRACE_DECODING,   /**< Passed to the decoder module */
+    VLC_TRACE_DECODED,    /**< Output by the decoder module */
+    VLC_TRACE_FILTERING,  /**< Dequeued by the video output */
+    VLC_TRACE_FILTERED,   /**< Output by the video filters */
+    VLC_TRACE_RENDERING,  /**< Rendering started */
+    VLC_TRACE_RENDERED,   /**< Rendering completed */
+    VLC_TRACE_DISPLAYING, /**< Display date reached */
+    VLC_TRACE_DISPLAYED,  /**< Displayed */
+};
+#define VLC_TRACE_STAGES (VLC_TRACE_DISPLAYED + 1)
+
+typedef struct vlc_trace vlc_trace_t;
+
+/**
+ * Creates the tracer of a LibVLC instance.
+ *
+ * \return the tracer, or NULL if tracing is disabled (or on error)
+ */
+vlc_trace_t *vlc_trace_New(vlc_object_t *);
+
+/**
+ * Destroys a tracer and completes the trace file, if any.
+ */
+void vlc_trace_Delete(vlc_trace_t *);
+
+/**
+ * Registers an elementary stream.
+ *
+ * \return the stream identifier, or 0 on error
+ */
+unsigned vlc_trace_AddEs(vlc_trace_t *, const es_format_t *);
+
+/**
+ * Unregisters an elementary stream, and reports its statistics.
+ */
+void vlc_trace_DelEs(vlc_trace_t *, unsigned es);
+
+/**
+ * Stamps a frame at a stage boundary.
+ *
+ * The frame is created if it is not known yet, and the stage is a decoder
+ * stage (i.e. up to VLC_TRACE_DECODED) and es is not 0.
+ * Displayed frames are completed.
+ *
+ * \param es stream identifier from vlc_trace_AddEs() (or 0)
+ * \param owner current frame owner
+ * \param ts current frame timestamp
+ */
+void vlc_trace_Stamp(vlc_trace_t *, unsigned es, const void *owner,
+                     mtime_t ts, enum vlc_trace_stage);
+
+/**
+ * Changes the owner and/or the timestamp of a frame, typically when the
+ * decoder passes it to the video output.
+ */
+void vlc_trace_Move(vlc_trace_t *, const void *owner, mtime_t ts,
+                    const void *new_owner, mtime_t new_ts);
+
+/**
+ * Completes a dropped frame.
+ */
+void vlc_trace_Drop(vlc_trace_t *, const void *owner, mtime_t ts);
+
+/** @} */
+#endif
@@ -28,9 +28,6 @@
 # include "config.h"
 #endif
 
-#ifdef HAVE_SEARCH_H
-# include <search.h>
-#endif
 #include <assert.h>
 #include <float.h>
 #include <math.h>
@@ -67,13 +64,24 @@ typedef struct callback_table_t
     callback_entry_t * p_entries;
 } callback_table_t;
 
+/**
+ * Entry of a variables hash table.
+ */
+struct var_entry
+{
+    struct var_entry *next; /**< Next entry in the same bucket */
+    const char *name;
+    uint32_t hash; /**< Hash of the name, see VarHash() */
+};
+
 /**
  * The structure describing a variable.
  * \note vlc_value_t is the common union for variable values
  */
 struct variable_t
 {
-    char *       psz_name; /**< The variable unique name (must be first) */
+    struct var_entry entry; /**< Object variables table entry */
+    char *       psz_name; /**< The variable unique name */
 
     /** The variable's exported value */
     vlc_value_t  val;
@@ -141,23 +149,107 @@ int_ops    = { CmpInt,     DupDummy,  FreeDummy,  },
 string_ops = { CmpString,  DupString, FreeString, },
 coords_ops = { NULL,       DupDummy,  FreeDummy,  };
 
-static int varcmp( const void *a, const void *b )
+/* FNV-1a */
+static uint32_t VarHash( const char *name )
+{
+    uint32_t hash = UINT32_C(2166136261);
+
+    while( *name )
+    {
+        hash ^= (unsigned char)*(name++);
+        hash *= UINT32_C(16777619);
+    }
+    return hash;
+}
+
+static struct var_entry *VarTableFind( const struct var_table *table,
+                                       const char *name, uint32_t hash )
+{
+    if( table->count == 0 )
+        return NULL;
+
+    for( struct var_entry *e = table->buckets[hash & (table->size - 1)];
+         e != NULL; e = e->next )
+        if( e->hash == hash && !strcmp( e->name, name ) )
+            return e;
+    return NULL;
+}
+
+static int VarTableInsert( struct var_table *table, struct var_entry *entry )
+{
+    if( table->count >= table->size )
+    {   /* Keep the load factor below one */
+        unsigned size = table->size ? (2 * table->size) : 16;
+        struct var_entry **buckets = calloc( size, sizeof (*buckets) );
+
+        if( unlikely(buckets == NULL) )
+            return VLC_ENOMEM;
+
+        for( unsigned i = 0; i < table->size; i++ )
+            for( struct var_entry *e = table->buckets[i], *next; e != NULL;
+                 e = next )
+            {
+                next = e->next;
+                e->next = buckets[e->hash & (size - 1)];
+                buckets[e->hash & (size - 1)] = e;
+            }
+
+        free( table->buckets );
+        table->buckets = buckets;
+        table->size = size;
+    }
+
+    struct var_entry **pp = &table->buckets[entry->hash & (table->size - 1)];
+
+    entry->next = *pp;
+    *pp = entry;
+    table->count++;
+    return VLC_SUCCESS;
+}
+
+static void VarTableRemove( struct var_table *table, struct var_entry *entry )
+{
+    struct var_entry **pp = &table->buckets[entry->hash & (table->size - 1)];
+
+    while( *pp != entry )
+    {
+        assert( *pp != NULL );
+        pp = &(*pp)->next;
+    }
+    *pp = entry->next;
+    table->count--;
+}
+
+static void VarTableClear( struct var_table *table,
+                           void (*release)( struct var_entry * ) )
 {
-    const variable_t *va = a, *vb = b;
+    for( unsigned i = 0; i < table->size; i++ )
+        for( struct var_entry *e = table->buckets[i], *next; e != NULL;
+             e = next )
+        {
+            next = e->next;
+            release( e );
+        }
+
+    free( table->buckets );
+    *table = (struct var_table){ NULL, 0, 0 };
+}
 
-    /* psz_name must be first */
-    assert( va == (const void *)&va->psz_name );
-    return strcmp( va->psz_name, vb->psz_name );
+/* Invalidates the inherited values depending on this object variables */
+static void VarChanged( vlc_object_internals_t *priv )
+{
+    atomic_fetch_add_explicit( &priv->var_gen, 1, memory_order_release );
 }
 
 static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
-    variable_t **pp_var;
+    uint32_t hash = VarHash( psz_name );
+    struct var_entry *entry;
 
     vlc_mutex_lock(&priv->var_lock);
-    pp_var = tfind( &psz_name, &priv->var_root, varcmp );
-    return (pp_var != NULL) ? *pp_var : NULL;
+    entry = VarTableFind( &priv->var_table, psz_name, hash );
+    return (entry != NULL) ? container_of(entry, variable_t, entry) : NULL;
 }
 
 static void Destroy( variable_t *p_var )
@@ -286,9 +378,8 @@ static void TriggerListCallback(vlc_object_t *obj, variable_t *var,
 /**
  * Initialize a vlc variable
  *
- * We hash the given string and insert it into the sorted list. The insertion
- * may require slow memory copies, but think about what we gain in the log(n)
- * lookup phase when setting/getting the variable value!
+ * We hash the given string and insert it into the object hash table, so that
+ * setting/getting the variable value costs a single string comparison.
  *
  * \param p_this The object in which to create the variable
  * \param psz_name The name of the variable
@@ -305,6 +396,13 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
 
     p_var->psz_name = strdup( psz_name );
     p_var->psz_text = NULL;
+    if( unlikely(p_var->psz_name == NULL) )
+    {
+        free( p_var );
+        return VLC_ENOMEM;
+    }
+    p_var->entry.name = p_var->psz_name;
+    p_var->entry.hash = VarHash( psz_name );
 
     p_var->i_type = i_type & ~VLC_VAR_DOINHERIT;
 
@@ -362,18 +460,25 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
         var_Inherit(p_this, psz_name, i_type, &p_var->val);
 
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
-    variable_t **pp_var, *p_oldvar;
+    struct var_entry *p_old;
     int ret = VLC_SUCCESS;
 
     vlc_mutex_lock( &p_priv->var_lock );
 
-    pp_var = tsearch( p_var, &p_priv->var_root, varcmp );
-    if( unlikely(pp_var == NULL) )
-        ret = VLC_ENOMEM;
-    else if( (p_oldvar = *pp_var) == p_var ) /* Variable create */
-        p_var = NULL; /* Variable created */
+    p_old = VarTableFind( &p_priv->var_table, psz_name, p_var->entry.hash );
+    if( p_old == NULL ) /* Variable create */
+    {
+        ret = VarTableInsert( &p_priv->var_table, &p_var->entry );
+        if( likely(ret == VLC_SUCCESS) )
+        {
+            p_var = NULL; /* Variable created */
+            VarChanged( p_priv );
+        }
+    }
     else /* Variable already exists */
     {
+        variable_t *p_oldvar = container_of(p_old, variable_t, entry);
+
         assert (((i_type ^ p_oldvar->i_type) & VLC_VAR_CLASS) == 0);
         p_oldvar->i_usage++;
         p_oldvar->i_type |= i_type & VLC_VAR_ISCOMMAND;
@@ -389,8 +494,7 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
 /**
  * Destroy a vlc variable
  *
- * Look for the variable and destroy it if it is found. As in var_Create we
- * do a call to memmove() but we have performance counterparts elsewhere.
+ * Look for the variable and destroy it if it is found.
  *
  * \param p_this The object that holds the variable
  * \param psz_name The name of the variable
@@ -410,7 +514,8 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
     else if( --p_var->i_usage == 0 )
     {
         assert(!p_var->b_incallback);
-        tdelete( p_var, &p_priv->var_root, varcmp );
+        VarTableRemove( &p_priv->var_table, &p_var->entry );
+        VarChanged( p_priv );
     }
     else
     {
@@ -423,17 +528,19 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
         Destroy( p_var );
 }
 
-static void CleanupVar( void *var )
+static void CleanupVar( struct var_entry *entry )
 {
-    Destroy( var );
+    Destroy( container_of(entry, variable_t, entry) );
 }
 
+static void CleanupCache( struct var_entry *entry );
+
 void var_DestroyAll( vlc_object_t *obj )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
 
-    tdestroy( priv->var_root, CleanupVar );
-    priv->var_root = NULL;
+    VarTableClear( &priv->var_table, CleanupVar );
+    VarTableClear( &priv->var_cache, CleanupCache );
 }
 
 #undef var_Change
@@ -482,6 +589,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
             assert(p_var->ops->pf_free == FreeDummy);
             p_var->step = *p_val;
             CheckValue( p_var, &p_var->val );
+            VarChanged( p_priv );
             break;
         case VLC_VAR_GETSTEP:
             switch (p_var->i_type & VLC_VAR_TYPE)
@@ -569,6 +677,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
             CheckValue( p_var, &newval );
             /* Set the variable */
             p_var->val = newval;
+            VarChanged( p_priv );
             /* Free data if needed */
             p_var->ops->pf_free( &oldval );
             break;
@@ -681,6 +790,7 @@ int var_GetAndSet( vlc_object_t *p_this, const char *psz_name, int i_action,
     /*  Check boundaries */
     CheckValue( p_var, &p_var->val );
     *p_val = p_var->val;
+    VarChanged( p_priv );
 
     /* Deal with callbacks.*/
     TriggerCallback( p_this, p_var, psz_name, oldval );
@@ -753,6 +863,7 @@ int var_SetChecked( vlc_object_t *p_this, const char *psz_name,
 
     /* Set the variable */
     p_var->val = val;
+    VarChanged( p_priv );
 
     /* Deal with callbacks */
     TriggerCallback( p_this, p_var, psz_name, oldval );
@@ -1164,16 +1275,40 @@ int var_LocationParse (vlc_object_t *obj, const char *mrl, const char *pref)
     return ret;
 }
 
+/* Maximum depth of an object for its inherited values to be cached */
+#define VAR_CACHE_DEPTH 16
+
 /**
- * Finds the value of a variable. If the specified object does not hold a
- * variable with the specified name, try the parent object, and iterate until
- * the top of the tree. If no match is found, the value is read from the
- * configuration.
+ * Resolved inherited value.
+ *
+ * The entry is valid as long as the variables of the object and of its
+ * ancestors, and the configuration, are unchanged since the resolution.
  */
-int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
-                 vlc_value_t *p_val )
+struct var_cache_entry
+{
+    struct var_entry entry;
+    int type;
+    int ret;
+    vlc_value_t val;
+    unsigned config_gen;
+    unsigned depth;
+    unsigned gens[VAR_CACHE_DEPTH];
+    char name[];
+};
+
+static void CleanupCache( struct var_entry *entry )
+{
+    struct var_cache_entry *ce = container_of(entry, struct var_cache_entry,
+                                              entry);
+
+    if( ce->type == VLC_VAR_STRING && ce->ret == VLC_SUCCESS )
+        free( ce->val.psz_string );
+    free( ce );
+}
+
+static int InheritUncached( vlc_object_t *p_this, const char *psz_name,
+                            int i_type, vlc_value_t *p_val )
 {
-    i_type &= VLC_VAR_CLASS;
     for( vlc_object_t *obj = p_this; obj != NULL; obj = obj->obj.parent )
     {
         if( var_GetChecked( obj, psz_name, i_type, p_val ) == VLC_SUCCESS )
@@ -1204,6 +1339,107 @@ int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
     return VLC_SUCCESS;
 }
 
+static void CopyInherited( int i_type, int ret, vlc_value_t *p_dst,
+                           const vlc_value_t *p_src )
+{
+    *p_dst = *p_src;
+    if( i_type == VLC_VAR_STRING && ret == VLC_SUCCESS )
+        p_dst->psz_string = strdup( p_src->psz_string ? p_src->psz_string
+                                                      : "" );
+}
+
+/**
+ * Finds the value of a variable. If the specified object does not hold a
+ * variable with the specified name, try the parent object, and iterate until
+ * the top of the tree. If no match is found, the value is read from the
+ * configuration.
+ *
+ * The result is cached in the object until a variable of the object or of
+ * one of its ancestors, or the configuration, changes.
+ */
+int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
+                 vlc_value_t *p_val )
+{
+    vlc_object_internals_t *priv = vlc_internals( p_this );
+    uint32_t hash = VarHash( psz_name );
+    unsigned gens[VAR_CACHE_DEPTH];
+    unsigned depth = 0, config_gen;
+    struct var_entry *entry;
+    int ret;
+
+    i_type &= VLC_VAR_CLASS;
+
+    /* Take the generations before resolving the value, so that concurrent
+     * changes invalidate the new cache entry. */
+    config_gen = atomic_load_explicit( &config_generation,
+                                       memory_order_acquire );
+    for( vlc_object_t *obj = p_this; obj != NULL; obj = obj->obj.parent )
+    {
+        if( depth >= VAR_CACHE_DEPTH )
+            return InheritUncached( p_this, psz_name, i_type, p_val );
+        gens[depth++] = atomic_load_explicit( &vlc_internals( obj )->var_gen,
+                                              memory_order_acquire );
+    }
+
+    vlc_mutex_lock( &priv->var_lock );
+    entry = VarTableFind( &priv->var_cache, psz_name, hash );
+    if( entry != NULL )
+    {
+        struct var_cache_entry *ce =
+            container_of(entry, struct var_cache_entry, entry);
+
+        if( ce->type == i_type && ce->config_gen == config_gen
+         && ce->depth == depth
+         && !memcmp( ce->gens, gens, depth * sizeof (*gens) ) )
+        {
+            ret = ce->ret;
+            CopyInherited( i_type, ret, p_val, &ce->val );
+            vlc_mutex_unlock( &priv->var_lock );
+            return ret;
+        }
+    }
+    vlc_mutex_unlock( &priv->var_lock );
+
+    ret = InheritUncached( p_this, psz_name, i_type, p_val );
+
+    /* Update the cache */
+    struct var_cache_entry *ce;
+
+    vlc_mutex_lock( &priv->var_lock );
+    entry = VarTableFind( &priv->var_cache, psz_name, hash );
+    if( entry != NULL )
+    {
+        ce = container_of(entry, struct var_cache_entry, entry);
+        if( ce->type == VLC_VAR_STRING && ce->ret == VLC_SUCCESS )
+            free( ce->val.psz_string );
+    }
+    else
+    {
+        size_t namelen = strlen( psz_name ) + 1;
+
+        ce = malloc( sizeof (*ce) + namelen );
+        if( unlikely(ce == NULL) )
+            goto out;
+        memcpy( ce->name, psz_name, namelen );
+        ce->entry.name = ce->name;
+        ce->entry.hash = hash;
+        if( VarTableInsert( &priv->var_cache, &ce->entry ) )
+        {
+            free( ce );
+            goto out;
+        }
+    }
+
+    ce->type = i_type;
+    ce->ret = ret;
+    CopyInherited( i_type, ret, &ce->val, p_val );
+    ce->config_gen = config_gen;
+    ce->depth = depth;
+    memcpy( ce->gens, gens, depth * sizeof (*gens) );
+out:
+    vlc_mutex_unlock( &priv->var_lock );
+    return ret;
+}
 
 /**
  * It inherits a string as an unsigned rational number (it also accepts basic
@@ -1309,13 +1545,8 @@ void var_FreeList( vlc_value_t *p_val, vlc_value_t *p_val2 )
     }
 }
 
-static void DumpVariable(const void *data, const VISIT which, const int depth)
+static void DumpVariable(const variable_t *var)
 {
-    if (which != postorder && which != leaf)
-        return;
-    (void) depth;
-
-    const variable_t *var = *(const variable_t **)data;
     const char *typename = "unknown";
 
     switch (var->i_type & VLC_VAR_TYPE)
@@ -1368,29 +1599,41 @@ static void DumpVariable(const void *data, const VISIT which, const int depth)
     putchar('\n');
 }
 
-void DumpVariables(vlc_object_t *obj)
+static int varcmp(const void *a, const void *b)
 {
-    vlc_mutex_lock(&vlc_internals(obj)->var_lock);
-    if (vlc_internals(obj)->var_root == NULL)
-        puts(" `-o No variables");
-    else
-        twalk(vlc_internals(obj)->var_root, DumpVariable);
-    vlc_mutex_unlock(&vlc_internals(obj)->var_lock);
-}
+    const variable_t *va = *(const variable_t **)a;
+    const variable_t *vb = *(const variable_t **)b;
 
-static thread_local void *twalk_ctx;
+    return strcmp(va->psz_name, vb->psz_name);
+}
 
-static void TwalkGetNames(const void *data, const VISIT which, const int depth)
+void DumpVariables(vlc_object_t *obj)
 {
-    if (which != postorder && which != leaf)
-        return;
-    (void) depth;
+    vlc_object_internals_t *priv = vlc_internals(obj);
 
-    const variable_t *var = *(const variable_t **)data;
-    DECL_ARRAY(char *) *names = twalk_ctx;
-    char *dup = strdup(var->psz_name);
-    if (dup != NULL)
-        ARRAY_APPEND(*names, dup);
+    vlc_mutex_lock(&priv->var_lock);
+    if (priv->var_table.count == 0)
+        puts(" `-o No variables");
+    else
+    {   /* Sort by name, for readability */
+        const variable_t **vars = malloc(priv->var_table.count
+                                         * sizeof (*vars));
+        size_t n = 0;
+
+        if (vars != NULL)
+        {
+            for (unsigned i = 0; i < priv->var_table.size; i++)
+                for (struct var_entry *e = priv->var_table.buckets[i];
+                     e != NULL; e = e->next)
+                    vars[n++] = container_of(e, variable_t, entry);
+
+            qsort(vars, n, sizeof (*vars), varcmp);
+            for (size_t i = 0; i < n; i++)
+                DumpVariable(vars[i]);
+            free(vars);
+        }
+    }
+    vlc_mutex_unlock(&priv->var_lock);
 }
 
 char **var_GetAllNames(vlc_object_t *obj)
@@ -1400,9 +1643,15 @@ char **var_GetAllNames(vlc_object_t *obj)
     DECL_ARRAY(char *) names;
     ARRAY_INIT(names);
 
-    twalk_ctx = &names;
     vlc_mutex_lock(&priv->var_lock);
-    twalk(priv->var_root, TwalkGetNames);
+    for (unsigned i = 0; i < priv->var_table.size; i++)
+        for (struct var_entry *e = priv->var_table.buckets[i]; e != NULL;
+             e = e->next)
+        {
+            char *dup = strdup(e->name);
+            if (dup != NULL)
+                ARRAY_APPEND(names, dup);
+        }
     vlc_mutex_unlock(&priv->var_lock);
 
     if (names.i_size == 0)
@@ -28,6 +28,16 @@
 
 struct vlc_res;
 
+/**
+ * Hash table of variables or of cached inherited values, indexed by name.
+ */
+struct var_table
+{
+    struct var_entry **buckets;
+    unsigned size; /**< Number of buckets (0 or a power of two) */
+    unsigned count; /**< Number of entries */
+};
+
 /**
  * Private LibVLC data for each object.
  */
@@ -38,7 +48,9 @@ struct vlc_object_internals
     char           *psz_name; /* given name */
 
     /* Object variables */
-    void           *var_root;
+    struct var_table var_table;
+    struct var_table var_cache; /* resolved inherited values */
+    atomic_uint     var_gen; /* incremented whenever a variable changes */
     vlc_mutex_t     var_lock;
     vlc_cond_t      var_wait;
 
@@ -259,6 +259,9 @@ typedef struct module_bank
     size_t        size;
     vlc_plugin_t **plugins;
     vlc_plugin_t *cache;
+
+    size_t        dirs_count;
+    struct vlc_cache_dir *dirs;
 } module_bank_t;
 
 /**
@@ -324,6 +327,21 @@ static void AllocatePluginDir (module_bank_t *bank, unsigned maxdepth,
         return;
     maxdepth--;
 
+    if (bank->mode & CACHE_WRITE_FILE) /* Add entry to to-be-saved cache */
+    {
+        struct stat st;
+
+        if (vlc_stat (absdir, &st) == 0)
+        {
+            bank->dirs = xrealloc(bank->dirs, (bank->dirs_count + 1)
+                                              * sizeof (*bank->dirs));
+            bank->dirs[bank->dirs_count].path =
+                (reldir != NULL) ? xstrdup(reldir) : NULL;
+            bank->dirs[bank->dirs_count].mtime = st.st_mtime;
+            bank->dirs_count++;
+        }
+    }
+
     DIR *dh = vlc_opendir (absdir);
     if (dh == NULL)
         return;
@@ -391,6 +409,37 @@ static void AllocatePluginDir (module_bank_t *bank, unsigned maxdepth,
     closedir (dh);
 }
 
+/**
+ * Registers all plug-ins from an up-to-date cache without browsing.
+ *
+ * The directories have not changed since the cache was written, so only the
+ * cached plug-in files themselves need to be checked.
+ *
+ * \return true if every cached plug-in file was unmodified
+ */
+static bool AllocatePluginCache (module_bank_t *bank)
+{
+    for (vlc_plugin_t *plugin = bank->cache; plugin != NULL;
+         plugin = plugin->next)
+    {
+        struct stat st;
+
+        if (vlc_stat (plugin->abspath, &st) == -1
+         || plugin->mtime != (int64_t)st.st_mtime
+         || plugin->size != (uint64_t)st.st_size)
+            return false;
+    }
+
+    while (bank->cache != NULL)
+    {
+        vlc_plugin_t *plugin = bank->cache;
+
+        bank->cache = plugin->next;
+        vlc_plugin_store(plugin);
+    }
+    return true;
+}
+
 /**
  * Scans for plug-ins within a file system hierarchy.
  * \param path base directory to browse
@@ -405,12 +454,16 @@ static void AllocatePluginPath(vlc_object_t *obj, const char *path,
         .mode = mode,
     };
 
+    bool uptodate = false;
+
     if (mode & CACHE_READ_FILE)
-        bank.cache = vlc_cache_load(obj, path, &modules.caches);
+        bank.cache = vlc_cache_load(obj, path, &modules.caches, &uptodate);
     else
         msg_Dbg(bank.obj, "ignoring plugins cache file");
 
-    if (mode & CACHE_SCAN_DIR)
+    if ((mode & CACHE_SCAN_DIR) && uptodate && AllocatePluginCache(&bank))
+        msg_Dbg(obj, "plugins cache of `%s' is up to date", bank.base);
+    else if (mode & CACHE_SCAN_DIR)
     {
         msg_Dbg(obj, "recursively browsing `%s'", bank.base);
 
@@ -431,8 +484,12 @@ static void AllocatePluginPath(vlc_object_t *obj, const char *path,
     }
 
     if (mode & CACHE_WRITE_FILE)
-        CacheSave(obj, path, bank.plugins, bank.size);
+        CacheSave(obj, path, bank.plugins, bank.size,
+                  bank.dirs, bank.dirs_count);
 
+    for (size_t i = 0; i < bank.dirs_count; i++)
+        free(bank.dirs[i].path);
+    free(bank.dirs);
     free(bank.plugins);
 }
 
@@ -57,7 +57,7 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 34
+#define CACHE_SUBVERSION_NUM 35
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
@@ -230,7 +230,8 @@ static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
         LOAD_ARRAY(cfg->list.i, cfg->list_count);
     }
 
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
+    if (cfg->list_count)
+        cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
     for (unsigned i = 0; i < cfg->list_count; i++)
     {
         LOAD_STRING (cfg->list_text[i]);
@@ -359,6 +360,53 @@ error:
     return NULL;
 }
 
+/**
+ * Checks the directories scanned when the cache was written.
+ *
+ * If none of them was modified since, no plug-in file was added, removed or
+ * renamed, and the directory tree need not be browsed again. Writing the cache
+ * file modifies the base directory: it is also up to date if it was not
+ * modified after the cache file.
+ */
+static int vlc_cache_load_dirs(const char *dir, int64_t cache_mtime,
+                               block_t *file, bool *uptodate)
+{
+    uint32_t count;
+
+    LOAD_IMMEDIATE(count);
+    *uptodate = count > 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const char *path;
+        int64_t mtime;
+
+        LOAD_STRING(path);
+        LOAD_IMMEDIATE(mtime);
+
+        if (!*uptodate)
+            continue;
+
+        char *abspath;
+        struct stat st;
+
+        if (path == NULL)
+            abspath = strdup(dir);
+        else if (asprintf(&abspath, "%s" DIR_SEP "%s", dir, path) == -1)
+            abspath = NULL;
+
+        if (unlikely(abspath == NULL) || vlc_stat(abspath, &st) != 0)
+            *uptodate = false;
+        else if ((int64_t)st.st_mtime != mtime
+              && (path != NULL || (int64_t)st.st_mtime > cache_mtime))
+            *uptodate = false;
+        free(abspath);
+    }
+    return 0;
+error:
+    return -1;
+}
+
 /**
  * Loads a plugins cache file.
  *
@@ -366,19 +414,32 @@ error:
  * will in turn be queried by AllocateAllPlugins() to see if it needs to
  * actually load the dynamically loadable module.
  * This allows us to only fully load plugins when they are actually used.
+ *
+ * The strings of the cache are used in place from the (memory-mapped) file.
+ * The plugins are returned in the order they were scanned in, so that
+ * vlc_cache_lookup() usually finds the entry it is looking for first.
+ *
+ * \param uptodate [OUT] whether the scanned directories are unmodified
  */
 vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
-                             block_t **backingp)
+                             block_t **backingp, bool *uptodate)
 {
     char *psz_filename;
 
     assert( dir != NULL );
 
+    *uptodate = false;
+
     if( asprintf( &psz_filename, "%s"DIR_SEP CACHE_NAME, dir ) == -1 )
         return 0;
 
     msg_Dbg( p_this, "loading plugins cache file %s", psz_filename );
 
+    struct stat st;
+    int64_t cache_mtime = INT64_MIN;
+    if (vlc_stat(psz_filename, &st) == 0)
+        cache_mtime = st.st_mtime;
+
     block_t *file = block_FilePath(psz_filename, false);
     if (file == NULL)
         msg_Warn(p_this, "cannot read %s: %s", psz_filename,
@@ -438,7 +499,10 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
         return 0;
     }
 
-    vlc_plugin_t *cache = NULL;
+    vlc_plugin_t *cache = NULL, **tailp = &cache;
+
+    if (vlc_cache_load_dirs(dir, cache_mtime, file, uptodate))
+        goto error;
 
     while (file->i_buffer > 0)
     {
@@ -454,8 +518,9 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
             goto error;
         }
 
-        plugin->next = cache;
-        cache = plugin;
+        plugin->next = NULL;
+        *tailp = plugin;
+        tailp = &plugin->next;
     }
 
     file->p_next = *backingp;
@@ -464,6 +529,7 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
 
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
+    *uptodate = false;
 
     /* TODO: cleanup */
     block_Release(file);
@@ -594,7 +660,8 @@ error:
     return -1;
 }
 
-static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
+static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n,
+                         const struct vlc_cache_dir *dirs, size_t dirc)
 {
     uint32_t i_file_size = 0;
 
@@ -617,6 +684,16 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
+    /* Scanned directories */
+    uint32_t dirs_count = dirc;
+
+    SAVE_IMMEDIATE(dirs_count);
+    for (size_t i = 0; i < dirc; i++)
+    {
+        SAVE_STRING(dirs[i].path);
+        SAVE_IMMEDIATE(dirs[i].mtime);
+    }
+
     for (size_t i = 0; i < n; i++)
     {
         const vlc_plugin_t *plugin = cache[i];
@@ -654,7 +731,8 @@ error:
  * Saves a module cache to disk, and release cache data from memory.
  */
 void CacheSave(vlc_object_t *p_this, const char *dir,
-               vlc_plugin_t *const *entries, size_t n)
+               vlc_plugin_t *const *entries, size_t n,
+               const struct vlc_cache_dir *dirs, size_t dirc)
 {
     char *filename = NULL, *tmpname = NULL;
 
@@ -674,7 +752,7 @@ void CacheSave(vlc_object_t *p_this, const char *dir,
         goto out;
     }
 
-    if (CacheSaveBank(file, entries, n))
+    if (CacheSaveBank(file, entries, n, dirs, dirc))
     {
         msg_Warn (p_this, "cannot write %s: %s", tmpname,
                   vlc_strerror_c(errno));
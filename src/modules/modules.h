@@ -127,9 +127,18 @@ void *module_Lookup (module_handle_t, const char *);
 void module_Unload (module_handle_t);
 
 /* Plugins cache */
-vlc_plugin_t *vlc_cache_load(vlc_object_t *, const char *, block_t **);
+/** Scanned directory, relative to the plug-ins base directory */
+struct vlc_cache_dir
+{
+    char *path; /**< NULL for the base directory */
+    int64_t mtime;
+};
+
+vlc_plugin_t *vlc_cache_load(vlc_object_t *, const char *, block_t **,
+                             bool *uptodate);
 vlc_plugin_t *vlc_cache_lookup(vlc_plugin_t **, const char *relpath);
 
-void CacheSave(vlc_object_t *, const char *, vlc_plugin_t *const *, size_t);
+void CacheSave(vlc_object_t *, const char *, vlc_plugin_t *const *, size_t,
+               const struct vlc_cache_dir *, size_t);
 
 #endif /* !LIBVLC_MODULES_H */
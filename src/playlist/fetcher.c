@@ -207,7 +207,8 @@ static int SearchByScope( playlist_fetcher_t* fetcher,
         ! SearchArt( fetcher, item, scope ) )
     {
         AddAlbumCache( fetcher, req->item, false );
-        if( !background_worker_Push( fetcher->downloader, req, NULL, 0 ) )
+        if( !background_worker_Push( fetcher->downloader, req, NULL, 0,
+                background_worker_RequestPriority( req->options ) ) )
             return VLC_SUCCESS;
     }
 
@@ -297,7 +298,8 @@ static void SearchLocal( playlist_fetcher_t* fetcher, struct fetcher_request* re
     if( var_InheritBool( fetcher->owner, "metadata-network-access" ) ||
         req->options & META_REQUEST_OPTION_SCOPE_NETWORK )
     {
-        if( background_worker_Push( fetcher->network, req, NULL, 0 ) )
+        if( background_worker_Push( fetcher->network, req, NULL, 0,
+                background_worker_RequestPriority( req->options ) ) )
             SetPreparsed( req );
     }
     else
@@ -400,10 +402,12 @@ DEF_STARTER(SearchNetwork, fetcher->network )
 DEF_STARTER(   Downloader, fetcher->downloader )
 
 static void WorkerInit( playlist_fetcher_t* fetcher,
-    struct background_worker** worker, int( *starter )( void*, void*, void** ) )
+    struct background_worker** worker, int( *starter )( void*, void*, void** ),
+    unsigned max_threads )
 {
     struct background_worker_config conf = {
         .default_timeout = 0,
+        .max_threads = max_threads,
         .pf_start = starter,
         .pf_probe = ProbeWorker,
         .pf_stop = CloseWorker,
@@ -422,9 +426,13 @@ playlist_fetcher_t* playlist_fetcher_New( vlc_object_t* owner )
 
     fetcher->owner = owner;
 
-    WorkerInit( fetcher, &fetcher->local, StartSearchLocal );
-    WorkerInit( fetcher, &fetcher->network, StartSearchNetwork );
-    WorkerInit( fetcher, &fetcher->downloader, StartDownloader );
+    int threads = var_InheritInteger( owner, "preparse-threads" );
+    unsigned max_threads = threads > 0 ? (unsigned)threads : vlc_GetCPUCount();
+
+    /* Remote meta services are queried one request at a time */
+    WorkerInit( fetcher, &fetcher->local, StartSearchLocal, max_threads );
+    WorkerInit( fetcher, &fetcher->network, StartSearchNetwork, 1 );
+    WorkerInit( fetcher, &fetcher->downloader, StartDownloader, max_threads );
 
     if( unlikely( !fetcher->local || !fetcher->network || !fetcher->downloader ) )
     {
@@ -462,7 +470,8 @@ int playlist_fetcher_Push( playlist_fetcher_t* fetcher, input_item_t* item,
     atomic_init( &req->refs, 1 );
     input_item_Hold( item );
 
-    if( background_worker_Push( fetcher->local, req, NULL, 0 ) )
+    if( background_worker_Push( fetcher->local, req, NULL, 0,
+                background_worker_RequestPriority( req->options ) ) )
         SetPreparsed( req );
 
     RequestRelease( req );
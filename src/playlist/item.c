@@ -746,7 +746,8 @@ static void playlist_Preparse( playlist_t *p_playlist,
 
     if( sys->b_preparse && !input_item_IsPreparsed( input )
      && (EMPTY_STR(psz_artist) || EMPTY_STR(psz_album)) )
-        libvlc_MetadataRequest( p_playlist->obj.libvlc, input, 0, -1, p_item );
+        libvlc_MetadataRequest( p_playlist->obj.libvlc, input,
+                                META_REQUEST_OPTION_PRIORITY_LOW, -1, p_item );
     free( psz_artist );
     free( psz_album );
 }
@@ -121,9 +121,11 @@ static void InputItemHold( void* item ) { input_item_Hold( item ); }
 playlist_preparser_t* playlist_preparser_New( vlc_object_t *parent )
 {
     playlist_preparser_t* preparser = malloc( sizeof *preparser );
+    int threads = var_InheritInteger( parent, "preparse-threads" );
 
     struct background_worker_config conf = {
         .default_timeout = var_InheritInteger( parent, "preparse-timeout" ),
+        .max_threads = threads > 0 ? (unsigned)threads : vlc_GetCPUCount(),
         .pf_start = PreparserOpenInput,
         .pf_probe = PreparserProbeInput,
         .pf_stop = PreparserCloseInput,
@@ -175,7 +177,8 @@ void playlist_preparser_Push( playlist_preparser_t *preparser,
             return;
     }
 
-    if( background_worker_Push( preparser->worker, item, id, timeout ) )
+    if( background_worker_Push( preparser->worker, item, id, timeout,
+                background_worker_RequestPriority( i_options ) ) )
         input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
 }
 
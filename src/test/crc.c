@@ -0,0 +1,120 @@
+/*****************************************************************************
+ * crc.c: test cyclic redundancy checks
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_crc.h>
+#include <vlc_rand.h>
+
+/* Bit by bit reference, on the width bits most significant of crc */
+static uint32_t crc_ref( uint32_t poly, unsigned width, uint32_t crc,
+                         const uint8_t *p, size_t len )
+{
+    const uint32_t top = UINT32_C(1) << (width - 1);
+    const uint32_t mask = top | (top - 1);
+
+    while( len-- > 0 )
+    {
+        crc ^= (uint32_t)*(p++) << (width - 8);
+        for( unsigned i = 0; i < 8; i++ )
+            crc = (crc & top) ? (crc << 1) ^ poly : crc << 1;
+        crc &= mask;
+    }
+    return crc;
+}
+
+static void test_vectors( void )
+{
+    static const char check[] = "123456789";
+
+    assert( vlc_crc8( 0, check, 9 ) == 0xF4 );
+    assert( vlc_crc16( 0, check, 9 ) == 0xFEE8 );
+    assert( vlc_crc32_mpeg( 0xFFFFFFFF, check, 9 ) == 0x0376E6E7 );
+    assert( vlc_crc32_mpeg( 0xFFFFFFFF, NULL, 0 ) == 0xFFFFFFFF );
+}
+
+static void test_random( const uint8_t *buf )
+{
+    /* Covers the byte, slice-by-8 and folding paths, and their tails */
+    for( size_t len = 0; len < 1100; len += (len < 300) ? 1 : 37 )
+        for( size_t off = 0; off < 16; off += 5 )
+        {
+            const uint8_t *p = buf + off;
+            uint32_t init = vlc_mrand48();
+
+            assert( vlc_crc8( init, p, len )
+                 == crc_ref( 0x07, 8, init & 0xff, p, len ) );
+            assert( vlc_crc16( init, p, len )
+                 == crc_ref( 0x8005, 16, init & 0xffff, p, len ) );
+            assert( vlc_crc32_mpeg( init, p, len )
+                 == crc_ref( 0x04C11DB7, 32, init, p, len ) );
+        }
+}
+
+static void test_split( const uint8_t *buf, size_t size )
+{
+    const uint32_t whole = vlc_crc32_mpeg( 0xFFFFFFFF, buf, size );
+
+    for( size_t cut = 0; cut <= size; cut += 61 )
+    {
+        uint32_t crc = vlc_crc32_mpeg( 0xFFFFFFFF, buf, cut );
+        assert( vlc_crc32_mpeg( crc, buf + cut, size - cut ) == whole );
+    }
+}
+
+static void test_speed( void )
+{
+    const size_t size = 1 << 20;
+    uint8_t *buf = malloc( size );
+    uint32_t crc = 0;
+
+    assert( buf != NULL );
+    vlc_rand_bytes( buf, size );
+
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < 16; i++ )
+        crc = vlc_crc32_mpeg( crc, buf, size );
+    mtime_t elapsed = mdate() - start;
+
+    if( elapsed > 0 )
+        printf( "CRC-32: %"PRId64" MB/s (%08"PRIX32")\n",
+                (int64_t)16 * size / elapsed, crc );
+    free( buf );
+}
+
+int main( void )
+{
+    uint8_t buf[1200];
+
+    vlc_rand_bytes( buf, sizeof (buf) );
+    test_vectors();
+    test_random( buf );
+    test_split( buf, sizeof (buf) );
+    test_speed();
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*****************************************************************************
+ * picture_cache.c: test cases for the decoded pictures cache
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../input/picture_cache.c"
+
+#include <stdbool.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_picture.h>
+
+static video_format_t fmt;
+
+static picture_t *NewPicture( mtime_t date )
+{
+    picture_t *pic = picture_NewFromFormat( &fmt );
+
+    assert( pic != NULL );
+    for( int i = 0; i < pic->i_planes; i++ )
+        memset( pic->p[i].p_pixels, date & 0xff,
+                pic->p[i].i_pitch * pic->p[i].i_lines );
+    pic->date = date;
+    return pic;
+}
+
+static void Put( picture_cache_t *cache, mtime_t date )
+{
+    picture_t *pic = NewPicture( date );
+
+    assert( picture_cache_Put( cache, pic ) == VLC_SUCCESS );
+    /* The cache keeps its own copy */
+    memset( pic->p[0].p_pixels, 0, pic->p[0].i_pitch );
+    picture_Release( pic );
+}
+
+static void Check( picture_cache_t *cache, mtime_t date, bool cached )
+{
+    picture_t *pic = picture_cache_Get( cache, date );
+
+    assert( (pic != NULL) == cached );
+    if( pic != NULL )
+    {
+        assert( pic->date == date );
+        assert( pic->p[0].p_pixels[0] == (date & 0xff) );
+        picture_Release( pic );
+    }
+}
+
+int main( void )
+{
+    video_format_Setup( &fmt, VLC_CODEC_I420, 64, 48, 64, 48, 1, 1 );
+
+    picture_t *pic = NewPicture( 1 );
+    size_t frame_size = 0;
+    for( int i = 0; i < pic->i_planes; i++ )
+        frame_size += pic->p[i].i_pitch * pic->p[i].i_lines;
+    picture_Release( pic );
+
+    /* Count limit, least recently used first */
+    picture_cache_t *cache = picture_cache_New( 3, SIZE_MAX );
+    assert( cache != NULL );
+    Put( cache, 10 );
+    Put( cache, 20 );
+    Put( cache, 30 );
+    Check( cache, 10, true );
+    Put( cache, 40 );
+    Check( cache, 20, false );
+    Check( cache, 10, true );
+    Check( cache, 30, true );
+    Check( cache, 40, true );
+
+    /* Same date replaces */
+    Put( cache, 40 );
+    assert( picture_cache_GetCount( cache, NULL ) == 3 );
+
+    /* Nearest lookup, within the distance */
+    pic = picture_cache_GetNearest( cache, 33, 100 );
+    assert( pic != NULL && pic->date == 30 );
+    picture_Release( pic );
+    pic = picture_cache_GetNearest( cache, 37, 100 );
+    assert( pic != NULL && pic->date == 40 );
+    picture_Release( pic );
+    assert( picture_cache_GetNearest( cache, 1000, 100 ) == NULL );
+
+    /* Links between consecutive pictures */
+    assert( picture_cache_GetNext( cache, 30 ) == VLC_TS_INVALID );
+    picture_cache_Link( cache, 30, 40 );
+    assert( picture_cache_GetNext( cache, 30 ) == 40 );
+    assert( picture_cache_GetNext( cache, 20 ) == VLC_TS_INVALID );
+    Put( cache, 30 );
+    assert( picture_cache_GetNext( cache, 30 ) == VLC_TS_INVALID );
+
+    picture_cache_Flush( cache );
+    size_t size;
+    assert( picture_cache_GetCount( cache, &size ) == 0 && size == 0 );
+    Check( cache, 10, false );
+    picture_cache_Delete( cache );
+
+    /* Memory limit */
+    cache = picture_cache_New( 100, 2 * frame_size );
+    assert( cache != NULL );
+    for( mtime_t date = 1; date <= 10; date++ )
+        Put( cache, date );
+    assert( picture_cache_GetCount( cache, &size ) == 2 );
+    assert( size == 2 * frame_size );
+    Check( cache, 9, true );
+    Check( cache, 10, true );
+
+    /* Pictures larger than the whole cache are refused */
+    video_format_Setup( &fmt, VLC_CODEC_I420, 128, 96, 128, 96, 1, 1 );
+    pic = NewPicture( 11 );
+    assert( picture_cache_Put( cache, pic ) == VLC_EGENERIC );
+
+    /* Copies are made apart from the cache, which adopts them */
+    picture_t *copy = picture_cache_Copy( pic );
+    assert( copy != NULL && copy->date == 11 );
+    assert( picture_cache_Add( cache, copy ) == VLC_EGENERIC );
+    pic->date = VLC_TS_INVALID;
+    assert( picture_cache_Copy( pic ) == NULL );
+    picture_Release( pic );
+    Check( cache, 10, true );
+    picture_cache_Delete( cache );
+
+    return 0;
+}
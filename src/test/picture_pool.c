@@ -23,6 +23,8 @@
 #endif
 
 #include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
 #undef NDEBUG
 #include <assert.h>
 
@@ -106,6 +108,68 @@ static void test(bool zombie)
             picture_Release(pics[i]);
 }
 
+static void get_planes(const video_format_t *f, void **planes)
+{
+    picture_t *pics[PICTURES];
+
+    pool = picture_pool_NewFromFormat(f, PICTURES);
+    assert(pool != NULL);
+
+    for (unsigned i = 0; i < PICTURES; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+        planes[i] = pics[i]->p[0].p_pixels;
+        /* Fault the pages in, as a decoder would */
+        for (int j = 0; j < pics[i]->i_planes; j++)
+            memset(pics[i]->p[j].p_pixels, 0x80,
+                   pics[i]->p[j].i_pitch * pics[i]->p[j].i_lines);
+    }
+
+    for (unsigned i = 0; i < PICTURES; i++)
+        picture_Release(pics[i]);
+    picture_pool_Release(pool);
+}
+
+static bool has_plane(void *const *planes, const void *plane)
+{
+    for (unsigned i = 0; i < PICTURES; i++)
+        if (planes[i] == plane)
+            return true;
+    return false;
+}
+
+/* Resolution switches, as in adaptive streaming */
+static void test_arena(void)
+{
+    video_format_t hd, sd;
+    void *hd_planes[PICTURES], *sd_planes[PICTURES], *planes[PICTURES];
+
+    video_format_Setup(&hd, VLC_CODEC_I420, 1280, 720, 1280, 720, 1, 1);
+    video_format_Setup(&sd, VLC_CODEC_I420, 640, 360, 640, 360, 1, 1);
+
+    get_planes(&hd, hd_planes);
+    get_planes(&sd, sd_planes);
+
+    /* The buffers of both resolutions are recycled */
+    get_planes(&hd, planes);
+    for (unsigned i = 0; i < PICTURES; i++)
+        assert(has_plane(hd_planes, planes[i]));
+    get_planes(&sd, planes);
+    for (unsigned i = 0; i < PICTURES; i++)
+        assert(has_plane(sd_planes, planes[i]));
+
+    /* Buffers are aligned for SIMD */
+    for (unsigned i = 0; i < PICTURES; i++)
+        assert(((uintptr_t)planes[i] % 64) == 0);
+
+    mtime_t start = mdate();
+    for (unsigned i = 0; i < 50; i++) {
+        get_planes(&hd, planes);
+        get_planes(&sd, planes);
+    }
+    printf("100 resolution switches in %"PRId64" us\n", mdate() - start);
+}
+
 int main(void)
 {
     video_format_Setup(&fmt, VLC_CODEC_I420, 320, 200, 320, 200, 1, 1);
@@ -122,6 +186,7 @@ int main(void)
 
     test(false);
     test(true);
+    test_arena();
 
     return 0;
 }
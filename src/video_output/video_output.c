@@ -54,12 +54,14 @@
 #include "display.h"
 #include "window.h"
 #include "../misc/variables.h"
+#include "../misc/trace.h"
 
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static void *Thread(void *);
 static void VoutDestructor(vlc_object_t *);
+static void VoutPrepareWake(vout_thread_t *);
 
 /* Maximum delay between 2 displayed pictures.
  * XXX it is needed for now but should be removed in the long term.
@@ -134,6 +136,7 @@ static vout_thread_t *VoutCreate(vlc_object_t *object,
 
     vout->p->original = original;
     vout->p->dpb_size = cfg->dpb_size;
+    vout->p->trace = libvlc_priv(vout->obj.libvlc)->tracer;
 
     vout_control_Init(&vout->p->control);
     vout_control_PushVoid(&vout->p->control, VOUT_CONTROL_INIT);
@@ -145,6 +148,8 @@ static vout_thread_t *VoutCreate(vlc_object_t *object,
     /* Initialize locks */
     vlc_mutex_init(&vout->p->filter.lock);
     vlc_mutex_init(&vout->p->spu_lock);
+    vlc_mutex_init(&vout->p->prepare.lock);
+    vlc_cond_init(&vout->p->prepare.wait);
 
     /* Take care of some "interface/control" related initialisations */
     vout_IntfInit(vout);
@@ -291,6 +296,8 @@ static void VoutDestructor(vlc_object_t *object)
     free(vout->p->splitter_name);
 
     /* Destroy the locks */
+    vlc_cond_destroy(&vout->p->prepare.wait);
+    vlc_mutex_destroy(&vout->p->prepare.lock);
     vlc_mutex_destroy(&vout->p->spu_lock);
     vlc_mutex_destroy(&vout->p->filter.lock);
     vout_control_Clean(&vout->p->control);
@@ -337,10 +344,24 @@ void vout_Flush(vout_thread_t *vout, mtime_t date)
 bool vout_IsEmpty(vout_thread_t *vout)
 {
     picture_t *picture = picture_fifo_Peek(vout->p->decoder_fifo);
-    if (picture)
+    if (picture) {
         picture_Release(picture);
+        return false;
+    }
 
-    return !picture;
+    /* Pictures filtered ahead are not displayed yet either */
+    vlc_mutex_lock(&vout->p->filter.lock);
+    bool empty = vout->p->prepare.count == 0 && !vout->p->prepare.pending;
+    if (empty && vout->p->prepare.replay) {
+        picture = picture_fifo_Peek(vout->p->prepare.replay);
+        if (picture) {
+            picture_Release(picture);
+            empty = false;
+        }
+    }
+    vlc_mutex_unlock(&vout->p->filter.lock);
+
+    return empty;
 }
 
 void vout_NextPicture(vout_thread_t *vout, mtime_t *duration)
@@ -427,6 +448,8 @@ void vout_PutPicture(vout_thread_t *vout, picture_t *picture)
     picture->p_next = NULL;
     picture_fifo_Push(vout->p->decoder_fifo, picture);
 
+    if (vout->p->prepare.depth > 0)
+        VoutPrepareWake(vout);
     vout_control_Wake(&vout->p->control);
 }
 
@@ -715,6 +738,8 @@ static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
         vlc_mutex_unlock(&vout->p->filter.lock);
 }
 
+static void ThreadPrepareReplay(vout_thread_t *);
+
 typedef struct {
     char           *name;
     config_chain_t *cfg;
@@ -835,19 +860,369 @@ static void ThreadChangeFilters(vout_thread_t *vout,
         video_format_Copy(&vout->p->filter.format, source);
     }
 
+    /* Pictures filtered ahead with the previous filters are filtered again */
+    ThreadPrepareReplay(vout);
+
     if (!is_locked)
         vlc_mutex_unlock(&vout->p->filter.lock);
 }
 
 
+static inline void ThreadTrace(vout_thread_t *vout, mtime_t date,
+                               enum vlc_trace_stage stage)
+{
+    if (vout->p->trace != NULL)
+        vlc_trace_Stamp(vout->p->trace, 0, vout, date, stage);
+}
+
+/*****************************************************************************
+ * Pictures filtered ahead of display
+ *****************************************************************************
+ * When enabled (--vout-prepare-ahead), the static filters (deinterlacing,
+ * post-processing) run on a separate thread, up to the given number of
+ * pictures ahead, while the video output thread waits for and displays the
+ * previous pictures. The interactive filters, subpicture blending and the
+ * conversion to the display format remain on the video output thread, since
+ * they depend on the display state.
+ *
+ * The video output thread handles format changes (which rebuild the filters)
+ * and the filters applied again to the last decoded picture. Everything but
+ * the wake-up flag is protected by filter.lock.
+ *****************************************************************************/
+static void VoutPrepareWake(vout_thread_t *vout)
+{
+    vlc_mutex_lock(&vout->p->prepare.lock);
+    vout->p->prepare.signaled = true;
+    vlc_cond_signal(&vout->p->prepare.wait);
+    vlc_mutex_unlock(&vout->p->prepare.lock);
+}
+
+/* Filters one more picture ahead, with filter.lock held */
+static int ThreadPrepareNext(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    vlc_assert_locked(&sys->filter.lock);
+    if (sys->prepare.count >= sys->prepare.depth || sys->prepare.pending)
+        return VLC_EGENERIC;
+
+    picture_t *picture = filter_chain_VideoFilter(sys->filter.chain_static, NULL);
+    while (!picture) {
+        picture_t *decoded = picture_fifo_Pop(sys->prepare.replay);
+        if (!decoded) {
+            decoded = picture_fifo_Pop(sys->decoder_fifo);
+            if (!decoded)
+                return VLC_EGENERIC;
+            ThreadTrace(vout, decoded->date, VLC_TRACE_FILTERING);
+        }
+
+        if (!VideoFormatIsCropArEqual(&decoded->format, &sys->filter.format)) {
+            /* Left to the video output thread */
+            sys->prepare.pending = decoded;
+            vout_control_Wake(&sys->control);
+            return VLC_EGENERIC;
+        }
+
+        if (sys->prepare.source)
+            picture_Release(sys->prepare.source);
+        sys->prepare.source = picture_Hold(decoded);
+
+        picture = filter_chain_VideoFilter(sys->filter.chain_static, decoded);
+    }
+
+    ThreadTrace(vout, picture->date, VLC_TRACE_FILTERED);
+
+    const mtime_t now = mdate();
+    sys->prepare.prepared++;
+    if (picture->date <= now)
+        sys->prepare.late++;
+    else
+        sys->prepare.lead += picture->date - now;
+
+    unsigned index = (sys->prepare.first + sys->prepare.count++) % VOUT_MAX_PREPARED;
+    sys->prepare.ring[index].picture = picture;
+    sys->prepare.ring[index].decoded = sys->prepare.source ?
+                                       picture_Hold(sys->prepare.source) : NULL;
+
+    vout_control_Wake(&sys->control);
+    return VLC_SUCCESS;
+}
+
+static void *PrepareThread(void *object)
+{
+    vout_thread_t *vout = object;
+    vout_thread_sys_t *sys = vout->p;
+
+    for (;;) {
+        vlc_mutex_lock(&sys->prepare.lock);
+        while (!sys->prepare.signaled && !sys->prepare.exit)
+            vlc_cond_wait(&sys->prepare.wait, &sys->prepare.lock);
+        const bool exit = sys->prepare.exit;
+        sys->prepare.signaled = false;
+        vlc_mutex_unlock(&sys->prepare.lock);
+
+        if (exit)
+            break;
+
+        int ret;
+        do {
+            vlc_mutex_lock(&sys->filter.lock);
+            ret = ThreadPrepareNext(vout);
+            vlc_mutex_unlock(&sys->filter.lock);
+        } while (ret == VLC_SUCCESS);
+    }
+    return NULL;
+}
+
+/* Returns the next picture filtered ahead, with filter.lock held */
+static picture_t *ThreadPrepareTake(vout_thread_t *vout, bool is_late_dropped)
+{
+    vout_thread_sys_t *sys = vout->p;
+    picture_t *picture = NULL;
+
+    vlc_assert_locked(&sys->filter.lock);
+    while (!picture && sys->prepare.count > 0) {
+        picture_t *decoded = sys->prepare.ring[sys->prepare.first].decoded;
+
+        picture = sys->prepare.ring[sys->prepare.first].picture;
+        sys->prepare.first = (sys->prepare.first + 1) % VOUT_MAX_PREPARED;
+        sys->prepare.count--;
+
+        if (decoded == sys->displayed.decoded || !decoded) {
+            if (decoded)
+                picture_Release(decoded);
+        } else {
+            if (sys->displayed.decoded)
+                picture_Release(sys->displayed.decoded);
+
+            sys->displayed.decoded       = decoded;
+            sys->displayed.timestamp     = decoded->date;
+            sys->displayed.is_interlaced = !decoded->b_progressive;
+        }
+
+        if (is_late_dropped && !picture->b_force) {
+            const mtime_t late = mdate() - picture->date;
+            if (late > VOUT_DISPLAY_LATE_THRESHOLD) {
+                msg_Warn(vout, "picture is too late to be displayed (missing %"PRId64" ms)", late/1000);
+                if (sys->trace != NULL)
+                    vlc_trace_Drop(sys->trace, vout, picture->date);
+                picture_Release(picture);
+                picture = NULL;
+                vout_statistic_AddLost(&sys->statistic, 1);
+            }
+        }
+    }
+
+    if (sys->prepare.depth > 0)
+        VoutPrepareWake(vout);
+    return picture;
+}
+
+/* Removes the pictures not to be displayed anymore, with filter.lock held */
+static void ThreadPrepareFlush(vout_thread_t *vout, bool below, mtime_t date)
+{
+    vout_thread_sys_t *sys = vout->p;
+    unsigned count = 0;
+
+    vlc_assert_locked(&sys->filter.lock);
+    for (unsigned i = 0; i < sys->prepare.count; i++) {
+        unsigned index = (sys->prepare.first + i) % VOUT_MAX_PREPARED;
+        picture_t *picture = sys->prepare.ring[index].picture;
+
+        if (( below && picture->date <= date) ||
+            (!below && picture->date >= date)) {
+            picture_Release(picture);
+            if (sys->prepare.ring[index].decoded)
+                picture_Release(sys->prepare.ring[index].decoded);
+        } else {
+            sys->prepare.ring[(sys->prepare.first + count++) % VOUT_MAX_PREPARED] =
+                sys->prepare.ring[index];
+        }
+    }
+    sys->prepare.count = count;
+
+    picture_t *pending = sys->prepare.pending;
+    if (pending && (( below && pending->date <= date) ||
+                    (!below && pending->date >= date))) {
+        picture_Release(pending);
+        sys->prepare.pending = NULL;
+    }
+
+    if (sys->prepare.replay)
+        picture_fifo_Flush(sys->prepare.replay, date, below);
+
+    if (sys->prepare.source) {
+        picture_Release(sys->prepare.source);
+        sys->prepare.source = NULL;
+    }
+
+    if (sys->prepare.depth > 0)
+        VoutPrepareWake(vout);
+}
+
+/* Shifts the dates of the pictures filtered ahead, with filter.lock held */
+static void ThreadPrepareOffsetDate(vout_thread_t *vout, mtime_t duration)
+{
+    vout_thread_sys_t *sys = vout->p;
+    picture_t *last = sys->displayed.decoded; /* already shifted */
+
+    vlc_assert_locked(&sys->filter.lock);
+    for (unsigned i = 0; i < sys->prepare.count; i++) {
+        unsigned index = (sys->prepare.first + i) % VOUT_MAX_PREPARED;
+        picture_t *picture = sys->prepare.ring[index].picture;
+        picture_t *decoded = sys->prepare.ring[index].decoded;
+
+        picture->date += duration;
+        /* Successive pictures may be filtered from the same source */
+        if (decoded && decoded != picture && decoded != last)
+            decoded->date += duration;
+        last = decoded;
+    }
+
+    if (sys->prepare.pending)
+        sys->prepare.pending->date += duration;
+    if (sys->prepare.replay)
+        picture_fifo_OffsetDate(sys->prepare.replay, duration);
+}
+
+/* Queues the sources of the pictures filtered ahead to be filtered again,
+ * with filter.lock held */
+static void ThreadPrepareReplay(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    vlc_assert_locked(&sys->filter.lock);
+    if (sys->prepare.count == 0 && !sys->prepare.pending)
+        return;
+
+    /* The sources come before the pictures already queued to be replayed */
+    picture_fifo_t *replay = picture_fifo_New();
+    picture_t *last = sys->displayed.decoded; /* filtered again if needed */
+
+    for (unsigned i = 0; i < sys->prepare.count; i++) {
+        unsigned index = (sys->prepare.first + i) % VOUT_MAX_PREPARED;
+        picture_t *decoded = sys->prepare.ring[index].decoded;
+
+        picture_Release(sys->prepare.ring[index].picture);
+        if (decoded && decoded != last && replay) {
+            picture_fifo_Push(replay, decoded);
+            last = decoded;
+        } else if (decoded)
+            picture_Release(decoded);
+    }
+    sys->prepare.count = 0;
+
+    if (replay) {
+        picture_t *picture;
+
+        while ((picture = picture_fifo_Pop(sys->prepare.replay)) != NULL)
+            picture_fifo_Push(replay, picture);
+        if (sys->prepare.pending)
+            picture_fifo_Push(replay, sys->prepare.pending);
+        picture_fifo_Delete(sys->prepare.replay);
+        sys->prepare.replay = replay;
+    } else if (sys->prepare.pending) {
+        picture_Release(sys->prepare.pending);
+        msg_Warn(vout, "pictures filtered ahead were lost");
+    }
+    sys->prepare.pending = NULL;
+
+    if (sys->prepare.source) {
+        picture_Release(sys->prepare.source);
+        sys->prepare.source = NULL;
+    }
+    VoutPrepareWake(vout);
+}
+
+static void ThreadPrepareStart(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    sys->prepare.first    = 0;
+    sys->prepare.count    = 0;
+    sys->prepare.source   = NULL;
+    sys->prepare.pending  = NULL;
+    sys->prepare.prepared = 0;
+    sys->prepare.late     = 0;
+    sys->prepare.lead     = 0;
+    sys->prepare.signaled = false;
+    sys->prepare.exit     = false;
+    sys->prepare.running  = false;
+
+    sys->prepare.replay = picture_fifo_New();
+    if (sys->prepare.depth == 0 || sys->prepare.replay == NULL)
+        return;
+
+    if (vlc_clone(&sys->prepare.thread, PrepareThread, vout,
+                  VLC_THREAD_PRIORITY_OUTPUT)) {
+        msg_Err(vout, "cannot filter pictures ahead");
+        sys->prepare.depth = 0;
+        return;
+    }
+    sys->prepare.running = true;
+}
+
+static void ThreadPrepareStop(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    if (sys->prepare.running) {
+        vlc_mutex_lock(&sys->prepare.lock);
+        sys->prepare.exit = true;
+        vlc_cond_signal(&sys->prepare.wait);
+        vlc_mutex_unlock(&sys->prepare.lock);
+
+        vlc_join(sys->prepare.thread, NULL);
+        sys->prepare.running = false;
+
+        if (sys->prepare.prepared > 0)
+            msg_Dbg(vout, "%u pictures filtered ahead, %u late, "
+                    "%"PRId64" ms ahead on average", sys->prepare.prepared,
+                    sys->prepare.late, sys->prepare.prepared > sys->prepare.late ?
+                    sys->prepare.lead / (sys->prepare.prepared - sys->prepare.late) / 1000 : 0);
+    }
+
+    vlc_mutex_lock(&sys->filter.lock);
+    ThreadPrepareFlush(vout, true, INT64_MAX);
+    if (sys->prepare.replay) {
+        picture_fifo_Delete(sys->prepare.replay);
+        sys->prepare.replay = NULL;
+    }
+    vlc_mutex_unlock(&sys->filter.lock);
+}
+
+static int ThreadDisplayQueuePicture(vout_thread_t *vout, picture_t *picture)
+{
+    if (!picture)
+        return VLC_EGENERIC;
+
+    assert(!vout->p->displayed.next);
+    if (!vout->p->displayed.current)
+        vout->p->displayed.current = picture;
+    else
+        vout->p->displayed.next    = picture;
+    return VLC_SUCCESS;
+}
+
 /* */
 static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool frame_by_frame)
 {
     bool is_late_dropped = vout->p->is_late_dropped && !vout->p->pause.is_on && !frame_by_frame;
 
+    const bool prepared = vout->p->prepare.running;
+
     vlc_mutex_lock(&vout->p->filter.lock);
 
-    picture_t *picture = filter_chain_VideoFilter(vout->p->filter.chain_static, NULL);
+    picture_t *picture;
+    if (prepared && !(reuse && vout->p->displayed.decoded)) {
+        picture = ThreadPrepareTake(vout, is_late_dropped);
+        if (picture || !vout->p->prepare.pending) {
+            vlc_mutex_unlock(&vout->p->filter.lock);
+            return ThreadDisplayQueuePicture(vout, picture);
+        }
+        reuse = false;
+    } else
+        picture = filter_chain_VideoFilter(vout->p->filter.chain_static, NULL);
     assert(!reuse || !picture);
 
     while (!picture) {
@@ -855,13 +1230,21 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         if (reuse && vout->p->displayed.decoded) {
             decoded = picture_Hold(vout->p->displayed.decoded);
         } else {
-            decoded = picture_fifo_Pop(vout->p->decoder_fifo);
+            if (prepared) {
+                /* Format change left by the preparation thread */
+                decoded = vout->p->prepare.pending;
+                vout->p->prepare.pending = NULL;
+            } else
+                decoded = picture_fifo_Pop(vout->p->decoder_fifo);
             if (decoded) {
+                ThreadTrace(vout, decoded->date, VLC_TRACE_FILTERING);
                 if (is_late_dropped && !decoded->b_force) {
                     const mtime_t predicted = mdate() + 0; /* TODO improve */
                     const mtime_t late = predicted - decoded->date;
                     if (late > VOUT_DISPLAY_LATE_THRESHOLD) {
                         msg_Warn(vout, "picture is too late to be displayed (missing %"PRId64" ms)", late/1000);
+                        if (vout->p->trace != NULL)
+                            vlc_trace_Drop(vout->p->trace, vout, decoded->date);
                         picture_Release(decoded);
                         vout_statistic_AddLost(&vout->p->statistic, 1);
                         continue;
@@ -885,20 +1268,22 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         vout->p->displayed.timestamp     = decoded->date;
         vout->p->displayed.is_interlaced = !decoded->b_progressive;
 
+        if (prepared) {
+            if (vout->p->prepare.source)
+                picture_Release(vout->p->prepare.source);
+            vout->p->prepare.source = picture_Hold(decoded);
+        }
+
         picture = filter_chain_VideoFilter(vout->p->filter.chain_static, decoded);
     }
 
+    if (prepared)
+        VoutPrepareWake(vout);
     vlc_mutex_unlock(&vout->p->filter.lock);
 
-    if (!picture)
-        return VLC_EGENERIC;
-
-    assert(!vout->p->displayed.next);
-    if (!vout->p->displayed.current)
-        vout->p->displayed.current = picture;
-    else
-        vout->p->displayed.next    = picture;
-    return VLC_SUCCESS;
+    if (picture)
+        ThreadTrace(vout, picture->date, VLC_TRACE_FILTERED);
+    return ThreadDisplayQueuePicture(vout, picture);
 }
 
 static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
@@ -907,6 +1292,9 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     vout_display_t *vd = vout->p->display.vd;
 
     picture_t *torender = picture_Hold(vout->p->displayed.current);
+    const mtime_t date = torender->date;
+
+    ThreadTrace(vout, date, VLC_TRACE_RENDERING);
 
     vout_chrono_Start(&vout->p->render);
 
@@ -1091,12 +1479,15 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     if (delay < 1000)
         msg_Warn(vout, "picture is late (%lld ms)", delay / 1000);
 #endif
+    ThreadTrace(vout, date, VLC_TRACE_RENDERED);
     if (!is_forced)
         mwait(todisplay->date);
+    ThreadTrace(vout, date, VLC_TRACE_DISPLAYING);
 
     /* Display the direct buffer returned by vout_RenderPicture */
     vout->p->displayed.date = mdate();
     vout_display_Display(vd, todisplay, subpic);
+    ThreadTrace(vout, date, VLC_TRACE_DISPLAYED);
 
     vout_statistic_AddDisplayed(&vout->p->statistic, 1);
 
@@ -1218,9 +1609,12 @@ static void ThreadChangePause(vout_thread_t *vout, bool is_paused, mtime_t date)
             vout->p->step.timestamp += duration;
         if (vout->p->step.last > VLC_TS_INVALID)
             vout->p->step.last += duration;
-        picture_fifo_OffsetDate(vout->p->decoder_fifo, duration);
         if (vout->p->displayed.decoded)
             vout->p->displayed.decoded->date += duration;
+        vlc_mutex_lock(&vout->p->filter.lock);
+        picture_fifo_OffsetDate(vout->p->decoder_fifo, duration);
+        ThreadPrepareOffsetDate(vout, duration);
+        vlc_mutex_unlock(&vout->p->filter.lock);
         spu_OffsetSubtitleDate(vout->p->spu, duration);
 
         ThreadFilterFlush(vout, false);
@@ -1251,7 +1645,10 @@ static void ThreadFlush(vout_thread_t *vout, bool below, mtime_t date)
         }
     }
 
+    vlc_mutex_lock(&vout->p->filter.lock);
     picture_fifo_Flush(vout->p->decoder_fifo, date, below);
+    ThreadPrepareFlush(vout, below, date);
+    vlc_mutex_unlock(&vout->p->filter.lock);
 }
 
 static void ThreadStep(vout_thread_t *vout, mtime_t *duration)
@@ -1458,6 +1855,8 @@ static int ThreadStart(vout_thread_t *vout, vout_display_state_t *state)
     vout->p->spu_blend_chroma        = 0;
     vout->p->spu_blend               = NULL;
 
+    ThreadPrepareStart(vout);
+
     video_format_Print(VLC_OBJECT(vout), "original format", &vout->p->original);
     return VLC_SUCCESS;
 error:
@@ -1476,6 +1875,8 @@ error:
 
 static void ThreadStop(vout_thread_t *vout, vout_display_state_t *state)
 {
+    ThreadPrepareStop(vout);
+
     if (vout->p->spu_blend)
         filter_DeleteBlend(vout->p->spu_blend);
 
@@ -1502,8 +1903,13 @@ static void ThreadStop(vout_thread_t *vout, vout_display_state_t *state)
 
 static void ThreadInit(vout_thread_t *vout)
 {
+    /* The range is not enforced on per-input options */
+    int64_t depth = var_InheritInteger(vout, "vout-prepare-ahead");
+
     vout->p->dead            = false;
     vout->p->is_late_dropped = var_InheritBool(vout, "drop-late-frames");
+    vout->p->prepare.depth   = VLC_CLIP(depth, 0, VOUT_MAX_PREPARED);
+    vout->p->prepare.replay  = NULL;
     vout->p->pause.is_on     = false;
     vout->p->pause.date      = VLC_TS_INVALID;
 
@@ -43,6 +43,11 @@
  */
 #define VOUT_MAX_PICTURES (20)
 
+/**
+ * Maximum number of pictures filtered ahead of their display.
+ */
+#define VOUT_MAX_PREPARED (8)
+
 /* */
 struct vout_thread_sys_t
 {
@@ -116,6 +121,7 @@ struct vout_thread_sys_t
 
     /* */
     bool            is_late_dropped;
+    struct vlc_trace *trace; /* latency tracer (or NULL) */
 
     /* Video filter2 chain */
     struct {
@@ -127,6 +133,32 @@ struct vout_thread_sys_t
         bool            has_deint;
     } filter;
 
+    /* Pictures filtered ahead of display by a separate thread.
+     * The pictures and statistics are protected by filter.lock */
+    struct {
+        unsigned        depth;          /**< 0 if disabled */
+        vlc_mutex_t     lock;
+        vlc_cond_t      wait;
+        bool            signaled;
+        bool            exit;
+        bool            running;
+        vlc_thread_t    thread;
+
+        struct {
+            picture_t   *picture;       /**< filtered picture */
+            picture_t   *decoded;       /**< its source picture (or NULL) */
+        } ring[VOUT_MAX_PREPARED];
+        unsigned        first;
+        unsigned        count;
+        picture_t       *source;        /**< last picture filtered */
+        picture_t       *pending;       /**< waiting for a filters change */
+        picture_fifo_t  *replay;        /**< to be filtered again */
+
+        unsigned        prepared;
+        unsigned        late;           /**< prepared after their date */
+        mtime_t         lead;           /**< total time prepared ahead */
+    } prepare;
+
     /* */
     vlc_mouse_t     mouse;
 
@@ -61,11 +61,50 @@ typedef struct {
     spu_heap_entry_t entry[VOUT_MAX_SUBPICTURES];
 } spu_heap_t;
 
+/* Subtitles are rendered ahead of their display date if they are queued at
+ * least this long before it */
+#define SPU_AHEAD_MIN_DELAY (CLOCK_FREQ / 50)
+
+/* Maximum number of chromas that can be rendered to */
+#define SPU_MAX_CHROMAS 8
+
+typedef struct {
+    subpicture_t *subpicture;
+    bool          busy;      /**< being rendered */
+    bool          reject;    /**< to be deleted once rendered */
+} spu_ahead_entry_t;
+
+/* Filters are not reentrant: each worker thread has its own renderers */
+typedef struct {
+    spu_t        *spu;
+    vlc_thread_t thread;
+    filter_t     *text;
+    filter_t     *scale;
+    filter_t     *scale_yuvp;
+} spu_ahead_worker_t;
+
+typedef struct {
+    vlc_cond_t   wait;       /**< new subpicture queued, or exit */
+    vlc_cond_t   done;       /**< a subpicture was rendered */
+    bool         exit;
+    unsigned     thread_count;
+    spu_ahead_worker_t *workers;
+
+    /* Output configuration of the last rendering */
+    bool          has_config;
+    video_format_t fmt_src;
+    video_format_t fmt_dst;
+    vlc_fourcc_t  chroma_list[SPU_MAX_CHROMAS + 1];
+
+    spu_ahead_entry_t entry[VOUT_MAX_SUBPICTURES];
+} spu_ahead_t;
+
 struct spu_private_t {
     vlc_mutex_t  lock;            /* lock to protect all followings fields */
     vlc_object_t *input;
 
     spu_heap_t   heap;
+    spu_ahead_t  ahead;      /**< subtitles to render ahead of time */
 
     int channel;             /**< number of subpicture channels registered */
     filter_t *text;                              /**< text renderer module */
@@ -244,13 +283,11 @@ static filter_t *SpuRenderCreateAndLoadScale(vlc_object_t *object,
     return scale;
 }
 
-static void SpuRenderText(spu_t *spu, bool *rerender_text,
+static void SpuRenderText(filter_t *text, bool *rerender_text,
                           subpicture_region_t *region,
                           const vlc_fourcc_t *chroma_list,
                           mtime_t elapsed_time)
 {
-    filter_t *text = spu->p->text;
-
     assert(region->fmt.i_chroma == VLC_CODEC_TEXT);
 
     if (!text || !text->p_module)
@@ -651,6 +688,122 @@ static void SpuSelectSubpictures(spu_t *spu,
 
 
 
+/**
+ * Converts and scales a rendered region to the destination size, into the
+ * region cache (region->p_private), unless it is already there.
+ *
+ * \return true if the region cache is to be used
+ */
+static bool SpuScaleRegion(spu_t *spu, filter_t *scale, filter_t *scale_yuvp,
+                           subpicture_region_t *region,
+                           const spu_scale_t scale_size,
+                           const vlc_fourcc_t *chroma_list,
+                           bool changed_palette)
+{
+    const bool using_palette = region->fmt.i_chroma == VLC_CODEC_YUVP;
+    bool convert_chroma = true;
+    for (int i = 0; chroma_list[i] && convert_chroma; i++) {
+        if (region->fmt.i_chroma == chroma_list[i])
+            convert_chroma = false;
+    }
+
+    if (!scale || !scale->p_module ||
+        (using_palette && (!scale_yuvp || !scale_yuvp->p_module)) ||
+        (scale_size.w == SCALE_UNIT && scale_size.h == SCALE_UNIT &&
+         !using_palette && !convert_chroma))
+        return false;
+
+    const unsigned dst_width  = spu_scale_w(region->fmt.i_visible_width,  scale_size);
+    const unsigned dst_height = spu_scale_h(region->fmt.i_visible_height, scale_size);
+
+    /* Destroy the cache if unusable */
+    if (region->p_private) {
+        subpicture_region_private_t *private = region->p_private;
+        bool is_changed = false;
+
+        /* Check resize changes */
+        if (dst_width  != private->fmt.i_visible_width ||
+            dst_height != private->fmt.i_visible_height)
+            is_changed = true;
+
+        /* Check forced palette changes */
+        if (changed_palette)
+            is_changed = true;
+
+        if (convert_chroma && private->fmt.i_chroma != chroma_list[0])
+            is_changed = true;
+
+        if (is_changed) {
+            subpicture_region_private_Delete(private);
+            region->p_private = NULL;
+        }
+    }
+
+    /* Scale if needed into cache */
+    if (!region->p_private && dst_width > 0 && dst_height > 0) {
+        picture_t *picture = region->p_picture;
+        picture_Hold(picture);
+
+        /* Convert YUVP to YUVA/RGBA first for better scaling quality */
+        if (using_palette) {
+            scale_yuvp->fmt_in.video = region->fmt;
+
+            scale_yuvp->fmt_out.video = region->fmt;
+            scale_yuvp->fmt_out.video.i_chroma = chroma_list[0];
+
+            picture = scale_yuvp->pf_video_filter(scale_yuvp, picture);
+            if (!picture) {
+                /* Well we will try conversion+scaling */
+                msg_Warn(spu, "%4.4s to %4.4s conversion failed",
+                         (const char*)&scale_yuvp->fmt_in.video.i_chroma,
+                         (const char*)&scale_yuvp->fmt_out.video.i_chroma);
+            }
+        }
+
+        /* Conversion(except from YUVP)/Scaling */
+        if (picture &&
+            (picture->format.i_visible_width  != dst_width ||
+             picture->format.i_visible_height != dst_height ||
+             (convert_chroma && !using_palette)))
+        {
+            scale->fmt_in.video  = picture->format;
+            scale->fmt_out.video = picture->format;
+            if (using_palette)
+                scale->fmt_in.video.i_chroma = chroma_list[0];
+            if (convert_chroma)
+                scale->fmt_out.i_codec        =
+                scale->fmt_out.video.i_chroma = chroma_list[0];
+
+            scale->fmt_out.video.i_width  = dst_width;
+            scale->fmt_out.video.i_height = dst_height;
+
+            scale->fmt_out.video.i_visible_width =
+                spu_scale_w(region->fmt.i_visible_width, scale_size);
+            scale->fmt_out.video.i_visible_height =
+                spu_scale_h(region->fmt.i_visible_height, scale_size);
+
+            picture = scale->pf_video_filter(scale, picture);
+            if (!picture)
+                msg_Err(spu, "scaling failed");
+        }
+
+        /* */
+        if (picture) {
+            region->p_private = subpicture_region_private_New(&picture->format);
+            if (region->p_private) {
+                region->p_private->p_picture = picture;
+                if (!region->p_private->p_picture) {
+                    subpicture_region_private_Delete(region->p_private);
+                    region->p_private = NULL;
+                }
+            } else {
+                picture_Release(picture);
+            }
+        }
+    }
+    return region->p_private != NULL;
+}
+
 /**
  * It will transform the provided region into another region suitable for rendering.
  */
@@ -679,7 +832,7 @@ static void SpuRenderRegion(spu_t *spu,
 
     /* Render text region */
     if (region->fmt.i_chroma == VLC_CODEC_TEXT) {
-        SpuRenderText(spu, &restore_text, region,
+        SpuRenderText(sys->text, &restore_text, region,
                       chroma_list,
                       render_date - subpic->i_start);
 
@@ -765,115 +918,11 @@ static void SpuRenderRegion(spu_t *spu,
     region_fmt = region->fmt;
     region_picture = region->p_picture;
 
-    bool convert_chroma = true;
-    for (int i = 0; chroma_list[i] && convert_chroma; i++) {
-        if (region_fmt.i_chroma == chroma_list[i])
-            convert_chroma = false;
-    }
-
     /* Scale from rendered size to destination size */
-    if (sys->scale && sys->scale->p_module &&
-        (!using_palette || (sys->scale_yuvp && sys->scale_yuvp->p_module)) &&
-        (scale_size.w != SCALE_UNIT || scale_size.h != SCALE_UNIT ||
-        using_palette || convert_chroma)) {
-        const unsigned dst_width  = spu_scale_w(region->fmt.i_visible_width,  scale_size);
-        const unsigned dst_height = spu_scale_h(region->fmt.i_visible_height, scale_size);
-
-        /* Destroy the cache if unusable */
-        if (region->p_private) {
-            subpicture_region_private_t *private = region->p_private;
-            bool is_changed = false;
-
-            /* Check resize changes */
-            if (dst_width  != private->fmt.i_visible_width ||
-                dst_height != private->fmt.i_visible_height)
-                is_changed = true;
-
-            /* Check forced palette changes */
-            if (changed_palette)
-                is_changed = true;
-
-            if (convert_chroma && private->fmt.i_chroma != chroma_list[0])
-                is_changed = true;
-
-            if (is_changed) {
-                subpicture_region_private_Delete(private);
-                region->p_private = NULL;
-            }
-        }
-
-        /* Scale if needed into cache */
-        if (!region->p_private && dst_width > 0 && dst_height > 0) {
-            filter_t *scale = sys->scale;
-
-            picture_t *picture = region->p_picture;
-            picture_Hold(picture);
-
-            /* Convert YUVP to YUVA/RGBA first for better scaling quality */
-            if (using_palette) {
-                filter_t *scale_yuvp = sys->scale_yuvp;
-
-                scale_yuvp->fmt_in.video = region->fmt;
-
-                scale_yuvp->fmt_out.video = region->fmt;
-                scale_yuvp->fmt_out.video.i_chroma = chroma_list[0];
-
-                picture = scale_yuvp->pf_video_filter(scale_yuvp, picture);
-                if (!picture) {
-                    /* Well we will try conversion+scaling */
-                    msg_Warn(spu, "%4.4s to %4.4s conversion failed",
-                             (const char*)&scale_yuvp->fmt_in.video.i_chroma,
-                             (const char*)&scale_yuvp->fmt_out.video.i_chroma);
-                }
-            }
-
-            /* Conversion(except from YUVP)/Scaling */
-            if (picture &&
-                (picture->format.i_visible_width  != dst_width ||
-                 picture->format.i_visible_height != dst_height ||
-                 (convert_chroma && !using_palette)))
-            {
-                scale->fmt_in.video  = picture->format;
-                scale->fmt_out.video = picture->format;
-                if (using_palette)
-                    scale->fmt_in.video.i_chroma = chroma_list[0];
-                if (convert_chroma)
-                    scale->fmt_out.i_codec        =
-                    scale->fmt_out.video.i_chroma = chroma_list[0];
-
-                scale->fmt_out.video.i_width  = dst_width;
-                scale->fmt_out.video.i_height = dst_height;
-
-                scale->fmt_out.video.i_visible_width =
-                    spu_scale_w(region->fmt.i_visible_width, scale_size);
-                scale->fmt_out.video.i_visible_height =
-                    spu_scale_h(region->fmt.i_visible_height, scale_size);
-
-                picture = scale->pf_video_filter(scale, picture);
-                if (!picture)
-                    msg_Err(spu, "scaling failed");
-            }
-
-            /* */
-            if (picture) {
-                region->p_private = subpicture_region_private_New(&picture->format);
-                if (region->p_private) {
-                    region->p_private->p_picture = picture;
-                    if (!region->p_private->p_picture) {
-                        subpicture_region_private_Delete(region->p_private);
-                        region->p_private = NULL;
-                    }
-                } else {
-                    picture_Release(picture);
-                }
-            }
-        }
-
-        /* And use the scaled picture */
-        if (region->p_private) {
-            region_fmt     = region->p_private->fmt;
-            region_picture = region->p_private->p_picture;
-        }
+    if (SpuScaleRegion(spu, sys->scale, sys->scale_yuvp, region, scale_size,
+                       chroma_list, changed_palette)) {
+        region_fmt     = region->p_private->fmt;
+        region_picture = region->p_private->p_picture;
     }
 
     /* Force cropping if requested */
@@ -969,6 +1018,33 @@ exit:
     }
 }
 
+/**
+ * Computes the scaling of a region from the original picture size to the
+ * destination size.
+ */
+static spu_scale_t SpuRegionScale(const subpicture_t *subpic,
+                                  const subpicture_region_t *region,
+                                  const video_format_t *fmt_dst)
+{
+    /* Compute region scale AR */
+    video_format_t region_fmt = region->fmt;
+    if (region_fmt.i_sar_num <= 0 || region_fmt.i_sar_den <= 0) {
+        region_fmt.i_sar_num = (int64_t)fmt_dst->i_visible_width  * fmt_dst->i_sar_num * subpic->i_original_picture_height;
+        region_fmt.i_sar_den = (int64_t)fmt_dst->i_visible_height * fmt_dst->i_sar_den * subpic->i_original_picture_width;
+        vlc_ureduce(&region_fmt.i_sar_num, &region_fmt.i_sar_den,
+                    region_fmt.i_sar_num, region_fmt.i_sar_den, 65536);
+    }
+
+    /* Compute scaling from original size to destination size
+     * FIXME The current scaling ensure that the heights match, the width being
+     * cropped.
+     */
+    return spu_scale_createq((uint64_t)fmt_dst->i_visible_height * fmt_dst->i_sar_den * region_fmt.i_sar_num,
+                             (uint64_t)subpic->i_original_picture_height * fmt_dst->i_sar_num * region_fmt.i_sar_den,
+                             fmt_dst->i_visible_height,
+                             subpic->i_original_picture_height);
+}
+
 /**
  * This function renders all sub picture units in the list.
  */
@@ -1056,24 +1132,7 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
          */
         for (region = subpic->p_region; region != NULL; region = region->p_next) {
             spu_area_t area;
-
-            /* Compute region scale AR */
-            video_format_t region_fmt = region->fmt;
-            if (region_fmt.i_sar_num <= 0 || region_fmt.i_sar_den <= 0) {
-                region_fmt.i_sar_num = (int64_t)fmt_dst->i_visible_width  * fmt_dst->i_sar_num * subpic->i_original_picture_height;
-                region_fmt.i_sar_den = (int64_t)fmt_dst->i_visible_height * fmt_dst->i_sar_den * subpic->i_original_picture_width;
-                vlc_ureduce(&region_fmt.i_sar_num, &region_fmt.i_sar_den,
-                            region_fmt.i_sar_num, region_fmt.i_sar_den, 65536);
-            }
-
-            /* Compute scaling from original size to destination size
-             * FIXME The current scaling ensure that the heights match, the width being
-             * cropped.
-             */
-            spu_scale_t scale = spu_scale_createq((uint64_t)fmt_dst->i_visible_height * fmt_dst->i_sar_den * region_fmt.i_sar_num,
-                                                  (uint64_t)subpic->i_original_picture_height * fmt_dst->i_sar_num * region_fmt.i_sar_den,
-                                                  fmt_dst->i_visible_height,
-                                                  subpic->i_original_picture_height);
+            spu_scale_t scale = SpuRegionScale(subpic, region, fmt_dst);
 
             /* Check scale validity */
             if (scale.w <= 0 || scale.h <= 0)
@@ -1109,6 +1168,352 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
     return output;
 }
 
+/*****************************************************************************
+ * Rendering ahead of the display date
+ *****************************************************************************/
+
+/**
+ * Renders the text and scales the regions of a subtitle for the output
+ * configuration of the last rendering, so that only placement and blending
+ * remain to be done on the video output thread.
+ */
+static void SpuPrerender(spu_t *spu, filter_t *text,
+                         filter_t *scale, filter_t *scale_yuvp,
+                         subpicture_t *subpic, mtime_t date,
+                         const video_format_t *fmt_src,
+                         const video_format_t *fmt_dst,
+                         const vlc_fourcc_t *chroma_list,
+                         bool force_palette)
+{
+    subpicture_Update(subpic, fmt_src, fmt_dst, date);
+
+    /* Left to the video output thread */
+    if (subpic->i_original_picture_width  <= 0 ||
+        subpic->i_original_picture_height <= 0)
+        return;
+
+    if (text) {
+        text->fmt_out.video.i_width          =
+        text->fmt_out.video.i_visible_width  = subpic->i_original_picture_width;
+
+        text->fmt_out.video.i_height         =
+        text->fmt_out.video.i_visible_height = subpic->i_original_picture_height;
+    }
+
+    for (subpicture_region_t *region = subpic->p_region;
+         region != NULL; region = region->p_next) {
+        spu_scale_t scale_size = SpuRegionScale(subpic, region, fmt_dst);
+
+        if (scale_size.w <= 0 || scale_size.h <= 0)
+            continue;
+
+        if (region->fmt.i_chroma == VLC_CODEC_TEXT) {
+            video_format_t fmt_original = region->fmt;
+            bool rerender = false;
+
+            SpuRenderText(text, &rerender, region, chroma_list, 0);
+            if (rerender) {
+                /* Time-dependent text is rendered when displayed */
+                if (region->p_picture) {
+                    picture_Release(region->p_picture);
+                    region->p_picture = NULL;
+                }
+                region->fmt = fmt_original;
+                continue;
+            }
+            if (region->fmt.i_chroma == VLC_CODEC_TEXT)
+                continue;
+        }
+
+        /* The forced palette is applied by the video output thread */
+        if (force_palette && region->fmt.i_chroma == VLC_CODEC_YUVP)
+            continue;
+
+        SpuScaleRegion(spu, scale, scale_yuvp, region, scale_size,
+                       chroma_list, false);
+    }
+}
+
+/* Returns the queued subpicture to render first, if any */
+static spu_ahead_entry_t *SpuAheadNext(spu_ahead_t *ahead)
+{
+    spu_ahead_entry_t *next = NULL;
+
+    for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++) {
+        spu_ahead_entry_t *entry = &ahead->entry[i];
+
+        if (entry->subpicture == NULL || entry->busy)
+            continue;
+        if (next == NULL ||
+            entry->subpicture->i_start < next->subpicture->i_start)
+            next = entry;
+    }
+    return next;
+}
+
+/* Returns whether a subpicture is being rendered ahead */
+static bool SpuAheadBusy(const spu_ahead_t *ahead)
+{
+    for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++)
+        if (ahead->entry[i].subpicture != NULL && ahead->entry[i].busy)
+            return true;
+    return false;
+}
+
+static void *SpuAheadThread(void *data)
+{
+    spu_ahead_worker_t *worker = data;
+    spu_t *spu = worker->spu;
+    spu_private_t *sys = spu->p;
+    spu_ahead_t *ahead = &sys->ahead;
+
+    vlc_mutex_lock(&sys->lock);
+    for (;;) {
+        spu_ahead_entry_t *entry = SpuAheadNext(ahead);
+
+        if (entry == NULL) {
+            if (ahead->exit)
+                break;
+            vlc_cond_wait(&ahead->wait, &sys->lock);
+            continue;
+        }
+
+        subpicture_t *subpic = entry->subpicture;
+        video_format_t fmt_src, fmt_dst;
+        vlc_fourcc_t chroma_list[SPU_MAX_CHROMAS + 1];
+        const bool force_palette = sys->force_palette;
+        /* The dates of queued subtitles may be offset meanwhile */
+        const mtime_t date = subpic->i_start;
+
+        entry->busy = true;
+        video_format_Copy(&fmt_src, &ahead->fmt_src);
+        video_format_Copy(&fmt_dst, &ahead->fmt_dst);
+        memcpy(chroma_list, ahead->chroma_list, sizeof (chroma_list));
+        vlc_mutex_unlock(&sys->lock);
+
+        /* The renderers are only replaced while no entry is busy */
+        SpuPrerender(spu, worker->text, worker->scale, worker->scale_yuvp,
+                     subpic, date, &fmt_src, &fmt_dst, chroma_list,
+                     force_palette);
+        video_format_Clean(&fmt_src);
+        video_format_Clean(&fmt_dst);
+        var_IncInteger(spu, "sub-rendered-ahead");
+
+        vlc_mutex_lock(&sys->lock);
+        bool reject = entry->reject;
+
+        entry->subpicture = NULL;
+        entry->busy = false;
+        entry->reject = false;
+
+        if (!reject && SpuHeapPush(&sys->heap, subpic)) {
+            msg_Err(spu, "subpicture heap full");
+            reject = true;
+        }
+        if (reject)
+            subpicture_Delete(subpic);
+        vlc_cond_broadcast(&ahead->done);
+    }
+    vlc_mutex_unlock(&sys->lock);
+    return NULL;
+}
+
+/**
+ * Queues a subtitle to be rendered ahead of its display date.
+ * The SPU lock must be held.
+ */
+static int SpuAheadPush(spu_t *spu, subpicture_t *subpic)
+{
+    spu_ahead_t *ahead = &spu->p->ahead;
+
+    if (ahead->thread_count == 0 || !ahead->has_config || !subpic->b_subtitle
+     || subpic->i_start <= mdate() + SPU_AHEAD_MIN_DELAY)
+        return VLC_EGENERIC;
+
+    for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++) {
+        spu_ahead_entry_t *entry = &ahead->entry[i];
+
+        if (entry->subpicture == NULL) {
+            entry->subpicture = subpic;
+            entry->busy = false;
+            entry->reject = false;
+            vlc_cond_signal(&ahead->wait);
+            return VLC_SUCCESS;
+        }
+    }
+    return VLC_EGENERIC;
+}
+
+/**
+ * Moves the queued subtitles to be displayed at the given date to the
+ * heap, rendered or not. The SPU lock must be held.
+ */
+static void SpuAheadFlush(spu_t *spu, mtime_t render_date)
+{
+    spu_private_t *sys = spu->p;
+    spu_ahead_t *ahead = &sys->ahead;
+
+    for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++) {
+        spu_ahead_entry_t *entry = &ahead->entry[i];
+        subpicture_t *subpic = entry->subpicture;
+
+        if (subpic == NULL || subpic->i_start > render_date)
+            continue;
+
+        if (entry->busy) {
+            /* Almost done: wait for it rather than rendering it again */
+            vlc_cond_wait(&ahead->done, &sys->lock);
+            i = -1;
+            continue;
+        }
+
+        entry->subpicture = NULL;
+        if (SpuHeapPush(&sys->heap, subpic)) {
+            msg_Err(spu, "subpicture heap full");
+            subpicture_Delete(subpic);
+        }
+    }
+}
+
+/**
+ * Records the output configuration to render subtitles ahead for.
+ * The SPU lock must be held.
+ */
+static void SpuAheadConfigure(spu_ahead_t *ahead,
+                              const video_format_t *fmt_src,
+                              const video_format_t *fmt_dst,
+                              const vlc_fourcc_t *chroma_list)
+{
+    vlc_fourcc_t chromas[SPU_MAX_CHROMAS + 1] = { 0 };
+
+    for (unsigned i = 0; i < SPU_MAX_CHROMAS && chroma_list[i]; i++)
+        chromas[i] = chroma_list[i];
+
+    if (ahead->has_config &&
+        video_format_IsSimilar(&ahead->fmt_src, fmt_src) &&
+        video_format_IsSimilar(&ahead->fmt_dst, fmt_dst) &&
+        !memcmp(ahead->chroma_list, chromas, sizeof (chromas)))
+        return;
+
+    if (ahead->has_config) {
+        video_format_Clean(&ahead->fmt_src);
+        video_format_Clean(&ahead->fmt_dst);
+    }
+    video_format_Copy(&ahead->fmt_src, fmt_src);
+    video_format_Copy(&ahead->fmt_dst, fmt_dst);
+    memcpy(ahead->chroma_list, chromas, sizeof (chromas));
+    ahead->has_config = true;
+}
+
+static void SpuAheadInit(spu_t *spu)
+{
+    spu_ahead_t *ahead = &spu->p->ahead;
+    int count = var_InheritInteger(spu, "sub-render-threads");
+
+    /* Number of subtitles rendered ahead so far */
+    var_Create(spu, "sub-rendered-ahead", VLC_VAR_INTEGER);
+
+    vlc_cond_init(&ahead->wait);
+    vlc_cond_init(&ahead->done);
+    ahead->exit = false;
+    ahead->has_config = false;
+    for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++)
+        ahead->entry[i].subpicture = NULL;
+
+    ahead->thread_count = 0;
+    ahead->workers = NULL;
+    if (count <= 0)
+        return;
+
+    ahead->workers = malloc(count * sizeof (*ahead->workers));
+    if (unlikely(ahead->workers == NULL))
+        return;
+
+    for (int i = 0; i < count; i++) {
+        spu_ahead_worker_t *worker = &ahead->workers[i];
+
+        worker->spu = spu;
+        worker->text = SpuRenderCreateAndLoadText(spu);
+        worker->scale = SpuRenderCreateAndLoadScale(VLC_OBJECT(spu),
+                                                    VLC_CODEC_YUVA,
+                                                    VLC_CODEC_RGBA, true);
+        worker->scale_yuvp = SpuRenderCreateAndLoadScale(VLC_OBJECT(spu),
+                                                         VLC_CODEC_YUVP,
+                                                         VLC_CODEC_YUVA,
+                                                         false);
+
+        if (vlc_clone(&worker->thread, SpuAheadThread, worker,
+                      VLC_THREAD_PRIORITY_LOW)) {
+            if (worker->text)
+                FilterRelease(worker->text);
+            if (worker->scale_yuvp)
+                FilterRelease(worker->scale_yuvp);
+            if (worker->scale)
+                FilterRelease(worker->scale);
+            break;
+        }
+        ahead->thread_count++;
+    }
+}
+
+/**
+ * Reloads the text renderers of the worker threads, e.g. for the fonts
+ * attached to a new input. The SPU lock must be held.
+ */
+static void SpuAheadReloadText(spu_t *spu)
+{
+    spu_private_t *sys = spu->p;
+    spu_ahead_t *ahead = &sys->ahead;
+
+    /* Workers only use their renderers while an entry is busy */
+    while (SpuAheadBusy(ahead))
+        vlc_cond_wait(&ahead->done, &sys->lock);
+
+    for (unsigned i = 0; i < ahead->thread_count; i++) {
+        spu_ahead_worker_t *worker = &ahead->workers[i];
+
+        if (worker->text)
+            FilterRelease(worker->text);
+        worker->text = SpuRenderCreateAndLoadText(spu);
+    }
+}
+
+static void SpuAheadClean(spu_t *spu)
+{
+    spu_private_t *sys = spu->p;
+    spu_ahead_t *ahead = &sys->ahead;
+
+    vlc_mutex_lock(&sys->lock);
+    ahead->exit = true;
+    vlc_cond_broadcast(&ahead->wait);
+    vlc_mutex_unlock(&sys->lock);
+
+    /* Queued subtitles are rendered before exiting, but not displayed */
+    for (unsigned i = 0; i < ahead->thread_count; i++) {
+        spu_ahead_worker_t *worker = &ahead->workers[i];
+
+        vlc_join(worker->thread, NULL);
+        if (worker->text)
+            FilterRelease(worker->text);
+        if (worker->scale_yuvp)
+            FilterRelease(worker->scale_yuvp);
+        if (worker->scale)
+            FilterRelease(worker->scale);
+    }
+    free(ahead->workers);
+
+    for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++)
+        if (ahead->entry[i].subpicture != NULL)
+            subpicture_Delete(ahead->entry[i].subpicture);
+
+    if (ahead->has_config) {
+        video_format_Clean(&ahead->fmt_src);
+        video_format_Clean(&ahead->fmt_dst);
+    }
+    vlc_cond_destroy(&ahead->done);
+    vlc_cond_destroy(&ahead->wait);
+}
+
 /*****************************************************************************
  * Object variables callbacks
  *****************************************************************************/
@@ -1306,6 +1711,8 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
     sys->last_sort_date = -1;
     sys->vout = vout;
 
+    SpuAheadInit(spu);
+
     return spu;
 }
 
@@ -1318,6 +1725,8 @@ void spu_Destroy(spu_t *spu)
 {
     spu_private_t *sys = spu->p;
 
+    SpuAheadClean(spu);
+
     if (sys->text)
         FilterRelease(sys->text);
 
@@ -1370,6 +1779,7 @@ void spu_Attach(spu_t *spu, vlc_object_t *input, bool attach)
         if (spu->p->text)
             FilterRelease(spu->p->text);
         spu->p->text = SpuRenderCreateAndLoadText(spu);
+        SpuAheadReloadText(spu);
 
         vlc_mutex_unlock(&spu->p->lock);
     } else {
@@ -1480,6 +1890,10 @@ void spu_PutSubpicture(spu_t *spu, subpicture_t *subpic)
 
     /* */
     vlc_mutex_lock(&sys->lock);
+    if (SpuAheadPush(spu, subpic) == VLC_SUCCESS) {
+        vlc_mutex_unlock(&sys->lock);
+        return;
+    }
     if (SpuHeapPush(&sys->heap, subpic)) {
         vlc_mutex_unlock(&sys->lock);
         msg_Err(spu, "subpicture heap full");
@@ -1549,6 +1963,12 @@ subpicture_t *spu_Render(spu_t *spu,
 
     vlc_mutex_lock(&sys->lock);
 
+    /* Subtitles are rendered ahead for the current output configuration */
+    if (sys->ahead.thread_count > 0) {
+        SpuAheadConfigure(&sys->ahead, fmt_src, fmt_dst, chroma_list);
+        SpuAheadFlush(spu, render_subtitle_date);
+    }
+
     unsigned int subpicture_count;
     subpicture_t *subpicture_array[VOUT_MAX_SUBPICTURES];
 
@@ -1601,6 +2021,16 @@ void spu_OffsetSubtitleDate(spu_t *spu, mtime_t duration)
                 current->i_stop  += duration;
         }
     }
+    for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++) {
+        subpicture_t *current = sys->ahead.entry[i].subpicture;
+
+        if (current) {
+            if (current->i_start > 0)
+                current->i_start += duration;
+            if (current->i_stop > 0)
+                current->i_stop  += duration;
+        }
+    }
     vlc_mutex_unlock(&sys->lock);
 }
 
@@ -1634,6 +2064,24 @@ void spu_ClearChannel(spu_t *spu, int channel)
         entry->reject = true;
     }
 
+    for (int i = 0; i < VOUT_MAX_SUBPICTURES; i++) {
+        spu_ahead_entry_t *entry = &sys->ahead.entry[i];
+        subpicture_t *subpic = entry->subpicture;
+
+        if (!subpic)
+            continue;
+        if (subpic->i_channel != channel && (channel != -1 || subpic->i_channel == VOUT_SPU_CHANNEL_OSD))
+            continue;
+
+        /* Subpictures being rendered are deleted once done */
+        if (entry->busy) {
+            entry->reject = true;
+        } else {
+            entry->subpicture = NULL;
+            subpicture_Delete(subpic);
+        }
+    }
+
     vlc_mutex_unlock(&sys->lock);
 }
 
@@ -123,9 +123,12 @@ int vout_InitWrapper(vout_thread_t *vout)
 
     sys->display.use_dr = !vout_IsDisplayFiltered(vd);
     const bool allow_dr = !vd->info.has_pictures_invalid && !vd->info.is_slow && sys->display.use_dr;
-    const unsigned private_picture  = 4; /* XXX 3 for filter, 1 for SPU */
+    const unsigned prepared_picture = sys->prepare.depth; /* filtered ahead */
+    const unsigned private_picture  = 4 /* XXX 3 for filter, 1 for SPU */
+                                    + prepared_picture;
     const unsigned decoder_picture  = 1 + sys->dpb_size;
     const unsigned kept_picture     = 1; /* last displayed picture */
+    /* The pictures filtered ahead come from the private pool */
     const unsigned reserved_picture = DISPLAY_PICTURE_COUNT +
                                       private_picture +
                                       kept_picture;
@@ -30,6 +30,7 @@
 
 #include <vlc_threads.h>
 #include <vlc_fs.h>
+#include <vlc_url.h>
 #include <vlc_input_item.h>
 #include <vlc_events.h>
 
@@ -175,6 +176,206 @@ static void test_input_metadata_timeout(libvlc_instance_t *vlc, int timeout,
     vlc_close(p_pipe[1]);
 }
 
+#define TEST_PRIORITY_COUNT 8
+
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_sem_t sem;
+    input_item_t *ended[TEST_PRIORITY_COUNT + 2];
+    unsigned count;
+} priority_test;
+
+static void input_item_preparse_ordered( const vlc_event_t *p_event,
+                                         void *user_data )
+{
+    (void) p_event;
+    vlc_mutex_lock(&priority_test.lock);
+    assert(priority_test.count < ARRAY_SIZE(priority_test.ended));
+    priority_test.ended[priority_test.count++] = user_data;
+    vlc_mutex_unlock(&priority_test.lock);
+    vlc_sem_post(&priority_test.sem);
+}
+
+static input_item_t *test_item_request(libvlc_instance_t *vlc, const char *uri,
+                                       input_item_meta_request_option_t opts,
+                                       int timeout, void *id)
+{
+    input_item_t *p_item = input_item_NewFile(uri, "test priority", 0,
+                                              ITEM_LOCAL);
+    assert(p_item != NULL);
+
+    int i_ret = vlc_event_attach(&p_item->event_manager,
+                                 vlc_InputItemPreparseEnded,
+                                 input_item_preparse_ordered, p_item);
+    assert(i_ret == 0);
+    i_ret = libvlc_MetadataRequest(vlc->p_libvlc_int, p_item,
+                                   META_REQUEST_OPTION_SCOPE_LOCAL | opts,
+                                   timeout, id);
+    assert(i_ret == 0);
+    return p_item;
+}
+
+/* With a single preparser thread, blocked on a pipe: queued requests are
+ * cancelled by id, and the high priority lane is served first. */
+static void test_input_metadata_priority(void)
+{
+    log ("test_input_metadata_priority\n");
+
+    static const char *args[] = { "-v", "--preparse-threads=1" };
+    libvlc_instance_t *vlc = libvlc_new (ARRAY_SIZE(args), args);
+    assert (vlc != NULL);
+
+    int i_ret, p_pipe[2];
+    i_ret = vlc_pipe(p_pipe);
+    assert(i_ret == 0 && p_pipe[1] >= 0);
+
+    char psz_fd_uri[strlen("fd://") + 11];
+    sprintf(psz_fd_uri, "fd://%u", (unsigned) p_pipe[1]);
+    char *psz_uri = vlc_path2uri(test_default_sample, NULL);
+    assert(psz_uri != NULL);
+
+    vlc_mutex_init(&priority_test.lock);
+    vlc_sem_init(&priority_test.sem, 0);
+    priority_test.count = 0;
+
+    int blocker_id, low_id, high_id, cancelled_id;
+    input_item_t *blocker = test_item_request(vlc, psz_fd_uri, 0, 0,
+                                              &blocker_id);
+    /* Let the only thread start it: queued requests are dropped silently */
+    msleep(100 * 1000);
+
+    input_item_t *items[TEST_PRIORITY_COUNT], *cancelled[TEST_PRIORITY_COUNT];
+
+    for (unsigned i = 0; i < TEST_PRIORITY_COUNT; ++i)
+        items[i] = test_item_request(vlc, psz_uri,
+                                     META_REQUEST_OPTION_PRIORITY_LOW, -1,
+                                     &low_id);
+    for (unsigned i = 0; i < TEST_PRIORITY_COUNT; ++i)
+        cancelled[i] = test_item_request(vlc, psz_uri, 0, -1, &cancelled_id);
+    input_item_t *high = test_item_request(vlc, psz_uri,
+                                           META_REQUEST_OPTION_PRIORITY_HIGH,
+                                           -1, &high_id);
+
+    libvlc_MetadataCancel(vlc->p_libvlc_int, &cancelled_id);
+    libvlc_MetadataCancel(vlc->p_libvlc_int, &blocker_id);
+
+    for (unsigned i = 0; i < TEST_PRIORITY_COUNT + 2; ++i)
+        vlc_sem_wait(&priority_test.sem);
+
+    vlc_mutex_lock(&priority_test.lock);
+    assert(priority_test.ended[0] == blocker);
+    assert(priority_test.ended[1] == high);
+    for (unsigned i = 0; i < TEST_PRIORITY_COUNT; ++i)
+        assert(priority_test.ended[i + 2] == items[i]);
+    vlc_mutex_unlock(&priority_test.lock);
+
+    libvlc_release(vlc);
+
+    /* Cancelled requests never ended */
+    assert(priority_test.count == TEST_PRIORITY_COUNT + 2);
+
+    for (unsigned i = 0; i < TEST_PRIORITY_COUNT; ++i)
+    {
+        input_item_Release(items[i]);
+        input_item_Release(cancelled[i]);
+    }
+    input_item_Release(high);
+    input_item_Release(blocker);
+    free(psz_uri);
+    vlc_sem_destroy(&priority_test.sem);
+    vlc_mutex_destroy(&priority_test.lock);
+    vlc_close(p_pipe[0]);
+    vlc_close(p_pipe[1]);
+}
+
+#define TEST_PARALLEL_COUNT 200
+
+/* Preparse a generated directory of samples, and report the time taken */
+static mtime_t test_media_preparse_parallel(const char *dir, unsigned threads)
+{
+    char arg[32];
+    sprintf(arg, "--preparse-threads=%u", threads);
+
+    const char *args[] = { "-v", arg };
+    libvlc_instance_t *vlc = libvlc_new (ARRAY_SIZE(args), args);
+    assert (vlc != NULL);
+
+    libvlc_media_t *medias[TEST_PARALLEL_COUNT];
+    vlc_sem_t sem;
+    vlc_sem_init (&sem, 0);
+
+    mtime_t start = mdate();
+    for (unsigned i = 0; i < TEST_PARALLEL_COUNT; ++i)
+    {
+        char path[256];
+        snprintf(path, sizeof (path), "%s/%u.voc", dir, i);
+
+        medias[i] = libvlc_media_new_path (vlc, path);
+        assert (medias[i] != NULL);
+
+        libvlc_event_manager_t *em = libvlc_media_event_manager (medias[i]);
+        libvlc_event_attach (em, libvlc_MediaParsedChanged,
+                             media_parse_ended, &sem);
+        assert (libvlc_media_parse_with_options (medias[i],
+                                                 libvlc_media_parse_local,
+                                                 -1) == 0);
+    }
+
+    for (unsigned i = 0; i < TEST_PARALLEL_COUNT; ++i)
+        vlc_sem_wait (&sem);
+    mtime_t duration = mdate() - start;
+
+    for (unsigned i = 0; i < TEST_PARALLEL_COUNT; ++i)
+    {
+        assert (libvlc_media_get_parsed_status (medias[i])
+                == libvlc_media_parsed_status_done);
+        libvlc_media_release (medias[i]);
+    }
+    vlc_sem_destroy (&sem);
+    libvlc_release (vlc);
+
+    log ("preparsed %u files with %u thread(s) in %"PRId64" us\n",
+         TEST_PARALLEL_COUNT, threads, duration);
+    return duration;
+}
+
+static void test_media_preparse_bench(void)
+{
+    char dir[] = "/tmp/vlc-test-preparse-XXXXXX";
+    assert (mkdtemp (dir) != NULL);
+
+    FILE *in = fopen (test_default_sample, "rb");
+    assert (in != NULL);
+
+    char buf[4096];
+    size_t len = fread (buf, 1, sizeof (buf), in);
+    assert (len > 0 && feof (in));
+    fclose (in);
+
+    for (unsigned i = 0; i < TEST_PARALLEL_COUNT; ++i)
+    {
+        char path[256];
+        snprintf (path, sizeof (path), "%s/%u.voc", dir, i);
+
+        FILE *out = fopen (path, "wb");
+        assert (out != NULL);
+        assert (fwrite (buf, len, 1, out) == 1);
+        fclose (out);
+    }
+
+    test_media_preparse_parallel (dir, 1);
+    test_media_preparse_parallel (dir, 4);
+
+    for (unsigned i = 0; i < TEST_PARALLEL_COUNT; ++i)
+    {
+        char path[256];
+        snprintf (path, sizeof (path), "%s/%u.voc", dir, i);
+        unlink (path);
+    }
+    rmdir (dir);
+}
+
 #define TEST_SUBITEMS_COUNT 6
 static struct
 {
@@ -376,5 +577,8 @@ int main(int i_argc, char *ppsz_argv[])
 
     libvlc_release (vlc);
 
+    test_input_metadata_priority ();
+    test_media_preparse_bench ();
+
     return 0;
 }
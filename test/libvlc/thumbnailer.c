@@ -0,0 +1,178 @@
+/*****************************************************************************
+ * thumbnailer.c: test for the libvlc thumbnailer
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "test.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <string.h>
+
+#define WIDTH  32
+#define HEIGHT 16
+#define FRAMES 50
+
+struct thumbnail
+{
+    vlc_sem_t done;
+    void *data;
+    size_t size;
+};
+
+static void on_thumbnail(void *opaque, libvlc_media_t *md,
+                         const void *data, size_t size)
+{
+    struct thumbnail *thumb = opaque;
+
+    assert(md != NULL);
+    if (data != NULL)
+    {
+        thumb->data = malloc(size);
+        assert(thumb->data != NULL);
+        memcpy(thumb->data, data, size);
+    }
+    else
+        thumb->data = NULL;
+    thumb->size = size;
+    vlc_sem_post(&thumb->done);
+}
+
+static void write_input(const char *path)
+{
+    uint8_t frame[WIDTH * HEIGHT * 3 / 2];
+    FILE *stream = fopen(path, "wb");
+
+    assert(stream != NULL);
+    fprintf(stream, "YUV4MPEG2 W%u H%u F25:1 Ip A1:1 C420jpeg\n",
+            WIDTH, HEIGHT);
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        memset(frame, 16 + i * 4, WIDTH * HEIGHT);
+        memset(frame + WIDTH * HEIGHT, 128, WIDTH * HEIGHT / 2);
+        fputs("FRAME\n", stream);
+        assert(fwrite(frame, sizeof (frame), 1, stream) == 1);
+    }
+    fclose(stream);
+}
+
+/* Returns the dimensions from the JPEG frame header */
+static void jpeg_size(const struct thumbnail *thumb,
+                      unsigned *width, unsigned *height)
+{
+    const uint8_t *p = thumb->data, *end = p + thumb->size;
+
+    assert(thumb->size > 4 && p[0] == 0xFF && p[1] == 0xD8);
+    for (p += 2; p + 9 <= end; p += 2 + GetWBE(p + 2))
+    {
+        assert(p[0] == 0xFF);
+        if (p[1] == 0xC0) /* baseline start of frame */
+        {
+            *height = GetWBE(p + 5);
+            *width = GetWBE(p + 7);
+            return;
+        }
+    }
+    assert(!"no start of frame");
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-thumbnailer-XXXXXX";
+    char in[64];
+
+    test_init();
+    assert(mkdtemp(dir) != NULL);
+    snprintf(in, sizeof (in), "%s/in.y4m", dir);
+    write_input(in);
+
+    const char *argv[] = { "--rawvid-fps=25" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    /* swscale converts to the full range chroma of the JPEG encoder */
+    static const char *const modules[] = {
+        "rawvid", "rawvideo", "jpeg", "swscale",
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(modules); i++)
+        if (!module_exists(modules[i]))
+        {
+            libvlc_release(vlc);
+            unlink(in);
+            rmdir(dir);
+            return 77;
+        }
+
+    libvlc_media_t *md = libvlc_media_new_path(vlc, in);
+    assert(md != NULL);
+    libvlc_media_t *missing = libvlc_media_new_path(vlc, "/nonexistent.y4m");
+    assert(missing != NULL);
+
+    libvlc_thumbnailer_t *th = libvlc_thumbnailer_new(vlc, 2, 5000);
+    assert(th != NULL);
+
+    /* Several requests run concurrently */
+    struct thumbnail thumbs[4];
+    for (size_t i = 0; i < ARRAY_SIZE(thumbs); i++)
+        vlc_sem_init(&thumbs[i].done, 0);
+
+    assert(!libvlc_thumbnailer_request_by_time(th, md, 0, 0, 0,
+                                               libvlc_thumbnail_jpg,
+                                               on_thumbnail, &thumbs[0]));
+    assert(!libvlc_thumbnailer_request_by_time(th, md, 1000, 0, 0,
+                                               libvlc_thumbnail_jpg,
+                                               on_thumbnail, &thumbs[1]));
+    assert(!libvlc_thumbnailer_request_by_pos(th, md, .5f, 0, 32,
+                                              libvlc_thumbnail_jpg,
+                                              on_thumbnail, &thumbs[2]));
+    assert(!libvlc_thumbnailer_request_by_time(th, missing, 0, 0, 0,
+                                               libvlc_thumbnail_jpg,
+                                               on_thumbnail, &thumbs[3]));
+
+    for (size_t i = 0; i < ARRAY_SIZE(thumbs); i++)
+        vlc_sem_wait(&thumbs[i].done);
+    libvlc_thumbnailer_release(th);
+
+    unsigned width, height;
+    jpeg_size(&thumbs[0], &width, &height);
+    assert(width == WIDTH && height == HEIGHT);
+    jpeg_size(&thumbs[1], &width, &height);
+    assert(width == WIDTH && height == HEIGHT);
+    /* The pictures differ from one time to another */
+    assert(thumbs[0].size != thumbs[1].size
+        || memcmp(thumbs[0].data, thumbs[1].data, thumbs[0].size));
+
+    /* The width is deduced from the aspect ratio */
+    jpeg_size(&thumbs[2], &width, &height);
+    log("scaled thumbnail: %ux%u\n", width, height);
+    assert(width == 2 * WIDTH && height == 2 * HEIGHT);
+
+    assert(thumbs[3].data == NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(thumbs); i++)
+    {
+        free(thumbs[i].data);
+        vlc_sem_destroy(&thumbs[i].done);
+    }
+    libvlc_media_release(missing);
+    libvlc_media_release(md);
+    libvlc_release(vlc);
+    unlink(in);
+    rmdir(dir);
+    return 0;
+}
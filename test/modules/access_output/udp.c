@@ -0,0 +1,214 @@
+/*****************************************************************************
+ * udp.c: UDP stream output pacing test
+ *****************************************************************************
+ * Copyright © 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define PACKET_SIZE (7 * 188)
+#define BURST_SIZE  4 /* packets sharing one deadline */
+#define BURSTS      25
+#define INTERVAL    INT64_C(10000)
+#define CACHING     100 /* ms */
+
+static int receiver_open(int *port)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof (addr);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    assert(fd != -1);
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF,
+               &(int){ 4 * BURSTS * BURST_SIZE * PACKET_SIZE }, sizeof (int));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof (addr))
+     || getsockname(fd, (struct sockaddr *)&addr, &addrlen))
+    {
+        close(fd);
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static void test_pacing(vlc_object_t *obj, bool gso)
+{
+    char access[64], dst[32];
+    int port;
+    int fd = receiver_open(&port);
+    assert(fd != -1);
+
+    snprintf(access, sizeof (access), "udp{caching=%d,gso=%d}", CACHING, gso);
+    snprintf(dst, sizeof (dst), "127.0.0.1:%d", port);
+
+    sout_access_out_t *out = sout_AccessOutNew(obj, access, dst);
+    assert(out != NULL);
+
+    /* All packets are queued long before the first one is due, so that
+     * how they are batched does not depend on scheduling. */
+    const mtime_t start = mdate() + 20000;
+    const unsigned count = BURSTS * BURST_SIZE;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        block_t *block = block_Alloc(PACKET_SIZE);
+        assert(block != NULL);
+        memset(block->p_buffer, 0x47, PACKET_SIZE);
+        memcpy(block->p_buffer, &i, sizeof (i));
+        block->i_dts = start + (i / BURST_SIZE) * INTERVAL;
+        assert(sout_AccessOutWrite(out, block) == PACKET_SIZE);
+    }
+
+    mtime_t late_max = 0, late_sum = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        struct pollfd ufd = { .fd = fd, .events = POLLIN };
+        unsigned char buf[PACKET_SIZE + 1];
+        unsigned idx;
+
+        assert(poll(&ufd, 1, 2000) == 1);
+
+        ssize_t val = recv(fd, buf, sizeof (buf), 0);
+        mtime_t now = mdate();
+
+        assert(val == PACKET_SIZE);
+        memcpy(&idx, buf, sizeof (idx));
+        assert(idx == i);
+
+        /* Never early; lateness depends on the load and is only reported */
+        mtime_t deadline = start + (idx / BURST_SIZE) * INTERVAL
+                         + CACHING * INT64_C(1000);
+        assert(now >= deadline);
+        if (now - deadline > late_max)
+            late_max = now - deadline;
+        late_sum += now - deadline;
+    }
+
+    printf("gso=%d: late by %"PRId64" us on average, %"PRId64" us at most\n",
+           gso, late_sum / count, late_max);
+
+    sout_AccessOutDelete(out);
+    close(fd);
+}
+
+/* A datagram sent to a closed port leaves an error pending on the socket,
+ * which fails the next send: the datagrams of the batch must still go out */
+static void test_refused(vlc_object_t *obj)
+{
+    char dst[32];
+    int port;
+    int fd = receiver_open(&port);
+    assert(fd != -1);
+    close(fd);
+
+    snprintf(dst, sizeof (dst), "127.0.0.1:%d", port);
+
+    sout_access_out_t *out = sout_AccessOutNew(obj, "udp{caching=0,gso=1}",
+                                               dst);
+    assert(out != NULL);
+
+    block_t *block = block_Alloc(PACKET_SIZE);
+    assert(block != NULL);
+    memset(block->p_buffer, 0x47, PACKET_SIZE);
+    block->i_dts = mdate();
+    mtime_t deadline = block->i_dts + 10 * INTERVAL;
+    assert(sout_AccessOutWrite(out, block) == PACKET_SIZE);
+    mwait(deadline);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(fd != -1);
+    assert(bind(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+
+    const mtime_t start = mdate() + 20000;
+
+    for (unsigned i = 0; i < BURST_SIZE; i++)
+    {
+        block = block_Alloc(PACKET_SIZE);
+        assert(block != NULL);
+        memset(block->p_buffer, 0x47, PACKET_SIZE);
+        memcpy(block->p_buffer, &i, sizeof (i));
+        block->i_dts = start;
+        assert(sout_AccessOutWrite(out, block) == PACKET_SIZE);
+    }
+
+    for (unsigned i = 0; i < BURST_SIZE; i++)
+    {
+        struct pollfd ufd = { .fd = fd, .events = POLLIN };
+        unsigned char buf[PACKET_SIZE + 1];
+        unsigned idx;
+
+        assert(poll(&ufd, 1, 2000) == 1);
+        assert(recv(fd, buf, sizeof (buf), 0) == PACKET_SIZE);
+        memcpy(&idx, buf, sizeof (idx));
+        assert(idx == i);
+    }
+
+    sout_AccessOutDelete(out);
+    close(fd);
+}
+
+static const char *const argv[] = { "--mtu=1316", NULL };
+
+int main(void)
+{
+    libvlc_instance_t *vlc;
+    vlc_object_t *obj;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+    obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    test_pacing(obj, false);
+    test_pacing(obj, true);
+    test_refused(obj);
+
+    libvlc_release(vlc);
+    return 0;
+}
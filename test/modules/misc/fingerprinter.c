@@ -0,0 +1,305 @@
+/*****************************************************************************
+ * fingerprinter.c: AcoustID fingerprinter module test
+ *****************************************************************************
+ * Copyright © 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MODULE_NAME test_fingerprinter
+#define MODULE_STRING "test_fingerprinter"
+#undef __PLUGIN__
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_access.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_modules.h>
+#include <vlc_url.h>
+#include <vlc_fingerprinter.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../../modules/stream_out/chromaprint_data.h"
+
+#include <vlc/vlc.h>
+
+#define DURATION 30 /* seconds */
+#define LOOKUP_INTERVAL (CLOCK_FREQ / 3)
+#define MAX_LOOKUPS 16
+
+/* Fake chromaprint stream output, counting the decoded tracks */
+static unsigned decodes;
+
+static sout_stream_id_sys_t *StreamAdd(sout_stream_t *stream,
+                                       const es_format_t *fmt)
+{
+    (void) fmt;
+    return (sout_stream_id_sys_t *)stream;
+}
+
+static void StreamDel(sout_stream_t *stream, sout_stream_id_sys_t *id)
+{
+    (void) stream; (void) id;
+}
+
+static int StreamSend(sout_stream_t *stream, sout_stream_id_sys_t *id,
+                      block_t *block)
+{
+    (void) stream; (void) id;
+    block_ChainRelease(block);
+    return VLC_SUCCESS;
+}
+
+static int StreamOpen(vlc_object_t *obj)
+{
+    sout_stream_t *stream = (sout_stream_t *)obj;
+    chromaprint_fingerprint_t *data =
+        var_InheritAddress(obj, "fingerprint-data");
+
+    assert(data != NULL);
+    data->psz_fingerprint = strdup("AQADtest");
+    data->i_duration = DURATION;
+    decodes++;
+
+    stream->pf_add = StreamAdd;
+    stream->pf_del = StreamDel;
+    stream->pf_send = StreamSend;
+    return VLC_SUCCESS;
+}
+
+/* Fake AcoustID web service, recording the lookup dates */
+static vlc_mutex_t lookup_lock = VLC_STATIC_MUTEX;
+static mtime_t lookup_dates[MAX_LOOKUPS];
+static unsigned lookups;
+
+static const char answer[] =
+    "{\"status\":\"ok\",\"results\":[{\"id\":\"test\",\"score\":1.0,"
+    "\"recordings\":[{\"id\":\"00000000-0000-0000-0000-000000000000\","
+    "\"title\":\"Test title\",\"artists\":[{\"name\":\"Test artist\"}]}]}]}";
+
+static ssize_t AccessRead(stream_t *access, void *buf, size_t len)
+{
+    size_t *offset = access->p_sys;
+
+    len = __MIN(len, sizeof (answer) - 1 - *offset);
+    memcpy(buf, answer + *offset, len);
+    *offset += len;
+    return len;
+}
+
+static int AccessControl(stream_t *access, int query, va_list args)
+{
+    (void) access;
+
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+            *va_arg(args, bool *) = false;
+            break;
+        case STREAM_GET_PTS_DELAY:
+            *va_arg(args, int64_t *) = 0;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int AccessOpen(vlc_object_t *obj)
+{
+    stream_t *access = (stream_t *)obj;
+    char duration[32];
+
+    if (strncmp(access->psz_location, "fingerprint.videolan.org/", 25))
+        return VLC_EGENERIC;
+
+    /* Cached fingerprints are looked up as decoded ones */
+    snprintf(duration, sizeof (duration), "&duration=%u&", DURATION);
+    assert(strstr(access->psz_location, duration) != NULL);
+    assert(strstr(access->psz_location, "&fingerprint=AQADtest") != NULL);
+
+    vlc_mutex_lock(&lookup_lock);
+    assert(lookups < MAX_LOOKUPS);
+    lookup_dates[lookups++] = mdate();
+    vlc_mutex_unlock(&lookup_lock);
+
+    size_t *offset = vlc_malloc(obj, sizeof (*offset));
+    if (unlikely(offset == NULL))
+        return VLC_ENOMEM;
+    *offset = 0;
+
+    access->pf_read = AccessRead;
+    access->pf_block = NULL;
+    access->pf_seek = NULL;
+    access->pf_control = AccessControl;
+    access->p_sys = offset;
+    return VLC_SUCCESS;
+}
+
+vlc_module_begin()
+    set_capability("sout stream", 1000)
+    add_shortcut("chromaprint")
+    set_callbacks(StreamOpen, NULL)
+    add_submodule()
+    set_capability("access", 1000)
+    add_shortcut("http")
+    set_callbacks(AccessOpen, NULL)
+vlc_module_end()
+
+typedef int (*vlc_plugin_cb)(vlc_set_cb, void *);
+
+/* Loaded by the plugins bank, ahead of the dynamic plugins */
+VLC_EXPORT vlc_plugin_cb vlc_static_modules[] = {
+    vlc_entry__test_fingerprinter,
+    NULL
+};
+
+static void write_input(const char *path, size_t size)
+{
+    FILE *stream = fopen(path, "wb");
+    char buf[1024] = { 0 };
+
+    assert(stream != NULL);
+    for (size_t i = 0; i < size; i += sizeof (buf))
+        assert(fwrite(buf, sizeof (buf), 1, stream) == 1);
+    fclose(stream);
+}
+
+static int on_results(vlc_object_t *obj, const char *name, vlc_value_t old,
+                      vlc_value_t cur, void *data)
+{
+    (void) obj; (void) name; (void) old; (void) cur;
+    vlc_sem_post(data);
+    return VLC_SUCCESS;
+}
+
+/* Fingerprints the same track count times concurrently */
+static void fingerprint(fingerprinter_thread_t *fp, vlc_sem_t *results,
+                        const char *uri, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        input_item_t *item = input_item_New(uri, "track");
+        assert(item != NULL);
+
+        fingerprint_request_t *req = fingerprint_request_New(item);
+        assert(req != NULL);
+        input_item_Release(item);
+        fp->pf_enqueue(fp, req);
+    }
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        fingerprint_request_t *req;
+
+        vlc_sem_wait(results);
+        req = fp->pf_getresults(fp);
+        assert(req != NULL);
+        assert(vlc_array_count(&req->results.metas_array) == 1);
+
+        const vlc_meta_t *meta =
+            vlc_array_item_at_index(&req->results.metas_array, 0);
+        const char *title = vlc_meta_Get(meta, vlc_meta_Title);
+        assert(title != NULL && !strcmp(title, "Test title"));
+        fingerprint_request_Delete(req);
+    }
+}
+
+static const char *const argv[] = { "--fingerprinter-jobs=4", NULL };
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-fingerprinter-XXXXXX";
+    char path[64];
+    vlc_sem_t results;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+
+    if (!module_exists("fingerprinter") || !module_exists("stream_out_transcode"))
+    {
+        libvlc_release(vlc);
+        return 77;
+    }
+
+    assert(mkdtemp(dir) != NULL);
+    snprintf(path, sizeof (path), "%s/track.dat", dir);
+    write_input(path, 4096);
+
+    char *uri = vlc_path2uri(path, NULL);
+    assert(uri != NULL);
+
+    fingerprinter_thread_t *fp =
+        fingerprinter_Create(VLC_OBJECT(vlc->p_libvlc_int));
+    assert(fp != NULL);
+    vlc_sem_init(&results, 0);
+    var_AddCallback(fp, "results-available", on_results, &results);
+
+    /* A new track is decoded */
+    fingerprint(fp, &results, uri, 1);
+    assert(decodes == 1);
+    assert(var_GetInteger(fp, "fingerprints") == 1);
+    assert(var_GetInteger(fp, "fingerprint-cache-hits") == 0);
+    assert(var_GetInteger(fp, "fingerprint-audio-time")
+           == DURATION * CLOCK_FREQ);
+    assert(var_GetInteger(fp, "fingerprint-decode-time") > 0);
+
+    /* An unchanged track is served from the cache, but still looked up */
+    fingerprint(fp, &results, uri, 3);
+    assert(decodes == 1);
+    assert(var_GetInteger(fp, "fingerprints") == 4);
+    assert(var_GetInteger(fp, "fingerprint-cache-hits") == 3);
+    assert(var_GetInteger(fp, "fingerprint-audio-time")
+           == DURATION * CLOCK_FREQ);
+
+    /* A modified track is decoded again */
+    write_input(path, 8192);
+    fingerprint(fp, &results, uri, 1);
+    assert(decodes == 2);
+    assert(var_GetInteger(fp, "fingerprints") == 5);
+    assert(var_GetInteger(fp, "fingerprint-cache-hits") == 3);
+    assert(var_GetInteger(fp, "fingerprint-audio-time")
+           == 2 * DURATION * CLOCK_FREQ);
+
+    /* The concurrent jobs share the AcoustID rate limit */
+    assert(lookups == 5);
+    for (unsigned i = 1; i < lookups; i++)
+        assert(lookup_dates[i] - lookup_dates[i - 1] >= LOOKUP_INTERVAL);
+
+    var_DelCallback(fp, "results-available", on_results, &results);
+    fingerprinter_Destroy(fp);
+    vlc_sem_destroy(&results);
+    libvlc_release(vlc);
+
+    free(uri);
+    unlink(path);
+    rmdir(dir);
+    return 0;
+}
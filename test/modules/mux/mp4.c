@@ -0,0 +1,284 @@
+/*****************************************************************************
+ * mp4.c: fragmented MP4 muxer CMAF output test
+ *****************************************************************************
+ * Copyright © 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define FRAME_SIZE  384 /* MPEG-1 Layer II, 128 kb/s, 48 kHz */
+#define FRAMES      500
+
+static void write_input(const char *path)
+{
+    static const uint8_t header[4] = { 0xFF, 0xFD, 0x84, 0x00 };
+    uint8_t frame[FRAME_SIZE] = { 0 };
+    FILE *stream = fopen(path, "wb");
+
+    assert(stream != NULL);
+    memcpy(frame, header, sizeof (header));
+    for (unsigned i = 0; i < FRAMES; i++)
+        assert(fwrite(frame, sizeof (frame), 1, stream) == 1);
+    fclose(stream);
+}
+
+static void on_event(const libvlc_event_t *event, void *data)
+{
+    (void) event;
+    vlc_sem_post(data);
+}
+
+static void remux(libvlc_instance_t *vlc, const char *in, const char *out)
+{
+    char opt[256];
+    vlc_sem_t done;
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, in);
+    assert(media != NULL);
+    snprintf(opt, sizeof (opt), ":sout=#std{access=file,mux=cmaf,dst='%s'}",
+             out);
+    libvlc_media_add_option(media, opt);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    vlc_sem_init(&done, 0);
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    libvlc_event_attach(em, libvlc_MediaPlayerEndReached, on_event, &done);
+    libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, on_event,
+                        &done);
+
+    assert(libvlc_media_player_play(mp) == 0);
+    vlc_sem_wait(&done);
+    libvlc_media_player_stop(mp);
+    libvlc_media_player_release(mp);
+    vlc_sem_destroy(&done);
+}
+
+static uint8_t *load(const char *path, size_t *size)
+{
+    FILE *stream = fopen(path, "rb");
+    assert(stream != NULL);
+    assert(fseek(stream, 0, SEEK_END) == 0);
+
+    long len = ftell(stream);
+    assert(len > 0);
+    rewind(stream);
+
+    uint8_t *buf = malloc(len);
+    assert(buf != NULL);
+    assert(fread(buf, len, 1, stream) == 1);
+    fclose(stream);
+    *size = len;
+    return buf;
+}
+
+/* Returns the size of the box at buf, checking that it fits */
+static uint32_t box(const uint8_t *buf, size_t size, const char *type)
+{
+    assert(size >= 8);
+
+    uint32_t len = GetDWBE(buf);
+    assert(len >= 8 && len <= size);
+    if (type != NULL)
+        assert(!memcmp(buf + 4, type, 4));
+    return len;
+}
+
+/* Finds a child box, returns its size or 0 if absent */
+static uint32_t child(const uint8_t *buf, size_t size, const char *type,
+                      const uint8_t **p_child)
+{
+    for (size_t i = 8; i < size;)
+    {
+        uint32_t len = box(buf + i, size - i, NULL);
+        if (!memcmp(buf + i + 4, type, 4))
+        {
+            *p_child = buf + i;
+            return len;
+        }
+        i += len;
+    }
+    return 0;
+}
+
+/* Parses the moov for the trex default sample size */
+static uint32_t trex_default_size(const uint8_t *moov, size_t size)
+{
+    const uint8_t *mvex, *trex;
+    uint32_t len = child(moov, size, "mvex", &mvex);
+
+    assert(len > 0);
+    len = child(mvex, len, "trex", &trex);
+    assert(len == 32);
+    return GetDWBE(trex + 24);
+}
+
+/* Checks one moof against the mdat following it, returns the next sequence
+ * number. */
+static uint32_t check_moof(const uint8_t *moof, uint32_t moof_size,
+                           const uint8_t *mdat, uint32_t mdat_size,
+                           uint32_t seq, uint32_t trex_size)
+{
+    const uint8_t *mfhd, *traf, *tfhd, *trun;
+
+    assert(child(moof, moof_size, "mfhd", &mfhd) == 16);
+    assert(GetDWBE(mfhd + 12) == seq);
+
+    /* CMAF: a single track per fragment, moof relative offsets */
+    uint32_t traf_size = child(moof, moof_size, "traf", &traf);
+    assert(traf_size > 0);
+    assert(traf + traf_size == moof + moof_size);
+
+    uint32_t tfhd_size = child(traf, traf_size, "tfhd", &tfhd);
+    assert(tfhd_size >= 16);
+    uint32_t tfhd_flags = GetDWBE(tfhd + 8) & 0xffffff;
+    assert(tfhd_flags & 0x20000); /* default-base-is-moof */
+
+    unsigned off = 16;
+    if (tfhd_flags & 0x08) /* default sample duration */
+        off += 4;
+
+    uint32_t default_size = trex_size;
+    if (tfhd_flags & 0x10)
+        default_size = GetDWBE(tfhd + off);
+
+    uint32_t trun_size = child(traf, traf_size, "trun", &trun);
+    assert(trun_size >= 20);
+    uint32_t trun_flags = GetDWBE(trun + 8) & 0xffffff;
+    uint32_t count = GetDWBE(trun + 12);
+    assert(count > 0);
+    assert(trun_flags & 0x01); /* data offset */
+    assert(GetDWBE(trun + 16) == moof_size + 8);
+
+    off = 20;
+    if (trun_flags & 0x04) /* first sample flags */
+        off += 4;
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (trun_flags & 0x100)
+            off += 4;
+        if (trun_flags & 0x200)
+        {
+            assert(off + 4 <= trun_size);
+            total += GetDWBE(trun + off);
+            off += 4;
+        }
+        else
+            total += default_size;
+        if (trun_flags & 0x400)
+            off += 4;
+        if (trun_flags & 0x800)
+            off += 4;
+    }
+    assert(off == trun_size);
+
+    assert(!memcmp(mdat + 4, "mdat", 4));
+    assert(mdat_size == total + 8);
+    return seq + 1;
+}
+
+static void check(const uint8_t *buf, size_t size)
+{
+    size_t i = 0;
+    uint32_t len;
+
+    len = box(buf, size, "ftyp");
+    assert(!memcmp(buf + 8, "iso6", 4));
+    i += len;
+
+    len = box(buf + i, size - i, "moov");
+    uint32_t trex_size = trex_default_size(buf + i, len);
+    i += len;
+
+    uint32_t seq = 1;
+    uint64_t samples = 0;
+
+    while (i < size)
+    {
+        uint32_t moof_size = box(buf + i, size - i, "moof");
+        uint32_t mdat_size = box(buf + i + moof_size, size - i - moof_size,
+                                 "mdat");
+
+        seq = check_moof(buf + i, moof_size, buf + i + moof_size, mdat_size,
+                         seq, trex_size);
+        samples += mdat_size - 8;
+        i += moof_size + mdat_size;
+    }
+
+    assert(i == size);
+    assert(seq > 1);
+    assert(samples > 0 && (samples % FRAME_SIZE) == 0);
+    printf("%"PRIu32" fragments, %"PRIu64" frames\n", seq - 1,
+           samples / FRAME_SIZE);
+}
+
+int main(void)
+{
+    /* Short fragments end before the first sample does: those are empty
+     * and must not consume a sequence number. */
+    static const unsigned durations[] = { 20, 100, 1500 };
+    char dir[] = "/tmp/vlc-test-mp4-XXXXXX";
+    char in[64], out[64];
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    assert(mkdtemp(dir) != NULL);
+    snprintf(in, sizeof (in), "%s/in.mp2", dir);
+    snprintf(out, sizeof (out), "%s/out.mp4", dir);
+    write_input(in);
+
+    for (unsigned i = 0; i < ARRAY_SIZE(durations); i++)
+    {
+        char duration[32];
+        const char *argv[] = { "--no-audio", "--no-video", duration };
+        size_t size;
+
+        snprintf(duration, sizeof (duration), "--sout-mp4frag-duration=%u",
+                 durations[i]);
+
+        libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+        assert(vlc != NULL);
+        remux(vlc, in, out);
+        libvlc_release(vlc);
+
+        uint8_t *buf = load(out, &size);
+        check(buf, size);
+        free(buf);
+        unlink(out);
+    }
+    unlink(in);
+    rmdir(dir);
+    return 0;
+}
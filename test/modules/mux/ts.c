@@ -0,0 +1,231 @@
+/*****************************************************************************
+ * ts.c: TS muxer remux test and benchmark
+ *****************************************************************************
+ * Copyright © 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define FRAME_SIZE  384 /* MPEG-1 Layer II, 128 kb/s, 48 kHz */
+#define FRAMES      2000
+#define AUDIO_PID   68
+
+static void write_input(const char *path)
+{
+    static const uint8_t header[4] = { 0xFF, 0xFD, 0x84, 0x00 };
+    uint8_t frame[FRAME_SIZE] = { 0 };
+    FILE *stream = fopen(path, "wb");
+
+    assert(stream != NULL);
+    memcpy(frame, header, sizeof (header));
+    for (unsigned i = 0; i < FRAMES; i++)
+        assert(fwrite(frame, sizeof (frame), 1, stream) == 1);
+    fclose(stream);
+}
+
+static void on_event(const libvlc_event_t *event, void *data)
+{
+    (void) event;
+    vlc_sem_post(data);
+}
+
+static mtime_t remux(libvlc_instance_t *vlc, const char *in, const char *out,
+                     unsigned batch)
+{
+    char opt[256];
+    vlc_sem_t done;
+
+    snprintf(opt, sizeof (opt), ":sout=#std{access=file,mux=ts{batch=%u,"
+             "tsid=1,netid=1,pid-audio=%d},dst='%s'}", batch, AUDIO_PID, out);
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, in);
+    assert(media != NULL);
+    libvlc_media_add_option(media, opt);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    vlc_sem_init(&done, 0);
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    libvlc_event_attach(em, libvlc_MediaPlayerEndReached, on_event, &done);
+    libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, on_event,
+                        &done);
+
+    mtime_t start = mdate();
+    assert(libvlc_media_player_play(mp) == 0);
+    vlc_sem_wait(&done);
+    libvlc_media_player_stop(mp);
+    mtime_t duration = mdate() - start;
+
+    libvlc_media_player_release(mp);
+    vlc_sem_destroy(&done);
+
+    printf("batch=%u: remuxed in %"PRId64" us\n", batch, duration);
+    return duration;
+}
+
+static uint8_t *load(const char *path, size_t *size)
+{
+    FILE *stream = fopen(path, "rb");
+    assert(stream != NULL);
+    assert(fseek(stream, 0, SEEK_END) == 0);
+
+    long len = ftell(stream);
+    assert(len > 0 && (len % 188) == 0);
+    rewind(stream);
+
+    uint8_t *buf = malloc(len);
+    assert(buf != NULL);
+    assert(fread(buf, len, 1, stream) == 1);
+    fclose(stream);
+    *size = len;
+    return buf;
+}
+
+static unsigned pid_of(const uint8_t *ts)
+{
+    return ((ts[1] & 0x1f) << 8) | ts[2];
+}
+
+static bool has_pcr(const uint8_t *ts)
+{
+    return (ts[3] & 0x20) && ts[4] >= 7 && (ts[5] & 0x10);
+}
+
+static void check(const uint8_t *buf, size_t size)
+{
+    int cc[8192];
+    unsigned es = 0, pcr = 0;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(cc); i++)
+        cc[i] = -1;
+
+    for (size_t i = 0; i < size; i += 188)
+    {
+        const uint8_t *ts = &buf[i];
+        unsigned pid = pid_of(ts);
+
+        assert(ts[0] == 0x47);
+        if (ts[3] & 0x10) /* has payload */
+        {
+            bool discontinuity = (ts[3] & 0x20) && ts[4] > 0
+                              && (ts[5] & 0x80);
+            if (cc[pid] >= 0 && !discontinuity)
+                assert((ts[3] & 0xf) == ((cc[pid] + 1) & 0xf));
+            cc[pid] = ts[3] & 0xf;
+        }
+        if (pid == AUDIO_PID)
+            es++;
+        if (has_pcr(ts))
+            pcr++;
+    }
+
+    assert(cc[0] >= 0); /* PAT */
+    assert(es * 184 >= FRAMES * FRAME_SIZE);
+    assert(pcr > 0);
+}
+
+/* Both modes output the same packets, only the PCR values may differ. */
+static void compare(const uint8_t *a, const uint8_t *b, size_t size)
+{
+    for (size_t i = 0; i < size; i += 188)
+    {
+        uint8_t pa[188], pb[188];
+
+        memcpy(pa, &a[i], 188);
+        memcpy(pb, &b[i], 188);
+        assert(pid_of(pa) == pid_of(pb));
+
+        if (pid_of(pa) != AUDIO_PID)
+            continue; /* PSI versions are random */
+        if (has_pcr(pa))
+            memset(&pa[6], 0, 6);
+        if (has_pcr(pb))
+            memset(&pb[6], 0, 6);
+        assert(!memcmp(pa, pb, 188));
+    }
+}
+
+static const char *const argv[] = {
+    "--no-audio", "--no-video", "--sout-keep", NULL
+};
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-ts-XXXXXX";
+    char in[64], out[2][64];
+    libvlc_instance_t *vlc;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+
+    if (!module_exists("mux_ts"))
+    {
+        libvlc_release(vlc);
+        return 77;
+    }
+
+    assert(mkdtemp(dir) != NULL);
+    snprintf(in, sizeof (in), "%s/in.mp2", dir);
+    snprintf(out[0], sizeof (out[0]), "%s/out0.ts", dir);
+    snprintf(out[1], sizeof (out[1]), "%s/out1.ts", dir);
+    write_input(in);
+
+    mtime_t single = remux(vlc, in, out[0], 0);
+    mtime_t batched = remux(vlc, in, out[1], 64);
+    printf("speed-up: %"PRId64"%%\n", single * 100 / (batched ? batched : 1));
+
+    size_t size[2];
+    uint8_t *buf[2];
+
+    for (unsigned i = 0; i < 2; i++)
+    {
+        buf[i] = load(out[i], &size[i]);
+        check(buf[i], size[i]);
+    }
+    assert(size[0] == size[1]);
+    compare(buf[0], buf[1], size[0]);
+
+    for (unsigned i = 0; i < 2; i++)
+    {
+        free(buf[i]);
+        unlink(out[i]);
+    }
+    unlink(in);
+    rmdir(dir);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,437 @@
+/*****************************************************************************
+ * bench.c: H.264/HEVC packetizers test and benchmark
+ *****************************************************************************
+ * Copyright © 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_codec.h>
+#include <vlc_modules.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define PICTURES    240
+#define ROUNDS      5
+#define GOP         24
+#define SLICES      4
+#define SLICE_SIZE  (16 * 1024)
+
+/* Bit writer for the parameter sets and slice headers */
+typedef struct
+{
+    uint8_t *p;
+    size_t   i_bytes;
+    unsigned i_bits;
+    uint8_t  cur;
+} bw_t;
+
+static void bw_put_byte(bw_t *bw, uint8_t b)
+{
+    /* Emulation prevention */
+    if (bw->i_bytes >= 2 && bw->p[bw->i_bytes - 1] == 0
+     && bw->p[bw->i_bytes - 2] == 0 && b <= 3)
+        bw->p[bw->i_bytes++] = 3;
+    bw->p[bw->i_bytes++] = b;
+}
+
+static void bw_put(bw_t *bw, unsigned count, uint32_t value)
+{
+    while (count-- > 0)
+    {
+        bw->cur = (bw->cur << 1) | ((value >> count) & 1);
+        if (++bw->i_bits == 8)
+        {
+            bw_put_byte(bw, bw->cur);
+            bw->i_bits = 0;
+            bw->cur = 0;
+        }
+    }
+}
+
+static void bw_put_ue(bw_t *bw, uint32_t value)
+{
+    unsigned len = 0;
+
+    while ((value + 1) >> (len + 1))
+        len++;
+    bw_put(bw, len, 0);
+    bw_put(bw, len + 1, value + 1);
+}
+
+static void bw_put_trailing(bw_t *bw)
+{
+    bw_put(bw, 1, 1);
+    while (bw->i_bits != 0)
+        bw_put(bw, 1, 0);
+}
+
+typedef struct
+{
+    uint8_t *p;
+    size_t   i_size;
+} es_buffer_t;
+
+/* Appends a NAL with a 4 bytes startcode, and returns a bit writer for its
+ * payload after the header */
+static bw_t nal_begin(es_buffer_t *s, const uint8_t *hdr, size_t hdr_size)
+{
+    static const uint8_t startcode[4] = { 0, 0, 0, 1 };
+
+    memcpy(&s->p[s->i_size], startcode, 4);
+    memcpy(&s->p[s->i_size + 4], hdr, hdr_size);
+    s->i_size += 4 + hdr_size;
+
+    bw_t bw = { .p = &s->p[s->i_size] };
+    return bw;
+}
+
+static void nal_end(es_buffer_t *s, bw_t *bw)
+{
+    s->i_size += bw->i_bytes;
+}
+
+/* Ends a slice with a payload that contains no startcode */
+static void slice_end(es_buffer_t *s, bw_t *bw, unsigned *seed)
+{
+    bw_put_trailing(bw);
+    for (size_t i = bw->i_bytes; i < SLICE_SIZE; i++)
+        bw->p[bw->i_bytes++] = 1 + (rand_r(seed) % 255);
+    nal_end(s, bw);
+}
+
+static void h264_write(es_buffer_t *s, unsigned pic, unsigned *seed)
+{
+    const bool idr = (pic % GOP) == 0;
+    bw_t bw;
+
+    bw = nal_begin(s, (const uint8_t []){ 0x09 }, 1); /* AUD */
+    bw_put(&bw, 3, 7);
+    bw_put_trailing(&bw);
+    nal_end(s, &bw);
+
+    if (idr)
+    {
+        bw = nal_begin(s, (const uint8_t []){ 0x67 }, 1); /* SPS */
+        bw_put(&bw, 8, 66); /* Baseline */
+        bw_put(&bw, 8, 0);
+        bw_put(&bw, 8, 51);
+        bw_put_ue(&bw, 0); /* sps_id */
+        bw_put_ue(&bw, 0); /* log2_max_frame_num_minus4 */
+        bw_put_ue(&bw, 2); /* pic_order_cnt_type */
+        bw_put_ue(&bw, 1); /* max_num_ref_frames */
+        bw_put(&bw, 1, 0);
+        bw_put_ue(&bw, 3840 / 16 - 1);
+        bw_put_ue(&bw, 2160 / 16 - 1);
+        bw_put(&bw, 1, 1); /* frame_mbs_only_flag */
+        bw_put(&bw, 1, 1);
+        bw_put(&bw, 1, 0);
+        bw_put(&bw, 1, 0); /* no VUI */
+        bw_put_trailing(&bw);
+        nal_end(s, &bw);
+
+        bw = nal_begin(s, (const uint8_t []){ 0x68 }, 1); /* PPS */
+        bw_put_ue(&bw, 0); /* pps_id */
+        bw_put_ue(&bw, 0); /* sps_id */
+        bw_put(&bw, 2, 0);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0);
+        bw_put(&bw, 3, 0);
+        bw_put_ue(&bw, 0); /* se(0) */
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0);
+        bw_put(&bw, 3, 0);
+        bw_put_trailing(&bw);
+        nal_end(s, &bw);
+    }
+
+    for (unsigned i = 0; i < SLICES; i++)
+    {
+        bw = nal_begin(s, (const uint8_t []){ idr ? 0x65 : 0x41 }, 1);
+        bw_put_ue(&bw, i * 32400 / SLICES); /* first_mb_in_slice */
+        bw_put_ue(&bw, idr ? 7 : 5); /* I or P */
+        bw_put_ue(&bw, 0); /* pps_id */
+        bw_put(&bw, 4, (pic % GOP) % 16); /* frame_num */
+        if (idr)
+            bw_put_ue(&bw, (pic / GOP) % 2); /* idr_pic_id */
+        else
+        {
+            bw_put(&bw, 1, 0); /* num_ref_idx_active_override_flag */
+            bw_put(&bw, 1, 0); /* ref_pic_list_modification_flag_l0 */
+            bw_put(&bw, 1, 0); /* adaptive_ref_pic_marking_mode_flag */
+        }
+        slice_end(s, &bw, seed);
+    }
+}
+
+static void hevc_write_ptl(bw_t *bw)
+{
+    bw_put(bw, 3, 0);
+    bw_put(bw, 5, 1); /* Main */
+    bw_put(bw, 32, 0x60000000);
+    bw_put(bw, 4, 0x9);
+    bw_put(bw, 32, 0);
+    bw_put(bw, 12, 0);
+    bw_put(bw, 8, 153); /* 5.1 */
+}
+
+static void hevc_write(es_buffer_t *s, unsigned pic, unsigned *seed)
+{
+    const bool idr = (pic % GOP) == 0;
+    bw_t bw;
+
+    bw = nal_begin(s, (const uint8_t []){ 35 << 1, 1 }, 2); /* AUD */
+    bw_put(&bw, 3, 2);
+    bw_put_trailing(&bw);
+    nal_end(s, &bw);
+
+    if (idr)
+    {
+        bw = nal_begin(s, (const uint8_t []){ 32 << 1, 1 }, 2); /* VPS */
+        bw_put(&bw, 4, 0);
+        bw_put(&bw, 2, 3);
+        bw_put(&bw, 6, 0);
+        bw_put(&bw, 3, 0);
+        bw_put(&bw, 1, 1);
+        bw_put(&bw, 16, 0xffff);
+        hevc_write_ptl(&bw);
+        bw_put(&bw, 1, 1);
+        bw_put_ue(&bw, 4);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0);
+        bw_put(&bw, 6, 0);
+        bw_put_ue(&bw, 0);
+        bw_put(&bw, 2, 0);
+        bw_put_trailing(&bw);
+        nal_end(s, &bw);
+
+        bw = nal_begin(s, (const uint8_t []){ 33 << 1, 1 }, 2); /* SPS */
+        bw_put(&bw, 4, 0);
+        bw_put(&bw, 3, 0);
+        bw_put(&bw, 1, 1);
+        hevc_write_ptl(&bw);
+        bw_put_ue(&bw, 0); /* sps_id */
+        bw_put_ue(&bw, 1); /* 4:2:0 */
+        bw_put_ue(&bw, 3840);
+        bw_put_ue(&bw, 2160);
+        bw_put(&bw, 1, 0);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 4); /* log2_max_pic_order_cnt_lsb_minus4 */
+        bw_put(&bw, 1, 1);
+        bw_put_ue(&bw, 4);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 3);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 3);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0);
+        bw_put(&bw, 4, 0);
+        bw_put_ue(&bw, 0); /* num_short_term_ref_pic_sets */
+        bw_put(&bw, 5, 0);
+        bw_put_trailing(&bw);
+        nal_end(s, &bw);
+
+        bw = nal_begin(s, (const uint8_t []){ 34 << 1, 1 }, 2); /* PPS */
+        bw_put_ue(&bw, 0); /* pps_id */
+        bw_put_ue(&bw, 0); /* sps_id */
+        bw_put(&bw, 7, 0);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0); /* se(0) */
+        bw_put(&bw, 3, 0);
+        bw_put_ue(&bw, 0);
+        bw_put_ue(&bw, 0);
+        bw_put(&bw, 10, 0);
+        bw_put_ue(&bw, 0);
+        bw_put(&bw, 2, 0);
+        bw_put_trailing(&bw);
+        nal_end(s, &bw);
+    }
+
+    for (unsigned i = 0; i < SLICES; i++)
+    {
+        /* IDR_W_RADL or TRAIL_R */
+        bw = nal_begin(s, (const uint8_t []){ (idr ? 19 : 1) << 1, 1 }, 2);
+        bw_put(&bw, 1, i == 0); /* first_slice_segment_in_pic_flag */
+        if (idr)
+            bw_put(&bw, 1, 0);
+        bw_put_ue(&bw, 0); /* pps_id */
+        if (i > 0)
+            bw_put(&bw, 11, i * 2040 / SLICES); /* slice_segment_address */
+        slice_end(s, &bw, seed);
+    }
+}
+
+struct codec
+{
+    const char *name;
+    vlc_fourcc_t fourcc;
+    void (*write)(es_buffer_t *, unsigned, unsigned *);
+};
+
+static const struct codec codecs[] = {
+    { "h264", VLC_CODEC_H264, h264_write },
+    { "hevc", VLC_CODEC_HEVC, hevc_write },
+};
+
+/* Packetizes the stream, fed by blocks of the given size or one access unit
+ * per block if zero, and checks that the access units are output intact.
+ * Returns the throughput of the packetizer in MB/s. */
+static double packetize(libvlc_int_t *obj, const struct codec *codec,
+                      const es_buffer_t *s, const size_t *au_offsets,
+                      size_t chunk)
+{
+    decoder_t *dec = vlc_object_create(obj, sizeof (*dec));
+    assert(dec != NULL);
+
+    es_format_Init(&dec->fmt_in, VIDEO_ES, codec->fourcc);
+    dec->fmt_in.video.i_frame_rate = 60;
+    dec->fmt_in.video.i_frame_rate_base = 1;
+    es_format_Init(&dec->fmt_out, VIDEO_ES, 0);
+    dec->p_module = module_need(dec, "packetizer", codec->name, true);
+    assert(dec->p_module != NULL);
+
+    size_t out_size = 0;
+    unsigned out_count = 0;
+    mtime_t duration = 0;
+
+    for (unsigned pic = 0, offset = 0; offset < s->i_size; )
+    {
+        size_t size;
+
+        if (chunk == 0)
+            size = au_offsets[pic + 1] - au_offsets[pic];
+        else
+            size = __MIN(chunk, s->i_size - offset);
+
+        block_t *in = block_Alloc(size);
+        assert(in != NULL);
+        memcpy(in->p_buffer, &s->p[offset], size);
+        if (pic < PICTURES && au_offsets[pic] < offset + size)
+            in->i_pts = in->i_dts = VLC_TS_0 + pic * CLOCK_FREQ / 60;
+        offset += size;
+        while (pic < PICTURES && au_offsets[pic] < offset)
+            pic++;
+
+        block_t **pp_in = &in;
+
+        for (;;)
+        {
+            mtime_t start = mdate();
+            block_t *out = dec->pf_packetize(dec, pp_in);
+            duration += mdate() - start;
+            if (out == NULL)
+                break;
+
+            for (block_t *au = out, *next; au != NULL; au = next)
+            {
+                next = au->p_next;
+                /* The access units are those of the stream */
+                assert(out_size + au->i_buffer <= s->i_size);
+                assert(out_size + au->i_buffer == au_offsets[out_count + 1]);
+                assert(!memcmp(&s->p[out_size], au->p_buffer, au->i_buffer));
+                out_size += au->i_buffer;
+                out_count++;
+                block_Release(au);
+            }
+        }
+    }
+
+    module_unneed(dec, dec->p_module);
+    es_format_Clean(&dec->fmt_in);
+    es_format_Clean(&dec->fmt_out);
+    vlc_object_release(dec);
+
+    /* The last access unit is held until the next one starts */
+    assert(out_count == PICTURES - 1);
+    return (double)s->i_size * CLOCK_FREQ / (duration ? duration : 1)
+                                          / (1024 * 1024);
+}
+
+static void bench(libvlc_int_t *obj, const struct codec *codec,
+                  const es_buffer_t *s, const size_t *au_offsets,
+                  size_t chunk)
+{
+    double best = 0.;
+
+    for (unsigned i = 0; i < ROUNDS; i++)
+    {
+        double rate = packetize(obj, codec, s, au_offsets, chunk);
+        if (rate > best)
+            best = rate;
+    }
+    printf("%s, %s: %.1f MB/s\n", codec->name,
+           chunk ? "chunks" : "access units", best);
+}
+
+int main(void)
+{
+    libvlc_instance_t *vlc;
+    static const char *const argv[] = { "-q" };
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(codecs); i++)
+        if (!module_exists(codecs[i].name))
+        {
+            libvlc_release(vlc);
+            return 77;
+        }
+
+    es_buffer_t s;
+    s.p = malloc(PICTURES * (SLICES * SLICE_SIZE + 1024));
+    assert(s.p != NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(codecs); i++)
+    {
+        size_t au_offsets[PICTURES + 1];
+        unsigned seed = 0;
+
+        s.i_size = 0;
+        for (unsigned pic = 0; pic < PICTURES; pic++)
+        {
+            au_offsets[pic] = s.i_size;
+            codecs[i].write(&s, pic, &seed);
+        }
+        au_offsets[PICTURES] = s.i_size;
+
+        bench(vlc->p_libvlc_int, &codecs[i], &s, au_offsets, 0);
+        bench(vlc->p_libvlc_int, &codecs[i], &s, au_offsets, 1316);
+    }
+
+    free(s.p);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -24,6 +24,7 @@
 #include <assert.h>
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_bits.h>
 #include "../modules/packetizer/hxxx_nal.h"
 #include "../modules/packetizer/hxxx_nal.c"
 
@@ -114,6 +115,39 @@ static void testannexbin( const uint8_t *p_data, size_t i_data,
         }
     }
 }
+/* The same shared payload converted for two outputs (e.g. duplicated
+ * mp4 muxes): converting one reference must not alter the other. */
+static void testannexbin_shared( const uint8_t *p_data, size_t i_data,
+                                 const uint8_t **pp_res, size_t *pi_res )
+{
+    for( unsigned int i=0; i<3; i++)
+    {
+        block_t *p_block = block_Alloc( i_data );
+        assert( p_block );
+        memcpy( p_block->p_buffer, p_data, i_data );
+
+        p_block = block_shared_Alloc( p_block );
+        assert( p_block );
+        block_t *p_dup = block_Share( p_block );
+        assert( p_dup );
+        assert( block_IsShared( p_dup ) );
+
+        for( unsigned int j=0; j<2; j++ )
+        {
+            block_t *p_out = hxxx_AnnexB_to_xVC( j ? p_dup : p_block, 1 << i );
+            assert( p_out );
+            assert( p_out->i_buffer == pi_res[i] );
+            assert( memcmp( p_out->p_buffer, pp_res[i], pi_res[i] ) == 0 );
+            if( j == 0 )
+            {   /* other reference untouched */
+                assert( p_dup->i_buffer == i_data );
+                assert( memcmp( p_dup->p_buffer, p_data, i_data ) == 0 );
+            }
+            block_Release( p_out );
+        }
+    }
+}
+
 #define runtest(number, name, testfunction) \
     printf("\nTEST %d %s\n", number, name);\
     p_res[0] = test##number##_avcdata1;  rgi_res[0] = sizeof(test##number##_avcdata1);\
@@ -192,6 +226,12 @@ static void test_annexb()
     runtest(1, "mixed nal set", testannexbin);
     runtest(6, "startcode repeat / empty nal", testannexbin);
 
+    runtest(2, "SH single nal test", testannexbin_shared);
+    runtest(3, "SH single nal test, startcode 3", testannexbin_shared);
+    runtest(5, "SH 4 bytes prefixed nal only (4 prefix optz)", testannexbin_shared);
+    runtest(1, "SH mixed nal set", testannexbin_shared);
+    runtest(6, "SH startcode repeat / empty nal", testannexbin_shared);
+
     runtest(1, "IT mixed nal set", test_iterators);
     runtest(2, "IT single nal test", test_iterators);
     runtest(3, "IT single nal test, startcode 3", test_iterators);
@@ -208,9 +248,126 @@ static void test_annexb()
     test_iterators( NULL, 0, p_res, rgi_res );
 }
 
+/* Byte by byte forward callback, as reference for the ep3b scanners */
+static uint8_t *ep3b_to_rbsp_ref( uint8_t *p, uint8_t *end, void *priv, size_t i_count )
+{
+    unsigned *pi_prev = (unsigned *) priv;
+    for( size_t i=0; i<i_count; i++ )
+    {
+        if( ++p >= end )
+            return p;
+
+        *pi_prev = (*pi_prev << 1) | (!*p);
+
+        if( *p == 0x03 && ( p + 1 ) != end && (*pi_prev & 0x06) == 0x06 )
+        {
+            ++p;
+            *pi_prev = ((*pi_prev >> 1) << 1) | (!*p);
+        }
+    }
+    return p;
+}
+
+static void test_ep3b( void )
+{
+    static const uint8_t values[] = { 0x00, 0x00, 0x00, 0x03, 0x03, 0x01, 0x55 };
+    uint8_t buf[4096];
+    unsigned seed = 42;
+
+    printf("\nTEST ep3b\n");
+    for( unsigned round = 0; round < 64; round++ )
+    {
+        /* Dense then sparse escape sequences */
+        for( size_t i = 0; i < sizeof(buf); i++ )
+            buf[i] = ( round & 1 ) && ( rand_r( &seed ) % 32 )
+                   ? 0x55 : values[rand_r( &seed ) % ARRAY_SIZE(values)];
+
+        bs_t a, b;
+        unsigned i_prev_a = 0, i_prev_b = 0;
+        bs_init( &a, buf, sizeof(buf) );
+        a.p_fwpriv = &i_prev_a;
+        a.pf_forward = hxxx_bsfw_ep3b_to_rbsp;
+        bs_init( &b, buf, sizeof(buf) );
+        b.p_fwpriv = &i_prev_b;
+        b.pf_forward = ep3b_to_rbsp_ref;
+
+        while( !bs_eof( &b ) )
+        {
+            const unsigned i_skip = rand_r( &seed ) % (round * 64 + 1);
+            bs_skip( &a, i_skip );
+            bs_skip( &b, i_skip );
+            assert( a.p == b.p && a.i_left == b.i_left );
+            assert( bs_read( &a, 8 ) == bs_read( &b, 8 ) );
+        }
+        assert( bs_eof( &a ) );
+    }
+
+    /* Scanner boundaries */
+    memset( buf, 0x55, sizeof(buf) );
+    for( size_t i = 1; i < 64; i++ )
+    {
+        buf[i - 1] = 0x00;
+        buf[i] = 0x03;
+        assert( hxxx_ep3b_find( buf, &buf[64] ) == &buf[i] );
+        assert( hxxx_ep3b_find( buf, &buf[i] ) == NULL );
+        assert( hxxx_ep3b_find( &buf[i], &buf[64] ) == NULL );
+        buf[i - 1] = buf[i] = 0x55;
+    }
+}
+
+/* Converts random sets of NAL against a straightforward conversion */
+static void test_annexb_random( void )
+{
+    enum { NALS = 64 };
+    uint8_t *p_ab = malloc( NALS * 204 );
+    uint8_t *p_xvc[3];
+    size_t i_ab = 0, i_xvc[3] = { 0, 0, 0 };
+    unsigned seed = 42;
+
+    printf("\nTEST random nal sets\n");
+    assert( p_ab );
+    for( unsigned i = 0; i < 3; i++ )
+    {
+        p_xvc[i] = malloc( NALS * (200 + 4) );
+        assert( p_xvc[i] );
+    }
+
+    for( unsigned n = 0; n < NALS; n++ )
+    {
+        const size_t i_nal = rand_r( &seed ) % 200;
+        const uint8_t *p_sc = ( rand_r( &seed ) & 1 ) ? annexb_startcode4
+                                                     : annexb_startcode3;
+        const size_t i_sc = ( p_sc == annexb_startcode4 ) ? 4 : 3;
+
+        memcpy( &p_ab[i_ab], p_sc, i_sc );
+        i_ab += i_sc;
+        for( unsigned i = 0; i < 3; i++ )
+        {
+            const unsigned i_prefix = 1 << i;
+            for( unsigned j = 0; j < i_prefix; j++ )
+                p_xvc[i][i_xvc[i]++] = i_nal >> (8 * (i_prefix - 1 - j));
+        }
+        for( size_t j = 0; j < i_nal; j++ )
+        {
+            const uint8_t i_byte = 1 + rand_r( &seed ) % 255;
+            p_ab[i_ab++] = i_byte;
+            for( unsigned i = 0; i < 3; i++ )
+                p_xvc[i][i_xvc[i]++] = i_byte;
+        }
+    }
+
+    testannexbin( p_ab, i_ab, (const uint8_t **) p_xvc, i_xvc );
+
+    for( unsigned i = 0; i < 3; i++ )
+        free( p_xvc[i] );
+    free( p_ab );
+}
+
 int main( void )
 {
     test_annexb();
+    test_annexb_random();
+    test_ep3b();
 
     return 0;
 }
@@ -0,0 +1,172 @@
+/*****************************************************************************
+ * duplicate.c: duplicate stream output test
+ *****************************************************************************
+ * Copyright © 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_modules.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define CHANNELS 6
+#define SAMPLES  960 /* per block, 20 ms at 48 kHz */
+#define BLOCKS   100
+#define BLOCK_SIZE (SAMPLES * CHANNELS * 2)
+
+static int16_t sample(unsigned block, unsigned i, unsigned channel)
+{
+    return channel * 1000 + (block * SAMPLES + i) % 1000;
+}
+
+static uint8_t *load(const char *path, size_t *len)
+{
+    FILE *stream = fopen(path, "rb");
+    assert(stream != NULL);
+    assert(fseek(stream, 0, SEEK_END) == 0);
+
+    long size = ftell(stream);
+    assert(size > 0);
+    rewind(stream);
+
+    uint8_t *buf = malloc(size);
+    assert(buf != NULL);
+    assert(fread(buf, 1, size, stream) == (size_t)size);
+    fclose(stream);
+    *len = size;
+    return buf;
+}
+
+/* The WAV muxer reorders 6.0 channels in place: outputs sharing the same
+ * payload must still get the original samples */
+static void test_reorder(sout_instance_t *sout, const char *dir)
+{
+    char chain[512], wav[64], raw[64];
+    es_format_t fmt;
+
+    snprintf(wav, sizeof (wav), "%s/out.wav", dir);
+    snprintf(raw, sizeof (raw), "%s/out.raw", dir);
+    snprintf(chain, sizeof (chain), "duplicate{"
+             "dst=std{mux=wav,access=file,dst='%s'},"
+             "dst=std{mux=raw,access=file,dst='%s'}}", wav, raw);
+
+    es_format_Init(&fmt, AUDIO_ES, VLC_CODEC_S16L);
+    fmt.audio.i_rate = 48000;
+    fmt.audio.i_channels = CHANNELS;
+    fmt.audio.i_physical_channels = AOUT_CHANS_6_0;
+    fmt.audio.i_bitspersample = 16;
+    fmt.audio.i_blockalign = CHANNELS * 2;
+
+    sout_stream_t *stream = sout_StreamChainNew(sout, chain, NULL, NULL);
+    assert(stream != NULL);
+    sout_stream_id_sys_t *id = sout_StreamIdAdd(stream, &fmt);
+    assert(id != NULL);
+
+    for (unsigned b = 0; b < BLOCKS; b++)
+    {
+        block_t *block = block_Alloc(BLOCK_SIZE);
+        assert(block != NULL);
+        for (unsigned i = 0; i < SAMPLES; i++)
+            for (unsigned c = 0; c < CHANNELS; c++)
+                SetWLE(block->p_buffer + (i * CHANNELS + c) * 2,
+                       sample(b, i, c));
+        block->i_dts = block->i_pts = VLC_TS_0 + b * INT64_C(20000);
+        block->i_length = 20000;
+        block->i_nb_samples = SAMPLES;
+        sout_StreamIdSend(stream, id, block);
+    }
+
+    sout_StreamIdDel(stream, id);
+    sout_StreamChainDelete(stream, NULL);
+    es_format_Clean(&fmt);
+
+    /* The raw output is untouched */
+    size_t len;
+    uint8_t *buf = load(raw, &len);
+    assert(len > BLOCK_SIZE && len % BLOCK_SIZE == 0);
+    for (size_t i = 0; i < len / 2; i++)
+    {
+        unsigned s = i / CHANNELS;
+        assert(GetWLE(buf + i * 2) ==
+               (uint16_t)sample(s / SAMPLES, s % SAMPLES, i % CHANNELS));
+    }
+    free(buf);
+
+    /* The WAV output has the rear channels before the side ones */
+    buf = load(wav, &len);
+    assert(len > 68 + BLOCK_SIZE);
+    assert(!memcmp(buf + 60, "data", 4));
+    assert(GetWLE(buf + 68 + 2 * 2) == (uint16_t)sample(0, 0, 4));
+    assert(GetWLE(buf + 68 + 4 * 2) == (uint16_t)sample(0, 0, 2));
+    free(buf);
+
+    unlink(wav);
+    unlink(raw);
+}
+
+static const char *const argv[] = { "--sout-mux-caching=0", NULL };
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-duplicate-XXXXXX";
+    libvlc_instance_t *vlc;
+    sout_instance_t *sout;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+
+    if (!module_exists("duplicate") || !module_exists("standard")
+     || !module_exists("wav") || !module_exists("dummy")
+     || !module_exists("file"))
+    {
+        libvlc_release(vlc);
+        return 77;
+    }
+
+    sout = vlc_object_create(vlc->p_libvlc_int, sizeof (*sout));
+    assert(sout != NULL);
+    sout->psz_sout = NULL;
+    sout->i_out_pace_nocontrol = 0;
+    vlc_mutex_init(&sout->lock);
+    sout->p_stream = NULL;
+
+    assert(mkdtemp(dir) != NULL);
+    test_reorder(sout, dir);
+    rmdir(dir);
+
+    vlc_mutex_destroy(&sout->lock);
+    vlc_object_release(sout);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,276 @@
+/*****************************************************************************
+ * packager.c: HLS/DASH packager stream output test
+ *****************************************************************************
+ * Copyright © 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_modules.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define FRAME_SIZE   384 /* MPEG-1 Layer II, 128 kb/s, 48 kHz */
+#define FRAME_LENGTH INT64_C(24000)
+
+static char *load(const char *dir, const char *name)
+{
+    char path[256];
+
+    snprintf(path, sizeof (path), "%s/%s", dir, name);
+
+    FILE *stream = fopen(path, "rb");
+    if (stream == NULL)
+        return NULL;
+    assert(fseek(stream, 0, SEEK_END) == 0);
+
+    long len = ftell(stream);
+    assert(len >= 0);
+    rewind(stream);
+
+    char *buf = malloc(len + 1);
+    assert(buf != NULL);
+    assert(fread(buf, 1, len, stream) == (size_t)len);
+    buf[len] = '\0';
+    fclose(stream);
+    return buf;
+}
+
+static bool exists(const char *dir, const char *name)
+{
+    char path[256];
+
+    snprintf(path, sizeof (path), "%s/%s", dir, name);
+    return access(path, F_OK) == 0;
+}
+
+static unsigned count(const char *str, const char *needle)
+{
+    unsigned n = 0;
+
+    while ((str = strstr(str, needle)) != NULL)
+    {
+        str += strlen(needle);
+        n++;
+    }
+    return n;
+}
+
+static void clean(const char *dir)
+{
+    DIR *d = opendir(dir);
+    struct dirent *ent;
+
+    assert(d != NULL);
+    while ((ent = readdir(d)) != NULL)
+        if (ent->d_name[0] != '.')
+            unlinkat(dirfd(d), ent->d_name, 0);
+    closedir(d);
+}
+
+/* Packages two audio renditions of `frames` frames */
+static void package(sout_instance_t *sout, const char *dir, unsigned frames,
+                    unsigned numsegs)
+{
+    static const char *const names[] = { "hi", "lo" };
+    sout_stream_t *stream[2];
+    sout_stream_id_sys_t *id[2];
+    es_format_t fmt;
+
+    es_format_Init(&fmt, AUDIO_ES, VLC_CODEC_MPGA);
+    fmt.audio.i_rate = 48000;
+    fmt.audio.i_channels = 2;
+
+    for (unsigned i = 0; i < 2; i++)
+    {
+        char chain[512];
+
+        snprintf(chain, sizeof (chain), "packager{group=test,name=%s,"
+                 "dir='%s',seglen=1,numsegs=%u}", names[i], dir,
+                 numsegs);
+        stream[i] = sout_StreamChainNew(sout, chain, NULL, NULL);
+        assert(stream[i] != NULL);
+        id[i] = sout_StreamIdAdd(stream[i], &fmt);
+        assert(id[i] != NULL);
+    }
+
+    for (unsigned f = 0; f < frames; f++)
+        for (unsigned i = 0; i < 2; i++)
+        {
+            block_t *block = block_Alloc(FRAME_SIZE);
+            assert(block != NULL);
+            memset(block->p_buffer, 0, FRAME_SIZE);
+            block->i_dts = block->i_pts = VLC_TS_0 + f * FRAME_LENGTH;
+            block->i_length = FRAME_LENGTH;
+            assert(sout_StreamIdSend(stream[i], id[i], block)
+                   == VLC_SUCCESS);
+        }
+
+    for (unsigned i = 0; i < 2; i++)
+    {
+        sout_StreamIdDel(stream[i], id[i]);
+        sout_StreamChainDelete(stream[i], NULL);
+    }
+    es_format_Clean(&fmt);
+}
+
+/* A finished presentation lists all its segments */
+static void test_vod(sout_instance_t *sout, const char *dir)
+{
+    /* 1 s segments cut on the first frame after 1 s: 42 frames each */
+    const unsigned segments = 5;
+
+    package(sout, dir, 42 * segments, 0);
+
+    char *master = load(dir, "master.m3u8");
+    assert(master != NULL);
+    assert(!strncmp(master, "#EXTM3U\n", 8));
+    assert(strstr(master, "#EXT-X-INDEPENDENT-SEGMENTS\n") != NULL);
+    assert(count(master, "#EXT-X-STREAM-INF:BANDWIDTH=") == 2);
+    assert(strstr(master, "\nhi.m3u8\n") != NULL);
+    assert(strstr(master, "\nlo.m3u8\n") != NULL);
+    free(master);
+
+    char *variant = load(dir, "hi.m3u8");
+    assert(variant != NULL);
+    assert(strstr(variant, "#EXT-X-MEDIA-SEQUENCE:1\n") != NULL);
+    assert(strstr(variant, "#EXT-X-PLAYLIST-TYPE:VOD\n") != NULL);
+    assert(strstr(variant, "#EXT-X-TARGETDURATION:2\n") != NULL);
+    assert(strstr(variant, "#EXT-X-VERSION:3\n") != NULL);
+    assert(strstr(variant, "#EXTINF:1.008,\nhi-1.ts\n") != NULL);
+    assert(count(variant, "#EXTINF:") == segments);
+    assert(strstr(variant, "#EXT-X-ENDLIST\n") != NULL);
+    free(variant);
+
+    for (unsigned i = 1; i <= segments; i++)
+    {
+        char name[32];
+
+        snprintf(name, sizeof (name), "hi-%u.ts", i);
+        assert(exists(dir, name));
+        snprintf(name, sizeof (name), "lo-%u.ts", i);
+        assert(exists(dir, name));
+    }
+
+    char *mpd = load(dir, "manifest.mpd");
+    assert(mpd != NULL);
+    assert(strstr(mpd, "profiles=\"urn:mpeg:dash:profile:mp2t-simple:2011\"")
+           != NULL);
+    assert(strstr(mpd, "type=\"static\"") != NULL);
+    assert(strstr(mpd, " publishTime=\"") != NULL);
+    assert(strstr(mpd, "mimeType=\"video/mp2t\"") != NULL);
+    assert(strstr(mpd, "segmentAlignment=\"true\"") != NULL);
+    assert(count(mpd, "<Representation id=") == 2);
+    assert(strstr(mpd, "media=\"hi-$Number$.ts\" startNumber=\"1\"")
+           != NULL);
+    assert(count(mpd, "<S t=") == 2 * segments);
+    assert(strstr(mpd, "<S t=\"0\" d=\"90720\"/>") != NULL);
+    assert(strstr(mpd, "<S t=\"90720\" d=\"90720\"/>") != NULL);
+    free(mpd);
+
+    clean(dir);
+}
+
+/* A sliding window keeps the timeline relative to the first segment */
+static void test_live(sout_instance_t *sout, const char *dir)
+{
+    const unsigned segments = 40, numsegs = 3;
+
+    package(sout, dir, 42 * segments, numsegs);
+
+    char *variant = load(dir, "lo.m3u8");
+    assert(variant != NULL);
+    assert(strstr(variant, "#EXT-X-PLAYLIST-TYPE") == NULL);
+    assert(count(variant, "#EXTINF:") == numsegs);
+    assert(strstr(variant, "#EXT-X-MEDIA-SEQUENCE:38\n") != NULL);
+    assert(strstr(variant, "\nlo-38.ts\n") != NULL);
+    free(variant);
+
+    /* Removed segments are deleted, the last ones once the output ends */
+    for (unsigned i = 1; i <= segments; i++)
+    {
+        char name[32];
+
+        snprintf(name, sizeof (name), "lo-%u.ts", i);
+        assert(exists(dir, name) == (i > segments - numsegs));
+    }
+
+    char *mpd = load(dir, "manifest.mpd");
+    assert(mpd != NULL);
+    assert(strstr(mpd, "type=\"static\"") != NULL);
+    assert(strstr(mpd, "startNumber=\"38\"") != NULL);
+    assert(count(mpd, "<S t=") == 2 * numsegs);
+    assert(strstr(mpd, "<S t=\"3356640\" d=\"90720\"/>") != NULL);
+    assert(strstr(mpd, "<S t=\"0\"") == NULL);
+    free(mpd);
+
+    clean(dir);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-packager-XXXXXX";
+    libvlc_instance_t *vlc;
+    sout_instance_t *sout;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    /* Segments are MPEG-TS */
+    if (!module_exists("mux_ts"))
+    {
+        libvlc_release(vlc);
+        return 77;
+    }
+
+    sout = vlc_object_create(vlc->p_libvlc_int, sizeof (*sout));
+    assert(sout != NULL);
+    sout->psz_sout = NULL;
+    sout->i_out_pace_nocontrol = 0;
+    vlc_mutex_init(&sout->lock);
+    sout->p_stream = NULL;
+
+    assert(mkdtemp(dir) != NULL);
+    test_vod(sout, dir);
+    test_live(sout, dir);
+    rmdir(dir);
+
+    vlc_mutex_destroy(&sout->lock);
+    vlc_object_release(sout);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*****************************************************************************
+ * rtp.c: RTP stream output send test
+ *****************************************************************************
+ * Copyright © 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define PAYLOAD_SIZE 1000 /* fits in one RTP packet */
+#define BURSTS       8
+#define CACHING      100 /* ms */
+#define INTERVAL     INT64_C(10000)
+
+/* Packets sharing one deadline, some bursts larger than a send batch */
+static unsigned burst_size(unsigned burst)
+{
+    static const unsigned sizes[] = { 1, 4, 40, 2, 33, 1, 64, 7 };
+    return sizes[burst % ARRAY_SIZE(sizes)];
+}
+
+static int receiver_open(int *port)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof (addr);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    assert(fd != -1);
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF,
+               &(int){ 1 << 20 }, sizeof (int));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof (addr))
+     || getsockname(fd, (struct sockaddr *)&addr, &addrlen))
+    {
+        close(fd);
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static void test_send(sout_instance_t *sout)
+{
+    char chain[128];
+    int port;
+    int fd = receiver_open(&port);
+    assert(fd != -1);
+
+    snprintf(chain, sizeof (chain), "rtp{dst=127.0.0.1,port-audio=%d,"
+             "caching=%d}", port, CACHING);
+
+    sout_stream_t *stream = sout_StreamChainNew(sout, chain, NULL, NULL);
+    assert(stream != NULL);
+
+    es_format_t fmt;
+    es_format_Init(&fmt, AUDIO_ES, VLC_CODEC_S16B);
+    fmt.audio.i_rate = 48000;
+    fmt.audio.i_channels = 2;
+
+    sout_stream_id_sys_t *id = sout_StreamIdAdd(stream, &fmt);
+    assert(id != NULL);
+
+    /* All packets are queued long before the first one is due, so that
+     * how they are batched does not depend on scheduling. */
+    const mtime_t start = mdate() + 20000;
+    unsigned count = 0;
+
+    for (unsigned b = 0; b < BURSTS; b++)
+        for (unsigned i = 0; i < burst_size(b); i++)
+        {
+            block_t *block = block_Alloc(PAYLOAD_SIZE);
+            assert(block != NULL);
+            memset(block->p_buffer, 0, PAYLOAD_SIZE);
+            memcpy(block->p_buffer, &count, sizeof (count));
+            memcpy(block->p_buffer + sizeof (count), &b, sizeof (b));
+            block->i_dts = block->i_pts = start + b * INTERVAL;
+            block->i_length = INTERVAL;
+            assert(sout_StreamIdSend(stream, id, block) == VLC_SUCCESS);
+            count++;
+        }
+
+    uint16_t seq = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        struct pollfd ufd = { .fd = fd, .events = POLLIN };
+        unsigned char buf[12 + PAYLOAD_SIZE + 1];
+        unsigned idx, b;
+
+        assert(poll(&ufd, 1, 2000) == 1);
+
+        ssize_t val = recv(fd, buf, sizeof (buf), 0);
+        mtime_t now = mdate();
+
+        assert(val == 12 + PAYLOAD_SIZE);
+        assert((buf[0] & 0xC0) == 0x80); /* RTP version 2 */
+
+        /* Consecutive sequence numbers, in queuing order */
+        if (i > 0)
+            assert(U16_AT(buf + 2) == (uint16_t)(seq + 1));
+        seq = U16_AT(buf + 2);
+
+        memcpy(&idx, buf + 12, sizeof (idx));
+        memcpy(&b, buf + 12 + sizeof (idx), sizeof (b));
+        assert(idx == i);
+        assert(b < BURSTS);
+
+        /* Never early */
+        assert(now >= start + b * INTERVAL + CACHING * INT64_C(1000));
+    }
+
+    sout_StreamIdDel(stream, id);
+    sout_StreamChainDelete(stream, NULL);
+    es_format_Clean(&fmt);
+    close(fd);
+}
+
+static const char *const argv[] = { "--mtu=1500", NULL };
+
+int main(void)
+{
+    libvlc_instance_t *vlc;
+    sout_instance_t *sout;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+
+    sout = vlc_object_create(vlc->p_libvlc_int, sizeof (*sout));
+    assert(sout != NULL);
+    sout->psz_sout = NULL;
+    sout->i_out_pace_nocontrol = 0;
+    vlc_mutex_init(&sout->lock);
+    sout->p_stream = NULL;
+
+    test_send(sout);
+
+    vlc_mutex_destroy(&sout->lock);
+    vlc_object_release(sout);
+    libvlc_release(vlc);
+    return 0;
+}
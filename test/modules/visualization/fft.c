@@ -0,0 +1,83 @@
+/*****************************************************************************
+ * fft.c: tests the visualization FFT against a naive DFT
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <vlc_common.h>
+#include "../modules/visualization/visual/fft.h"
+#include "../modules/visualization/visual/fft.c"
+
+static void test_size(unsigned int size_log)
+{
+    const unsigned int size = 1 << size_log;
+    sound_sample *input = malloc(size * sizeof (*input));
+    float *output = malloc((size / 2 + 1) * sizeof (*output));
+    fft_state *state = visual_fft_init(size_log);
+
+    assert(input != NULL && output != NULL && state != NULL);
+
+    for (unsigned int i = 0; i < size; i++)
+        input[i] = (rand() % 65536) - 32768;
+    fft_perform(input, output, state);
+
+    /* Compare to the DFT, with respect to its largest intensity */
+    double *ref = malloc((size / 2 + 1) * sizeof (*ref));
+    double max = 0.;
+    assert(ref != NULL);
+    for (unsigned int k = 0; k <= size / 2; k++)
+    {
+        double x_re = 0., x_im = 0.;
+        for (unsigned int n = 0; n < size; n++)
+        {
+            x_re += input[n] * cos(2. * M_PI * k * n / size);
+            x_im -= input[n] * sin(2. * M_PI * k * n / size);
+        }
+        ref[k] = x_re * x_re + x_im * x_im;
+        if (k == 0 || k == size / 2)
+            ref[k] /= 4;
+        if (ref[k] > max)
+            max = ref[k];
+    }
+    for (unsigned int k = 0; k <= size / 2; k++)
+        assert(fabs(output[k] - ref[k]) <= max * 1e-4);
+
+    /* Bands aggregate the maximum of their intensities */
+    const unsigned int xscale[] = { 0, 1, 3, size / 4, size / 2 + 1 };
+    float bands[ARRAY_SIZE(xscale) - 1];
+    fft_bands_max(output, xscale, ARRAY_SIZE(bands), bands);
+    for (unsigned int i = 0; i < ARRAY_SIZE(bands); i++)
+        for (unsigned int k = xscale[i]; k < xscale[i + 1]; k++)
+            assert(output[k] <= bands[i]);
+
+    fft_close(state);
+    free(ref);
+    free(output);
+    free(input);
+}
+
+int main(void)
+{
+    srand(0);
+    for (unsigned int size_log = 2; size_log <= 12; size_log++)
+        test_size(size_log);
+    return 0;
+}
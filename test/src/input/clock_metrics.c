@@ -0,0 +1,179 @@
+/*****************************************************************************
+ * clock_metrics.c: test for the clock synchronisation metrics
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <assert.h>
+#include <locale.h>
+#include <string.h>
+
+#define WIDTH  16
+#define HEIGHT 16
+#define FRAMES 25
+
+static uint32_t pixels[WIDTH * HEIGHT];
+
+static void *lock(void *data, void **planes)
+{
+    (void) data;
+    *planes = pixels;
+    return NULL;
+}
+
+static void on_event(const libvlc_event_t *event, void *data)
+{
+    (void) event;
+    vlc_sem_post(data);
+}
+
+static void write_input(const char *path)
+{
+    uint8_t frame[WIDTH * HEIGHT * 3 / 2];
+    FILE *stream = fopen(path, "wb");
+
+    assert(stream != NULL);
+    fprintf(stream, "YUV4MPEG2 W%u H%u F25:1 Ip A1:1 C420jpeg\n",
+            WIDTH, HEIGHT);
+    memset(frame, 128, sizeof (frame));
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        fputs("FRAME\n", stream);
+        assert(fwrite(frame, sizeof (frame), 1, stream) == 1);
+    }
+    fclose(stream);
+}
+
+/* Plays the input to the end, dumping the metrics to the given file */
+static void play(const char *in, const char *out)
+{
+    char opt[80];
+    snprintf(opt, sizeof (opt), "--clock-metrics-file=%s", out);
+
+    const char *argv[] = { "--no-audio", "--rawvid-fps=25", opt };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, in);
+    assert(media != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+
+    libvlc_video_set_callbacks(mp, lock, NULL, NULL, NULL);
+    libvlc_video_set_format(mp, "RV32", WIDTH, HEIGHT, WIDTH * 4);
+
+    vlc_sem_t done;
+    vlc_sem_init(&done, 0);
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    libvlc_event_attach(em, libvlc_MediaPlayerEndReached, on_event, &done);
+    libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, on_event,
+                        &done);
+
+    assert(libvlc_media_player_play(mp) == 0);
+    vlc_sem_wait(&done);
+
+    libvlc_media_clock_stats_t stats;
+    assert(libvlc_media_get_clock_stats(media, &stats));
+    assert(stats.f_resample_ratio == 1.f);
+    assert(stats.i_late_abuffers == 0 && stats.i_early_abuffers == 0);
+
+    libvlc_media_player_stop(mp);
+    libvlc_media_player_release(mp);
+    libvlc_media_release(media);
+    vlc_sem_destroy(&done);
+    libvlc_release(vlc);
+}
+
+static char *read_file(const char *path)
+{
+    static char buf[65536];
+    FILE *stream = fopen(path, "rt");
+
+    assert(stream != NULL);
+    size_t len = fread(buf, 1, sizeof (buf) - 1, stream);
+    fclose(stream);
+    buf[len] = '\0';
+    return buf;
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-clock-metrics-XXXXXX";
+    char in[64], csv[64], json[64];
+
+    test_init();
+    /* The dump must not use the decimal comma, if that locale exists */
+    setlocale(LC_NUMERIC, "de_DE.UTF-8");
+    assert(mkdtemp(dir) != NULL);
+    snprintf(in, sizeof (in), "%s/in.y4m", dir);
+    snprintf(csv, sizeof (csv), "%s/metrics.csv", dir);
+    snprintf(json, sizeof (json), "%s/metrics.json", dir);
+    write_input(in);
+
+    static const char *const modules[] = { "rawvid", "rawvideo", "vmem" };
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    for (size_t i = 0; i < ARRAY_SIZE(modules); i++)
+        if (!module_exists(modules[i]))
+        {
+            libvlc_release(vlc);
+            unlink(in);
+            rmdir(dir);
+            return 77;
+        }
+    libvlc_release(vlc);
+
+    /* CSV rows of successive inputs are appended after a single header */
+    play(in, csv);
+    play(in, csv);
+
+    const char *str = read_file(csv);
+    const char *header = "uri,date,clock_offset,";
+    assert(!strncmp(str, header, strlen(header)));
+    assert(strstr(str + 1, header) == NULL);
+
+    unsigned rows = 0;
+    for (const char *p = strchr(str, '\n'); p[1] != '\0';
+         p = strchr(p + 1, '\n'))
+    {
+        assert(!strncmp(p + 1, "\"file://", 8));
+        rows++;
+    }
+    printf("%u CSV rows\n", rows);
+    assert(rows >= 4);
+    assert(strstr(str, ",1.000000,") != NULL);
+
+    /* One JSON object per input */
+    play(in, json);
+    str = read_file(json);
+    assert(!strncmp(str, "{\"uri\":\"file://", 15));
+    assert(strstr(str, "\"samples\":[{\"date\":") != NULL);
+    assert(strstr(str, "\"resample_ratio\":1.000000,") != NULL);
+    assert(!strcmp(str + strlen(str) - 3, "]}\n"));
+
+    unlink(json);
+    unlink(csv);
+    unlink(in);
+    rmdir(dir);
+    return 0;
+}
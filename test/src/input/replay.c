@@ -0,0 +1,294 @@
+/*****************************************************************************
+ * replay.c: test for the replay of cached decoded pictures
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_atomic.h>
+#include <assert.h>
+#include <string.h>
+
+/* Large enough pictures that a few MiB only hold a couple of seconds */
+#define WIDTH  320
+#define HEIGHT 240
+#define FRAMES 100
+
+struct frames
+{
+    uint32_t pixels[WIDTH * HEIGHT];
+    uint8_t level[4 * FRAMES]; /**< background level of the pictures */
+    unsigned count;
+    vlc_sem_t step; /**< posted after some pictures are displayed */
+    atomic_uint replays; /**< replays started */
+    atomic_uint ends; /**< replays ended by a missing picture */
+};
+
+static void put_le32(FILE *stream, uint32_t value)
+{
+    uint8_t buf[4];
+
+    SetDWLE(buf, value);
+    assert(fwrite(buf, sizeof (buf), 1, stream) == 1);
+}
+
+static void put_le16(FILE *stream, uint16_t value)
+{
+    uint8_t buf[2];
+
+    SetWLE(buf, value);
+    assert(fwrite(buf, sizeof (buf), 1, stream) == 1);
+}
+
+static void put_fourcc(FILE *stream, const char *fourcc)
+{
+    assert(fwrite(fourcc, 4, 1, stream) == 1);
+}
+
+#define FRAME_SIZE (WIDTH * HEIGHT * 3 / 2)
+#define STRL_SIZE  (4 + 8 + 56 + 8 + 40)
+#define HDRL_SIZE  (4 + 8 + 56 + 8 + STRL_SIZE)
+#define MOVI_SIZE  (4 + FRAMES * (8 + FRAME_SIZE))
+#define IDX1_SIZE  (FRAMES * 16)
+
+/* Writes an indexed AVI file of raw I420 pictures, which can be seeked into
+ * accurately */
+static void write_input(const char *path)
+{
+    static uint8_t frame[FRAME_SIZE];
+    FILE *stream = fopen(path, "wb");
+
+    assert(stream != NULL);
+    put_fourcc(stream, "RIFF");
+    put_le32(stream, 4 + 8 + HDRL_SIZE + 8 + MOVI_SIZE + 8 + IDX1_SIZE);
+    put_fourcc(stream, "AVI ");
+
+    put_fourcc(stream, "LIST");
+    put_le32(stream, HDRL_SIZE);
+    put_fourcc(stream, "hdrl");
+    put_fourcc(stream, "avih");
+    put_le32(stream, 56);
+    put_le32(stream, 40000); /* 25 fps */
+    put_le32(stream, FRAME_SIZE * 25);
+    put_le32(stream, 0);
+    put_le32(stream, 0x10); /* has an index */
+    put_le32(stream, FRAMES);
+    put_le32(stream, 0);
+    put_le32(stream, 1); /* streams */
+    put_le32(stream, FRAME_SIZE);
+    put_le32(stream, WIDTH);
+    put_le32(stream, HEIGHT);
+    for (unsigned i = 0; i < 4; i++)
+        put_le32(stream, 0);
+
+    put_fourcc(stream, "LIST");
+    put_le32(stream, STRL_SIZE);
+    put_fourcc(stream, "strl");
+    put_fourcc(stream, "strh");
+    put_le32(stream, 56);
+    put_fourcc(stream, "vids");
+    put_fourcc(stream, "I420");
+    put_le32(stream, 0);
+    put_le16(stream, 0);
+    put_le16(stream, 0);
+    put_le32(stream, 0);
+    put_le32(stream, 1); /* scale */
+    put_le32(stream, 25); /* rate */
+    put_le32(stream, 0);
+    put_le32(stream, FRAMES);
+    put_le32(stream, FRAME_SIZE);
+    put_le32(stream, UINT32_MAX);
+    put_le32(stream, 0);
+    put_le16(stream, 0);
+    put_le16(stream, 0);
+    put_le16(stream, WIDTH);
+    put_le16(stream, HEIGHT);
+    put_fourcc(stream, "strf");
+    put_le32(stream, 40);
+    put_le32(stream, 40);
+    put_le32(stream, WIDTH);
+    put_le32(stream, HEIGHT);
+    put_le16(stream, 1);
+    put_le16(stream, 12);
+    put_fourcc(stream, "I420");
+    put_le32(stream, FRAME_SIZE);
+    for (unsigned i = 0; i < 4; i++)
+        put_le32(stream, 0);
+
+    put_fourcc(stream, "LIST");
+    put_le32(stream, MOVI_SIZE);
+    put_fourcc(stream, "movi");
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        memset(frame, 16 + i * 2, WIDTH * HEIGHT);
+        memset(frame + WIDTH * HEIGHT, 128, WIDTH * HEIGHT / 2);
+        put_fourcc(stream, "00dc");
+        put_le32(stream, FRAME_SIZE);
+        assert(fwrite(frame, sizeof (frame), 1, stream) == 1);
+    }
+
+    put_fourcc(stream, "idx1");
+    put_le32(stream, IDX1_SIZE);
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        put_fourcc(stream, "00dc");
+        put_le32(stream, 0x10); /* key frame */
+        put_le32(stream, 4 + i * (8 + FRAME_SIZE));
+        put_le32(stream, FRAME_SIZE);
+    }
+    fclose(stream);
+}
+
+static void *lock(void *data, void **planes)
+{
+    struct frames *frames = data;
+
+    *planes = frames->pixels;
+    return NULL;
+}
+
+static void display(void *data, void *id)
+{
+    struct frames *frames = data;
+
+    (void) id;
+    if (frames->count < ARRAY_SIZE(frames->level))
+        frames->level[frames->count] = frames->pixels[0] & 0xff;
+    frames->count++;
+    if (frames->count == 25 || frames->count == 75)
+        vlc_sem_post(&frames->step);
+}
+
+static void on_log(void *data, int level, const libvlc_log_t *ctx,
+                   const char *fmt, va_list ap)
+{
+    struct frames *frames = data;
+    char buf[64];
+
+    (void) level; (void) ctx;
+    vsnprintf(buf, sizeof (buf), fmt, ap);
+    if (!strncmp(buf, "replaying decoded pictures ", 27))
+        atomic_fetch_add(&frames->replays, 1);
+    if (!strncmp(buf, "end of replay ", 14))
+        atomic_fetch_add(&frames->ends, 1);
+}
+
+static void on_event(const libvlc_event_t *event, void *data)
+{
+    (void) event;
+    vlc_sem_post(data);
+}
+
+static struct frames frames;
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-replay-XXXXXX";
+    char in[64];
+    vlc_sem_t done;
+
+    test_init();
+    assert(mkdtemp(dir) != NULL);
+    snprintf(in, sizeof (in), "%s/in.avi", dir);
+    write_input(in);
+
+    const char *argv[] = {
+        "--no-audio", "--no-drop-late-frames", "--file-caching=100",
+        "--frame-cache-size=5",
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    static const char *const modules[] = {
+        "avi", "rawvideo", "vmem", "i420_rgb",
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(modules); i++)
+        if (!module_exists(modules[i]))
+        {
+            libvlc_release(vlc);
+            unlink(in);
+            rmdir(dir);
+            return 77;
+        }
+
+    atomic_init(&frames.replays, 0);
+    atomic_init(&frames.ends, 0);
+    libvlc_log_set(vlc, on_log, &frames);
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, in);
+    assert(media != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    vlc_sem_init(&frames.step, 0);
+    libvlc_video_set_callbacks(mp, lock, NULL, display, &frames);
+    libvlc_video_set_format(mp, "RV32", WIDTH, HEIGHT, WIDTH * 4);
+
+    vlc_sem_init(&done, 0);
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    libvlc_event_attach(em, libvlc_MediaPlayerEndReached, on_event, &done);
+    libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, on_event,
+                        &done);
+
+    assert(libvlc_media_player_play(mp) == 0);
+
+    /* Seek back a few pictures: those were decoded recently enough to be
+     * replayed from the cache, up to the last decoded one. The following
+     * ones are decoded again. */
+    vlc_sem_wait(&frames.step);
+    libvlc_media_player_set_time(mp, 800);
+
+    /* Seek back to the start: those pictures were evicted long ago */
+    vlc_sem_wait(&frames.step);
+    libvlc_media_player_set_time(mp, 0);
+
+    vlc_sem_wait(&done);
+    libvlc_media_player_stop(mp);
+    libvlc_media_player_release(mp);
+    vlc_sem_destroy(&done);
+    vlc_sem_destroy(&frames.step);
+    libvlc_log_unset(vlc);
+    libvlc_release(vlc);
+
+    printf("%u pictures displayed, %u replays, %u ended\n", frames.count,
+           atomic_load(&frames.replays), atomic_load(&frames.ends));
+    assert(frames.count <= ARRAY_SIZE(frames.level));
+    assert(atomic_load(&frames.replays) == 1);
+    assert(atomic_load(&frames.ends) == 1);
+
+    /* Both seeks went back, and no picture was shown twice in a row, be it
+     * replayed or decoded again */
+    unsigned rewinds = 0;
+    for (unsigned i = 1; i < frames.count; i++)
+    {
+        assert(frames.level[i] != frames.level[i - 1]);
+        if (frames.level[i] < frames.level[i - 1])
+            rewinds++;
+    }
+    assert(rewinds == 2);
+    assert(frames.count > FRAMES);
+
+    unlink(in);
+    rmdir(dir);
+    return 0;
+}
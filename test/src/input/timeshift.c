@@ -0,0 +1,182 @@
+/*****************************************************************************
+ * timeshift.c: test for seeking within the timeshift buffer
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <assert.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define WIDTH  16
+#define HEIGHT 16
+#define FRAMES 75
+
+struct frames
+{
+    uint32_t pixels[WIDTH * HEIGHT];
+    uint8_t level[4 * FRAMES]; /**< background level of the pictures */
+    unsigned count;
+    vlc_sem_t step; /**< posted after some pictures are displayed */
+};
+
+/* Writes the pictures in real time, as a live source would */
+static void *write_input(void *data)
+{
+    uint8_t frame[WIDTH * HEIGHT * 3 / 2];
+    FILE *stream = fopen(data, "wb");
+
+    assert(stream != NULL);
+    fprintf(stream, "YUV4MPEG2 W%u H%u F25:1 Ip A1:1 C420jpeg\n",
+            WIDTH, HEIGHT);
+
+    mtime_t start = mdate();
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        memset(frame, 16 + i * 2, WIDTH * HEIGHT);
+        memset(frame + WIDTH * HEIGHT, 128, WIDTH * HEIGHT / 2);
+        fputs("FRAME\n", stream);
+        assert(fwrite(frame, sizeof (frame), 1, stream) == 1);
+        fflush(stream);
+        mwait(start + (i + 1) * CLOCK_FREQ / 25);
+    }
+    fclose(stream);
+    return NULL;
+}
+
+static void *lock(void *data, void **planes)
+{
+    struct frames *frames = data;
+
+    *planes = frames->pixels;
+    return NULL;
+}
+
+static void display(void *data, void *id)
+{
+    struct frames *frames = data;
+
+    (void) id;
+    if (frames->count < ARRAY_SIZE(frames->level))
+        frames->level[frames->count] = frames->pixels[0] & 0xff;
+    frames->count++;
+    if (frames->count == 15 || frames->count == 60)
+        vlc_sem_post(&frames->step);
+}
+
+static void on_event(const libvlc_event_t *event, void *data)
+{
+    (void) event;
+    vlc_sem_post(data);
+}
+
+static struct frames frames;
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-timeshift-XXXXXX";
+    char in[64], mrl[80];
+    vlc_sem_t done, paused;
+    vlc_thread_t writer;
+
+    test_init();
+    assert(mkdtemp(dir) != NULL);
+    snprintf(in, sizeof (in), "%s/in.y4m", dir);
+    /* Without pace control, as live streams */
+    snprintf(mrl, sizeof (mrl), "stream://%s", in);
+    assert(mkfifo(in, 0600) == 0);
+
+    const char *argv[] = {
+        "--no-audio", "--no-drop-late-frames", "--rawvid-fps=25",
+        "--input-timeshift-size=16",
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    static const char *const modules[] = {
+        "rawvid", "rawvideo", "vmem", "i420_rgb",
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(modules); i++)
+        if (!module_exists(modules[i]))
+        {
+            libvlc_release(vlc);
+            unlink(in);
+            rmdir(dir);
+            return 77;
+        }
+
+    libvlc_media_t *media = libvlc_media_new_location(vlc, mrl);
+    assert(media != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    vlc_sem_init(&frames.step, 0);
+    libvlc_video_set_callbacks(mp, lock, NULL, display, &frames);
+    libvlc_video_set_format(mp, "RV32", WIDTH, HEIGHT, WIDTH * 4);
+
+    vlc_sem_init(&done, 0);
+    vlc_sem_init(&paused, 0);
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    libvlc_event_attach(em, libvlc_MediaPlayerPaused, on_event, &paused);
+    libvlc_event_attach(em, libvlc_MediaPlayerEndReached, on_event, &done);
+    libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, on_event,
+                        &done);
+
+    assert(vlc_clone(&writer, write_input, in, VLC_THREAD_PRIORITY_LOW) == 0);
+    assert(libvlc_media_player_play(mp) == 0);
+
+    /* Pausing starts the timeshift */
+    vlc_sem_wait(&frames.step);
+    libvlc_media_player_set_pause(mp, 1);
+    vlc_sem_wait(&paused);
+    libvlc_media_player_set_pause(mp, 0);
+
+    /* Seek back within the history, recorded since the pause */
+    vlc_sem_wait(&frames.step);
+    libvlc_media_player_set_time(mp, 1800);
+
+    vlc_sem_wait(&done);
+    vlc_join(writer, NULL);
+    libvlc_media_player_stop(mp);
+    libvlc_media_player_release(mp);
+    vlc_sem_destroy(&done);
+    vlc_sem_destroy(&paused);
+    vlc_sem_destroy(&frames.step);
+    libvlc_release(vlc);
+
+    printf("%u pictures displayed\n", frames.count);
+    assert(frames.count <= ARRAY_SIZE(frames.level));
+
+    /* Some pictures were displayed again */
+    unsigned rewinds = 0;
+    for (unsigned i = 1; i < frames.count; i++)
+        if (frames.level[i] < frames.level[i - 1])
+            rewinds++;
+    assert(rewinds == 1);
+    assert(frames.count > FRAMES);
+
+    unlink(in);
+    rmdir(dir);
+    return 0;
+}
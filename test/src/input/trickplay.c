@@ -0,0 +1,296 @@
+/*****************************************************************************
+ * trickplay.c: test for the keyframe-only playback at high rates
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+
+#define GOPS     20
+#define GOP_SIZE 5 /* one I picture, then B pictures */
+
+struct bits
+{
+    uint8_t buf[16];
+    unsigned pos;
+};
+
+static void put_bits(struct bits *b, uint32_t value, unsigned n)
+{
+    while (n-- > 0)
+    {
+        if (value & (UINT32_C(1) << n))
+            b->buf[b->pos / 8] |= 0x80 >> (b->pos % 8);
+        b->pos++;
+    }
+}
+
+static void put_start_code(FILE *stream, uint8_t code, struct bits *b)
+{
+    const uint8_t prefix[4] = { 0, 0, 1, code };
+
+    assert(fwrite(prefix, sizeof (prefix), 1, stream) == 1);
+    if (b != NULL)
+        assert(fwrite(b->buf, (b->pos + 7) / 8, 1, stream) == 1);
+}
+
+/* Writes an MPEG-1 video elementary stream, with empty slices */
+static void write_input(const char *path)
+{
+    static const uint8_t slice[8] = { 0x55, 0x55, 0x55, 0x55,
+                                      0x55, 0x55, 0x55, 0x55 };
+    FILE *stream = fopen(path, "wb");
+    struct bits b;
+
+    assert(stream != NULL);
+
+    memset(&b, 0, sizeof (b));
+    put_bits(&b, 16, 12); /* width */
+    put_bits(&b, 16, 12); /* height */
+    put_bits(&b, 1, 4); /* square pixels */
+    put_bits(&b, 3, 4); /* 25 fps */
+    put_bits(&b, 0x3FFFF, 18); /* variable bit rate */
+    put_bits(&b, 1, 1); /* marker */
+    put_bits(&b, 16, 10); /* VBV buffer size */
+    put_bits(&b, 0, 3); /* no constraints, default matrices */
+    put_start_code(stream, 0xB3, &b);
+
+    for (unsigned gop = 0; gop < GOPS; gop++)
+    {
+        memset(&b, 0, sizeof (b));
+        put_bits(&b, 0, 12); /* time code hours and minutes */
+        put_bits(&b, 1, 1); /* marker */
+        put_bits(&b, 0, 12); /* time code seconds and pictures */
+        put_bits(&b, 1, 1); /* closed GOP */
+        put_bits(&b, 0, 6);
+        put_start_code(stream, 0xB8, &b);
+
+        for (unsigned i = 0; i < GOP_SIZE; i++)
+        {
+            memset(&b, 0, sizeof (b));
+            put_bits(&b, i, 10); /* temporal reference */
+            put_bits(&b, i == 0 ? 1 : 3, 3); /* I or B picture */
+            put_bits(&b, 0xFFFF, 16); /* VBV delay */
+            if (i > 0)
+                put_bits(&b, 0x11, 8); /* motion vector codes */
+            put_bits(&b, 0, 1); /* no extra information */
+            put_start_code(stream, 0x00, &b);
+
+            put_start_code(stream, 0x01, NULL);
+            assert(fwrite(slice, sizeof (slice), 1, stream) == 1);
+        }
+    }
+    put_start_code(stream, 0xB7, NULL); /* sequence end */
+    fclose(stream);
+}
+
+static char *load(const char *path)
+{
+    FILE *stream = fopen(path, "rb");
+    assert(stream != NULL);
+
+    char *buf = malloc(1 << 20);
+    assert(buf != NULL);
+    size_t len = fread(buf, 1, (1 << 20) - 1, stream);
+    assert(len > 0 && len < (1 << 20) - 1);
+    buf[len] = '\0';
+    fclose(stream);
+    return buf;
+}
+
+static unsigned count(const char *buf, const char *str)
+{
+    unsigned n = 0;
+
+    while ((buf = strstr(buf, str)) != NULL)
+    {
+        buf += strlen(str);
+        n++;
+    }
+    return n;
+}
+
+static void on_event(const libvlc_event_t *event, void *data)
+{
+    (void) event;
+    vlc_sem_post(data);
+}
+
+/* Plays the input to the end, returns the number of decoded pictures */
+static unsigned run(libvlc_instance_t *vlc, const char *in,
+                    const char *option)
+{
+    vlc_sem_t done;
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, in);
+    assert(media != NULL);
+    if (option != NULL)
+        libvlc_media_add_option(media, option);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    vlc_sem_init(&done, 0);
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    libvlc_event_attach(em, libvlc_MediaPlayerPaused, on_event, &done);
+    libvlc_event_attach(em, libvlc_MediaPlayerEndReached, on_event, &done);
+    libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, on_event,
+                        &done);
+
+    assert(libvlc_media_player_play(mp) == 0);
+    vlc_sem_wait(&done);
+    if (libvlc_media_player_get_state(mp) == libvlc_Paused)
+    {
+        libvlc_media_player_set_pause(mp, 0);
+        vlc_sem_wait(&done);
+    }
+    assert(libvlc_media_player_get_state(mp) == libvlc_Ended);
+    libvlc_media_player_stop(mp); /* completes the statistics */
+
+    libvlc_media_stats_t stats;
+    media = libvlc_media_player_get_media(mp);
+    assert(media != NULL);
+    assert(libvlc_media_get_stats(media, &stats));
+    libvlc_media_release(media);
+    libvlc_media_player_release(mp);
+    vlc_sem_destroy(&done);
+    return stats.i_decoded_video;
+}
+
+/* Remuxes the elementary stream to MP4, which has a sync sample table */
+static void remux(const char *in, const char *out)
+{
+    char opt[128];
+
+    snprintf(opt, sizeof (opt), ":sout=#std{mux=mp4,access=file,dst='%s'}",
+             out);
+
+    const char *argv[] = { "--demux=mpgv" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+    run(vlc, in, opt);
+    libvlc_release(vlc);
+    assert(access(out, R_OK) == 0);
+}
+
+/* Plays the input with the dummy decoder, returns the number of dropped
+ * pictures */
+static unsigned play(const char *in, const char *demux, const char *out,
+                     const char *rate, const char *trickplay,
+                     unsigned *decoded)
+{
+    char opt[96];
+
+    snprintf(opt, sizeof (opt), "--latency-trace-file=%s", out);
+
+    /* Start paused, so that the rate applies before anything is decoded:
+     * the dummy decoder does not wait for any picture to be displayed */
+    const char *argv[] = {
+        "--no-audio", "--start-paused", demux, "--codec=ddummy", opt, rate,
+        trickplay,
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv)
+                                        - (trickplay == NULL), argv);
+    assert(vlc != NULL);
+    *decoded = run(vlc, in, NULL);
+    libvlc_release(vlc); /* completes the trace */
+
+    char *trace = load(out);
+    unsigned dropped = count(trace, "\"name\":\"drop\"");
+
+    free(trace);
+    unlink(out);
+    return dropped;
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-trickplay-XXXXXX";
+    char in[64], mp4[64], out[64];
+
+    test_init();
+    assert(mkdtemp(dir) != NULL);
+    snprintf(in, sizeof (in), "%s/in.mpv", dir);
+    snprintf(mp4, sizeof (mp4), "%s/in.mp4", dir);
+    snprintf(out, sizeof (out), "%s/trace.json", dir);
+    write_input(in);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    if (!module_exists("mpgv") || !module_exists("mpegvideo")
+     || !module_exists("ddummy"))
+    {
+        libvlc_release(vlc);
+        unlink(in);
+        rmdir(dir);
+        return 77;
+    }
+    libvlc_release(vlc);
+
+    const unsigned b_pictures = GOPS * (GOP_SIZE - 1);
+    unsigned decoded;
+
+    /* Every picture is decoded by default, or below the trick play rate */
+    assert(play(in, "--demux=mpgv", out, "--rate=8", NULL, &decoded) == 0);
+    assert(play(in, "--demux=mpgv", out, "--rate=2", "--trickplay-rate=4",
+                &decoded) == 0);
+
+    /* Only the I pictures are decoded at or above the trick play rate, and
+     * the skipped ones are traced as dropped */
+    unsigned dropped = play(in, "--demux=mpgv", out, "--rate=8",
+                            "--trickplay-rate=4", &decoded);
+
+    printf("%u of %u B pictures dropped\n", dropped, b_pictures);
+    assert(dropped == b_pictures);
+
+    /* The MP4 demuxer only delivers the sync samples, which the muxer
+     * records at most every two seconds. The first samples are demuxed while
+     * buffering, before the initial rate applies. */
+    vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    /* The MP4 demuxer and muxer are both named after their source file */
+    bool has_mp4 = module_exists("mp4") && module_exists("standard")
+                && module_exists("file");
+    libvlc_release(vlc);
+
+    if (has_mp4)
+    {
+        unsigned all;
+
+        remux(in, mp4);
+        play(mp4, "--demux=mp4", out, "--rate=8", NULL, &all);
+        play(mp4, "--demux=mp4", out, "--rate=8", "--trickplay-rate=4",
+             &decoded);
+        printf("%u of %u MP4 samples decoded\n", decoded, all);
+        assert(all >= GOPS * GOP_SIZE - 1);
+        assert(decoded > 0 && decoded < all / 4);
+        unlink(mp4);
+    }
+
+    unlink(in);
+    rmdir(dir);
+    return 0;
+}
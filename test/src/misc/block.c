@@ -0,0 +1,174 @@
+/*****************************************************************************
+ * block.c test shared data blocks
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <assert.h>
+
+static const char payload[] = "0123456789abcdef";
+
+static block_t *Create( void )
+{
+    block_t *b = block_Alloc( sizeof(payload) );
+    assert( b != NULL );
+    memcpy( b->p_buffer, payload, sizeof(payload) );
+    b->i_pts = b->i_dts = 42;
+    b->i_flags = BLOCK_FLAG_TYPE_I;
+    return block_shared_Alloc( b );
+}
+
+static void test_share( void )
+{
+    block_t *a = Create();
+    assert( a != NULL );
+    assert( !block_IsShared( a ) );
+
+    block_t *b = block_Share( a );
+    assert( b != NULL );
+    assert( b->p_buffer == a->p_buffer );
+    assert( b->i_buffer == a->i_buffer );
+    assert( b->i_pts == 42 && b->i_dts == 42 );
+    assert( b->i_flags == BLOCK_FLAG_TYPE_I );
+    assert( block_IsShared( a ) && block_IsShared( b ) );
+
+    /* Properties and boundaries are per reference */
+    b->p_buffer += 4;
+    b->i_buffer -= 4;
+    b->i_pts = 0;
+    assert( a->i_pts == 42 && a->i_buffer == sizeof(payload) );
+
+    block_Release( a );
+    assert( !block_IsShared( b ) );
+    assert( !memcmp( b->p_buffer, payload + 4, sizeof(payload) - 4 ) );
+    block_Release( b );
+}
+
+static void test_realloc( void )
+{
+    block_t *a = Create();
+    block_t *b = block_Share( a );
+    assert( a != NULL && b != NULL );
+
+    /* Prepending must not write into the shared spare space */
+    b = block_Realloc( b, 2, b->i_buffer );
+    assert( b != NULL );
+    assert( !block_IsShared( a ) && !block_IsShared( b ) );
+    b->p_buffer[0] = 'x';
+    b->p_buffer[1] = 'y';
+    assert( !memcmp( b->p_buffer + 2, payload, sizeof(payload) ) );
+    assert( !memcmp( a->p_buffer, payload, sizeof(payload) ) );
+    block_Release( b );
+
+    /* Shrinking is done in place */
+    b = block_Share( a );
+    const uint8_t *p = b->p_buffer;
+    b = block_Realloc( b, 0, 4 );
+    assert( b != NULL && b->p_buffer == p && b->i_buffer == 4 );
+    block_Release( b );
+
+    /* The last reference owns the payload */
+    a = block_Realloc( a, 2, a->i_buffer );
+    assert( a != NULL );
+    assert( !memcmp( a->p_buffer + 2, payload, sizeof(payload) ) );
+    block_Release( a );
+}
+
+static void test_unshare( void )
+{
+    block_t *a = Create();
+    block_t *b = block_Share( a );
+    assert( a != NULL && b != NULL );
+
+    block_t *c = block_Unshare( b );
+    assert( c != NULL && c->p_buffer != a->p_buffer );
+    assert( c->i_pts == 42 );
+    c->p_buffer[0] = 'x';
+    assert( a->p_buffer[0] == '0' );
+    block_Release( c );
+
+    /* Not shared anymore: no copy */
+    c = block_Unshare( a );
+    assert( c == a );
+    block_Release( c );
+
+    /* Sharing a plain block duplicates it */
+    a = block_Alloc( 4 );
+    assert( a != NULL );
+    b = block_Share( a );
+    assert( b != NULL && b->p_buffer != a->p_buffer );
+    assert( !block_IsShared( a ) );
+    block_Release( b );
+    block_Release( a );
+}
+
+static void test_gather( void )
+{
+    block_t *a = Create();
+    assert( a != NULL );
+    assert( block_shared_Alloc( a ) == a ); /* Already shared */
+
+    /* Consecutive views are merged into the first one */
+    block_t *b = block_Share( a ), *c = block_Share( a );
+    assert( b != NULL && c != NULL );
+    b->i_buffer = 4;
+    b->i_length = 1;
+    c->p_buffer += 4;
+    c->i_buffer = 6;
+    c->i_length = 2;
+    c->i_pts = 0;
+    b->p_next = c;
+
+    block_t *g = block_ChainGather( b );
+    assert( g == b && g->p_next == NULL );
+    assert( g->p_buffer == a->p_buffer && g->i_buffer == 10 );
+    assert( g->i_pts == 42 && g->i_length == 3 );
+    block_Release( g );
+
+    /* Views with a gap must be copied */
+    b = block_Share( a );
+    c = block_Share( a );
+    assert( b != NULL && c != NULL );
+    b->i_buffer = 4;
+    c->p_buffer += 5;
+    c->i_buffer = 2;
+    b->p_next = c;
+    assert( block_shared_Gather( b ) == NULL && b->p_next == c );
+
+    g = block_ChainGather( b );
+    assert( g != NULL && g->p_next == NULL && g->i_buffer == 6 );
+    assert( !memcmp( g->p_buffer, payload, 4 ) );
+    assert( !memcmp( g->p_buffer + 4, payload + 5, 2 ) );
+    block_Release( g );
+    assert( !block_IsShared( a ) );
+    block_Release( a );
+}
+
+int main( void )
+{
+    test_share();
+    test_realloc();
+    test_unshare();
+    test_gather();
+    return 0;
+}
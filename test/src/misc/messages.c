@@ -0,0 +1,326 @@
+/*****************************************************************************
+ * messages.c: test for the asynchronous logging pipeline
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <assert.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define THREADS  4
+#define MESSAGES 100 /* per thread, fits in a ring */
+
+struct log_sink
+{
+    vlc_mutex_t lock;
+    vlc_sem_t *gate;
+    unsigned last[THREADS];
+    unsigned received;
+    unsigned rated;
+    unsigned dropped;
+    unsigned suppressed;
+};
+
+static void log_cb(void *data, int level, const libvlc_log_t *ctx,
+                   const char *fmt, va_list ap)
+{
+    struct log_sink *sink = data;
+    char buf[256];
+    unsigned thread, seq, n;
+
+    (void) level; (void) ctx;
+    vsnprintf(buf, sizeof (buf), fmt, ap);
+
+    if (sink->gate != NULL)
+    {   /* Stall the logger thread until the emitter is done */
+        vlc_sem_wait(sink->gate);
+        sink->gate = NULL;
+    }
+
+    vlc_mutex_lock(&sink->lock);
+    if (sscanf(buf, "thread %u message %u", &thread, &seq) == 2)
+    {
+        assert(thread < THREADS);
+        assert(seq == sink->last[thread] + 1); /* in order, no loss */
+        sink->last[thread] = seq;
+        sink->received++;
+    }
+    else if (sscanf(buf, "rate %u", &n) == 1)
+        sink->rated++;
+    else if (sscanf(buf, "%u log messages dropped", &n) == 1)
+        sink->dropped += n;
+    else if (sscanf(buf, "(%u similar messages suppressed)", &n) == 1)
+        sink->suppressed += n;
+    vlc_mutex_unlock(&sink->lock);
+}
+
+static void sink_init(struct log_sink *sink)
+{
+    vlc_mutex_init(&sink->lock);
+    sink->gate = NULL;
+    memset(sink->last, 0, sizeof (sink->last));
+    sink->received = sink->rated = 0;
+    sink->dropped = sink->suppressed = 0;
+}
+
+static libvlc_instance_t *create(const char *const *argv, int argc,
+                                 struct log_sink *sink)
+{
+    libvlc_instance_t *vlc = libvlc_new(argc, argv);
+
+    assert(vlc != NULL);
+    libvlc_log_set(vlc, log_cb, sink);
+    return vlc;
+}
+
+struct emitter
+{
+    vlc_object_t *obj;
+    unsigned id;
+};
+
+static void *emit(void *data)
+{
+    struct emitter *e = data;
+
+    for (unsigned i = 1; i <= MESSAGES; i++)
+        vlc_Log(e->obj, VLC_MSG_DBG, "test", __FILE__, __LINE__, __func__,
+                "thread %u message %u", e->id, i);
+    return NULL;
+}
+
+static void test_order(void)
+{
+    static const char *const argv[] = { "--log-async", "--log-rate-limit=0" };
+    struct log_sink sink;
+    struct emitter emitters[THREADS];
+    vlc_thread_t threads[THREADS];
+
+    sink_init(&sink);
+    libvlc_instance_t *vlc = create(argv, ARRAY_SIZE(argv), &sink);
+
+    for (unsigned i = 0; i < THREADS; i++)
+    {
+        emitters[i].obj = VLC_OBJECT(vlc->p_libvlc_int);
+        emitters[i].id = i;
+        assert(vlc_clone(&threads[i], emit, &emitters[i],
+                         VLC_THREAD_PRIORITY_LOW) == 0);
+    }
+    for (unsigned i = 0; i < THREADS; i++)
+        vlc_join(threads[i], NULL);
+
+    libvlc_log_unset(vlc); /* waits for pending messages */
+    assert(sink.received == THREADS * MESSAGES);
+    assert(sink.dropped == 0);
+    libvlc_release(vlc);
+    vlc_mutex_destroy(&sink.lock);
+}
+
+static void test_drop(void)
+{
+    static const char *const argv[] = { "--log-async", "--log-rate-limit=0" };
+    struct log_sink sink;
+    vlc_sem_t gate;
+    const unsigned count = 10000;
+
+    sink_init(&sink);
+    vlc_sem_init(&gate, 0);
+    libvlc_instance_t *vlc = create(argv, ARRAY_SIZE(argv), &sink);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    libvlc_log_unset(vlc);
+    sink.gate = &gate;
+    libvlc_log_set(vlc, log_cb, &sink);
+
+    for (unsigned i = 1; i <= count; i++)
+        vlc_Log(obj, VLC_MSG_DBG, "test", __FILE__, __LINE__, __func__,
+                "thread 0 message %u", i);
+    vlc_sem_post(&gate);
+
+    libvlc_log_unset(vlc);
+    /* The first messages got through, the others were dropped at once.
+     * The logger thread is stalled on the first message, so a few messages
+     * from libvlc_log_set() may still be queued ahead of those. */
+    assert(sink.received > 0 && sink.received < count);
+    assert(sink.dropped > 0);
+    assert(sink.received + sink.dropped == count);
+    printf("%u messages received, %u dropped\n", sink.received, sink.dropped);
+
+    libvlc_release(vlc);
+    vlc_sem_destroy(&gate);
+    vlc_mutex_destroy(&sink.lock);
+}
+
+static void emit_rated(vlc_object_t *obj, unsigned i)
+{
+    vlc_Log(obj, VLC_MSG_DBG, "test", __FILE__, __LINE__, __func__,
+            "rate %u", i);
+}
+
+static void test_rate_limit(void)
+{
+    static const char *const argv[] = { "--log-async", "--log-rate-limit=10" };
+    struct log_sink sink;
+
+    sink_init(&sink);
+    libvlc_instance_t *vlc = create(argv, ARRAY_SIZE(argv), &sink);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    /* Messages from the same site within the same second */
+    mtime_t deadline = (mdate() / CLOCK_FREQ + 1) * CLOCK_FREQ;
+
+    for (unsigned i = 0; i < 50; i++)
+        emit_rated(obj, i);
+
+    /* The suppressed messages are reported in the next second */
+    mwait(deadline + CLOCK_FREQ / 100);
+    emit_rated(obj, 50);
+
+    libvlc_log_unset(vlc);
+    /* At most one second boundary was crossed while emitting */
+    assert(sink.rated >= 11 && sink.rated <= 21);
+    assert(sink.rated + sink.suppressed == 51);
+    libvlc_release(vlc);
+    vlc_mutex_destroy(&sink.lock);
+}
+
+/* No rate limit unless requested */
+static void test_no_rate_limit(void)
+{
+    struct log_sink sink;
+
+    sink_init(&sink);
+    libvlc_instance_t *vlc = create(NULL, 0, &sink);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    for (unsigned i = 0; i < 100; i++)
+        emit_rated(obj, i);
+
+    libvlc_log_unset(vlc);
+    assert(sink.rated == 100);
+    assert(sink.suppressed == 0);
+    libvlc_release(vlc);
+    vlc_mutex_destroy(&sink.lock);
+}
+
+struct busy_emitter
+{
+    vlc_object_t *obj;
+    atomic_bool stop;
+};
+
+static void *emit_busy(void *data)
+{
+    struct busy_emitter *e = data;
+
+    while (!atomic_load(&e->stop))
+        vlc_Log(e->obj, VLC_MSG_DBG, "test", __FILE__, __LINE__, __func__,
+                "busy");
+    return NULL;
+}
+
+/* Flushing completes even though an emitter never stops */
+static void test_flush_busy(void)
+{
+    struct log_sink sink;
+    struct busy_emitter e;
+    vlc_thread_t th;
+
+    sink_init(&sink);
+    libvlc_instance_t *vlc = create(NULL, 0, &sink);
+
+    e.obj = VLC_OBJECT(vlc->p_libvlc_int);
+    atomic_init(&e.stop, false);
+    assert(vlc_clone(&th, emit_busy, &e, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    for (unsigned i = 0; i < 20; i++)
+    {
+        libvlc_log_unset(vlc);
+        libvlc_log_set(vlc, log_cb, &sink);
+    }
+
+    atomic_store(&e.stop, true);
+    vlc_join(th, NULL);
+    libvlc_log_unset(vlc);
+    libvlc_release(vlc);
+    vlc_mutex_destroy(&sink.lock);
+}
+
+static void slow_cb(void *data, int level, const libvlc_log_t *ctx,
+                    const char *fmt, va_list ap)
+{
+    FILE *stream = data;
+
+    (void) level; (void) ctx;
+    vfprintf(stream, fmt, ap);
+    fputc('\n', stream);
+    fflush(stream);
+}
+
+/* Measures the time spent by the emitting thread */
+static mtime_t bench(const char *arg)
+{
+    const char *argv[] = { "--log-rate-limit=0", arg };
+    FILE *stream = fopen("/dev/null", "w");
+    assert(stream != NULL);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+    libvlc_log_set(vlc, slow_cb, stream);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    mtime_t total = 0;
+
+    for (unsigned i = 0; i < 100; i++)
+    {
+        mtime_t start = mdate();
+        for (unsigned j = 0; j < 100; j++)
+            vlc_Log(obj, VLC_MSG_DBG, "test", __FILE__, __LINE__, __func__,
+                    "message %u of batch %u", j, i);
+        total += mdate() - start;
+        libvlc_log_unset(vlc);
+        libvlc_log_set(vlc, slow_cb, stream);
+    }
+
+    libvlc_release(vlc);
+    fclose(stream);
+    return total / 100;
+}
+
+int main(void)
+{
+    test_init();
+
+    test_order();
+    test_drop();
+    test_rate_limit();
+    test_no_rate_limit();
+    test_flush_busy();
+
+    mtime_t sync = bench("--no-log-async");
+    mtime_t async = bench("--log-async");
+    printf("100 messages emitted in %"PRId64" us (synchronous), "
+           "%"PRId64" us (asynchronous)\n", sync, async);
+    return 0;
+}
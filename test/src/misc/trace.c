@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * trace.c: test for the playback latency tracer
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <assert.h>
+#include <string.h>
+
+#define WIDTH  16
+#define HEIGHT 16
+#define FRAMES 25
+
+static void write_input(const char *path)
+{
+    uint8_t frame[WIDTH * HEIGHT * 3 / 2];
+    FILE *stream = fopen(path, "wb");
+
+    assert(stream != NULL);
+    fprintf(stream, "YUV4MPEG2 W%u H%u F50:1 Ip A1:1 C420jpeg\n",
+            WIDTH, HEIGHT);
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        memset(frame, i * 8, sizeof (frame));
+        fputs("FRAME\n", stream);
+        assert(fwrite(frame, sizeof (frame), 1, stream) == 1);
+    }
+    fclose(stream);
+}
+
+static char *load(const char *path)
+{
+    FILE *stream = fopen(path, "rb");
+    assert(stream != NULL);
+
+    char *buf = malloc(1 << 20);
+    assert(buf != NULL);
+    size_t len = fread(buf, 1, (1 << 20) - 1, stream);
+    assert(len > 0 && len < (1 << 20) - 1);
+    buf[len] = '\0';
+    fclose(stream);
+    return buf;
+}
+
+static unsigned count(const char *buf, const char *str)
+{
+    unsigned n = 0;
+
+    while ((buf = strstr(buf, str)) != NULL)
+    {
+        buf++;
+        n++;
+    }
+    return n;
+}
+
+static void on_event(const libvlc_event_t *event, void *data)
+{
+    (void) event;
+    vlc_sem_post(data);
+}
+
+static void play(libvlc_instance_t *vlc, const char *path)
+{
+    vlc_sem_t done;
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, path);
+    assert(media != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    vlc_sem_init(&done, 0);
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    libvlc_event_attach(em, libvlc_MediaPlayerEndReached, on_event, &done);
+    libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, on_event,
+                        &done);
+
+    assert(libvlc_media_player_play(mp) == 0);
+    vlc_sem_wait(&done);
+    libvlc_media_player_stop(mp);
+    libvlc_media_player_release(mp);
+    vlc_sem_destroy(&done);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-trace-XXXXXX";
+    char in[64], out[64], opt[96];
+
+    test_init();
+    assert(mkdtemp(dir) != NULL);
+    snprintf(in, sizeof (in), "%s/in.y4m", dir);
+    snprintf(out, sizeof (out), "%s/trace.json", dir);
+    snprintf(opt, sizeof (opt), "--latency-trace-file=%s", out);
+    write_input(in);
+
+    const char *argv[] = {
+        "--no-audio", "--vout=dummy", "--no-drop-late-frames",
+        "--rawvid-fps=50", "--dummy-chroma=I420", opt,
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    if (!module_exists("rawvid") || !module_exists("rawvideo")
+     || !module_exists("vdummy"))
+    {
+        libvlc_release(vlc);
+        unlink(out);
+        unlink(in);
+        rmdir(dir);
+        return 77;
+    }
+
+    play(vlc, in);
+    libvlc_release(vlc); /* completes the trace */
+
+    char *trace = load(out);
+    unsigned frames = count(trace, "\"name\":\"frame\"");
+
+    printf("%u frames traced\n", frames);
+    /* The trace file is a complete JSON object */
+    assert(!strncmp(trace, "{\"traceEvents\":[", 16));
+    assert(!strcmp(trace + strlen(trace) - 3, "]}\n"));
+    assert(count(trace, "{") == count(trace, "}"));
+    assert(count(trace, "[") == count(trace, "]"));
+
+    /* Every frame is displayed, or dropped */
+    assert(frames > 0);
+    assert(frames + count(trace, "\"name\":\"drop\"") <= FRAMES);
+    assert(count(trace, "\"name\":\"decode\"") >= frames);
+    assert(count(trace, "\"name\":\"display\"") == frames);
+    assert(count(trace, "\"ph\":\"M\"") == 1);
+
+    char summary[32];
+    snprintf(summary, sizeof (summary), "\"displayed\":%u,", frames);
+    assert(strstr(trace, summary) != NULL);
+    assert(strstr(trace, "\"codec\":\"I420\"") != NULL);
+
+    free(trace);
+    unlink(out);
+    unlink(in);
+    rmdir(dir);
+    return 0;
+}
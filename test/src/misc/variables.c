@@ -443,6 +443,108 @@ static void test_creation_and_type( libvlc_int_t *p_libvlc )
     assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOVAR );
 }
 
+static void test_inherit( libvlc_int_t *p_libvlc )
+{
+    vlc_object_t *child = vlc_object_create( p_libvlc, sizeof (*child) );
+    vlc_object_t *obj = vlc_object_create( child, sizeof (*obj) );
+    assert( child != NULL && obj != NULL );
+
+    /* Configuration value */
+    int64_t caching = config_GetInt( p_libvlc, "file-caching" );
+    assert( var_InheritInteger( obj, "file-caching" ) == caching );
+    assert( var_InheritInteger( obj, "file-caching" ) == caching );
+
+    config_PutInt( p_libvlc, "file-caching", caching + 1 );
+    assert( var_InheritInteger( obj, "file-caching" ) == caching + 1 );
+    config_PutInt( p_libvlc, "file-caching", caching );
+    assert( var_InheritInteger( obj, "file-caching" ) == caching );
+
+    /* Variables of the ancestors take precedence */
+    var_Create( child, "file-caching", VLC_VAR_INTEGER );
+    var_SetInteger( child, "file-caching", 42 );
+    assert( var_InheritInteger( obj, "file-caching" ) == 42 );
+    var_SetInteger( child, "file-caching", 43 );
+    assert( var_InheritInteger( obj, "file-caching" ) == 43 );
+    var_Create( obj, "file-caching", VLC_VAR_INTEGER );
+    assert( var_InheritInteger( obj, "file-caching" ) == 0 );
+    var_Destroy( obj, "file-caching" );
+    assert( var_InheritInteger( obj, "file-caching" ) == 43 );
+    var_Destroy( child, "file-caching" );
+    assert( var_InheritInteger( obj, "file-caching" ) == caching );
+
+    /* Strings are duplicated */
+    var_Create( p_libvlc, "bla", VLC_VAR_STRING );
+    var_SetString( p_libvlc, "bla", "foo" );
+    for( unsigned i = 0; i < 2; i++ )
+    {
+        char *str = var_InheritString( obj, "bla" );
+        assert( str != NULL && !strcmp( str, "foo" ) );
+        free( str );
+    }
+    var_SetString( p_libvlc, "bla", "bar" );
+    char *str = var_InheritString( obj, "bla" );
+    assert( str != NULL && !strcmp( str, "bar" ) );
+    free( str );
+    var_Destroy( p_libvlc, "bla" );
+
+    vlc_object_release( obj );
+    vlc_object_release( child );
+}
+
+#define BENCH_VARS  1000
+#define BENCH_RUNS  100000
+
+static void bench_lookups( libvlc_int_t *p_libvlc )
+{
+    vlc_object_t *child = vlc_object_create( p_libvlc, sizeof (*child) );
+    vlc_object_t *obj = vlc_object_create( child, sizeof (*obj) );
+    char name[16];
+    mtime_t start, get, inherit, invalidated;
+    int64_t sum = 0;
+
+    assert( child != NULL && obj != NULL );
+
+    for( unsigned i = 0; i < BENCH_VARS; i++ )
+    {
+        snprintf( name, sizeof (name), "bench-%u", i );
+        var_Create( p_libvlc, name, VLC_VAR_INTEGER );
+    }
+    var_Create( child, "bench", VLC_VAR_INTEGER );
+
+    start = mdate();
+    for( unsigned i = 0; i < BENCH_RUNS; i++ )
+        sum += var_GetInteger( p_libvlc, "bench-500" );
+    get = mdate() - start;
+
+    start = mdate();
+    for( unsigned i = 0; i < BENCH_RUNS; i++ )
+        sum += var_InheritInteger( obj, "file-caching" );
+    inherit = mdate() - start;
+
+    start = mdate();
+    for( unsigned i = 0; i < BENCH_RUNS; i++ )
+    {
+        var_SetInteger( child, "bench", i );
+        sum += var_InheritInteger( obj, "file-caching" );
+    }
+    invalidated = mdate() - start;
+
+    printf( "var_GetInteger() among %u variables: %"PRId64" ns\n"
+            "var_InheritInteger() from configuration: %"PRId64" ns cached, "
+            "%"PRId64" ns after a change\n", BENCH_VARS,
+            get * 1000 / BENCH_RUNS, inherit * 1000 / BENCH_RUNS,
+            invalidated * 1000 / BENCH_RUNS );
+    assert( sum != 0 );
+
+    for( unsigned i = 0; i < BENCH_VARS; i++ )
+    {
+        snprintf( name, sizeof (name), "bench-%u", i );
+        var_Destroy( p_libvlc, name );
+    }
+    vlc_object_release( obj );
+    vlc_object_release( child );
+}
+
 static void test_variables( libvlc_instance_t *p_vlc )
 {
     libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
@@ -480,6 +582,12 @@ static void test_variables( libvlc_instance_t *p_vlc )
 
     log( "Testing type at creation\n" );
     test_creation_and_type( p_libvlc );
+
+    log( "Testing inheritance\n" );
+    test_inherit( p_libvlc );
+
+    log( "Benchmarking lookups\n" );
+    bench_lookups( p_libvlc );
 }
 
 
@@ -0,0 +1,132 @@
+/*****************************************************************************
+ * cache.c: test for the plugins cache
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <assert.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define CACHE_PATH "../modules/plugins.dat"
+#define RUNS 20
+
+static int strcmpp(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Describes the module bank as a sorted list of strings */
+static char **bank_describe(size_t *countp)
+{
+    size_t count;
+    module_t **list = module_list_get(&count);
+    char **descv = malloc(count * sizeof (*descv));
+
+    assert(list != NULL && descv != NULL);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const module_t *m = list[i];
+
+        if (asprintf(&descv[i], "%s/%s/%d",
+                     module_get_capability(m) ? module_get_capability(m) : "",
+                     module_get_object(m), module_get_score(m)) == -1)
+            abort();
+    }
+    module_list_free(list);
+
+    qsort(descv, count, sizeof (*descv), strcmpp);
+    *countp = count;
+    return descv;
+}
+
+static void bank_free(char **descv, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        free(descv[i]);
+    free(descv);
+}
+
+/* Starts libvlc, and returns the average startup time in microseconds */
+static mtime_t startup(const char *arg, char ***descvp, size_t *countp,
+                       unsigned runs)
+{
+    const char *args[] = { arg };
+    mtime_t total = 0;
+
+    for (unsigned i = 0; i < runs; i++)
+    {
+        mtime_t start = mdate();
+        libvlc_instance_t *vlc = libvlc_new(arg != NULL, args);
+        total += mdate() - start;
+        assert(vlc != NULL);
+
+        if (i == 0)
+            *descvp = bank_describe(countp);
+        libvlc_release(vlc);
+    }
+    return total / runs;
+}
+
+static void check_same_bank(char **a, size_t na, char **b, size_t nb)
+{
+    assert(na == nb);
+    for (size_t i = 0; i < na; i++)
+        assert(!strcmp(a[i], b[i]));
+}
+
+int main(void)
+{
+    struct stat st;
+    char **ref, **descv;
+    size_t refc, count;
+
+    test_init();
+    alarm(30);
+
+    bool had_cache = stat(CACHE_PATH, &st) == 0;
+
+    startup("--reset-plugins-cache", &ref, &refc, 1);
+    if (stat(CACHE_PATH, &st) != 0)
+    {   /* no dynamic plug-ins, or read-only build tree */
+        bank_free(ref, refc);
+        return 77;
+    }
+
+    mtime_t cached = startup(NULL, &descv, &count, RUNS);
+    check_same_bank(ref, refc, descv, count);
+    bank_free(descv, count);
+
+    mtime_t scanned = startup("--no-plugins-cache", &descv, &count, 2);
+    check_same_bank(ref, refc, descv, count);
+    bank_free(descv, count);
+
+    printf("%zu modules, startup in %"PRId64" us with cache, "
+           "%"PRId64" us without\n", refc, cached, scanned);
+    bank_free(ref, refc);
+
+    if (!had_cache)
+        unlink(CACHE_PATH);
+    return 0;
+}
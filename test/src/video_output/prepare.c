@@ -0,0 +1,211 @@
+/*****************************************************************************
+ * prepare.c: test for the pictures filtered ahead of display
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <assert.h>
+#include <string.h>
+
+#define WIDTH  64
+#define HEIGHT 64
+#define FRAMES 25
+
+struct frames
+{
+    uint32_t pixels[WIDTH * HEIGHT];
+    uint32_t sum[4 * FRAMES]; /**< checksums of the displayed pictures */
+    uint8_t level[4 * FRAMES]; /**< background level of the pictures */
+    unsigned count;
+    vlc_sem_t *seek; /**< posted once some pictures are displayed */
+};
+
+/* Interlaced pictures, with distinct fields */
+static void write_input(const char *path)
+{
+    uint8_t frame[WIDTH * HEIGHT * 3 / 2];
+    FILE *stream = fopen(path, "wb");
+
+    assert(stream != NULL);
+    fprintf(stream, "YUV4MPEG2 W%u H%u F25:1 It A1:1 C420jpeg\n",
+            WIDTH, HEIGHT);
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        for (unsigned y = 0; y < HEIGHT; y++)
+            memset(frame + y * WIDTH, 16 + i * 8 + (y & 1) * 4, WIDTH);
+        memset(frame + WIDTH * HEIGHT, 128, WIDTH * HEIGHT / 2);
+        fputs("FRAME\n", stream);
+        assert(fwrite(frame, sizeof (frame), 1, stream) == 1);
+    }
+    fclose(stream);
+}
+
+static void *lock(void *data, void **planes)
+{
+    struct frames *frames = data;
+
+    *planes = frames->pixels;
+    return NULL;
+}
+
+static void display(void *data, void *id)
+{
+    struct frames *frames = data;
+    uint32_t sum = 0;
+
+    (void) id;
+    for (unsigned j = 0; j < WIDTH * HEIGHT; j++)
+        sum = (sum << 1 | sum >> 31) ^ frames->pixels[j];
+
+    if (frames->count < ARRAY_SIZE(frames->sum))
+    {
+        frames->sum[frames->count] = sum;
+        frames->level[frames->count] = frames->pixels[0] & 0xff;
+    }
+    if (++frames->count == 10 && frames->seek != NULL)
+        vlc_sem_post(frames->seek);
+}
+
+static void on_event(const libvlc_event_t *event, void *data)
+{
+    (void) event;
+    vlc_sem_post(data);
+}
+
+static void play(const char *path, unsigned depth, bool seek,
+                 struct frames *frames)
+{
+    char depthopt[32];
+    vlc_sem_t done, seekable;
+
+    snprintf(depthopt, sizeof (depthopt), "--vout-prepare-ahead=%u", depth);
+
+    const char *argv[] = {
+        "--no-audio", "--no-drop-late-frames", "--rawvid-fps=25",
+        "--deinterlace=1", "--deinterlace-mode=linear", depthopt,
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, path);
+    assert(media != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    memset(frames, 0, sizeof (*frames));
+    vlc_sem_init(&seekable, 0);
+    if (seek)
+        frames->seek = &seekable;
+    libvlc_video_set_callbacks(mp, lock, NULL, display, frames);
+    libvlc_video_set_format(mp, "RV32", WIDTH, HEIGHT, WIDTH * 4);
+
+    vlc_sem_init(&done, 0);
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    libvlc_event_attach(em, libvlc_MediaPlayerEndReached, on_event, &done);
+    libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, on_event,
+                        &done);
+
+    assert(libvlc_media_player_play(mp) == 0);
+    if (seek)
+    {
+        /* Flushes the pictures filtered ahead */
+        vlc_sem_wait(&seekable);
+        libvlc_media_player_set_position(mp, 0.f);
+    }
+    vlc_sem_wait(&done);
+    libvlc_media_player_stop(mp);
+    libvlc_media_player_release(mp);
+    vlc_sem_destroy(&done);
+    vlc_sem_destroy(&seekable);
+    libvlc_release(vlc);
+}
+
+static struct frames sync_frames, ahead_frames, seek_frames, deep_frames;
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-prepare-XXXXXX";
+    char in[64];
+
+    test_init();
+    assert(mkdtemp(dir) != NULL);
+    snprintf(in, sizeof (in), "%s/in.y4m", dir);
+    write_input(in);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    static const char *const modules[] = {
+        "rawvid", "rawvideo", "vmem", "i420_rgb", "deinterlace",
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(modules); i++)
+        if (!module_exists(modules[i]))
+        {
+            libvlc_release(vlc);
+            unlink(in);
+            rmdir(dir);
+            return 77;
+        }
+    libvlc_release(vlc);
+
+    play(in, 0, false, &sync_frames);
+    play(in, 3, false, &ahead_frames);
+    printf("%u pictures displayed, %u filtered ahead\n",
+           sync_frames.count, ahead_frames.count);
+
+    /* Both fields of (most) pictures are displayed */
+    assert(sync_frames.count > FRAMES);
+    assert(ahead_frames.count > FRAMES);
+    assert(ahead_frames.count <= ARRAY_SIZE(ahead_frames.sum));
+
+    /* The same pictures are displayed in order */
+    for (unsigned i = 0; i < ahead_frames.count; i++)
+    {
+        unsigned j = 0;
+
+        while (j < sync_frames.count
+            && sync_frames.sum[j] != ahead_frames.sum[i])
+            j++;
+        assert(j < sync_frames.count);
+        if (i > 0)
+            assert(ahead_frames.level[i] >= ahead_frames.level[i - 1]);
+    }
+
+    /* Seeking back flushes the pictures filtered ahead */
+    play(in, 3, true, &seek_frames);
+    printf("%u pictures displayed with a seek\n", seek_frames.count);
+    assert(seek_frames.count > FRAMES + 10);
+
+    /* Options are not range checked: the depth is clamped to the ring */
+    play(in, 64, true, &deep_frames);
+    printf("%u pictures displayed too far ahead\n", deep_frames.count);
+    assert(deep_frames.count > FRAMES + 10);
+    assert(deep_frames.count <= ARRAY_SIZE(deep_frames.sum));
+    for (unsigned i = 1; i < 10; i++)
+        assert(deep_frames.level[i] >= deep_frames.level[i - 1]);
+
+    unlink(in);
+    rmdir(dir);
+    return 0;
+}
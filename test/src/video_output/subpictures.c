@@ -0,0 +1,240 @@
+/*****************************************************************************
+ * subpictures.c: test for the subtitles rendered ahead of time
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+#include "../../../lib/media_player_internal.h"
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <assert.h>
+#include <string.h>
+
+#define WIDTH  320
+#define HEIGHT 240
+#define FRAMES 40
+
+struct frames
+{
+    uint32_t pixels[WIDTH * HEIGHT];
+    /* Frames are identified by their (converted) background level */
+    uint32_t sum[256]; /**< checksum of each displayed frame, or 0 */
+    bool subtitled[256];
+    unsigned ahead; /**< subtitles rendered ahead of time */
+};
+
+static void write_input(const char *path)
+{
+    uint8_t frame[WIDTH * HEIGHT * 3 / 2];
+    FILE *stream = fopen(path, "wb");
+
+    assert(stream != NULL);
+    fprintf(stream, "YUV4MPEG2 W%u H%u F25:1 Ip A1:1 C420jpeg\n",
+            WIDTH, HEIGHT);
+    for (unsigned i = 0; i < FRAMES; i++)
+    {
+        memset(frame, 16 + i * 4, WIDTH * HEIGHT);
+        memset(frame + WIDTH * HEIGHT, 128, WIDTH * HEIGHT / 2);
+        fputs("FRAME\n", stream);
+        assert(fwrite(frame, sizeof (frame), 1, stream) == 1);
+    }
+    fclose(stream);
+}
+
+static void write_subtitles(const char *path)
+{
+    FILE *stream = fopen(path, "wt");
+
+    assert(stream != NULL);
+    fputs("1\n00:00:00,400 --> 00:00:00,800\nFirst line\n\n"
+          "2\n00:00:00,800 --> 00:00:01,400\nSecond line\n\n", stream);
+    fclose(stream);
+}
+
+static void *lock(void *data, void **planes)
+{
+    struct frames *frames = data;
+
+    *planes = frames->pixels;
+    return NULL;
+}
+
+static void display(void *data, void *id)
+{
+    struct frames *frames = data;
+    uint32_t sum = 0;
+    bool subtitled = false;
+
+    (void) id;
+    unsigned i = frames->pixels[0] & 0xff;
+
+    for (unsigned j = 0; j < WIDTH * HEIGHT; j++)
+    {
+        sum = (sum << 1 | sum >> 31) ^ frames->pixels[j];
+        if (frames->pixels[j] != frames->pixels[0])
+            subtitled = true;
+    }
+    frames->sum[i] = sum | 1;
+    frames->subtitled[i] = subtitled;
+}
+
+/* Returns the number of subtitles rendered ahead by the (saved) video
+ * outputs of a media player */
+static unsigned count_ahead(libvlc_media_player_t *mp)
+{
+    vlc_list_t *vouts = vlc_list_children(mp);
+    unsigned count = 0;
+
+    assert(vouts != NULL);
+    for (int i = 0; i < vouts->i_count; i++)
+    {
+        vlc_object_t *vout = vouts->p_values[i].p_address;
+        if (strcmp(vout->obj.object_type, "video output"))
+            continue;
+
+        vlc_list_t *spus = vlc_list_children(vout);
+        assert(spus != NULL);
+        for (int j = 0; j < spus->i_count; j++)
+        {
+            vlc_object_t *spu = spus->p_values[j].p_address;
+            if (!strcmp(spu->obj.object_type, "subpicture"))
+                count += var_GetInteger(spu, "sub-rendered-ahead");
+        }
+        vlc_list_release(spus);
+    }
+    vlc_list_release(vouts);
+    return count;
+}
+
+static void on_event(const libvlc_event_t *event, void *data)
+{
+    (void) event;
+    vlc_sem_post(data);
+}
+
+static void play(const char *path, const char *sub, unsigned threads,
+                 struct frames *frames)
+{
+    char subopt[96], threadsopt[32];
+    vlc_sem_t done;
+
+    snprintf(subopt, sizeof (subopt), "--sub-file=%s", sub);
+    snprintf(threadsopt, sizeof (threadsopt), "--sub-render-threads=%u",
+             threads);
+
+    const char *argv[] = {
+        "--no-audio", "--no-drop-late-frames", "--rawvid-fps=25",
+        subopt, threadsopt,
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    memset(frames, 0, sizeof (*frames));
+
+    libvlc_media_t *media = libvlc_media_new_path(vlc, path);
+    assert(media != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    libvlc_video_set_callbacks(mp, lock, NULL, display, frames);
+    libvlc_video_set_format(mp, "RV32", WIDTH, HEIGHT, WIDTH * 4);
+
+    vlc_sem_init(&done, 0);
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    libvlc_event_attach(em, libvlc_MediaPlayerEndReached, on_event, &done);
+    libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, on_event,
+                        &done);
+
+    assert(libvlc_media_player_play(mp) == 0);
+    vlc_sem_wait(&done);
+    /* The video output is kept until the player is stopped */
+    frames->ahead = count_ahead(mp);
+    libvlc_media_player_stop(mp);
+    libvlc_media_player_release(mp);
+    vlc_sem_destroy(&done);
+    libvlc_release(vlc);
+}
+
+static struct frames sync_frames, ahead_frames;
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-test-subpictures-XXXXXX";
+    char in[64], sub[64];
+
+    test_init();
+    assert(mkdtemp(dir) != NULL);
+    snprintf(in, sizeof (in), "%s/in.y4m", dir);
+    snprintf(sub, sizeof (sub), "%s/in.srt", dir);
+    write_input(in);
+    write_subtitles(sub);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    static const char *const modules[] = {
+        "rawvid", "rawvideo", "vmem", "i420_rgb", "subtitle", "subsdec",
+        "freetype", "blend",
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(modules); i++)
+        if (!module_exists(modules[i]))
+        {
+            libvlc_release(vlc);
+            unlink(sub);
+            unlink(in);
+            rmdir(dir);
+            return 77;
+        }
+    libvlc_release(vlc);
+
+    play(in, sub, 0, &sync_frames);
+    play(in, sub, 2, &ahead_frames);
+
+    /* Subtitles rendered ahead of time are identical */
+    unsigned common = 0, subtitled = 0;
+
+    for (unsigned i = 0; i < 256; i++)
+    {
+        if (sync_frames.sum[i] == 0 || ahead_frames.sum[i] == 0)
+            continue;
+        assert(sync_frames.sum[i] == ahead_frames.sum[i]);
+        assert(sync_frames.subtitled[i] == ahead_frames.subtitled[i]);
+        common++;
+        if (ahead_frames.subtitled[i])
+            subtitled++;
+    }
+
+    printf("%u frames compared, %u subtitled, %u subtitles rendered ahead\n",
+           common, subtitled, ahead_frames.ahead);
+    assert(common > 0);
+    assert(subtitled > 0);
+    /* The subtitles are queued long before they are due, but the first
+     * one may come before the output configuration is known. */
+    assert(sync_frames.ahead == 0);
+    assert(ahead_frames.ahead > 0);
+
+    unlink(sub);
+    unlink(in);
+    rmdir(dir);
+    return 0;
+}